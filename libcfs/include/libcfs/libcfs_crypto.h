@@ -149,6 +149,8 @@ struct cfs_crypto_hash_desc*
 			     unsigned char *key, unsigned int key_len);
 
 /**    Update digest by part of data.
+ *     Pages may be queued and hashed together with the following ones, so
+ *     their data must not change until cfs_crypto_hash_final().
  *     @param desc	      hash descriptor
  *     @param page	      data page
  *     @param offset	    data offset
@@ -195,7 +197,8 @@ int cfs_crypto_register(void);
 void cfs_crypto_unregister(void);
 
 /**     Return hash speed in Mbytes per second for valid hash algorithm
- *      identifier. If test was unsuccessfull -1 would be return.
+ *      identifier, as measured on page vectors of a bulk RPC at module
+ *      load. If test was unsuccessfull -1 would be return.
  */
 int cfs_crypto_hash_speed(unsigned char hash_alg);
 #endif
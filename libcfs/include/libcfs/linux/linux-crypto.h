@@ -53,3 +53,8 @@ void cfs_crypto_crc32_pclmul_unregister(void);
  */
 int cfs_crypto_crc32c_pclmul_register(void);
 void cfs_crypto_crc32c_pclmul_unregister(void);
+
+/**
+ * Print the speeds measured at module load, for /proc/sys/lnet.
+ */
+int cfs_crypto_hash_speeds_print(char *buf, int len);
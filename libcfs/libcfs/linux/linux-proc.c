@@ -64,6 +64,7 @@
 # define DEBUG_SUBSYSTEM S_LNET
 
 #include <libcfs/libcfs.h>
+#include <libcfs/linux/linux-crypto.h>
 #include <asm/div64.h>
 #include "tracefile.h"
 
@@ -341,6 +342,37 @@ static int __proc_cpt_table(void *data, int write,
 }
 DECLARE_PROC_HANDLER(proc_cpt_table)
 
+static int __proc_crypto_hash_speeds(void *data, int write,
+				     loff_t pos, void *buffer, int nob)
+{
+	char *buf;
+	int   len = 512;
+	int   rc;
+
+	if (write)
+		return -EPERM;
+
+	LIBCFS_ALLOC(buf, len);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	rc = cfs_crypto_hash_speeds_print(buf, len);
+	if (rc < 0)
+		goto out;
+
+	if (pos >= rc) {
+		rc = 0;
+		goto out;
+	}
+
+	rc = cfs_trace_copyout_string(buffer, nob, buf + pos, NULL);
+ out:
+	LIBCFS_FREE(buf, len);
+	return rc;
+}
+
+DECLARE_PROC_HANDLER(proc_crypto_hash_speeds)
+
 static struct ctl_table lnet_table[] = {
 	/*
 	 * NB No .strategy entries have been provided since sysctl(8) prefers
@@ -414,6 +446,13 @@ static struct ctl_table lnet_table[] = {
 		.mode		= 0444,
 		.proc_handler	= &proc_cpt_table,
 	},
+	{
+		INIT_CTL_NAME
+		.procname	= "crypto_hash_speeds",
+		.maxlen		= 128,
+		.mode		= 0444,
+		.proc_handler	= &proc_crypto_hash_speeds,
+	},
 	{
 		INIT_CTL_NAME
 		.procname	= "upcall",
@@ -720,6 +720,9 @@ AC_CHECK_FUNCS([gethostbyname socket connect])
 # lnet/utils/debug.c
 AC_CHECK_HEADERS([linux/version.h])
 
+# lnet/ulnds/socklnd/poll.c
+AC_CHECK_HEADERS([sys/epoll.h])
+
 # lnet/utils/wirecheck.c
 AC_CHECK_FUNCS([strnlen])
 
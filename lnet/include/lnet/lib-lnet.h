@@ -410,6 +410,21 @@ lnet_msg_alloc (void)
 	return msg;
 }
 
+static inline lnet_msg_t *
+lnet_msg_alloc_locked(void)
+{
+	/* ALWAYS called with network lock held */
+	struct lnet_msg_container *msc = the_lnet.ln_msg_containers[0];
+	lnet_msg_t		  *msg;
+
+	LASSERT(LNET_CPT_NUMBER == 1);
+
+	msg = (lnet_msg_t *)lnet_freelist_alloc(&msc->msc_freelist);
+	if (msg != NULL)
+		memset(msg, 0, sizeof(*msg));
+	return msg;
+}
+
 static inline void
 lnet_msg_free_locked(lnet_msg_t *msg)
 {
@@ -520,6 +535,16 @@ lnet_msg_alloc(void)
         return (msg);
 }
 
+static inline lnet_msg_t *
+lnet_msg_alloc_locked(void)
+{
+	/* ALWAYS called with network lock held */
+	lnet_msg_t *msg;
+
+	LIBCFS_ALLOC_ATOMIC(msg, sizeof(*msg));
+	return msg;
+}
+
 static inline void
 lnet_msg_free(lnet_msg_t *msg)
 {
@@ -825,6 +850,8 @@ int lnet_parse (lnet_ni_t *ni, lnet_hdr_t *hdr,
                 lnet_nid_t fromnid, void *private, int rdma_req);
 void lnet_recv(lnet_ni_t *ni, void *private, lnet_msg_t *msg, int delayed,
                unsigned int offset, unsigned int mlen, unsigned int rlen);
+void lnet_ni_recv(lnet_ni_t *ni, void *private, lnet_msg_t *msg, int delayed,
+		  unsigned int offset, unsigned int mlen, unsigned int rlen);
 lnet_msg_t *lnet_create_reply_msg (lnet_ni_t *ni, lnet_msg_t *get_msg);
 void lnet_set_reply_msg_len(lnet_ni_t *ni, lnet_msg_t *msg, unsigned int len);
 void lnet_finalize(lnet_ni_t *ni, lnet_msg_t *msg, int rc);
@@ -841,6 +868,7 @@ void lnet_print_hdr (lnet_hdr_t * hdr);
 int lnet_fail_nid(lnet_nid_t nid, unsigned int threshold);
 
 void lnet_counters_get(lnet_counters_t *counters);
+void lnet_batch_counters_get(lnet_batch_counters_t *counters);
 void lnet_counters_reset(void);
 
 unsigned int lnet_iov_nob (unsigned int niov, struct iovec *iov);
@@ -964,6 +992,33 @@ void lnet_peer_tables_destroy(void);
 int lnet_peer_tables_create(void);
 void lnet_debug_peer(lnet_nid_t nid);
 
+int lnet_rail_add(lnet_nid_t primary, lnet_nid_t nid);
+int lnet_rail_del(lnet_nid_t nid);
+int lnet_rails_create(void);
+void lnet_rails_destroy(void);
+lnet_nid_t lnet_rail_primary_locked(lnet_nid_t nid);
+lnet_nid_t lnet_rail_primary(lnet_nid_t nid);
+int lnet_rail_healthy(lnet_rail_member_t *lrm, lnet_ni_t *ni,
+		      cfs_time_t now);
+lnet_nid_t lnet_rail_select_locked(lnet_nid_t nid);
+void lnet_rail_error_locked(lnet_nid_t nid);
+
+int lnet_batch_init(void);
+void lnet_batch_fini(void);
+lnet_msg_t *lnet_batch_txq_locked(lnet_msg_t *msg);
+void lnet_batch_pack(lnet_msg_t *msg);
+int lnet_parse_batch(lnet_ni_t *ni, lnet_msg_t *msg);
+int lnet_parse_rec(lnet_ni_t *ni, lnet_hdr_t *hdr, lnet_nid_t from_nid,
+		   lnet_batch_rec_t *rec);
+int lnet_batch_recv(lnet_ni_t *ni, void *private, lnet_msg_t *msg,
+		    unsigned int niov, struct iovec *iov, lnet_kiov_t *kiov,
+		    unsigned int offset, unsigned int mlen);
+void lnet_batch_rec_put(lnet_batch_rec_t *rec);
+void lnet_batch_finalize(lnet_msg_t *msg, int status);
+int lnet_batch_probe_locked(lnet_peer_t *lp);
+void lnet_batch_probe(lnet_peer_t *lp);
+void lnet_batch_prune(int shutdown);
+
 #ifndef __KERNEL__
 static inline int
 lnet_parse_int_tunable(int *value, char *name)
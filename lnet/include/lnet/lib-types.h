@@ -81,6 +81,7 @@ typedef enum {
         LNET_MSG_GET,
         LNET_MSG_REPLY,
         LNET_MSG_HELLO,
+        LNET_MSG_BATCH,
 } lnet_msg_type_t;
 
 /* The variant fields of the portals message header are aligned on an 8
@@ -118,6 +119,10 @@ typedef struct lnet_hello {
         __u32              type;
 } WIRE_ATTR lnet_hello_t;
 
+typedef struct lnet_batch {
+        __u32              count;               /* # messages packed */
+} WIRE_ATTR lnet_batch_t;
+
 typedef struct {
         lnet_nid_t          dest_nid;
         lnet_nid_t          src_nid;
@@ -132,9 +137,18 @@ typedef struct {
                 lnet_get_t   get;
                 lnet_reply_t reply;
                 lnet_hello_t hello;
+                lnet_batch_t batch;
         } msg;
 } WIRE_ATTR lnet_hdr_t;
 
+/* A BATCH message carries lnet_hdr_t::msg.batch.count small messages for
+ * the same peer in its payload, so they take one peer credit and one LND
+ * send between them.  Each one is its wire header followed by its payload,
+ * padded to an 8 byte boundary.  Only peers that set LNET_PING_FEAT_BATCH
+ * in their ping info are sent BATCHes. */
+#define LNET_BATCH_MAX_SIZE                 4096 /* max BATCH payload */
+#define LNET_BATCH_REC_SIZE(nob)            cfs_size_round(sizeof(lnet_hdr_t) + (nob))
+
 /* A HELLO message contains a magic number and protocol version
  * code in the header's dest_nid, the peer's NID in the src_nid, and
  * LNET_MSG_HELLO in the type field.  All other common fields are zero
@@ -205,6 +219,10 @@ typedef struct lnet_msg {
 	unsigned int		msg_rx_delayed:1;
 	/* ready for pending on RX delay list */
 	unsigned int		msg_rx_ready_delay:1;
+	/* carries a BATCH of other messages */
+	unsigned int		msg_batch:1;
+	/* unpacked from a received BATCH */
+	unsigned int		msg_rx_batched:1;
 
         unsigned int          msg_vmflush:1;      /* VM trying to free memory */
         unsigned int          msg_target_is_router:1; /* sending to a router */
@@ -450,9 +468,11 @@ typedef struct lnet_ni {
 #define LNET_PING_FEAT_INVAL		(0)		/* no feature */
 #define LNET_PING_FEAT_BASE		(1 << 0)	/* just a ping */
 #define LNET_PING_FEAT_NI_STATUS	(1 << 1)	/* return NI status */
+#define LNET_PING_FEAT_BATCH		(1 << 2)	/* accept BATCH */
 
 #define LNET_PING_FEAT_MASK		(LNET_PING_FEAT_BASE | \
-					 LNET_PING_FEAT_NI_STATUS)
+					 LNET_PING_FEAT_NI_STATUS | \
+					 LNET_PING_FEAT_BATCH)
 
 typedef struct {
 	__u32			pi_magic;
@@ -502,10 +522,56 @@ typedef struct lnet_peer {
 	int			lp_rtr_refcount;
 	/* returned RC ping features */
 	unsigned int		lp_ping_feats;
+	/* does the peer accept BATCH messages? (LNET_BATCH_*) */
+	int			lp_batch;
+	/* don't probe for BATCH support again before, after a failure */
+	cfs_time_t		lp_batch_retry;
 	cfs_list_t		lp_routes;	/* routers on this peer */
 	lnet_rc_data_t		*lp_rcd;	/* router checker state */
 } lnet_peer_t;
 
+/* lnet_peer_t::lp_batch */
+#define LNET_BATCH_UNKNOWN	0	/* not asked yet */
+#define LNET_BATCH_PROBING	1	/* ping in flight */
+#define LNET_BATCH_NO		2
+#define LNET_BATCH_YES		3
+
+/* a BATCH being sent or received */
+typedef struct lnet_batch_rec {
+	struct lnet_batch_buf	*br_buf;	/* buffer I'm in */
+	char			*br_payload;	/* my payload */
+} lnet_batch_rec_t;
+
+typedef struct lnet_batch_buf {
+	/* messages packed in a BATCH I send */
+	cfs_list_t		bb_msgs;
+	/* received: 1 + # messages not yet consumed */
+	cfs_atomic_t		bb_refcount;
+	int			bb_size;	/* bytes allocated */
+	int			bb_nrecs;	/* # bb_recs */
+	struct iovec		bb_iov;		/* the BATCH payload */
+	lnet_batch_rec_t	bb_recs[0];	/* received messages */
+} lnet_batch_buf_t;
+
+/* asking a peer whether it accepts BATCH messages */
+typedef struct {
+	/* chain on the_lnet.ln_batch_probes */
+	cfs_list_t		bp_list;
+	lnet_handle_md_t	bp_mdh;		/* ping buffer MD */
+	struct lnet_peer	*bp_peer;	/* reference to the peer */
+	cfs_time_t		bp_deadline;	/* give up on a reply then */
+	unsigned int		bp_unlinking:1;	/* unlink in progress */
+	unsigned int		bp_unlinked:1;	/* ready to free */
+	lnet_ping_info_t	bp_info;	/* ping buffer */
+} lnet_batch_probe_t;
+
+typedef struct {
+	__u64			tx_batches;	/* BATCHes sent */
+	__u64			tx_msgs;	/* messages sent in them */
+	__u64			rx_batches;	/* BATCHes received */
+	__u64			rx_msgs;	/* messages received in them */
+} lnet_batch_counters_t;
+
 /* peer hash size */
 #define LNET_PEER_HASH_BITS     9
 #define LNET_PEER_HASH_SIZE     (1 << LNET_PEER_HASH_BITS)
@@ -544,6 +610,32 @@ typedef struct {
         __u32                   lrn_net;        /* my net number */
 } lnet_remotenet_t;
 
+/* most NIDs one peer can be reached by as rails */
+#define LNET_MAX_RAILS			4
+/* seconds a rail is avoided after a failed send */
+#define LNET_RAIL_RECOVERY_DEFAULT	10
+
+struct lnet_rail_group;
+
+/* one NID of a multi-rail peer, with the health of the rail to it */
+typedef struct {
+	cfs_list_t		lrm_hashlist;	/* chain on ln_rail_hash */
+	struct lnet_rail_group	*lrm_group;	/* group of this rail */
+	lnet_nid_t		lrm_nid;
+	cfs_atomic_t		lrm_sends;	/* messages sent on this rail */
+	cfs_atomic_t		lrm_errors;	/* sends which failed */
+	cfs_time_t		lrm_error_time;	/* when the last one failed */
+} lnet_rail_member_t;
+
+/* NIDs of one peer on different local networks, used together */
+typedef struct lnet_rail_group {
+	cfs_list_t		lrg_list;	/* chain on ln_rails */
+	int			lrg_seq;	/* sequence for round-robin */
+	int			lrg_nmembers;
+	/* lrg_members[0] is the primary NID the peer is known by */
+	lnet_rail_member_t	lrg_members[LNET_MAX_RAILS];
+} lnet_rail_group_t;
+
 typedef struct {
         cfs_list_t rbp_bufs;             /* my free buffer pool */
         cfs_list_t rbp_msgs;             /* messages blocking for a buffer */
@@ -764,6 +856,22 @@ typedef struct
 	cfs_list_t			ln_routers;
 	/* validity stamp */
 	__u64				ln_routers_version;
+	/* multi-rail peers, changed under LNET_LOCK_EX */
+	cfs_list_t			ln_rails;
+	/* rails of ln_rails hashed by NID, LNET_PEER_HASH_SIZE chains */
+	cfs_list_t			*ln_rail_hash;
+	/* # rail groups on ln_rails */
+	int				ln_rail_count;
+	/* seconds a failed rail is avoided */
+	int				ln_rail_recovery;
+	/* largest BATCH to send, 0 to send every message on its own */
+	int				ln_coalesce_size;
+	/* percpt BATCH counters */
+	lnet_batch_counters_t		**ln_batch_counters;
+	/* BATCH support probes, changed under LNET_LOCK_EX */
+	cfs_list_t			ln_batch_probes;
+	/* BATCH support probes' event queue */
+	lnet_handle_eq_t		ln_batch_eqh;
 	/* percpt router buffer pools */
 	lnet_rtrbufpool_t		**ln_rtrpools;
 
@@ -67,6 +67,15 @@ static int rnet_htable_size = LNET_REMOTE_NETS_HASH_DEFAULT;
 CFS_MODULE_PARM(rnet_htable_size, "i", int, 0444,
 		"size of remote network hash table");
 
+static int rail_recovery = LNET_RAIL_RECOVERY_DEFAULT;
+CFS_MODULE_PARM(rail_recovery, "i", int, 0444,
+		"seconds a rail is not used after a failed send");
+
+static int coalesce_size;
+CFS_MODULE_PARM(coalesce_size, "i", int, 0444,
+		"max bytes of messages waiting for a peer credit to send "
+		"in one BATCH (0 to disable)");
+
 char *
 lnet_get_routes(void)
 {
@@ -284,6 +293,7 @@ void lnet_assert_wire_constants (void)
         CLASSERT (LNET_MSG_GET == 2);
         CLASSERT (LNET_MSG_REPLY == 3);
         CLASSERT (LNET_MSG_HELLO == 4);
+        CLASSERT (LNET_MSG_BATCH == 5);
 
         /* Checks for struct ptl_handle_wire_t */
         CLASSERT ((int)sizeof(lnet_handle_wire_t) == 16);
@@ -359,6 +369,10 @@ void lnet_assert_wire_constants (void)
         CLASSERT ((int)sizeof(((lnet_hdr_t *)0)->msg.hello.incarnation) == 8);
         CLASSERT ((int)offsetof(lnet_hdr_t, msg.hello.type) == 40);
         CLASSERT ((int)sizeof(((lnet_hdr_t *)0)->msg.hello.type) == 4);
+
+        /* Batch */
+        CLASSERT ((int)offsetof(lnet_hdr_t, msg.batch.count) == 32);
+        CLASSERT ((int)sizeof(((lnet_hdr_t *)0)->msg.batch.count) == 4);
 }
 
 lnd_t *
@@ -440,17 +454,40 @@ lnet_counters_get(lnet_counters_t *counters)
 }
 EXPORT_SYMBOL(lnet_counters_get);
 
+void
+lnet_batch_counters_get(lnet_batch_counters_t *counters)
+{
+	lnet_batch_counters_t	*ctr;
+	int			i;
+
+	memset(counters, 0, sizeof(*counters));
+
+	lnet_net_lock(LNET_LOCK_EX);
+
+	cfs_percpt_for_each(ctr, i, the_lnet.ln_batch_counters) {
+		counters->tx_batches += ctr->tx_batches;
+		counters->tx_msgs    += ctr->tx_msgs;
+		counters->rx_batches += ctr->rx_batches;
+		counters->rx_msgs    += ctr->rx_msgs;
+	}
+	lnet_net_unlock(LNET_LOCK_EX);
+}
+
 void
 lnet_counters_reset(void)
 {
-	lnet_counters_t *counters;
-	int		i;
+	lnet_counters_t		*counters;
+	lnet_batch_counters_t	*bc;
+	int			i;
 
 	lnet_net_lock(LNET_LOCK_EX);
 
 	cfs_percpt_for_each(counters, i, the_lnet.ln_counters)
 		memset(counters, 0, sizeof(lnet_counters_t));
 
+	cfs_percpt_for_each(bc, i, the_lnet.ln_batch_counters)
+		memset(bc, 0, sizeof(lnet_batch_counters_t));
+
 	lnet_net_unlock(LNET_LOCK_EX);
 }
 EXPORT_SYMBOL(lnet_counters_reset);
@@ -749,6 +786,7 @@ lnet_prepare(lnet_pid_t requested_pid)
 	CFS_INIT_LIST_HEAD(&the_lnet.ln_nis_cpt);
 	CFS_INIT_LIST_HEAD(&the_lnet.ln_nis_zombie);
 	CFS_INIT_LIST_HEAD(&the_lnet.ln_routers);
+	CFS_INIT_LIST_HEAD(&the_lnet.ln_rails);
 
 	rc = lnet_create_remote_nets_table();
 	if (rc != 0)
@@ -764,10 +802,22 @@ lnet_prepare(lnet_pid_t requested_pid)
 		goto failed;
 	}
 
+	the_lnet.ln_batch_counters = cfs_percpt_alloc(lnet_cpt_table(),
+						sizeof(lnet_batch_counters_t));
+	if (the_lnet.ln_batch_counters == NULL) {
+		CERROR("Failed to allocate BATCH counters for LNet\n");
+		rc = -ENOMEM;
+		goto failed;
+	}
+
 	rc = lnet_peer_tables_create();
 	if (rc != 0)
 		goto failed;
 
+	rc = lnet_rails_create();
+	if (rc != 0)
+		goto failed;
+
 	rc = lnet_msg_containers_create();
 	if (rc != 0)
 		goto failed;
@@ -837,12 +887,17 @@ lnet_unprepare (void)
 
 	lnet_msg_containers_destroy();
 	lnet_peer_tables_destroy();
+	lnet_rails_destroy();
 	lnet_rtrpools_free();
 
 	if (the_lnet.ln_counters != NULL) {
 		cfs_percpt_free(the_lnet.ln_counters);
 		the_lnet.ln_counters = NULL;
 	}
+	if (the_lnet.ln_batch_counters != NULL) {
+		cfs_percpt_free(the_lnet.ln_batch_counters);
+		the_lnet.ln_batch_counters = NULL;
+	}
 	lnet_destroy_remote_nets_table();
 
 	return 0;
@@ -1370,7 +1425,9 @@ LNetInit(void)
 	the_lnet.ln_refcount = 0;
 	the_lnet.ln_init = 1;
 	LNetInvalidateHandle(&the_lnet.ln_rc_eqh);
+	LNetInvalidateHandle(&the_lnet.ln_batch_eqh);
 	CFS_INIT_LIST_HEAD(&the_lnet.ln_lnds);
+	CFS_INIT_LIST_HEAD(&the_lnet.ln_batch_probes);
 	CFS_INIT_LIST_HEAD(&the_lnet.ln_rcd_zombie);
 	CFS_INIT_LIST_HEAD(&the_lnet.ln_rcd_deathrow);
 
@@ -1384,12 +1441,17 @@ LNetInit(void)
 		rnet_htable_size = LNET_REMOTE_NETS_HASH_MAX;
 	the_lnet.ln_remote_nets_hbits = max_t(int, 1,
 					   order_base_2(rnet_htable_size) - 1);
+	the_lnet.ln_rail_recovery = max(rail_recovery, 0);
+	the_lnet.ln_coalesce_size = coalesce_size;
 
         /* All LNDs apart from the LOLND are in separate modules.  They
          * register themselves when their module loads, and unregister
          * themselves when their module is unloaded. */
 #else
 	the_lnet.ln_remote_nets_hbits = 8;
+	the_lnet.ln_rail_recovery = LNET_RAIL_RECOVERY_DEFAULT;
+	lnet_parse_int_tunable(&the_lnet.ln_coalesce_size,
+			       "LNET_COALESCE_SIZE");
 
         /* Register LNDs
          * NB the order here determines default 'networks=' order */
@@ -1397,6 +1459,9 @@ LNetInit(void)
         LNET_REGISTER_ULND(the_tcplnd);
 # endif
 #endif
+	the_lnet.ln_coalesce_size = min(max(the_lnet.ln_coalesce_size, 0),
+					LNET_BATCH_MAX_SIZE);
+
         lnet_register_lnd(&the_lolnd);
         return 0;
 }
@@ -1499,13 +1564,19 @@ LNetNIInit(lnet_pid_t requested_pid)
         if (rc != 0)
                 goto failed3;
 
-        rc = lnet_router_checker_start();
+        rc = lnet_batch_init();
         if (rc != 0)
                 goto failed4;
 
+        rc = lnet_router_checker_start();
+        if (rc != 0)
+                goto failed5;
+
         lnet_proc_init();
         goto out;
 
+ failed5:
+        lnet_batch_fini();
  failed4:
         lnet_ping_target_fini();
  failed3:
@@ -1548,6 +1619,7 @@ LNetNIFini()
 
                 lnet_proc_fini();
                 lnet_router_checker_stop();
+                lnet_batch_fini();
                 lnet_ping_target_fini();
 
                 /* Teardown fns that use my own API functions BEFORE here */
@@ -1610,6 +1682,12 @@ LNetCtl(unsigned int cmd, void *arg)
                                       &data->ioc_net, &data->ioc_count,
 				      &data->ioc_nid, &data->ioc_flags,
 				      &data->ioc_priority);
+	case IOC_LIBCFS_ADD_RAIL:
+		return lnet_rail_add(data->ioc_nid, data->ioc_u64[0]);
+
+	case IOC_LIBCFS_DEL_RAIL:
+		return lnet_rail_del(data->ioc_nid);
+
         case IOC_LIBCFS_NOTIFY_ROUTER:
                 return lnet_notify(NULL, data->ioc_nid, data->ioc_flags,
                                    cfs_time_current() -
@@ -1766,7 +1844,7 @@ lnet_create_ping_info(void)
         pinfo->pi_nnis    = n;
         pinfo->pi_pid     = the_lnet.ln_pid;
         pinfo->pi_magic   = LNET_PROTO_PING_MAGIC;
-	pinfo->pi_features = LNET_PING_FEAT_NI_STATUS;
+	pinfo->pi_features = LNET_PING_FEAT_NI_STATUS | LNET_PING_FEAT_BATCH;
 
         for (i = 0; i < n; i++) {
                 lnet_ni_status_t *ns = &pinfo->pi_ni[i];
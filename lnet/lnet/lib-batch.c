@@ -0,0 +1,624 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 021110-1307, USA
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lnet/lnet/lib-batch.c
+ *
+ * Coalescing small messages for a peer into BATCH messages.
+ *
+ * Messages that wait on lnet_peer_t::lp_txq for a peer credit are packed
+ * into one BATCH when a credit comes back, so the lot costs one credit and
+ * one LND send; nothing is held back for a BATCH that would otherwise go
+ * out at once.  Peers are pinged first to check they understand BATCHes.
+ */
+
+#define DEBUG_SUBSYSTEM S_LNET
+
+#include <lnet/lib-lnet.h>
+
+/* seconds to wait for the REPLY to a BATCH probe */
+#define LNET_BATCH_PROBE_TIMEOUT	50
+/* seconds before probing a peer again when a probe got no answer */
+#define LNET_BATCH_PROBE_RETRY		60
+
+static lnet_batch_buf_t *
+lnet_batch_buf_alloc(int nrecs, int nob, int atomic)
+{
+	lnet_batch_buf_t *bb;
+	int		  size;
+
+	/* keep the packed headers 8 byte aligned */
+	size = cfs_size_round(offsetof(lnet_batch_buf_t, bb_recs[nrecs]));
+	if (atomic)
+		LIBCFS_ALLOC_ATOMIC(bb, size + nob);
+	else
+		LIBCFS_ALLOC(bb, size + nob);
+	if (bb == NULL)
+		return NULL;
+
+	CFS_INIT_LIST_HEAD(&bb->bb_msgs);
+	cfs_atomic_set(&bb->bb_refcount, 1);
+	bb->bb_size = size + nob;
+	bb->bb_nrecs = nrecs;
+	bb->bb_iov.iov_base = (char *)bb + size;
+	bb->bb_iov.iov_len = nob;
+	return bb;
+}
+
+static void
+lnet_batch_buf_put(lnet_batch_buf_t *bb)
+{
+	if (cfs_atomic_dec_and_test(&bb->bb_refcount))
+		LIBCFS_FREE(bb, bb->bb_size);
+}
+
+void
+lnet_batch_rec_put(lnet_batch_rec_t *rec)
+{
+	lnet_batch_buf_put(rec->br_buf);
+}
+
+static inline lnet_batch_buf_t *
+lnet_msg2batch(lnet_msg_t *msg)
+{
+	LASSERT(msg->msg_batch);
+	return container_of(msg->msg_iov, lnet_batch_buf_t, bb_iov);
+}
+
+static int
+lnet_batch_msg_fits(lnet_msg_t *msg, int space)
+{
+	/* a BATCH goes to the peer's LNet itself, so messages for another
+	 * process on the peer can't travel in it */
+	if (msg->msg_target.pid != LUSTRE_SRV_LNET_PID)
+		return 0;
+
+	/* leave the LND its optimized GET */
+	if (msg->msg_type == LNET_MSG_GET && !msg->msg_routing)
+		return 0;
+
+	/* lnet_post_send_locked() completes these */
+	if (msg->msg_md != NULL &&
+	    (msg->msg_md->md_flags & LNET_MD_FLAG_ABORTED) != 0)
+		return 0;
+
+	return LNET_BATCH_REC_SIZE(msg->msg_len) <= space;
+}
+
+/**
+ * Called with the peer's CPT lock held when a peer credit comes back and
+ * \a msg, just taken off the head of lp_txq, is about to be sent.
+ *
+ * \return a BATCH carrying \a msg and the messages queued behind it that
+ * fit, or \a msg itself if there is nothing to batch it with.
+ */
+lnet_msg_t *
+lnet_batch_txq_locked(lnet_msg_t *msg)
+{
+	lnet_peer_t	 *lp = msg->msg_txpeer;
+	lnet_batch_buf_t *bb;
+	lnet_msg_t	 *batch;
+	lnet_msg_t	 *tmp;
+	lnet_hdr_t	 *hdr;
+	int		  size = the_lnet.ln_coalesce_size;
+	int		  nob;
+	int		  n = 1;
+	int		  i;
+
+	if (size == 0 || lp->lp_batch != LNET_BATCH_YES ||
+	    !lnet_batch_msg_fits(msg, size))
+		return msg;
+
+	nob = LNET_BATCH_REC_SIZE(msg->msg_len);
+	cfs_list_for_each_entry(tmp, &lp->lp_txq, msg_list) {
+		if (!lnet_batch_msg_fits(tmp, size - nob))
+			break;
+		nob += LNET_BATCH_REC_SIZE(tmp->msg_len);
+		n++;
+	}
+
+	if (n == 1)
+		return msg;
+
+	batch = lnet_msg_alloc_locked();
+	if (batch == NULL)
+		return msg;
+
+	bb = lnet_batch_buf_alloc(0, nob, 1);
+	if (bb == NULL) {
+		lnet_msg_free_locked(batch);
+		return msg;
+	}
+
+	/* the messages give back their peer credits and the BATCH takes
+	 * one; they are packed once the network lock is dropped */
+	for (i = 0; i < n; i++) {
+		if (i == 0) {
+			tmp = msg;
+		} else {
+			tmp = cfs_list_entry(lp->lp_txq.next,
+					     lnet_msg_t, msg_list);
+			cfs_list_del(&tmp->msg_list);
+		}
+
+		LASSERT(tmp->msg_txpeer == lp);
+		LASSERT(tmp->msg_tx_delayed);
+		LASSERT(tmp->msg_peertxcredit);
+		LASSERT(!tmp->msg_txcredit);
+
+		tmp->msg_peertxcredit = 0;
+		lp->lp_txqnob -= tmp->msg_len + sizeof(lnet_hdr_t);
+		lp->lp_txcredits++;
+		cfs_list_add_tail(&tmp->msg_list, &bb->bb_msgs);
+	}
+
+	/* LNDs send it as a PUT, only its header says BATCH */
+	batch->msg_batch = 1;
+	batch->msg_type = LNET_MSG_PUT;
+	batch->msg_target.nid = lp->lp_nid;
+	batch->msg_target.pid = LUSTRE_SRV_LNET_PID;
+	batch->msg_len = nob;
+	batch->msg_niov = 1;
+	batch->msg_iov = &bb->bb_iov;
+	batch->msg_sending = 1;
+	batch->msg_tx_delayed = 1;
+
+	hdr = &batch->msg_hdr;
+	hdr->type = cpu_to_le32(LNET_MSG_BATCH);
+	hdr->dest_nid = cpu_to_le64(lp->lp_nid);
+	hdr->src_nid = cpu_to_le64(lp->lp_ni->ni_nid);
+	hdr->dest_pid = cpu_to_le32(LUSTRE_SRV_LNET_PID);
+	hdr->src_pid = cpu_to_le32(the_lnet.ln_pid);
+	hdr->payload_length = cpu_to_le32(nob);
+	hdr->msg.batch.count = cpu_to_le32(n);
+
+	lnet_msg_commit(batch, msg->msg_tx_cpt);
+
+	lnet_peer_addref_locked(lp);
+	batch->msg_txpeer = lp;
+	batch->msg_peertxcredit = 1;
+	lp->lp_txqnob += nob + sizeof(lnet_hdr_t);
+	lp->lp_txcredits--;
+
+	CDEBUG(D_NET, "BATCH of %d (%d bytes) to %s\n",
+	       n, nob, libcfs_nid2str(lp->lp_nid));
+	return batch;
+}
+
+/* Copy the messages a BATCH carries into its payload */
+void
+lnet_batch_pack(lnet_msg_t *msg)
+{
+	lnet_batch_buf_t *bb = lnet_msg2batch(msg);
+	char		 *buf = bb->bb_iov.iov_base;
+	lnet_msg_t	 *tmp;
+
+	cfs_list_for_each_entry(tmp, &bb->bb_msgs, msg_list) {
+		/* the header is already in wire byte order */
+		memcpy(buf, &tmp->msg_hdr, sizeof(lnet_hdr_t));
+
+		if (tmp->msg_len == 0)
+			;
+		else if (tmp->msg_iov != NULL)
+			lnet_copy_iov2flat(tmp->msg_len,
+					   buf + sizeof(lnet_hdr_t), 0,
+					   tmp->msg_niov, tmp->msg_iov,
+					   tmp->msg_offset, tmp->msg_len);
+		else
+			lnet_copy_kiov2flat(tmp->msg_len,
+					    buf + sizeof(lnet_hdr_t), 0,
+					    tmp->msg_niov, tmp->msg_kiov,
+					    tmp->msg_offset, tmp->msg_len);
+
+		buf += LNET_BATCH_REC_SIZE(tmp->msg_len);
+	}
+
+	LASSERT(buf == (char *)bb->bb_iov.iov_base + bb->bb_iov.iov_len);
+}
+
+int
+lnet_parse_batch(lnet_ni_t *ni, lnet_msg_t *msg)
+{
+	lnet_hdr_t	 *hdr = &msg->msg_hdr;
+	lnet_batch_buf_t *bb;
+
+	/* Convert batch fields to host byte order */
+	hdr->msg.batch.count = le32_to_cpu(hdr->msg.batch.count);
+
+	bb = lnet_batch_buf_alloc(hdr->msg.batch.count, msg->msg_len, 0);
+	if (bb == NULL) {
+		CNETERR("Dropping BATCH of %d from %s: out of memory\n",
+			hdr->msg.batch.count, libcfs_nid2str(msg->msg_from));
+		return ENOENT;	/* +ve: OK but no buffer */
+	}
+
+	msg->msg_batch = 1;
+	msg->msg_niov = 1;
+	msg->msg_iov = &bb->bb_iov;
+
+	lnet_ni_recv(ni, msg->msg_private, msg, 0,
+		     0, msg->msg_len, msg->msg_len);
+	return 0;
+}
+
+/* lnd_recv() for a message unpacked from a BATCH: \a private is its
+ * lnet_batch_rec_t */
+int
+lnet_batch_recv(lnet_ni_t *ni, void *private, lnet_msg_t *msg,
+		unsigned int niov, struct iovec *iov, lnet_kiov_t *kiov,
+		unsigned int offset, unsigned int mlen)
+{
+	lnet_batch_rec_t *rec = private;
+
+	if (mlen == 0)
+		;
+	else if (iov != NULL)
+		lnet_copy_flat2iov(niov, iov, offset,
+				   mlen, rec->br_payload, 0, mlen);
+	else
+		lnet_copy_flat2kiov(niov, kiov, offset,
+				    mlen, rec->br_payload, 0, mlen);
+
+	lnet_batch_rec_put(rec);
+	lnet_finalize(ni, msg, 0);
+	return 0;
+}
+
+static void
+lnet_batch_unpack(lnet_msg_t *msg, lnet_batch_buf_t *bb)
+{
+	lnet_ni_t	 *ni = msg->msg_rxpeer->lp_ni;
+	char		 *buf = bb->bb_iov.iov_base;
+	int		  left = bb->bb_iov.iov_len;
+	lnet_batch_rec_t *rec;
+	lnet_hdr_t	 *hdr;
+	int		  nob;
+	int		  rc;
+	int		  i;
+
+	/* check all of it before passing any of it on */
+	for (i = 0; i < bb->bb_nrecs; i++) {
+		if (left < (int)sizeof(lnet_hdr_t))
+			break;
+
+		hdr = (lnet_hdr_t *)buf;
+		nob = le32_to_cpu(hdr->payload_length);
+		if (nob < 0 || nob > LNET_BATCH_MAX_SIZE ||
+		    LNET_BATCH_REC_SIZE(nob) > left)
+			break;
+
+		bb->bb_recs[i].br_buf = bb;
+		bb->bb_recs[i].br_payload = buf + sizeof(lnet_hdr_t);
+		buf += LNET_BATCH_REC_SIZE(nob);
+		left -= LNET_BATCH_REC_SIZE(nob);
+	}
+
+	if (i < bb->bb_nrecs || left != 0) {
+		CERROR("%s: Dropping bad BATCH from %s: message %d of %d, "
+		       "%d bytes left\n", libcfs_nid2str(ni->ni_nid),
+		       libcfs_nid2str(msg->msg_from), i, bb->bb_nrecs, left);
+		return;
+	}
+
+	cfs_atomic_add(bb->bb_nrecs, &bb->bb_refcount);
+
+	for (i = 0; i < bb->bb_nrecs; i++) {
+		rec = &bb->bb_recs[i];
+		hdr = (lnet_hdr_t *)(rec->br_payload - sizeof(lnet_hdr_t));
+
+		rc = lnet_parse_rec(ni, hdr, msg->msg_from, rec);
+		if (rc < 0)
+			lnet_batch_rec_put(rec);
+	}
+}
+
+/* Called by lnet_finalize() for a BATCH: a sent one completes the messages
+ * it carries with its own status, a received one passes them on */
+void
+lnet_batch_finalize(lnet_msg_t *msg, int status)
+{
+	lnet_batch_buf_t *bb = lnet_msg2batch(msg);
+	lnet_msg_t	 *tmp;
+
+	if (msg->msg_sending) {
+		while (!cfs_list_empty(&bb->bb_msgs)) {
+			tmp = cfs_list_entry(bb->bb_msgs.next,
+					     lnet_msg_t, msg_list);
+			cfs_list_del(&tmp->msg_list);
+			lnet_finalize(tmp->msg_txpeer->lp_ni, tmp, status);
+		}
+	} else if (status == 0) {
+		lnet_batch_unpack(msg, bb);
+	}
+
+	msg->msg_niov = 0;
+	msg->msg_iov = NULL;
+	lnet_batch_buf_put(bb);
+}
+
+/**
+ * Called with the peer's CPT lock held when a message for \a lp has to
+ * wait for a peer credit, which is when BATCHes would help.
+ *
+ * \retval 1 if the caller must call lnet_batch_probe() on \a lp once the
+ * lock is dropped, to find out whether the peer accepts BATCHes.
+ */
+int
+lnet_batch_probe_locked(lnet_peer_t *lp)
+{
+	if (the_lnet.ln_coalesce_size == 0 ||
+	    lp->lp_batch != LNET_BATCH_UNKNOWN ||
+	    (lp->lp_batch_retry != 0 &&
+	     cfs_time_before(cfs_time_current(), lp->lp_batch_retry)))
+		return 0;
+
+	lp->lp_batch = LNET_BATCH_PROBING;
+	lnet_peer_addref_locked(lp); /* for lnet_batch_probe() */
+	return 1;
+}
+
+static int
+lnet_batch_probe_accepted(lnet_batch_probe_t *bp, int mlength)
+{
+	lnet_ping_info_t *info = &bp->bp_info;
+	__u32		  features = info->pi_features;
+
+	if (mlength < (int)offsetof(lnet_ping_info_t, pi_pid))
+		return 0;
+
+	if (info->pi_magic == __swab32(LNET_PROTO_PING_MAGIC))
+		__swab32s(&features);
+	else if (info->pi_magic != LNET_PROTO_PING_MAGIC)
+		return 0;
+
+	return (features & LNET_PING_FEAT_BATCH) != 0;
+}
+
+/* no answer from \a lp, ask it again later; called with its CPT lock held */
+static void
+lnet_batch_probe_failed_locked(lnet_peer_t *lp)
+{
+	lp->lp_batch = LNET_BATCH_UNKNOWN;
+	lp->lp_batch_retry = cfs_time_shift(LNET_BATCH_PROBE_RETRY);
+	CDEBUG(D_NET, "BATCH probe of %s failed, retry in %d seconds\n",
+	       libcfs_nid2str(lp->lp_nid), LNET_BATCH_PROBE_RETRY);
+}
+
+static void
+lnet_batch_probe_event(lnet_event_t *event)
+{
+	lnet_batch_probe_t *bp = event->md.user_ptr;
+	lnet_peer_t	   *lp = bp->bp_peer;
+	int		    batch = LNET_BATCH_NO;
+
+	if (event->type == LNET_EVENT_REPLY && event->status == 0 &&
+	    lnet_batch_probe_accepted(bp, event->mlength))
+		batch = LNET_BATCH_YES;
+
+	/* NB: it's called with holding lnet_res_lock, see
+	 * lnet_router_checker_event() about lock ordering */
+	lnet_net_lock(lp->lp_cpt);
+
+	/* anything but a good SEND is the answer: only a REPLY tells whether
+	 * the peer accepts BATCHes, a failure or an unlink before it means
+	 * asking again later */
+	if (lp->lp_batch == LNET_BATCH_PROBING &&
+	    (event->type != LNET_EVENT_SEND || event->status != 0)) {
+		if (event->type == LNET_EVENT_REPLY && event->status == 0) {
+			lp->lp_batch = batch;
+			lp->lp_batch_retry = 0;
+			CDEBUG(D_NET, "%s %s BATCH\n",
+			       libcfs_nid2str(lp->lp_nid),
+			       batch == LNET_BATCH_YES ?
+			       "accepts" : "doesn't accept");
+		} else {
+			lnet_batch_probe_failed_locked(lp);
+		}
+	}
+
+	if (event->unlinked)
+		bp->bp_unlinked = 1;
+
+	lnet_net_unlock(lp->lp_cpt);
+}
+
+/* Unlink probes which waited too long for their REPLY, or all of them on
+ * \a shutdown, and free the ones whose MD is gone.  Called every second by
+ * the router checker, so that deadlines hold when no other probe is sent */
+void
+lnet_batch_prune(int shutdown)
+{
+	lnet_batch_probe_t *bp;
+	lnet_batch_probe_t *tmp;
+	lnet_handle_md_t    mdh;
+	cfs_list_t	    head;
+	cfs_time_t	    now = cfs_time_current();
+	int		    empty;
+
+	/* the list only changes under the exclusive lock, don't take it
+	 * every second for nothing */
+	lnet_net_lock(0);
+	empty = cfs_list_empty(&the_lnet.ln_batch_probes);
+	lnet_net_unlock(0);
+	if (empty)
+		return;
+
+	CFS_INIT_LIST_HEAD(&head);
+
+	lnet_net_lock(LNET_LOCK_EX);
+ again:
+	cfs_list_for_each_entry_safe(bp, tmp, &the_lnet.ln_batch_probes,
+				     bp_list) {
+		if (bp->bp_unlinked) {
+			lnet_peer_decref_locked(bp->bp_peer);
+			cfs_list_move(&bp->bp_list, &head);
+			continue;
+		}
+
+		if (bp->bp_unlinking || LNetHandleIsInvalid(bp->bp_mdh) ||
+		    (!shutdown && cfs_time_before(now, bp->bp_deadline)))
+			continue;
+
+		/* the event callback takes the net lock */
+		bp->bp_unlinking = 1;
+		mdh = bp->bp_mdh;
+		lnet_net_unlock(LNET_LOCK_EX);
+
+		LNetMDUnlink(mdh);
+
+		lnet_net_lock(LNET_LOCK_EX);
+		goto again;
+	}
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	while (!cfs_list_empty(&head)) {
+		bp = cfs_list_entry(head.next, lnet_batch_probe_t, bp_list);
+		cfs_list_del(&bp->bp_list);
+		LIBCFS_FREE(bp, sizeof(*bp));
+	}
+}
+
+/* Ping \a lp to see whether it accepts BATCHes; consumes the reference
+ * lnet_batch_probe_locked() took on it */
+void
+lnet_batch_probe(lnet_peer_t *lp)
+{
+	lnet_process_id_t   id;
+	lnet_batch_probe_t *bp;
+	lnet_handle_md_t    mdh;
+	lnet_md_t	    md = {0};
+	int		    rc;
+
+	lnet_batch_prune(0);
+
+	LIBCFS_ALLOC(bp, sizeof(*bp));
+	if (bp != NULL) {
+		bp->bp_peer = lp;
+		bp->bp_deadline = cfs_time_shift(LNET_BATCH_PROBE_TIMEOUT);
+		LNetInvalidateHandle(&bp->bp_mdh);
+	}
+
+	lnet_net_lock(LNET_LOCK_EX);
+	md.eq_handle = the_lnet.ln_batch_eqh;
+	if (bp == NULL || LNetHandleIsInvalid(md.eq_handle)) {
+		/* out of memory or shutting down, ask again later */
+		if (lp->lp_batch == LNET_BATCH_PROBING)
+			lp->lp_batch = LNET_BATCH_UNKNOWN;
+		lnet_peer_decref_locked(lp);
+		lnet_net_unlock(LNET_LOCK_EX);
+
+		if (bp != NULL)
+			LIBCFS_FREE(bp, sizeof(*bp));
+		return;
+	}
+	cfs_list_add(&bp->bp_list, &the_lnet.ln_batch_probes);
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	md.start     = &bp->bp_info;
+	md.length    = sizeof(bp->bp_info);
+	md.threshold = 2; /* GET/REPLY */
+	md.max_size  = 0;
+	md.options   = LNET_MD_TRUNCATE;
+	md.user_ptr  = bp;
+
+	rc = LNetMDBind(md, LNET_UNLINK, &mdh);
+	if (rc != 0) {
+		CERROR("Can't bind BATCH probe MD for %s: %d\n",
+		       libcfs_nid2str(lp->lp_nid), rc);
+
+		lnet_net_lock(LNET_LOCK_EX);
+		if (lp->lp_batch == LNET_BATCH_PROBING)
+			lnet_batch_probe_failed_locked(lp);
+		bp->bp_unlinked = 1;
+		lnet_net_unlock(LNET_LOCK_EX);
+		return;
+	}
+
+	lnet_net_lock(LNET_LOCK_EX);
+	bp->bp_mdh = mdh;
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	id.nid = lp->lp_nid;
+	id.pid = LUSTRE_SRV_LNET_PID;
+	rc = LNetGet(LNET_NID_ANY, mdh, id, LNET_RESERVED_PORTAL,
+		     LNET_PROTO_PING_MATCHBITS, 0);
+	if (rc != 0) {
+		CNETERR("Can't send BATCH probe to %s: %d\n",
+			libcfs_nid2str(lp->lp_nid), rc);
+		LNetMDUnlink(mdh); /* the unlink event retries later */
+	}
+}
+
+int
+lnet_batch_init(void)
+{
+	int	rc;
+
+	/* the probes are only needed to send BATCHes; I always accept them */
+	if (the_lnet.ln_coalesce_size == 0)
+		return 0;
+
+	rc = LNetEQAlloc(0, lnet_batch_probe_event, &the_lnet.ln_batch_eqh);
+	if (rc != 0) {
+		CERROR("Can't allocate BATCH probe EQ: %d\n", rc);
+		return rc;
+	}
+
+	return 0;
+}
+
+void
+lnet_batch_fini(void)
+{
+	lnet_handle_eq_t eqh;
+	int		 i = 2;
+	int		 rc;
+
+	lnet_net_lock(LNET_LOCK_EX);
+	eqh = the_lnet.ln_batch_eqh;
+	LNetInvalidateHandle(&the_lnet.ln_batch_eqh);
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	if (LNetHandleIsInvalid(eqh))
+		return;
+
+	for (;;) {
+		lnet_batch_prune(1);
+
+		lnet_net_lock(LNET_LOCK_EX);
+		rc = cfs_list_empty(&the_lnet.ln_batch_probes);
+		lnet_net_unlock(LNET_LOCK_EX);
+		if (rc)
+			break;
+
+		i++;
+		CDEBUG(((i & (-i)) == i) ? D_WARNING : D_NET,
+		       "Waiting for BATCH probes to unlink\n");
+		cfs_pause(cfs_time_seconds(1) / 4);
+	}
+
+	rc = LNetEQFree(eqh);
+	LASSERT(rc == 0);
+}
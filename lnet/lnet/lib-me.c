@@ -51,7 +51,8 @@
  * \param match_id Specifies the match criteria for the process ID of
  * the requester. The constants LNET_PID_ANY and LNET_NID_ANY can be
  * used to wildcard either of the identifiers in the lnet_process_id_t
- * structure.
+ * structure. A NID of a peer with several rails is replaced by the
+ * primary NID of that peer, which is what incoming messages carry.
  * \param match_bits,ignore_bits Specify the match criteria to apply
  * to the match bits in the incoming request. The ignore bits are used
  * to mask out insignificant bits in the incoming match bits. The resulting
@@ -89,6 +90,9 @@ LNetMEAttach(unsigned int portal,
 	if ((int)portal >= the_lnet.ln_nportals)
 		return -EINVAL;
 
+	if (match_id.nid != LNET_NID_ANY)
+		match_id.nid = lnet_rail_primary(match_id.nid);
+
 	mtable = lnet_mt_of_attach(portal, match_id,
 				   match_bits, ignore_bits, pos);
 	if (mtable == NULL) /* can't match portal type */
@@ -162,6 +166,9 @@ LNetMEInsert(lnet_handle_me_t current_meh,
 	if (pos == LNET_INS_LOCAL)
 		return -EPERM;
 
+	if (match_id.nid != LNET_NID_ANY)
+		match_id.nid = lnet_rail_primary(match_id.nid);
+
 	new_me = lnet_me_alloc();
 	if (new_me == NULL)
 		return -ENOMEM;
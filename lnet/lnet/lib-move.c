@@ -636,8 +636,15 @@ lnet_ni_recv(lnet_ni_t *ni, void *private, lnet_msg_t *msg, int delayed,
                 }
         }
 
-        rc = (ni->ni_lnd->lnd_recv)(ni, private, msg, delayed,
-                                    niov, iov, kiov, offset, mlen, rlen);
+	if (msg != NULL && msg->msg_rx_batched) {
+		/* the payload is in the BATCH I received it in */
+		rc = lnet_batch_recv(ni, private, msg, niov, iov, kiov,
+				     offset, mlen);
+	} else {
+		rc = (ni->ni_lnd->lnd_recv)(ni, private, msg, delayed,
+					    niov, iov, kiov, offset,
+					    mlen, rlen);
+	}
         if (rc < 0)
                 lnet_finalize(ni, msg, rc);
 }
@@ -692,6 +699,9 @@ lnet_ni_send(lnet_ni_t *ni, lnet_msg_t *msg)
 	LASSERT (LNET_NETTYP(LNET_NIDNET(ni->ni_nid)) == LOLND ||
 		 (msg->msg_txcredit && msg->msg_peertxcredit));
 
+	if (msg->msg_batch)
+		lnet_batch_pack(msg);
+
 	rc = (ni->ni_lnd->lnd_send)(ni, priv, msg);
 	if (rc < 0)
 		lnet_finalize(ni, msg, rc);
@@ -705,6 +715,7 @@ lnet_ni_eager_recv(lnet_ni_t *ni, lnet_msg_t *msg)
 	LASSERT(!msg->msg_sending);
 	LASSERT(msg->msg_receiving);
 	LASSERT(!msg->msg_rx_ready_delay);
+	LASSERT(!msg->msg_rx_batched);
 	LASSERT(ni->ni_lnd->lnd_eager_recv != NULL);
 
 	msg->msg_rx_ready_delay = 1;
@@ -1060,6 +1071,8 @@ lnet_return_tx_credits_locked(lnet_msg_t *msg)
 			LASSERT(msg2->msg_txpeer == txpeer);
 			LASSERT(msg2->msg_tx_delayed);
 
+			/* take more of lp_txq with it if I can */
+			msg2 = lnet_batch_txq_locked(msg2);
                         (void) lnet_post_send_locked(msg2, 1);
                 }
         }
@@ -1239,6 +1252,8 @@ lnet_send(lnet_nid_t src_nid, lnet_msg_t *msg, lnet_nid_t rtr_nid)
 	struct lnet_peer	*lp;
 	int			cpt;
 	int			cpt2;
+	int			railed = 0;
+	int			probe;
 	int			rc;
 
 	/* NB: rtr_nid is set to LNET_NID_ANY for all current use-cases,
@@ -1262,6 +1277,28 @@ lnet_send(lnet_nid_t src_nid, lnet_msg_t *msg, lnet_nid_t rtr_nid)
 		return -ESHUTDOWN;
 	}
 
+	/* a peer with several rails: pick the one to use for this message,
+	 * the source NID is on the rail's network then */
+	if (!railed && !msg->msg_routing && rtr_nid == LNET_NID_ANY &&
+	    the_lnet.ln_rail_count > 0) {
+		railed = 1;
+		dst_nid = lnet_rail_select_locked(dst_nid);
+		if (dst_nid != msg->msg_target.nid) {
+			msg->msg_target.nid = dst_nid;
+			msg->msg_hdr.dest_nid = cpu_to_le64(dst_nid);
+			if (src_nid != LNET_NID_ANY &&
+			    LNET_NIDNET(src_nid) != LNET_NIDNET(dst_nid))
+				src_nid = LNET_NID_ANY;
+
+			cpt2 = lnet_cpt_of_nid_locked(dst_nid);
+			if (cpt2 != cpt) {
+				lnet_net_unlock(cpt);
+				cpt = cpt2;
+				goto again;
+			}
+		}
+	}
+
 	if (src_nid == LNET_NID_ANY) {
 		src_ni = NULL;
 	} else {
@@ -1404,8 +1441,16 @@ lnet_send(lnet_nid_t src_nid, lnet_msg_t *msg, lnet_nid_t rtr_nid)
         msg->msg_txpeer = lp;                   /* msg takes my ref on lp */
 
         rc = lnet_post_send_locked(msg, 0);
+	/* queued on lp_txq waiting for a peer credit: BATCHes might help.
+	 * The NI credit is only taken once the peer credit is granted, so a
+	 * message waiting for an NI credit has msg_txcredit set */
+	probe = rc == EAGAIN && !msg->msg_txcredit &&
+		lnet_batch_probe_locked(lp);
 	lnet_net_unlock(cpt);
 
+	if (probe)
+		lnet_batch_probe(lp);
+
 	if (rc == EHOSTUNREACH || rc == ECANCELED)
 		return -rc;
 
@@ -1416,14 +1461,18 @@ lnet_send(lnet_nid_t src_nid, lnet_msg_t *msg, lnet_nid_t rtr_nid)
 }
 
 static void
-lnet_drop_message(lnet_ni_t *ni, int cpt, void *private, unsigned int nob)
+lnet_drop_message(lnet_ni_t *ni, int cpt, void *private, unsigned int nob,
+		  int batched)
 {
 	lnet_net_lock(cpt);
 	the_lnet.ln_counters[cpt]->drop_count++;
 	the_lnet.ln_counters[cpt]->drop_length += nob;
 	lnet_net_unlock(cpt);
 
-	lnet_ni_recv(ni, private, NULL, 0, 0, 0, nob);
+	if (batched)
+		lnet_batch_rec_put(private);
+	else
+		lnet_ni_recv(ni, private, NULL, 0, 0, 0, nob);
 }
 
 static void
@@ -1465,7 +1514,9 @@ lnet_parse_put(lnet_ni_t *ni, lnet_msg_t *msg)
 	info.mi_roffset	= hdr->msg.put.offset;
 	info.mi_mbits	= hdr->msg.put.match_bits;
 
-	msg->msg_rx_ready_delay = ni->ni_lnd->lnd_eager_recv == NULL;
+	/* a batched PUT's payload stays in its BATCH while it waits */
+	msg->msg_rx_ready_delay = msg->msg_rx_batched ||
+				  ni->ni_lnd->lnd_eager_recv == NULL;
 
  again:
 	rc = lnet_ptl_match_md(&info, msg);
@@ -1545,7 +1596,13 @@ lnet_parse_get(lnet_ni_t *ni, lnet_msg_t *msg, int rdma_get)
                 return 0;
         }
 
-        lnet_ni_recv(ni, msg->msg_private, NULL, 0, 0, 0, 0);
+	if (msg->msg_rx_batched) {
+		lnet_batch_rec_put(msg->msg_private);
+		msg->msg_private = NULL;
+		msg->msg_rx_batched = 0;
+	} else {
+		lnet_ni_recv(ni, msg->msg_private, NULL, 0, 0, 0, 0);
+	}
         msg->msg_receiving = 0;
 
 	rc = lnet_send(ni->ni_nid, msg, LNET_NID_ANY);
@@ -1686,7 +1743,8 @@ lnet_parse_forward_locked(lnet_ni_t *ni, lnet_msg_t *msg)
 #ifdef __KERNEL__
 	if (msg->msg_rxpeer->lp_rtrcredits <= 0 ||
 	    lnet_msg2bufpool(msg)->rbp_credits <= 0) {
-		if (ni->ni_lnd->lnd_eager_recv == NULL) {
+		if (ni->ni_lnd->lnd_eager_recv == NULL ||
+		    msg->msg_rx_batched) {
 			msg->msg_rx_ready_delay = 1;
 		} else {
 			lnet_net_unlock(msg->msg_rx_cpt);
@@ -1717,6 +1775,8 @@ lnet_msgtyp2str (int type)
                 return ("REPLY");
         case LNET_MSG_HELLO:
                 return ("HELLO");
+        case LNET_MSG_BATCH:
+                return ("BATCH");
         default:
                 return ("<UNKNOWN>");
         }
@@ -1785,9 +1845,9 @@ lnet_print_hdr(lnet_hdr_t * hdr)
 
 }
 
-int
-lnet_parse(lnet_ni_t *ni, lnet_hdr_t *hdr, lnet_nid_t from_nid,
-	   void *private, int rdma_req)
+static int
+lnet_parse_msg(lnet_ni_t *ni, lnet_hdr_t *hdr, lnet_nid_t from_nid,
+	       void *private, int rdma_req, int batched)
 {
 	int		rc = 0;
 	int		cpt;
@@ -1836,6 +1896,22 @@ lnet_parse(lnet_ni_t *ni, lnet_hdr_t *hdr, lnet_nid_t from_nid,
                 }
                 break;
 
+	case LNET_MSG_BATCH:
+		/* BATCHes don't nest and aren't routed */
+		if (batched || !for_me ||
+		    payload_length > LNET_BATCH_MAX_SIZE ||
+		    le32_to_cpu(hdr->msg.batch.count) == 0 ||
+		    le32_to_cpu(hdr->msg.batch.count) >
+		    payload_length / sizeof(lnet_hdr_t)) {
+			CERROR("%s, src %s: bad BATCH of %d payload %d\n",
+			       libcfs_nid2str(from_nid),
+			       libcfs_nid2str(src_nid),
+			       le32_to_cpu(hdr->msg.batch.count),
+			       payload_length);
+			return -EPROTO;
+		}
+		break;
+
         default:
                 CERROR("%s, src %s: Bad message type 0x%x\n",
                        libcfs_nid2str(from_nid),
@@ -1924,6 +2000,7 @@ lnet_parse(lnet_ni_t *ni, lnet_hdr_t *hdr, lnet_nid_t from_nid,
 
         msg->msg_type = type;
         msg->msg_private = private;
+	msg->msg_rx_batched = batched;
         msg->msg_receiving = 1;
         msg->msg_len = msg->msg_wanted = payload_length;
         msg->msg_offset = 0;
@@ -1946,6 +2023,10 @@ lnet_parse(lnet_ni_t *ni, lnet_hdr_t *hdr, lnet_nid_t from_nid,
 	}
 
 	lnet_net_lock(cpt);
+	/* a peer with several rails is always known by its primary NID */
+	if (for_me && the_lnet.ln_rail_count > 0)
+		msg->msg_hdr.src_nid = lnet_rail_primary_locked(src_nid);
+
 	rc = lnet_nid2peer_locked(&msg->msg_rxpeer, from_nid, cpt);
 	if (rc != 0) {
 		lnet_net_unlock(cpt);
@@ -1987,6 +2068,9 @@ lnet_parse(lnet_ni_t *ni, lnet_hdr_t *hdr, lnet_nid_t from_nid,
         case LNET_MSG_REPLY:
                 rc = lnet_parse_reply(ni, msg);
                 break;
+	case LNET_MSG_BATCH:
+		rc = lnet_parse_batch(ni, msg);
+		break;
         default:
                 LASSERT(0);
 		rc = -EPROTO;
@@ -2003,11 +2087,28 @@ lnet_parse(lnet_ni_t *ni, lnet_hdr_t *hdr, lnet_nid_t from_nid,
 	lnet_finalize(ni, msg, rc);
 
  drop:
-	lnet_drop_message(ni, cpt, private, payload_length);
+	lnet_drop_message(ni, cpt, private, payload_length, batched);
 	return 0;
 }
+
+int
+lnet_parse(lnet_ni_t *ni, lnet_hdr_t *hdr, lnet_nid_t from_nid,
+	   void *private, int rdma_req)
+{
+	return lnet_parse_msg(ni, hdr, from_nid, private, rdma_req, 0);
+}
 EXPORT_SYMBOL(lnet_parse);
 
+/* Parse a message unpacked from a received BATCH.  \a rec holds a reference
+ * on the BATCH which is dropped once the message has been consumed; if this
+ * returns an error the caller must drop it. */
+int
+lnet_parse_rec(lnet_ni_t *ni, lnet_hdr_t *hdr, lnet_nid_t from_nid,
+	       lnet_batch_rec_t *rec)
+{
+	return lnet_parse_msg(ni, hdr, from_nid, rec, 0, 1);
+}
+
 void
 lnet_drop_delayed_msg_list(cfs_list_t *head, char *reason)
 {
@@ -2040,7 +2141,8 @@ lnet_drop_delayed_msg_list(cfs_list_t *head, char *reason)
 
 		lnet_drop_message(msg->msg_rxpeer->lp_ni,
 				  msg->msg_rxpeer->lp_cpt,
-				  msg->msg_private, msg->msg_len);
+				  msg->msg_private, msg->msg_len,
+				  msg->msg_rx_batched);
 		/*
 		 * NB: message will not generate event because w/o attached MD,
 		 * but we still should give error code so lnet_msg_decommit()
@@ -172,12 +172,23 @@ lnet_msg_commit(lnet_msg_t *msg, int cpt)
 static void
 lnet_msg_decommit_tx(lnet_msg_t *msg, int status)
 {
-	lnet_counters_t	*counters;
-	lnet_event_t	*ev = &msg->msg_ev;
+	lnet_counters_t		*counters;
+	lnet_batch_counters_t	*bc;
+	lnet_event_t		*ev = &msg->msg_ev;
 
 	LASSERT(msg->msg_tx_committed);
-	if (status != 0)
+	if (status != 0) {
+		if (!msg->msg_routing && the_lnet.ln_rail_count > 0)
+			lnet_rail_error_locked(msg->msg_target.nid);
 		goto out;
+	}
+
+	if (msg->msg_batch) { /* its messages are counted by themselves */
+		bc = the_lnet.ln_batch_counters[msg->msg_tx_cpt];
+		bc->tx_batches++;
+		bc->tx_msgs += le32_to_cpu(msg->msg_hdr.msg.batch.count);
+		goto out;
+	}
 
 	counters = the_lnet.ln_counters[msg->msg_tx_cpt];
 	switch (ev->type) {
@@ -222,8 +233,9 @@ lnet_msg_decommit_tx(lnet_msg_t *msg, int status)
 static void
 lnet_msg_decommit_rx(lnet_msg_t *msg, int status)
 {
-	lnet_counters_t	*counters;
-	lnet_event_t	*ev = &msg->msg_ev;
+	lnet_counters_t		*counters;
+	lnet_batch_counters_t	*bc;
+	lnet_event_t		*ev = &msg->msg_ev;
 
 	LASSERT(!msg->msg_tx_committed); /* decommitted or never committed */
 	LASSERT(msg->msg_rx_committed);
@@ -231,6 +243,13 @@ lnet_msg_decommit_rx(lnet_msg_t *msg, int status)
 	if (status != 0)
 		goto out;
 
+	if (msg->msg_batch) {
+		bc = the_lnet.ln_batch_counters[msg->msg_rx_cpt];
+		bc->rx_batches++;
+		bc->rx_msgs += msg->msg_hdr.msg.batch.count;
+		goto out;
+	}
+
 	counters = the_lnet.ln_counters[msg->msg_rx_cpt];
 	switch (ev->type) {
 	default:
@@ -464,6 +483,10 @@ lnet_finalize (lnet_ni_t *ni, lnet_msg_t *msg, int status)
                msg->msg_txpeer == NULL ? "<none>" : libcfs_nid2str(msg->msg_txpeer->lp_nid),
                msg->msg_rxpeer == NULL ? "<none>" : libcfs_nid2str(msg->msg_rxpeer->lp_nid));
 #endif
+	/* complete the messages a BATCH carries before the BATCH itself */
+	if (msg->msg_batch)
+		lnet_batch_finalize(msg, status);
+
         msg->msg_ev.status = status;
 
 	if (msg->msg_md != NULL) {
@@ -335,3 +335,324 @@ lnet_debug_peer(lnet_nid_t nid)
 
 	lnet_net_unlock(cpt);
 }
+
+int
+lnet_rails_create(void)
+{
+	cfs_list_t	*hash;
+	int		i;
+
+	LIBCFS_ALLOC(hash, LNET_PEER_HASH_SIZE * sizeof(*hash));
+	if (hash == NULL) {
+		CERROR("Failed to create rail hash table\n");
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < LNET_PEER_HASH_SIZE; i++)
+		CFS_INIT_LIST_HEAD(&hash[i]);
+	the_lnet.ln_rail_hash = hash;
+
+	return 0;
+}
+
+/* must be called with lnet_net_lock held */
+static lnet_rail_group_t *
+lnet_rail_find_locked(lnet_nid_t nid, int *idxp)
+{
+	lnet_rail_member_t	*lrm;
+	cfs_list_t		*head;
+
+	head = &the_lnet.ln_rail_hash[lnet_nid2peerhash(nid)];
+	cfs_list_for_each_entry(lrm, head, lrm_hashlist) {
+		if (lrm->lrm_nid != nid)
+			continue;
+
+		if (idxp != NULL)
+			*idxp = lrm - lrm->lrm_group->lrg_members;
+		return lrm->lrm_group;
+	}
+
+	return NULL;
+}
+
+static void
+lnet_rail_member_init(lnet_rail_group_t *lrg, int idx, lnet_nid_t nid)
+{
+	lnet_rail_member_t *lrm = &lrg->lrg_members[idx];
+
+	lrm->lrm_group = lrg;
+	lrm->lrm_nid = nid;
+	lrm->lrm_error_time = 0;
+	cfs_atomic_set(&lrm->lrm_sends, 0);
+	cfs_atomic_set(&lrm->lrm_errors, 0);
+}
+
+/* must be called with LNET_LOCK_EX held */
+static void
+lnet_rail_member_hash(lnet_rail_member_t *lrm)
+{
+	cfs_list_add_tail(&lrm->lrm_hashlist,
+			  &the_lnet.ln_rail_hash[lnet_nid2peerhash(
+							lrm->lrm_nid)]);
+}
+
+/**
+ * Make \a nid another rail of the peer known as \a primary, creating the
+ * rail group of \a primary if this is its first rail.  Every rail must be
+ * on a different network, and a NID belongs to one group at most.
+ */
+int
+lnet_rail_add(lnet_nid_t primary, lnet_nid_t nid)
+{
+	lnet_rail_group_t	*lrg;
+	lnet_rail_group_t	*new_lrg;
+	int			idx;
+	int			rc = 0;
+	int			i;
+
+	if (primary == LNET_NID_ANY || nid == LNET_NID_ANY ||
+	    LNET_NIDNET(primary) == LNET_NIDNET(nid))
+		return -EINVAL;
+
+	if (lnet_islocalnid(primary) || lnet_islocalnid(nid))
+		return -EINVAL;
+
+	LIBCFS_ALLOC(new_lrg, sizeof(*new_lrg));
+	if (new_lrg == NULL)
+		return -ENOMEM;
+
+	lnet_rail_member_init(new_lrg, 0, primary);
+	new_lrg->lrg_nmembers = 1;
+
+	lnet_net_lock(LNET_LOCK_EX);
+
+	if (lnet_rail_find_locked(nid, NULL) != NULL) {
+		rc = -EEXIST;
+		goto out;
+	}
+
+	lrg = lnet_rail_find_locked(primary, &idx);
+	if (lrg == NULL) {
+		lrg = new_lrg;
+		new_lrg = NULL;
+		lnet_rail_member_hash(&lrg->lrg_members[0]);
+		cfs_list_add_tail(&lrg->lrg_list, &the_lnet.ln_rails);
+		the_lnet.ln_rail_count++;
+
+	} else if (idx != 0) {
+		/* primary is a rail of another peer */
+		rc = -EINVAL;
+		goto out;
+	}
+
+	if (lrg->lrg_nmembers == LNET_MAX_RAILS) {
+		rc = -E2BIG;
+		goto out;
+	}
+
+	for (i = 0; i < lrg->lrg_nmembers; i++) {
+		if (LNET_NIDNET(lrg->lrg_members[i].lrm_nid) ==
+		    LNET_NIDNET(nid)) {
+			rc = -EINVAL;
+			goto out;
+		}
+	}
+
+	lnet_rail_member_init(lrg, lrg->lrg_nmembers, nid);
+	lnet_rail_member_hash(&lrg->lrg_members[lrg->lrg_nmembers++]);
+ out:
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	if (new_lrg != NULL)
+		LIBCFS_FREE(new_lrg, sizeof(*new_lrg));
+
+	if (rc == 0) {
+		CDEBUG(D_NET, "Added rail %s to %s\n",
+		       libcfs_nid2str(nid), libcfs_nid2str(primary));
+	}
+	return rc;
+}
+
+/**
+ * Remove rail \a nid; removing the primary NID of a group, or its last
+ * rail, removes the whole group.
+ */
+int
+lnet_rail_del(lnet_nid_t nid)
+{
+	lnet_rail_group_t	*lrg;
+	int			idx;
+	int			i;
+
+	lnet_net_lock(LNET_LOCK_EX);
+
+	lrg = lnet_rail_find_locked(nid, &idx);
+	if (lrg == NULL) {
+		lnet_net_unlock(LNET_LOCK_EX);
+		return -ENOENT;
+	}
+
+	/* members move down, hash them again once they are in place */
+	for (i = idx; i < lrg->lrg_nmembers; i++)
+		cfs_list_del(&lrg->lrg_members[i].lrm_hashlist);
+
+	if (idx != 0 && lrg->lrg_nmembers > 2) {
+		lrg->lrg_nmembers--;
+		memmove(&lrg->lrg_members[idx], &lrg->lrg_members[idx + 1],
+			(lrg->lrg_nmembers - idx) * sizeof(lrg->lrg_members[0]));
+		for (i = idx; i < lrg->lrg_nmembers; i++)
+			lnet_rail_member_hash(&lrg->lrg_members[i]);
+		lrg = NULL;
+	} else {
+		for (i = 0; i < idx; i++)
+			cfs_list_del(&lrg->lrg_members[i].lrm_hashlist);
+		cfs_list_del(&lrg->lrg_list);
+		the_lnet.ln_rail_count--;
+	}
+
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	if (lrg != NULL)
+		LIBCFS_FREE(lrg, sizeof(*lrg));
+	return 0;
+}
+
+void
+lnet_rails_destroy(void)
+{
+	lnet_rail_group_t	*lrg;
+
+	while (!cfs_list_empty(&the_lnet.ln_rails)) {
+		lrg = cfs_list_entry(the_lnet.ln_rails.next,
+				     lnet_rail_group_t, lrg_list);
+		cfs_list_del(&lrg->lrg_list);
+		LIBCFS_FREE(lrg, sizeof(*lrg));
+	}
+	the_lnet.ln_rail_count = 0;
+
+	if (the_lnet.ln_rail_hash != NULL) {
+		LIBCFS_FREE(the_lnet.ln_rail_hash,
+			    LNET_PEER_HASH_SIZE *
+			    sizeof(*the_lnet.ln_rail_hash));
+		the_lnet.ln_rail_hash = NULL;
+	}
+}
+
+/**
+ * Return the NID the peer reached by \a nid is known by, so messages
+ * arriving on any of its rails look as if they came from one NID.
+ */
+lnet_nid_t
+lnet_rail_primary_locked(lnet_nid_t nid)
+{
+	lnet_rail_group_t *lrg;
+
+	if (the_lnet.ln_rail_count == 0)
+		return nid;
+
+	lrg = lnet_rail_find_locked(nid, NULL);
+	return lrg == NULL ? nid : lrg->lrg_members[0].lrm_nid;
+}
+
+lnet_nid_t
+lnet_rail_primary(lnet_nid_t nid)
+{
+	int cpt;
+
+	if (the_lnet.ln_rail_count == 0)
+		return nid;
+
+	cpt = lnet_net_lock_current();
+	nid = lnet_rail_primary_locked(nid);
+	lnet_net_unlock(cpt);
+
+	return nid;
+}
+
+/* must be called with lnet_net_lock held */
+int
+lnet_rail_healthy(lnet_rail_member_t *lrm, lnet_ni_t *ni, cfs_time_t now)
+{
+	if (ni->ni_status != NULL &&
+	    ni->ni_status->ns_status == LNET_NI_STATUS_DOWN)
+		return 0;
+
+	return lrm->lrm_error_time == 0 ||
+	       cfs_time_after(now, cfs_time_add(lrm->lrm_error_time,
+						the_lnet.ln_rail_recovery));
+}
+
+/**
+ * Choose the rail to send the next message for \a nid on.  Only rails on a
+ * local network are candidates; healthy ones are preferred over those which
+ * failed recently, then the one whose local NI has the most free send
+ * credits wins, and ties are broken round-robin.  Returns \a nid itself if
+ * it is not part of a rail group or no rail is reachable directly.
+ */
+lnet_nid_t
+lnet_rail_select_locked(lnet_nid_t nid)
+{
+	lnet_rail_group_t	*lrg;
+	lnet_rail_member_t	*lrm;
+	lnet_rail_member_t	*best = NULL;
+	lnet_ni_t		*ni;
+	cfs_time_t		now = cfs_time_current_sec();
+	int			best_healthy = 0;
+	int			best_credits = 0;
+	int			healthy;
+	int			credits;
+	int			seq;
+	int			i;
+
+	lrg = lnet_rail_find_locked(nid, NULL);
+	if (lrg == NULL)
+		return nid;
+
+	/* racy but harmless, just like lr_seq of routes */
+	seq = lrg->lrg_seq++;
+	for (i = 0; i < lrg->lrg_nmembers; i++) {
+		lrm = &lrg->lrg_members[(seq + i) % lrg->lrg_nmembers];
+
+		cfs_list_for_each_entry(ni, &the_lnet.ln_nis, ni_list) {
+			if (LNET_NIDNET(ni->ni_nid) == LNET_NIDNET(lrm->lrm_nid))
+				break;
+		}
+		if (&ni->ni_list == &the_lnet.ln_nis)
+			continue;
+
+		healthy = lnet_rail_healthy(lrm, ni, now);
+		credits = ni->ni_tx_queues[lnet_cpt_of_nid_locked(
+						lrm->lrm_nid)]->tq_credits;
+		if (best != NULL &&
+		    (best_healthy > healthy ||
+		     (best_healthy == healthy && best_credits >= credits)))
+			continue;
+
+		best = lrm;
+		best_healthy = healthy;
+		best_credits = credits;
+	}
+
+	if (best == NULL)
+		return nid;
+
+	cfs_atomic_inc(&best->lrm_sends);
+	return best->lrm_nid;
+}
+
+/* a send on rail \a nid failed, avoid it for a while */
+void
+lnet_rail_error_locked(lnet_nid_t nid)
+{
+	lnet_rail_group_t	*lrg;
+	int			idx;
+
+	lrg = lnet_rail_find_locked(nid, &idx);
+	if (lrg == NULL)
+		return;
+
+	cfs_atomic_inc(&lrg->lrg_members[idx].lrm_errors);
+	lrg->lrg_members[idx].lrm_error_time = cfs_time_current_sec();
+	CDEBUG(D_NET, "Send on rail %s of %s failed\n", libcfs_nid2str(nid),
+	       libcfs_nid2str(lrg->lrg_members[0].lrm_nid));
+}
@@ -129,8 +129,14 @@ lnet_notify_locked(lnet_peer_t *lp, int notifylnd, int alive, cfs_time_t when)
         lp->lp_alive = !(!alive);               /* 1 bit! */
         lp->lp_notify = 1;
         lp->lp_notifylnd |= notifylnd;
-	if (lp->lp_alive)
+	if (lp->lp_alive) {
 		lp->lp_ping_feats = LNET_PING_FEAT_INVAL; /* reset */
+		/* it may have restarted with another LNet: ask again */
+		if (lp->lp_batch != LNET_BATCH_PROBING) {
+			lp->lp_batch = LNET_BATCH_UNKNOWN;
+			lp->lp_batch_retry = 0;
+		}
+	}
 
 	CDEBUG(D_NET, "set %s %d\n", libcfs_nid2str(lp->lp_nid), alive);
 }
@@ -642,6 +648,10 @@ lnet_parse_rc_info(lnet_rc_data_t *rcd)
 		return; /* nothing I can understand */
 	}
 
+	/* no need to probe a router for BATCH support */
+	gw->lp_batch = (gw->lp_ping_feats & LNET_PING_FEAT_BATCH) != 0 ?
+		       LNET_BATCH_YES : LNET_BATCH_NO;
+
 	if ((gw->lp_ping_feats & LNET_PING_FEAT_NI_STATUS) == 0)
 		return; /* can't carry NI status info */
 
@@ -1275,6 +1285,7 @@ rescan:
 		lnet_net_unlock(cpt);
 
 		lnet_prune_rc_data(0); /* don't wait for UNLINK */
+		lnet_batch_prune(0); /* BATCH probes past their deadline */
 
 		/* Call cfs_pause() here always adds 1 to load average
 		 * because kernel counts # active tasks as nr_running
@@ -1716,6 +1727,8 @@ lnet_router_checker (void)
 
         LASSERT (the_lnet.ln_rc_state == LNET_RC_STATE_RUNNING);
 
+	lnet_batch_prune(0); /* BATCH probes past their deadline */
+
 	lnet_net_lock(0);
 
         version = the_lnet.ln_routers_version;
@@ -84,9 +84,10 @@ static int __proc_lnet_stats(void *data, int write,
 {
         int              rc;
         lnet_counters_t *ctrs;
+        lnet_batch_counters_t bctrs;
         int              len;
         char            *tmpstr;
-        const int        tmpsiz = 256; /* 7 %u and 4 LPU64 */
+        const int        tmpsiz = 256; /* 7 %u and 8 LPU64 */
 
         if (write) {
 		lnet_counters_reset();
@@ -106,16 +107,20 @@ static int __proc_lnet_stats(void *data, int write,
         }
 
 	lnet_counters_get(ctrs);
+	lnet_batch_counters_get(&bctrs);
 
+	/* BATCH counters go last so old parsers still work */
         len = snprintf(tmpstr, tmpsiz,
                        "%u %u %u %u %u %u %u "LPU64" "LPU64" "
-                       LPU64" "LPU64,
+                       LPU64" "LPU64" "LPU64" "LPU64" "LPU64" "LPU64,
                        ctrs->msgs_alloc, ctrs->msgs_max,
                        ctrs->errors,
                        ctrs->send_count, ctrs->recv_count,
                        ctrs->route_count, ctrs->drop_count,
                        ctrs->send_length, ctrs->recv_length,
-                       ctrs->route_length, ctrs->drop_length);
+                       ctrs->route_length, ctrs->drop_length,
+                       bctrs.tx_batches, bctrs.tx_msgs,
+                       bctrs.rx_batches, bctrs.rx_msgs);
 
         if (pos >= min_t(int, len, strlen(tmpstr)))
                 rc = 0;
@@ -615,6 +620,88 @@ static int __proc_lnet_buffers(void *data, int write,
 
 DECLARE_PROC_HANDLER(proc_lnet_buffers);
 
+/* one line per rail of every multi-rail peer */
+static int __proc_lnet_rails(void *data, int write,
+			     loff_t pos, void *buffer, int nob)
+{
+	lnet_rail_group_t	*lrg;
+	lnet_rail_member_t	*lrm;
+	lnet_ni_t		*ni;
+	cfs_time_t		now = cfs_time_current_sec();
+	char			*state;
+	char			*s;
+	char			*tmpstr;
+	int			tmpsiz;
+	int			len;
+	int			rc;
+	int			i;
+
+	LASSERT(!write);
+
+	lnet_net_lock(0);
+	tmpsiz = 128 * (the_lnet.ln_rail_count * LNET_MAX_RAILS + 1);
+	lnet_net_unlock(0);
+
+	LIBCFS_ALLOC(tmpstr, tmpsiz);
+	if (tmpstr == NULL)
+		return -ENOMEM;
+
+	s = tmpstr; /* points to current position in tmpstr[] */
+
+	s += snprintf(s, tmpstr + tmpsiz - s,
+		      "%-24s %-24s %-24s %5s %10s %10s\n",
+		      "primary", "rail", "ni", "state", "sends", "errors");
+	LASSERT(tmpstr + tmpsiz - s > 0);
+
+	lnet_net_lock(0);
+	cfs_list_for_each_entry(lrg, &the_lnet.ln_rails, lrg_list) {
+		for (i = 0; i < lrg->lrg_nmembers; i++) {
+			/* groups added since the buffer was sized */
+			if (tmpstr + tmpsiz - s < 128)
+				break;
+
+			lrm = &lrg->lrg_members[i];
+			cfs_list_for_each_entry(ni, &the_lnet.ln_nis, ni_list) {
+				if (LNET_NIDNET(ni->ni_nid) ==
+				    LNET_NIDNET(lrm->lrm_nid))
+					break;
+			}
+
+			if (&ni->ni_list == &the_lnet.ln_nis) {
+				ni = NULL;
+				state = "NA";
+			} else {
+				state = lnet_rail_healthy(lrm, ni, now) ?
+					"up" : "down";
+			}
+
+			s += snprintf(s, tmpstr + tmpsiz - s,
+				      "%-24s %-24s %-24s %5s %10d %10d\n",
+				      libcfs_nid2str(lrg->lrg_members[0].lrm_nid),
+				      libcfs_nid2str(lrm->lrm_nid),
+				      ni == NULL ? "NA" :
+				      libcfs_nid2str(ni->ni_nid), state,
+				      cfs_atomic_read(&lrm->lrm_sends),
+				      cfs_atomic_read(&lrm->lrm_errors));
+			LASSERT(tmpstr + tmpsiz - s > 0);
+		}
+	}
+	lnet_net_unlock(0);
+
+	len = s - tmpstr;
+
+	if (pos >= min_t(int, len, strlen(tmpstr)))
+		rc = 0;
+	else
+		rc = cfs_trace_copyout_string(buffer, nob,
+					      tmpstr + pos, NULL);
+
+	LIBCFS_FREE(tmpstr, tmpsiz);
+	return rc;
+}
+
+DECLARE_PROC_HANDLER(proc_lnet_rails);
+
 int LL_PROC_PROTO(proc_lnet_nis)
 {
 	int	tmpsiz = 128 * LNET_CPT_NUMBER;
@@ -875,6 +962,12 @@ static struct ctl_table lnet_table[] = {
 		.mode		= 0444,
 		.proc_handler	= &proc_lnet_nis,
 	},
+	{
+		INIT_CTL_NAME
+		.procname	= "rails",
+		.mode		= 0444,
+		.proc_handler	= &proc_lnet_rails,
+	},
 	{
 		INIT_CTL_NAME
 		.procname	= "portal_rotor",
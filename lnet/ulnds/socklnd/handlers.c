@@ -617,6 +617,7 @@ usocklnd_passiveconn_hellorecv(usock_conn_t *conn)
 int
 usocklnd_write_handler(usock_conn_t *conn)
 {
+        CFS_LIST_HEAD (txs);
         usock_tx_t   *tx;
         int           ret;
         int           rc = 0;
@@ -660,7 +661,10 @@ usocklnd_write_handler(usock_conn_t *conn)
 
                 if (cfs_list_empty(&conn->uc_tx_list) &&
                     cfs_list_empty(&conn->uc_zcack_list)) {
-                        LASSERT(usock_tuns.ut_fair_limit > 1);
+                        /* a later pass, or the fd stayed in upt_ready[]
+                         * of epoll across epoll_wait() */
+                        LASSERT(usock_tuns.ut_fair_limit > 1 ||
+                                usock_tuns.ut_epoll);
                         pthread_mutex_unlock(&conn->uc_lock);
                         return 0;
                 }
@@ -672,26 +676,32 @@ usocklnd_write_handler(usock_conn_t *conn)
                 else
                         rc = -ENOMEM;
 
-                pthread_mutex_unlock(&conn->uc_lock);
-
-                if (rc)
+                if (rc) {
+                        pthread_mutex_unlock(&conn->uc_lock);
                         break;
+                }
+
+                /* take the rest of queued txs as well to send them
+                 * together, zc-acks left behind go with the next call */
+                cfs_list_add(&tx->tx_list, &txs);
+                cfs_list_splice_init(&conn->uc_tx_list, txs.prev);
+
+                pthread_mutex_unlock(&conn->uc_lock);
 
-                rc = usocklnd_send_tx(conn, tx);
+                rc = usocklnd_send_txs(conn, &txs);
                 if (rc == 0) { /* partial send or connection closed */
                         pthread_mutex_lock(&conn->uc_lock);
-                        cfs_list_add(&tx->tx_list, &conn->uc_tx_list);
+                        cfs_list_splice(&txs, &conn->uc_tx_list);
                         conn->uc_sending = 0;
                         pthread_mutex_unlock(&conn->uc_lock);
                         break;
                 }
                 if (rc < 0) { /* real error */
-                        usocklnd_destroy_tx(ni, tx);
+                        usocklnd_destroy_txlist(ni, &txs);
                         break;
                 }
 
-                /* rc == 1: tx was sent completely */
-                usocklnd_destroy_tx(ni, tx);
+                /* rc == 1: all txs were sent completely */
 
                 pthread_mutex_lock(&conn->uc_lock);
                 conn->uc_sending = 0;
@@ -921,6 +931,42 @@ usocklnd_passiveconn_hellosent(usock_conn_t *conn)
         return 0;
 }
 
+/* "consume" \a nob bytes of tx iov */
+static void
+usocklnd_tx_consume(usock_tx_t *tx, int nob)
+{
+        struct iovec *iov = tx->tx_iov;
+
+        LASSERT (nob <= tx->tx_resid);
+        tx->tx_resid -= nob;
+
+        while (nob != 0) {
+                LASSERT (tx->tx_niov > 0);
+
+                if (nob < iov->iov_len) {
+                        iov->iov_base = (void *)(((unsigned long)(iov->iov_base)) + nob);
+                        iov->iov_len -= nob;
+                        break;
+                }
+
+                nob -= iov->iov_len;
+                tx->tx_iov = ++iov;
+                tx->tx_niov--;
+        }
+}
+
+static void
+usocklnd_tx_progress(usock_conn_t *conn)
+{
+        usock_peer_t *peer = conn->uc_peer;
+        cfs_time_t    t    = cfs_time_current();
+
+        conn->uc_tx_deadline = cfs_time_add(t, cfs_time_seconds(usock_tuns.ut_timeout));
+
+        if(peer != NULL)
+                peer->up_last_alive = t;
+}
+
 /* Send as much tx data as possible.
  * Returns 0 or 1 on succsess, <0 if fatal error.
  * 0 means partial send or non-fatal error, 1 - complete.
@@ -931,15 +977,11 @@ usocklnd_passiveconn_hellosent(usock_conn_t *conn)
 int
 usocklnd_send_tx(usock_conn_t *conn, usock_tx_t *tx)
 {
-        struct iovec *iov;
         int           nob;
-        cfs_time_t    t;
 
         LASSERT (tx->tx_resid != 0);
 
         do {
-                usock_peer_t *peer = conn->uc_peer;
-
                 LASSERT (tx->tx_niov > 0);
 
                 nob = libcfs_sock_writev(conn->uc_sock,
@@ -949,31 +991,65 @@ usocklnd_send_tx(usock_conn_t *conn, usock_tx_t *tx)
                 if (nob <= 0) /* write queue is flow-controlled or error */
                         return nob;
 
-                LASSERT (nob <= tx->tx_resid);
-                tx->tx_resid -= nob;
-                t = cfs_time_current();
-                conn->uc_tx_deadline = cfs_time_add(t, cfs_time_seconds(usock_tuns.ut_timeout));
+                usocklnd_tx_progress(conn);
+                usocklnd_tx_consume(tx, nob);
 
-                if(peer != NULL)
-                        peer->up_last_alive = t;
+        } while (tx->tx_resid != 0);
 
-                /* "consume" iov */
-                iov = tx->tx_iov;
-                do {
-                        LASSERT (tx->tx_niov > 0);
+        return 1; /* send complete */
+}
 
-                        if (nob < iov->iov_len) {
-                                iov->iov_base = (void *)(((unsigned long)(iov->iov_base)) + nob);
-                                iov->iov_len -= nob;
+/* Send the txs of \a txs gathering as many of them as upt_tx_iov[] holds
+ * into each writev(), rather than a syscall per tx. Sent txs are removed
+ * from \a txs and destroyed, the others are left there in order.
+ * Returns 1 if all txs were sent, 0 on partial send, <0 on error */
+int
+usocklnd_send_txs(usock_conn_t *conn, cfs_list_t *txs)
+{
+        usock_pollthread_t *pt  = &usock_data.ud_pollthreads[conn->uc_pt_idx];
+        struct iovec       *iov = pt->upt_tx_iov;
+        lnet_ni_t          *ni  = conn->uc_peer->up_ni;
+        usock_tx_t         *tx;
+        int                 niov;
+        int                 nob;
+
+        while (!cfs_list_empty(txs)) {
+                niov = 0;
+                cfs_list_for_each_entry(tx, txs, tx_list) {
+                        LASSERT (tx->tx_resid != 0 && tx->tx_niov > 0);
+
+                        if (niov + tx->tx_niov > UPT_TX_NIOV)
                                 break;
-                        }
 
-                        nob -= iov->iov_len;
-                        tx->tx_iov = ++iov;
-                        tx->tx_niov--;
-                } while (nob != 0);
+                        memcpy(&iov[niov], tx->tx_iov,
+                               tx->tx_niov * sizeof(*iov));
+                        niov += tx->tx_niov;
+                }
+                LASSERT (niov > 0);
 
-        } while (tx->tx_resid != 0);
+                nob = libcfs_sock_writev(conn->uc_sock, iov, niov);
+                if (nob < 0)
+                        conn->uc_errored = 1;
+                if (nob <= 0) /* write queue is flow-controlled or error */
+                        return nob;
+
+                usocklnd_tx_progress(conn);
+
+                while (nob != 0) {
+                        int sent;
+
+                        tx = cfs_list_entry(txs->next, usock_tx_t, tx_list);
+                        sent = MIN(nob, tx->tx_resid);
+                        usocklnd_tx_consume(tx, sent);
+                        nob -= sent;
+
+                        if (tx->tx_resid != 0) /* partially sent */
+                                break;
+
+                        cfs_list_del(&tx->tx_list);
+                        usocklnd_destroy_tx(ni, tx);
+                }
+        }
 
         return 1; /* send complete */
 }
@@ -1000,6 +1076,8 @@ usocklnd_read_data(usock_conn_t *conn)
                 if (nob <= 0) {/* read nothing or error */
                         if (nob < 0)
                                 conn->uc_errored = 1;
+                        else
+                                conn->uc_rx_eagain = 1;
                         return nob;
                 }
 
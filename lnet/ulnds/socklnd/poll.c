@@ -42,6 +42,183 @@
 #include <unistd.h>
 #include <sys/syscall.h>
 
+#ifdef HAVE_SYS_EPOLL_H
+/* Register \a fd with \a op (EPOLL_CTL_ADD or EPOLL_CTL_MOD) for the poll
+ * \a events. Edge triggered: an fd is only reported when it becomes ready,
+ * the handlers have to drain it (see upt_ready[]).
+ * Returns 0 on success, <0 else */
+static int
+usocklnd_epoll_ctl(usock_pollthread_t *pt_data, int op, int fd, short events)
+{
+        struct epoll_event ev;
+
+        if (pt_data->upt_epfd < 0)
+                return 0;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLET;
+        if ((events & POLLIN) != 0)
+                ev.events |= EPOLLIN;
+        if ((events & POLLOUT) != 0)
+                ev.events |= EPOLLOUT;
+        ev.data.fd = fd;
+
+        if (epoll_ctl(pt_data->upt_epfd, op, fd, &ev) == 0)
+                return 0;
+
+        CERROR("Cannot epoll_ctl(%d) fd %d: errno=%d\n", op, fd, errno);
+        return -errno;
+}
+
+int
+usocklnd_epoll_init(usock_pollthread_t *pt_data)
+{
+        int rc;
+
+        pt_data->upt_epfd = -1;
+        if (!usock_tuns.ut_epoll)
+                return 0;
+
+        pt_data->upt_epfd = epoll_create(UPT_START_SIZ);
+        if (pt_data->upt_epfd < 0) {
+                rc = -errno;
+                CERROR("Cannot epoll_create(): errno=%d\n", errno);
+                return rc;
+        }
+
+        rc = usocklnd_epoll_ctl(pt_data, EPOLL_CTL_ADD,
+                                LIBCFS_SOCK2FD(pt_data->upt_notifier[1]),
+                                POLLIN);
+        if (rc != 0)
+                usocklnd_epoll_fini(pt_data);
+        return rc;
+}
+
+void
+usocklnd_epoll_fini(usock_pollthread_t *pt_data)
+{
+        if (pt_data->upt_epfd >= 0)
+                close(pt_data->upt_epfd);
+        pt_data->upt_epfd = -1;
+}
+
+/* Wait for events and merge them into upt_pollfd[].revents, so that they
+ * are handled the same way as poll(2) results. Returns the number of
+ * fds to handle, or <0 with errno set like poll(2) */
+static int
+usocklnd_epoll_wait(usock_pollthread_t *pt_data)
+{
+        struct epoll_event  events[UPT_EPOLL_EVENTS];
+        struct pollfd      *pollfd = pt_data->upt_pollfd;
+        int                 timeout;
+        int                 nevents;
+        int                 idx;
+        int                 fd;
+        int                 i;
+
+        /* don't sleep while handlers left some fds undrained */
+        timeout = pt_data->upt_nready > 0 ? 0 :
+                  usock_tuns.ut_poll_timeout * 1000;
+
+        nevents = epoll_wait(pt_data->upt_epfd, events, UPT_EPOLL_EVENTS,
+                             timeout);
+        if (nevents < 0)
+                return nevents;
+
+        for (i = 0; i < nevents; i++) {
+                short revents = 0;
+
+                if ((events[i].events & EPOLLIN) != 0)
+                        revents |= POLLIN;
+                if ((events[i].events & EPOLLOUT) != 0)
+                        revents |= POLLOUT;
+                if ((events[i].events & EPOLLERR) != 0)
+                        revents |= POLLERR;
+                if ((events[i].events & EPOLLHUP) != 0)
+                        revents |= POLLHUP;
+
+                fd = events[i].data.fd;
+                if (fd == pollfd[0].fd) { /* notifier */
+                        pollfd[0].revents |= revents;
+                        continue;
+                }
+
+                idx = pt_data->upt_fd2idx[fd];
+                if (idx == 0) /* deleted since */
+                        continue;
+
+                if (pollfd[idx].revents == 0)
+                        pt_data->upt_ready[pt_data->upt_nready++] = fd;
+                pollfd[idx].revents |= revents;
+        }
+
+        return pt_data->upt_nready + (pollfd[0].revents != 0);
+}
+
+/* A read handler stopped before the socket returned EAGAIN, e.g. to wait
+ * for lnet_parse(): data may still be there, but edge triggered epoll
+ * won't report it again. Re-arming reports it if it is there. */
+static void
+usocklnd_epoll_rearm(usock_pollthread_t *pt_data, int idx)
+{
+        struct pollfd *pollfd = &pt_data->upt_pollfd[idx];
+
+        usocklnd_epoll_ctl(pt_data, EPOLL_CTL_MOD, pollfd->fd,
+                           pollfd->events);
+}
+
+#else /* !HAVE_SYS_EPOLL_H */
+
+#define EPOLL_CTL_ADD 1
+#define EPOLL_CTL_MOD 3
+
+static inline int
+usocklnd_epoll_ctl(usock_pollthread_t *pt_data, int op, int fd, short events)
+{
+        return 0;
+}
+
+int
+usocklnd_epoll_init(usock_pollthread_t *pt_data)
+{
+        pt_data->upt_epfd = -1;
+        return 0;
+}
+
+void
+usocklnd_epoll_fini(usock_pollthread_t *pt_data)
+{
+}
+
+static inline int
+usocklnd_epoll_wait(usock_pollthread_t *pt_data)
+{
+        LBUG();
+        return -1;
+}
+
+static inline void
+usocklnd_epoll_rearm(usock_pollthread_t *pt_data, int idx)
+{
+}
+#endif /* HAVE_SYS_EPOLL_H */
+
+/* Forget about \a fd being ready, it is deleted */
+static void
+usocklnd_ready_del(usock_pollthread_t *pt_data, int fd)
+{
+        int i;
+
+        for (i = 0; i < pt_data->upt_nready; i++) {
+                if (pt_data->upt_ready[i] != fd)
+                        continue;
+
+                pt_data->upt_ready[i] =
+                        pt_data->upt_ready[--pt_data->upt_nready];
+                break;
+        }
+}
+
 void
 usocklnd_process_stale_list(usock_pollthread_t *pt_data)
 {
@@ -109,16 +286,21 @@ usocklnd_poll_thread(void *arg)
                 usocklnd_process_stale_list(pt_data);
 
                 /* Actual polling for events */
-                rc = poll(pt_data->upt_pollfd,
-                          pt_data->upt_nfds,
-                          usock_tuns.ut_poll_timeout * 1000);
+                if (pt_data->upt_epfd >= 0)
+                        rc = usocklnd_epoll_wait(pt_data);
+                else
+                        rc = poll(pt_data->upt_pollfd,
+                                  pt_data->upt_nfds,
+                                  usock_tuns.ut_poll_timeout * 1000);
 
                 if (rc < 0 && errno != EINTR) {
                         CERROR("Cannot poll(2): errno=%d\n", errno);
                         break;
                 }
 
-                if (rc > 0)
+                if (rc > 0 && pt_data->upt_epfd >= 0)
+                        usocklnd_execute_ready(pt_data);
+                else if (rc > 0)
                         usocklnd_execute_handlers(pt_data);
 
                 current_time = cfs_time_current();
@@ -283,6 +465,7 @@ usocklnd_process_pollrequest(usock_pollrequest_t *pr,
         short          value = pr->upr_value;
         usock_conn_t  *conn  = pr->upr_conn;
         int            idx = 0;
+        int            rc;
         struct pollfd *pollfd   = pt_data->upt_pollfd;
         int           *fd2idx   = pt_data->upt_fd2idx;
         usock_conn_t **idx2conn = pt_data->upt_idx2conn;
@@ -322,6 +505,7 @@ usocklnd_process_pollrequest(usock_pollrequest_t *pr,
                         int            new_npollfd = pt_data->upt_npollfd * 2;
                         usock_conn_t **new_idx2conn;
                         int           *new_skip;
+                        int           *new_ready;
 
                         new_pollfd = LIBCFS_REALLOC(pollfd, new_npollfd *
                                                      sizeof(struct pollfd));
@@ -341,6 +525,12 @@ usocklnd_process_pollrequest(usock_pollrequest_t *pr,
                                 goto process_pollrequest_enomem;
                         pt_data->upt_skip = new_skip;
 
+                        new_ready = LIBCFS_REALLOC(pt_data->upt_ready,
+                                                   new_npollfd * sizeof(int));
+                        if (new_ready == NULL)
+                                goto process_pollrequest_enomem;
+                        pt_data->upt_ready = new_ready;
+
                         pt_data->upt_npollfd = new_npollfd;
                 }
 
@@ -366,6 +556,13 @@ usocklnd_process_pollrequest(usock_pollrequest_t *pr,
 
                 LASSERT(fd2idx[LIBCFS_SOCK2FD(conn->uc_sock)] == 0);
 
+                rc = usocklnd_epoll_ctl(pt_data, EPOLL_CTL_ADD,
+                                        LIBCFS_SOCK2FD(conn->uc_sock), value);
+                if (rc != 0) {
+                        usocklnd_conn_decref(conn);
+                        return rc;
+                }
+
                 idx = pt_data->upt_nfds++;
                 idx2conn[idx] = conn;
                 fd2idx[LIBCFS_SOCK2FD(conn->uc_sock)] = idx;
@@ -377,6 +574,7 @@ usocklnd_process_pollrequest(usock_pollrequest_t *pr,
         case POLL_DEL_REQUEST:
                 fd2idx[LIBCFS_SOCK2FD(conn->uc_sock)] = 0; /* invalidate this
                                                             * entry */
+                usocklnd_ready_del(pt_data, LIBCFS_SOCK2FD(conn->uc_sock));
                 --pt_data->upt_nfds;
                 if (idx != pt_data->upt_nfds) {
                         /* shift last entry into released position */
@@ -386,6 +584,7 @@ usocklnd_process_pollrequest(usock_pollrequest_t *pr,
                         fd2idx[pollfd[idx].fd] = idx;
                 }
 
+                /* closing the fd removes it from the epoll set too */
                 libcfs_sock_release(conn->uc_sock);
                 cfs_list_add_tail(&conn->uc_stale_list,
                                   &pt_data->upt_stale_list);
@@ -403,6 +602,11 @@ usocklnd_process_pollrequest(usock_pollrequest_t *pr,
                 LBUG(); /* unknown type */
         }
 
+        /* a new interest is reported by epoll if the fd is ready already */
+        if (type != POLL_ADD_REQUEST && type != POLL_DEL_REQUEST)
+                usocklnd_epoll_ctl(pt_data, EPOLL_CTL_MOD, pollfd[idx].fd,
+                                   pollfd[idx].events);
+
         /* In the case of POLL_ADD_REQUEST, idx2conn[idx] takes the
          * reference that poll request possesses */
         if (type != POLL_ADD_REQUEST)
@@ -415,6 +619,82 @@ usocklnd_process_pollrequest(usock_pollrequest_t *pr,
         return -ENOMEM;
 }
 
+/* Execute handlers for the events of upt_pollfd[idx].
+ * Returns non-zero if the conn is still ready for reading or writing */
+static int
+usocklnd_handle_events(usock_pollthread_t *pt_data, int idx)
+{
+        struct pollfd *pollfd = &pt_data->upt_pollfd[idx];
+        usock_conn_t  *conn   = pt_data->upt_idx2conn[idx];
+        int            rc;
+
+        /* kill connection if it's closed by peer and
+         * there is no data pending for reading */
+        if ((pollfd->revents & POLLERR) != 0 ||
+            (pollfd->revents & POLLHUP) != 0) {
+                if ((pollfd->events & POLLIN) != 0 &&
+                    (pollfd->revents & POLLIN) == 0)
+                        usocklnd_conn_kill(conn);
+                else
+                        usocklnd_exception_handler(conn);
+                pollfd->revents &= ~(POLLERR | POLLHUP);
+        }
+
+        if ((pollfd->revents & POLLIN) != 0) {
+                conn->uc_rx_eagain = 0;
+                rc = usocklnd_read_handler(conn);
+                if (rc <= 0) {
+                        pollfd->revents &= ~POLLIN;
+                        if (rc == 0 && !conn->uc_rx_eagain)
+                                usocklnd_epoll_rearm(pt_data, idx);
+                }
+        }
+
+        if ((pollfd->revents & POLLOUT) != 0 &&
+            usocklnd_write_handler(conn) <= 0)
+                pollfd->revents &= ~POLLOUT;
+
+        return (pollfd->revents & (POLLIN | POLLOUT)) != 0;
+}
+
+/* epoll flavour of usocklnd_execute_handlers(): only visits the fds
+ * reported ready. Those still ready after fair_limit passes stay in
+ * upt_ready[] to be handled after the next epoll_wait() */
+void
+usocklnd_execute_ready(usock_pollthread_t *pt_data)
+{
+        struct pollfd *pollfd = pt_data->upt_pollfd;
+        int           *ready  = pt_data->upt_ready;
+        int            i;
+        int            j;
+        int            n;
+
+        if (pollfd[0].revents & POLLIN)
+                while (usocklnd_notifier_handler(pollfd[0].fd) > 0)
+                        ;
+        pollfd[0].revents = 0;
+
+        for (j = 0; j < usock_tuns.ut_fair_limit; j++) {
+                if (pt_data->upt_nready == 0) /* nothing ready */
+                        break;
+
+                for (i = n = 0; i < pt_data->upt_nready; i++) {
+                        int idx = pt_data->upt_fd2idx[ready[i]];
+
+                        /* the interest may have been dropped since the
+                         * event was reported, e.g. UC_RX_PARSE_WAIT */
+                        pollfd[idx].revents &= pollfd[idx].events |
+                                               POLLERR | POLLHUP;
+
+                        if (usocklnd_handle_events(pt_data, idx))
+                                ready[n++] = ready[i];
+                        else
+                                pollfd[idx].revents = 0;
+                }
+                pt_data->upt_nready = n;
+        }
+}
+
 /* Loop on poll data executing handlers repeatedly until
  *  fair_limit is reached or all entries are exhausted */
 void
@@ -422,7 +702,6 @@ usocklnd_execute_handlers(usock_pollthread_t *pt_data)
 {
         struct pollfd *pollfd   = pt_data->upt_pollfd;
         int            nfds     = pt_data->upt_nfds;
-        usock_conn_t **idx2conn = pt_data->upt_idx2conn;
         int           *skip     = pt_data->upt_skip;
         int            j;
 
@@ -440,7 +719,6 @@ usocklnd_execute_handlers(usock_pollthread_t *pt_data)
                         break;
 
                 do {
-                        usock_conn_t *conn = idx2conn[i];
                         int next;
 
                         if (j == 0) /* first pass... */
@@ -448,26 +726,7 @@ usocklnd_execute_handlers(usock_pollthread_t *pt_data)
                         else /* later passes... */
                                 next = skip[i]; /* skip unready pollfds */
 
-                        /* kill connection if it's closed by peer and
-                         * there is no data pending for reading */
-                        if ((pollfd[i].revents & POLLERR) != 0 ||
-                            (pollfd[i].revents & POLLHUP) != 0) {
-                                if ((pollfd[i].events & POLLIN) != 0 &&
-                                    (pollfd[i].revents & POLLIN) == 0)
-                                        usocklnd_conn_kill(conn);
-                                else
-                                        usocklnd_exception_handler(conn);
-                        }
-
-                        if ((pollfd[i].revents & POLLIN) != 0 &&
-                            usocklnd_read_handler(conn) <= 0)
-                                pollfd[i].revents &= ~POLLIN;
-
-                        if ((pollfd[i].revents & POLLOUT) != 0 &&
-                            usocklnd_write_handler(conn) <= 0)
-                                pollfd[i].revents &= ~POLLOUT;
-
-                        if ((pollfd[i].revents & (POLLIN | POLLOUT)) == 0)
+                        if (!usocklnd_handle_events(pt_data, i))
                                 skip[prev] = next; /* skip this entry next pass */
                         else
                                 prev = i;
@@ -61,6 +61,11 @@ usock_tunables_t usock_tuns = {
         .ut_peertxcredits   = 8,
         .ut_socknagle       = 0,
         .ut_sockbufsiz      = 0,
+#ifdef HAVE_SYS_EPOLL_H
+        .ut_epoll           = 1,
+#else
+        .ut_epoll           = 0,
+#endif
 };
 
 #define MAX_REASONABLE_TIMEOUT 36000 /* 10 hours */
@@ -128,6 +133,20 @@ usocklnd_validate_tunables()
                 return -1;
         }
 
+        if (usock_tuns.ut_epoll != 0 &&
+            usock_tuns.ut_epoll != 1) {
+                CERROR("USOCK_EPOLL: %d should be 0 or 1\n",
+                       usock_tuns.ut_epoll);
+                return -1;
+        }
+
+#ifndef HAVE_SYS_EPOLL_H
+        if (usock_tuns.ut_epoll) {
+                CERROR("USOCK_EPOLL: epoll(7) isn't supported\n");
+                return -1;
+        }
+#endif
+
         return 0;
 }
 
@@ -142,6 +161,8 @@ usocklnd_release_poll_states(int n)
                 libcfs_sock_release(pt->upt_notifier[0]);
                 libcfs_sock_release(pt->upt_notifier[1]);
 
+                usocklnd_epoll_fini(pt);
+
                 pthread_mutex_destroy(&pt->upt_pollrequests_lock);
 		fini_completion(&pt->upt_completion);
 
@@ -149,6 +170,10 @@ usocklnd_release_poll_states(int n)
                              sizeof(struct pollfd) * pt->upt_npollfd);
                 LIBCFS_FREE (pt->upt_idx2conn,
                               sizeof(usock_conn_t *) * pt->upt_npollfd);
+                LIBCFS_FREE (pt->upt_ready,
+                              sizeof(int) * pt->upt_npollfd);
+                LIBCFS_FREE (pt->upt_tx_iov,
+                              sizeof(struct iovec) * UPT_TX_NIOV);
                 LIBCFS_FREE (pt->upt_fd2idx,
                               sizeof(int) * pt->upt_nfd2idx);
         }
@@ -204,6 +229,11 @@ usocklnd_update_tunables()
         if (rc)
                 return rc;
 
+        rc = lnet_parse_int_tunable(&usock_tuns.ut_epoll,
+                                      "USOCK_EPOLL");
+        if (rc)
+                return rc;
+
         if (usocklnd_validate_tunables())
                 return -EINVAL;
 
@@ -269,11 +299,26 @@ usocklnd_base_startup()
                 if (pt->upt_skip == NULL)
                         goto base_startup_failed_3;
 
+                LIBCFS_ALLOC (pt->upt_ready,
+                              sizeof(int) * UPT_START_SIZ);
+                if (pt->upt_ready == NULL)
+                        goto base_startup_failed_4;
+
+                LIBCFS_ALLOC (pt->upt_tx_iov,
+                              sizeof(struct iovec) * UPT_TX_NIOV);
+                if (pt->upt_tx_iov == NULL)
+                        goto base_startup_failed_5;
+
                 pt->upt_npollfd = pt->upt_nfd2idx = UPT_START_SIZ;
+                pt->upt_nready = 0;
 
                 rc = libcfs_socketpair(pt->upt_notifier);
                 if (rc != 0)
-                        goto base_startup_failed_4;
+                        goto base_startup_failed_6;
+
+                rc = usocklnd_epoll_init(pt);
+                if (rc != 0)
+                        goto base_startup_failed_7;
 
                 pt->upt_pollfd[0].fd = LIBCFS_SOCK2FD(pt->upt_notifier[1]);
                 pt->upt_pollfd[0].events = POLLIN;
@@ -310,6 +355,13 @@ usocklnd_base_startup()
 
         return 0;
 
+  base_startup_failed_7:
+        libcfs_sock_release(pt->upt_notifier[0]);
+        libcfs_sock_release(pt->upt_notifier[1]);
+  base_startup_failed_6:
+        LIBCFS_FREE (pt->upt_tx_iov, sizeof(struct iovec) * UPT_TX_NIOV);
+  base_startup_failed_5:
+        LIBCFS_FREE (pt->upt_ready, sizeof(int) * UPT_START_SIZ);
   base_startup_failed_4:
         LIBCFS_FREE (pt->upt_skip, sizeof(int) * UPT_START_SIZ);
   base_startup_failed_3:
@@ -42,6 +42,9 @@
 #endif
 #include <pthread.h>
 #include <poll.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 #include <lnet/lib-lnet.h>
 #include <lnet/socklnd.h>
 
@@ -86,6 +89,8 @@ typedef struct {
         void              *uc_rx_lnetmsg;    /* LNET message being received */
         cfs_time_t         uc_rx_deadline;   /* when to time out */
         int                uc_rx_flag;       /* deadline valid? */
+        int                uc_rx_eagain;     /* last read found socket
+                                              * drained? */
         ksock_msg_t        uc_rx_msg;        /* message buffer */
 
         /* Send state */
@@ -150,6 +155,13 @@ typedef struct {
                                                  * by fd */
         int                 upt_nfd2idx;        /* # of allocated elements
                                                  * of upt_fd2idx[] */
+        int                 upt_epfd;           /* epoll fd, -1 if poll(2)
+                                                 * is used */
+        int                *upt_ready;          /* fds epoll reported ready
+                                                 * and not drained yet */
+        int                 upt_nready;         /* # of upt_ready[] in use */
+        struct iovec       *upt_tx_iov;         /* to gather queued txs
+                                                 * into one writev() */
         cfs_list_t          upt_stale_list;     /* list of orphaned conns */
         cfs_list_t          upt_pollrequests;   /* list of poll requests */
         pthread_mutex_t     upt_pollrequests_lock; /* serialize */
@@ -162,6 +174,13 @@ typedef struct {
  * at initialization time. Will be resized on demand */
 #define UPT_START_SIZ 32
 
+/* # of events taken by one epoll_wait() */
+#define UPT_EPOLL_EVENTS 64
+
+/* Size of upt_tx_iov[]: a single tx takes up to LNET_MAX_IOV + 1 frags,
+ * and it stays within IOV_MAX */
+#define UPT_TX_NIOV (2 * (LNET_MAX_IOV + 1))
+
 /* # peer lists */
 #define UD_PEER_HASH_SIZE  101
 
@@ -200,6 +219,7 @@ typedef struct {
         int ut_peertxcredits; /* # concurrent sends to 1 peer */
         int ut_socknagle;     /* Is Nagle alg on ? */
         int ut_sockbufsiz;    /* size of socket buffers */
+        int ut_epoll;         /* use epoll(7) rather than poll(2) ? */
 } usock_tunables_t;
 
 extern usock_tunables_t usock_tuns;
@@ -285,8 +305,11 @@ void usocklnd_add_killrequest(usock_conn_t *conn);
 int usocklnd_process_pollrequest(usock_pollrequest_t *pr,
                                  usock_pollthread_t *pt_data);
 void usocklnd_execute_handlers(usock_pollthread_t *pt_data);
+void usocklnd_execute_ready(usock_pollthread_t *pt_data);
 int usocklnd_calculate_chunk_size(int num);
 void usocklnd_wakeup_pollthread(int i);
+int usocklnd_epoll_init(usock_pollthread_t *pt_data);
+void usocklnd_epoll_fini(usock_pollthread_t *pt_data);
 
 int usocklnd_notifier_handler(int fd);
 void usocklnd_exception_handler(usock_conn_t *conn);
@@ -302,6 +325,7 @@ usock_tx_t * usocklnd_try_piggyback(cfs_list_t *tx_list_p,
 int usocklnd_activeconn_hellosent(usock_conn_t *conn);
 int usocklnd_passiveconn_hellosent(usock_conn_t *conn);
 int usocklnd_send_tx(usock_conn_t *conn, usock_tx_t *tx);
+int usocklnd_send_txs(usock_conn_t *conn, cfs_list_t *txs);
 int usocklnd_read_data(usock_conn_t *conn);
 
 void usocklnd_release_poll_states(int n);
@@ -1269,6 +1269,76 @@ jt_ptl_notify_router (int argc, char **argv)
         return (0);
 }
 
+int
+jt_ptl_add_rail(int argc, char **argv)
+{
+	struct libcfs_ioctl_data data;
+	lnet_nid_t		 primary;
+	lnet_nid_t		 nid;
+	int			 rc;
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s primaryNID railNID\n", argv[0]);
+		return 0;
+	}
+
+	primary = libcfs_str2nid(argv[1]);
+	if (primary == LNET_NID_ANY) {
+		fprintf(stderr, "Can't parse NID \"%s\"\n", argv[1]);
+		return -1;
+	}
+
+	nid = libcfs_str2nid(argv[2]);
+	if (nid == LNET_NID_ANY) {
+		fprintf(stderr, "Can't parse NID \"%s\"\n", argv[2]);
+		return -1;
+	}
+
+	LIBCFS_IOC_INIT(data);
+	data.ioc_nid = primary;
+	data.ioc_u64[0] = nid;
+
+	rc = l_ioctl(LNET_DEV_ID, IOC_LIBCFS_ADD_RAIL, &data);
+	if (rc != 0) {
+		fprintf(stderr, "IOC_LIBCFS_ADD_RAIL (%s %s) failed: %s\n",
+			argv[1], argv[2], strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+jt_ptl_del_rail(int argc, char **argv)
+{
+	struct libcfs_ioctl_data data;
+	lnet_nid_t		 nid;
+	int			 rc;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s NID\n", argv[0]);
+		return 0;
+	}
+
+	nid = libcfs_str2nid(argv[1]);
+	if (nid == LNET_NID_ANY) {
+		fprintf(stderr, "Can't parse NID \"%s\"\n", argv[1]);
+		return -1;
+	}
+
+	LIBCFS_IOC_INIT(data);
+	data.ioc_nid = nid;
+
+	rc = l_ioctl(LNET_DEV_ID, IOC_LIBCFS_DEL_RAIL, &data);
+	if (rc != 0) {
+		fprintf(stderr, "IOC_LIBCFS_DEL_RAIL (%s) failed: %s\n",
+			libcfs_nid2str(nid), strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
 int
 jt_ptl_print_routes (int argc, char **argv)
 {
@@ -48,6 +48,10 @@ command_t list[] = {
         {"set_route", jt_ptl_notify_router, 0, 
          "enable/disable a route in the routing table (args: gatewayNID up/down [time]"},
         {"print_routes", jt_ptl_print_routes, 0, "print the routing table (args: none)"},
+        {"add_rail", jt_ptl_add_rail, 0,
+         "use another NID of a peer together with its primary NID (args: primaryNID railNID)"},
+        {"del_rail", jt_ptl_del_rail, 0,
+         "stop using a NID as a rail of its peer (args: NID)"},
         {"dump", jt_ioc_dump, 0, "usage: dump file, save ioctl buffer to file"},
         {"fail", jt_ptl_fail_nid, 0, "usage: fail nid|_all_ [count]"},
         {"testprotocompat", jt_ptl_testprotocompat, 0, "usage: testprotocompat count"},
@@ -0,0 +1,342 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lnet/utils/usocklnd_bench.c
+ *
+ * Loopback throughput benchmark for the userspace socket LND. A server
+ * process and a client process both run LNet in userspace over the
+ * "tcp(lo)" network, so no kernel module is needed; the client keeps a
+ * window of PUTs in flight and both sides report what they moved.
+ * Compare the poll() and epoll backends by running it with USOCK_EPOLL=0
+ * and USOCK_EPOLL=1; the server side must run as root. With
+ * LNET_COALESCE_SIZE set to hold at least two PUTs, both sides also check
+ * that the PUTs travelled in BATCHes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <lnet/lnetctl.h>
+#include <lnet/api.h>
+#include <lnet/lib-lnet.h>
+
+#define error(fmt, args...) do {                        \
+	fflush(stdout), fflush(stderr);                 \
+	fprintf(stderr, "\nError:" fmt, ##args);        \
+	exit(1);                                        \
+} while (0)
+
+#define UB_PORTAL	31
+#define UB_MATCHBITS	0x5553424e43484dULL
+/* upper bound on the PUT window */
+#define UB_MAX_WINDOW	1024
+
+static unsigned int ub_size = 4096;
+static unsigned int ub_count = 100000;
+static unsigned int ub_window = 32;
+
+static double ub_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void ub_report(const char *who, unsigned int msgs, double elapsed)
+{
+	double mb = (double)msgs * ub_size / (1 << 20);
+
+	if (elapsed <= 0)
+		elapsed = 1e-6;
+	printf("%s: %u x %u bytes in %.3fs: %10.1f MB/s %10.0f msgs/s\n",
+	       who, msgs, ub_size, elapsed, mb / elapsed, msgs / elapsed);
+}
+
+static void ub_lnet_init(int server)
+{
+	int rc;
+
+	rc = libcfs_debug_init(5 * 1024 * 1024);
+	if (rc != 0)
+		error("libcfs_debug_init() failed: %d\n", rc);
+
+	rc = LNetInit();
+	if (rc != 0)
+		error("LNetInit() failed: %d\n", rc);
+
+	if (server)
+		lnet_server_mode();
+
+	rc = LNetNIInit(LUSTRE_LNET_PID);
+	if (rc < 0)
+		error("LNetNIInit() failed: %d\n", rc);
+}
+
+/* report the BATCHes sent or received, which coalescing must produce */
+static void ub_batch_check(const char *who, int tx)
+{
+	lnet_batch_counters_t bctrs;
+	__u64 batches;
+	__u64 msgs;
+
+	if (the_lnet.ln_coalesce_size < 2 * LNET_BATCH_REC_SIZE(ub_size))
+		return;
+
+	lnet_batch_counters_get(&bctrs);
+	batches = tx ? bctrs.tx_batches : bctrs.rx_batches;
+	msgs = tx ? bctrs.tx_msgs : bctrs.rx_msgs;
+
+	printf("%s: %llu messages in %llu BATCHes\n", who,
+	       (unsigned long long)msgs, (unsigned long long)batches);
+	if (batches == 0 || msgs < 2 * batches)
+		error("%s: no PUTs were coalesced with LNET_COALESCE_SIZE=%d\n",
+		      who, the_lnet.ln_coalesce_size);
+}
+
+static void ub_lnet_fini(void)
+{
+	LNetNIFini();
+	LNetFini();
+	libcfs_debug_cleanup();
+}
+
+/* take PUTs until the client has sent all of them; the MD unlinks itself
+ * after the last one, since BATCHes can deliver PUTs faster than they are
+ * polled and an overflowing event queue drops events */
+static void ub_server(int ready_fd)
+{
+	lnet_process_id_t any = { .nid = LNET_NID_ANY, .pid = LNET_PID_ANY };
+	lnet_handle_eq_t eqh;
+	lnet_handle_me_t meh;
+	lnet_handle_md_t mdh;
+	lnet_md_t md;
+	lnet_event_t ev;
+	unsigned int got = 0;
+	double begin = 0;
+	void *buf;
+	int which;
+	int rc;
+
+	buf = malloc(ub_size > 0 ? ub_size : 1);
+	if (buf == NULL)
+		error("no memory\n");
+
+	ub_lnet_init(1);
+
+	rc = LNetEQAlloc(UB_MAX_WINDOW * 2, LNET_EQ_HANDLER_NONE, &eqh);
+	if (rc != 0)
+		error("LNetEQAlloc() failed: %d\n", rc);
+
+	rc = LNetMEAttach(UB_PORTAL, any, UB_MATCHBITS, 0, LNET_UNLINK,
+			  LNET_INS_AFTER, &meh);
+	if (rc != 0)
+		error("LNetMEAttach() failed: %d\n", rc);
+
+	memset(&md, 0, sizeof(md));
+	md.start     = buf;
+	md.length    = ub_size;
+	md.threshold = ub_count;
+	md.options   = LNET_MD_OP_PUT | LNET_MD_MANAGE_REMOTE;
+	md.eq_handle = eqh;
+
+	rc = LNetMDAttach(meh, md, LNET_UNLINK, &mdh);
+	if (rc != 0)
+		error("LNetMDAttach() failed: %d\n", rc);
+
+	/* the client may connect now */
+	if (write(ready_fd, "", 1) != 1)
+		error("cannot signal the client: %s\n", strerror(errno));
+	close(ready_fd);
+
+	for (;;) {
+		rc = LNetEQPoll(&eqh, 1, 10000, &ev, &which);
+		if (rc == 0)
+			error("server: no traffic after %u PUTs\n", got);
+		if (rc < 0 && rc != -EOVERFLOW)
+			error("server: LNetEQPoll() failed: %d\n", rc);
+		if (ev.type != LNET_EVENT_PUT)
+			continue;
+		if (ev.status != 0)
+			error("server: PUT failed: %d\n", ev.status);
+		if (got++ == 0)
+			begin = ub_now();
+		if (ev.unlinked)
+			break;
+	}
+	ub_report("server", ub_count - 1, ub_now() - begin);
+	ub_batch_check("server", 0);
+
+	LNetEQFree(eqh); /* the ME went with the MD */
+	ub_lnet_fini();
+	free(buf);
+}
+
+static void ub_client(void)
+{
+	lnet_process_id_t target;
+	lnet_handle_eq_t eqh;
+	lnet_handle_md_t mdh;
+	lnet_md_t md;
+	lnet_event_t ev;
+	unsigned int sent = 0;
+	unsigned int done = 0;
+	double begin;
+	void *buf;
+	int which;
+	int rc;
+
+	buf = malloc(ub_size > 0 ? ub_size : 1);
+	if (buf == NULL)
+		error("no memory\n");
+	memset(buf, 0x5a, ub_size);
+
+	ub_lnet_init(0);
+
+	rc = LNetGetId(1, &target);
+	if (rc != 0)
+		error("no usocklnd network is configured, set LNET_NETWORKS\n");
+	target.pid = LUSTRE_SRV_LNET_PID;
+
+	rc = LNetEQAlloc(UB_MAX_WINDOW * 2, LNET_EQ_HANDLER_NONE, &eqh);
+	if (rc != 0)
+		error("LNetEQAlloc() failed: %d\n", rc);
+
+	memset(&md, 0, sizeof(md));
+	md.start     = buf;
+	md.length    = ub_size;
+	md.threshold = LNET_MD_THRESH_INF;
+	md.eq_handle = eqh;
+
+	rc = LNetMDBind(md, LNET_RETAIN, &mdh);
+	if (rc != 0)
+		error("LNetMDBind() failed: %d\n", rc);
+
+	begin = ub_now();
+	while (done < ub_count) {
+		while (sent < ub_count && sent - done < ub_window) {
+			rc = LNetPut(LNET_NID_ANY, mdh, LNET_NOACK_REQ, target,
+				     UB_PORTAL, UB_MATCHBITS, 0, 0);
+			if (rc != 0)
+				error("LNetPut() failed: %d\n", rc);
+			sent++;
+		}
+
+		rc = LNetEQPoll(&eqh, 1, 10000, &ev, &which);
+		if (rc == 0)
+			error("client: no completion after %u PUTs\n", done);
+		if (rc < 0 && rc != -EOVERFLOW)
+			error("client: LNetEQPoll() failed: %d\n", rc);
+		if (ev.type != LNET_EVENT_SEND)
+			continue;
+		if (ev.status != 0)
+			error("client: PUT to %s failed: %d\n",
+			      libcfs_id2str(target), ev.status);
+		done++;
+	}
+	ub_report("client", done, ub_now() - begin);
+	ub_batch_check("client", 1);
+
+	LNetMDUnlink(mdh);
+	LNetEQFree(eqh);
+	ub_lnet_fini();
+	free(buf);
+}
+
+static void usage(char *prog)
+{
+	fprintf(stderr, "usage: %s [-s bytes] [-n count] [-w window]\n", prog);
+	fprintf(stderr, "  -s  payload of each PUT in bytes (default 4096)\n"
+		"  -n  number of PUTs to send (default 100000)\n"
+		"  -w  PUTs kept in flight by the client (default 32)\n"
+		"LNET_NETWORKS defaults to \"tcp(lo)\"; set USOCK_EPOLL=0 "
+		"to use poll(); set LNET_COALESCE_SIZE to check that small "
+		"PUTs are sent in BATCHes\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	int ready[2];
+	int status;
+	pid_t pid;
+	char c;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:n:w:")) != -1) {
+		switch (opt) {
+		case 's':
+			ub_size = atoi(optarg);
+			break;
+		case 'n':
+			ub_count = atoi(optarg);
+			break;
+		case 'w':
+			ub_window = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || ub_size > LNET_MTU || ub_count < 2 ||
+	    ub_window == 0 || ub_window > UB_MAX_WINDOW)
+		usage(argv[0]);
+
+	/* the client is not root and connects from an unprivileged port */
+	setenv("LNET_NETWORKS", "tcp(lo)", 0);
+	setenv("LNET_ACCEPT", "all", 0);
+
+	if (pipe(ready) != 0)
+		error("pipe: %s\n", strerror(errno));
+
+	pid = fork();
+	if (pid < 0)
+		error("fork: %s\n", strerror(errno));
+	if (pid == 0) {
+		close(ready[0]);
+		ub_server(ready[1]);
+		return 0;
+	}
+
+	close(ready[1]);
+	if (read(ready[0], &c, 1) != 1)
+		error("server failed to start\n");
+	close(ready[0]);
+
+	ub_client();
+
+	if (waitpid(pid, &status, 0) != pid)
+		error("waitpid: %s\n", strerror(errno));
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		error("server exited with status %d\n", status);
+
+	return 0;
+}
@@ -151,6 +151,10 @@ check_lnet_hdr (void)
         COMMENT ("Hello");
         CHECK_MEMBER (lnet_hdr_t, msg.hello.incarnation);
         CHECK_MEMBER (lnet_hdr_t, msg.hello.type);
+
+        BLANK_LINE ();
+        COMMENT ("Batch");
+        CHECK_MEMBER (lnet_hdr_t, msg.batch.count);
 }
 
 void
@@ -236,6 +240,7 @@ main (int argc, char **argv)
         CHECK_VALUE (LNET_MSG_GET);
         CHECK_VALUE (LNET_MSG_REPLY);
         CHECK_VALUE (LNET_MSG_HELLO);
+        CHECK_VALUE (LNET_MSG_BATCH);
 
         check_lnet_handle_wire ();
         check_lnet_magicversion ();
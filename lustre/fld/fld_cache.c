@@ -63,6 +63,8 @@ struct fld_cache *fld_cache_init(const char *name,
                                  int cache_size, int cache_threshold)
 {
         struct fld_cache *cache;
+	struct fld_cache_hit *hit;
+	int i;
         ENTRY;
 
         LASSERT(name != NULL);
@@ -72,6 +74,18 @@ struct fld_cache *fld_cache_init(const char *name,
         if (cache == NULL)
                 RETURN(ERR_PTR(-ENOMEM));
 
+	cache->fci_hits = cfs_percpt_alloc(cfs_cpt_table, sizeof(*hit));
+	if (cache->fci_hits == NULL) {
+		OBD_FREE_PTR(cache);
+		RETURN(ERR_PTR(-ENOMEM));
+	}
+
+	cfs_percpt_for_each(hit, i, cache->fci_hits) {
+		spin_lock_init(&hit->fch_lock);
+		hit->fch_generation = -1;
+	}
+	cfs_atomic_set(&cache->fci_generation, 0);
+
         CFS_INIT_LIST_HEAD(&cache->fci_entries_head);
         CFS_INIT_LIST_HEAD(&cache->fci_lru);
 
@@ -116,17 +130,91 @@ void fld_cache_fini(struct fld_cache *cache)
         CDEBUG(D_INFO, "  Cache reqs: "LPU64"\n", cache->fci_stat.fst_cache);
         CDEBUG(D_INFO, "  Cache hits: "LPU64"%%\n", pct);
 
+	LASSERT(cache->fci_tree == NULL);
+	cfs_percpt_free(cache->fci_hits);
         OBD_FREE_PTR(cache);
 
         EXIT;
 }
 
+/**
+ * Invalidate the per-CPT last hit caches; called whenever fld entries are
+ * added, removed or changed, with fci_lock held for writing.
+ */
+static inline void fld_cache_invalidate(struct fld_cache *cache)
+{
+	cfs_atomic_inc(&cache->fci_generation);
+}
+
+/**
+ * add \a flde to the interval tree. If an entry that covers the same extent
+ * is there already, \a flde is linked to it instead.
+ */
+static void fld_cache_entry_index(struct fld_cache *cache,
+				  struct fld_cache_entry *flde)
+{
+	const struct lu_seq_range *range = &flde->fce_range;
+	struct interval_node *twin;
+
+	interval_set(&flde->fce_node, range->lsr_start,
+		     range->lsr_end > range->lsr_start ?
+		     range->lsr_end - 1 : range->lsr_start);
+
+	twin = interval_insert(&flde->fce_node, &cache->fci_tree);
+	if (twin != NULL)
+		cfs_list_add_tail(&flde->fce_twins,
+				  &container_of(twin, struct fld_cache_entry,
+						fce_node)->fce_twins);
+}
+
+/**
+ * remove \a flde from the interval tree, handing its place over to an entry
+ * that covers the same extent, if there is one.
+ */
+static void fld_cache_entry_unindex(struct fld_cache *cache,
+				    struct fld_cache_entry *flde)
+{
+	struct fld_cache_entry *twin;
+	struct interval_node   *node;
+
+	if (!interval_is_intree(&flde->fce_node)) {
+		cfs_list_del_init(&flde->fce_twins);
+		return;
+	}
+
+	interval_erase(&flde->fce_node, &cache->fci_tree);
+	if (cfs_list_empty(&flde->fce_twins))
+		return;
+
+	twin = cfs_list_entry(flde->fce_twins.next, struct fld_cache_entry,
+			      fce_twins);
+	cfs_list_del_init(&flde->fce_twins);
+
+	interval_set(&twin->fce_node, interval_low(&twin->fce_node),
+		     interval_high(&twin->fce_node));
+	node = interval_insert(&twin->fce_node, &cache->fci_tree);
+	LASSERT(node == NULL);
+}
+
+/**
+ * update the interval tree after the range of \a flde has been changed.
+ */
+static void fld_cache_entry_reindex(struct fld_cache *cache,
+				    struct fld_cache_entry *flde)
+{
+	fld_cache_invalidate(cache);
+	fld_cache_entry_unindex(cache, flde);
+	fld_cache_entry_index(cache, flde);
+}
+
 /**
  * delete given node from list.
  */
 void fld_cache_entry_delete(struct fld_cache *cache,
 			    struct fld_cache_entry *node)
 {
+	fld_cache_invalidate(cache);
+	fld_cache_entry_unindex(cache, node);
 	cfs_list_del(&node->fce_list);
 	cfs_list_del(&node->fce_lru);
 	cache->fci_cache_count--;
@@ -134,29 +222,39 @@ void fld_cache_entry_delete(struct fld_cache *cache,
 }
 
 /**
- * fix list by checking new entry with NEXT entry in order.
+ * fix list by checking entries around \a f_mod, which has just been added or
+ * changed, with NEXT entry in order.
+ *
+ * The rest of the list is known to be in order already, so the check starts
+ * with the entry before \a f_mod, and stops as soon as a pair of entries past
+ * all changed ranges needs no fixing.
  */
-static void fld_fix_new_list(struct fld_cache *cache)
+static void fld_fix_new_list(struct fld_cache *cache,
+			     struct fld_cache_entry *f_mod)
 {
         struct fld_cache_entry *f_curr;
         struct fld_cache_entry *f_next;
         struct lu_seq_range *c_range;
         struct lu_seq_range *n_range;
         cfs_list_t *head = &cache->fci_entries_head;
+	cfs_list_t *pos;
+	seqno_t stop = f_mod->fce_range.lsr_end;
         ENTRY;
 
-restart_fixup:
+	pos = f_mod->fce_list.prev != head ? f_mod->fce_list.prev :
+					     &f_mod->fce_list;
 
-        cfs_list_for_each_entry_safe(f_curr, f_next, head, fce_list) {
+	while (pos != head && pos->next != head) {
+		f_curr = cfs_list_entry(pos, struct fld_cache_entry, fce_list);
+		f_next = cfs_list_entry(pos->next, struct fld_cache_entry,
+					fce_list);
                 c_range = &f_curr->fce_range;
                 n_range = &f_next->fce_range;
 
                 LASSERT(range_is_sane(c_range));
-                if (&f_next->fce_list == head)
-                        break;
 
 		if (c_range->lsr_flags != n_range->lsr_flags)
-			continue;
+			goto next;
 
                 LASSERTF(c_range->lsr_start <= n_range->lsr_start,
                          "cur lsr_start "DRANGE" next lsr_start "DRANGE"\n",
@@ -165,9 +263,12 @@ restart_fixup:
                 /* check merge possibility with next range */
                 if (c_range->lsr_end == n_range->lsr_start) {
                         if (c_range->lsr_index != n_range->lsr_index)
-                                continue;
+				goto next;
                         n_range->lsr_start = c_range->lsr_start;
+			fld_cache_entry_reindex(cache, f_next);
                         fld_cache_entry_delete(cache, f_curr);
+			stop = max(stop, n_range->lsr_end);
+			pos = &f_next->fce_list;
                         continue;
                 }
 
@@ -177,24 +278,39 @@ restart_fixup:
                                 n_range->lsr_start = c_range->lsr_start;
                                 n_range->lsr_end = max(c_range->lsr_end,
                                                        n_range->lsr_end);
+				fld_cache_entry_reindex(cache, f_next);
                                 fld_cache_entry_delete(cache, f_curr);
                         } else {
                                 if (n_range->lsr_end <= c_range->lsr_end) {
                                         *n_range = *c_range;
+					fld_cache_entry_reindex(cache, f_next);
                                         fld_cache_entry_delete(cache, f_curr);
-                                } else
+				} else {
                                         n_range->lsr_start = c_range->lsr_end;
+					fld_cache_entry_reindex(cache, f_next);
+				}
                         }
 
-                        /* we could have overlap over next
-                         * range too. better restart. */
-                        goto restart_fixup;
+			/* we could have overlap over next range too. better
+			 * restart, from the entry before the changed one. */
+			stop = max(stop, n_range->lsr_end);
+			pos = f_next->fce_list.prev != head ?
+			      f_next->fce_list.prev : &f_next->fce_list;
+			continue;
                 }
 
                 /* kill duplicates */
 		if (c_range->lsr_start == n_range->lsr_start &&
-		    c_range->lsr_end == n_range->lsr_end)
+		    c_range->lsr_end == n_range->lsr_end) {
 			fld_cache_entry_delete(cache, f_curr);
+			pos = &f_next->fce_list;
+			continue;
+		}
+next:
+		/* nothing was changed beyond this point */
+		if (c_range->lsr_start > stop)
+			break;
+		pos = pos->next;
         }
 
         EXIT;
@@ -211,7 +327,9 @@ static inline void fld_cache_entry_add(struct fld_cache *cache,
         cfs_list_add(&f_new->fce_lru, &cache->fci_lru);
 
         cache->fci_cache_count++;
-        fld_fix_new_list(cache);
+	fld_cache_invalidate(cache);
+	fld_cache_entry_index(cache, f_new);
+	fld_fix_new_list(cache, f_new);
 }
 
 /**
@@ -284,6 +402,7 @@ static void fld_cache_punch_hole(struct fld_cache *cache,
                 /* overlap is not allowed, so dont mess up list. */
                 return;
         }
+	CFS_INIT_LIST_HEAD(&fldt->fce_twins);
         /*  break f_curr RANGE into three RANGES:
          *        f_curr, f_new , fldt
          */
@@ -297,6 +416,7 @@ static void fld_cache_punch_hole(struct fld_cache *cache,
 
         /* f_curr */
         f_curr->fce_range.lsr_end = new_start;
+	fld_cache_entry_reindex(cache, f_curr);
 
         /* add these two entries to list */
         fld_cache_entry_add(cache, f_new, &f_curr->fce_list);
@@ -327,9 +447,10 @@ static void fld_cache_overlap_handle(struct fld_cache *cache,
 
                 f_curr->fce_range.lsr_end = max(f_curr->fce_range.lsr_end,
                                                 new_end);
+		fld_cache_entry_reindex(cache, f_curr);
 
                 OBD_FREE_PTR(f_new);
-                fld_fix_new_list(cache);
+		fld_fix_new_list(cache, f_curr);
 
         } else if (new_start <= f_curr->fce_range.lsr_start &&
                         f_curr->fce_range.lsr_end <= new_end) {
@@ -337,8 +458,9 @@ static void fld_cache_overlap_handle(struct fld_cache *cache,
                  *         e.g. whole range migrated. update fld cache entry */
 
                 f_curr->fce_range = *range;
+		fld_cache_entry_reindex(cache, f_curr);
                 OBD_FREE_PTR(f_new);
-                fld_fix_new_list(cache);
+		fld_fix_new_list(cache, f_curr);
 
         } else if (f_curr->fce_range.lsr_start < new_start &&
                         new_end < f_curr->fce_range.lsr_end) {
@@ -354,6 +476,7 @@ static void fld_cache_overlap_handle(struct fld_cache *cache,
                 LASSERT(new_start <= f_curr->fce_range.lsr_start);
 
                 f_curr->fce_range.lsr_start = new_end;
+		fld_cache_entry_reindex(cache, f_curr);
                 fld_cache_entry_add(cache, f_new, f_curr->fce_list.prev);
 
         } else if (f_curr->fce_range.lsr_start <= new_start) {
@@ -364,6 +487,7 @@ static void fld_cache_overlap_handle(struct fld_cache *cache,
                 LASSERT(f_curr->fce_range.lsr_end <= new_end);
 
                 f_curr->fce_range.lsr_end = new_start;
+		fld_cache_entry_reindex(cache, f_curr);
                 fld_cache_entry_add(cache, f_new, &f_curr->fce_list);
         } else
                 CERROR("NEW range ="DRANGE" curr = "DRANGE"\n",
@@ -382,9 +506,106 @@ struct fld_cache_entry
 		RETURN(ERR_PTR(-ENOMEM));
 
 	f_new->fce_range = *range;
+	CFS_INIT_LIST_HEAD(&f_new->fce_twins);
 	RETURN(f_new);
 }
 
+/**
+ * Query against fld_cache::fci_tree, see fld_cache_search().
+ */
+struct fld_cache_query {
+	/** whether an entry is a match */
+	int			(*fcq_match)(struct fld_cache_query *query,
+					     struct fld_cache_entry *flde);
+	seqno_t			  fcq_seq;
+	const struct lu_seq_range *fcq_range;
+	/** the matching entry with the lowest lsr_start */
+	struct fld_cache_entry	 *fcq_found;
+};
+
+static void fld_cache_query_check(struct fld_cache_query *query,
+				  struct fld_cache_entry *flde)
+{
+	if (query->fcq_match(query, flde) &&
+	    (query->fcq_found == NULL ||
+	     flde->fce_range.lsr_start <
+	     query->fcq_found->fce_range.lsr_start))
+		query->fcq_found = flde;
+}
+
+static enum interval_iter fld_cache_query_cb(struct interval_node *node,
+					     void *args)
+{
+	struct fld_cache_query *query = args;
+	struct fld_cache_entry *flde;
+	struct fld_cache_entry *twin;
+
+	flde = container_of(node, struct fld_cache_entry, fce_node);
+	fld_cache_query_check(query, flde);
+	cfs_list_for_each_entry(twin, &flde->fce_twins, fce_twins)
+		fld_cache_query_check(query, twin);
+
+	return INTERVAL_ITER_CONT;
+}
+
+/**
+ * Look for the first entry in order, i.e. the one with the lowest lsr_start,
+ * among the ones indexed in [start, end] that \a query matches.
+ */
+static void fld_cache_search(struct fld_cache *cache, __u64 start, __u64 end,
+			     struct fld_cache_query *query)
+{
+	struct interval_node_extent ext = { .start = start, .end = end };
+
+	interval_search(cache->fci_tree, &ext, fld_cache_query_cb, query);
+}
+
+/**
+ * the new range overlaps, or is adjacent to, \a flde of the same type.
+ */
+static int fld_cache_match_overlap(struct fld_cache_query *query,
+				   struct fld_cache_entry *flde)
+{
+	const struct lu_seq_range *range = query->fcq_range;
+
+	return range->lsr_flags == flde->fce_range.lsr_flags &&
+	       flde->fce_range.lsr_start <= range->lsr_end &&
+	       range->lsr_start < flde->fce_range.lsr_end;
+}
+
+/**
+ * Find the last entry in order whose lsr_start is below \a seq; entries with
+ * the same lsr_start follow each other, and only one of them is in the tree.
+ */
+static cfs_list_t *fld_cache_pos_before(struct fld_cache *cache, seqno_t seq)
+{
+	struct interval_node *node = cache->fci_tree;
+	struct interval_node *best = NULL;
+	cfs_list_t *head = &cache->fci_entries_head;
+	cfs_list_t *pos;
+
+	while (node != NULL) {
+		if (interval_low(node) < seq) {
+			best = node;
+			node = node->in_right;
+		} else {
+			node = node->in_left;
+		}
+	}
+
+	if (best == NULL)
+		return head;
+
+	pos = &container_of(best, struct fld_cache_entry,
+			    fce_node)->fce_list;
+	while (pos->next != head &&
+	       cfs_list_entry(pos->next, struct fld_cache_entry,
+			      fce_list)->fce_range.lsr_start < seq)
+		pos = pos->next;
+
+	return pos;
+}
+
 /**
  * Insert FLD entry in FLD cache.
  *
@@ -394,13 +615,10 @@ struct fld_cache_entry
 int fld_cache_insert_nolock(struct fld_cache *cache,
 			    struct fld_cache_entry *f_new)
 {
-	struct fld_cache_entry *f_curr;
-	struct fld_cache_entry *n;
-	cfs_list_t *head;
-	cfs_list_t *prev = NULL;
-	const seqno_t new_start  = f_new->fce_range.lsr_start;
-	const seqno_t new_end  = f_new->fce_range.lsr_end;
-	__u32 new_flags  = f_new->fce_range.lsr_flags;
+	struct fld_cache_query query = {
+		.fcq_match	= fld_cache_match_overlap,
+		.fcq_range	= &f_new->fce_range,
+	};
 	ENTRY;
 
 	/*
@@ -412,31 +630,19 @@ int fld_cache_insert_nolock(struct fld_cache *cache,
 	if (!cache->fci_no_shrink)
 		fld_cache_shrink(cache);
 
-	head = &cache->fci_entries_head;
-
-	cfs_list_for_each_entry_safe(f_curr, n, head, fce_list) {
-		/* add list if next is end of list */
-		if (new_end < f_curr->fce_range.lsr_start ||
-		   (new_end == f_curr->fce_range.lsr_start &&
-		    new_flags != f_curr->fce_range.lsr_flags))
-			break;
-
-		prev = &f_curr->fce_list;
-		/* check if this range is to left of new range. */
-		if (new_start < f_curr->fce_range.lsr_end &&
-		    new_flags == f_curr->fce_range.lsr_flags) {
-			fld_cache_overlap_handle(cache, f_curr, f_new);
-			goto out;
-		}
+	/* check if an entry of the same type overlaps with the new range. */
+	fld_cache_search(cache, f_new->fce_range.lsr_start,
+			 f_new->fce_range.lsr_end, &query);
+	if (query.fcq_found != NULL) {
+		fld_cache_overlap_handle(cache, query.fcq_found, f_new);
+		RETURN(0);
 	}
 
-	if (prev == NULL)
-		prev = head;
-
 	CDEBUG(D_INFO, "insert range "DRANGE"\n", PRANGE(&f_new->fce_range));
 	/* Add new entry to cache and lru list. */
-	fld_cache_entry_add(cache, f_new, prev);
-out:
+	fld_cache_entry_add(cache, f_new,
+			    fld_cache_pos_before(cache,
+						 f_new->fce_range.lsr_end));
 	RETURN(0);
 }
 
@@ -463,19 +669,10 @@ void fld_cache_delete_nolock(struct fld_cache *cache,
 		      const struct lu_seq_range *range)
 {
 	struct fld_cache_entry *flde;
-	struct fld_cache_entry *tmp;
-	cfs_list_t *head;
-
-	head = &cache->fci_entries_head;
-	cfs_list_for_each_entry_safe(flde, tmp, head, fce_list) {
-		/* add list if next is end of list */
-		if (range->lsr_start == flde->fce_range.lsr_start ||
-		   (range->lsr_end == flde->fce_range.lsr_end &&
-		    range->lsr_flags == flde->fce_range.lsr_flags)) {
-			fld_cache_entry_delete(cache, flde);
-			break;
-		}
-	}
+
+	flde = fld_cache_entry_lookup_nolock(cache, range);
+	if (flde != NULL)
+		fld_cache_entry_delete(cache, flde);
 }
 
 /**
@@ -490,25 +687,32 @@ void fld_cache_delete(struct fld_cache *cache,
 	write_unlock(&cache->fci_lock);
 }
 
+static int fld_cache_match_entry(struct fld_cache_query *query,
+				 struct fld_cache_entry *flde)
+{
+	const struct lu_seq_range *range = query->fcq_range;
+
+	return range->lsr_start == flde->fce_range.lsr_start ||
+	       (range->lsr_end == flde->fce_range.lsr_end &&
+		range->lsr_flags == flde->fce_range.lsr_flags);
+}
+
 struct fld_cache_entry *
 fld_cache_entry_lookup_nolock(struct fld_cache *cache,
 			      const struct lu_seq_range *range)
 {
-	struct fld_cache_entry *flde;
-	struct fld_cache_entry *got = NULL;
-	cfs_list_t *head;
-
-	head = &cache->fci_entries_head;
-	cfs_list_for_each_entry(flde, head, fce_list) {
-		if (range->lsr_start == flde->fce_range.lsr_start ||
-		   (range->lsr_end == flde->fce_range.lsr_end &&
-		    range->lsr_flags == flde->fce_range.lsr_flags)) {
-			got = flde;
-			break;
-		}
-	}
-
-	RETURN(got);
+	struct fld_cache_query query = {
+		.fcq_match	= fld_cache_match_entry,
+		.fcq_range	= range,
+	};
+
+	/* entries that start at lsr_start, and entries that end at lsr_end,
+	 * which are indexed up to lsr_end - 1, or at lsr_end if empty. */
+	fld_cache_search(cache, range->lsr_start, range->lsr_start, &query);
+	fld_cache_search(cache, range->lsr_end > 0 ? range->lsr_end - 1 : 0,
+			 range->lsr_end, &query);
+
+	RETURN(query.fcq_found);
 }
 
 /**
@@ -528,37 +732,85 @@ fld_cache_entry_lookup(struct fld_cache *cache,
 	RETURN(got);
 }
 
+static int fld_cache_match_seq(struct fld_cache_query *query,
+			       struct fld_cache_entry *flde)
+{
+	return range_within(&flde->fce_range, query->fcq_seq);
+}
+
+/**
+ * \a flde is the only entry that contains any of its sequences, so that it
+ * can be cached as the answer for all of them.
+ */
+static int fld_cache_match_other(struct fld_cache_query *query,
+				 struct fld_cache_entry *flde)
+{
+	const struct lu_seq_range *range = query->fcq_range;
+
+	return &flde->fce_range != range &&
+	       flde->fce_range.lsr_start < flde->fce_range.lsr_end &&
+	       flde->fce_range.lsr_start < range->lsr_end &&
+	       range->lsr_start < flde->fce_range.lsr_end;
+}
+
 /**
  * lookup \a seq sequence for range in fld cache.
+ *
+ * The range found last on the current CPT is tried first, without taking
+ * fci_lock; it is cached only if no other entry overlaps with it, and is only
+ * used until any entry changes.
  */
 int fld_cache_lookup(struct fld_cache *cache,
 		     const seqno_t seq, struct lu_seq_range *range)
 {
+	struct fld_cache_hit *hit;
 	struct fld_cache_entry *flde;
-	struct fld_cache_entry *prev = NULL;
-	cfs_list_t *head;
+	struct fld_cache_query query = {
+		.fcq_match	= fld_cache_match_seq,
+		.fcq_seq	= seq,
+	};
+	int generation;
 	ENTRY;
 
-	read_lock(&cache->fci_lock);
-	head = &cache->fci_entries_head;
-
 	cache->fci_stat.fst_count++;
-	cfs_list_for_each_entry(flde, head, fce_list) {
-		if (flde->fce_range.lsr_start > seq) {
-			if (prev != NULL)
-				*range = prev->fce_range;
-			break;
-		}
 
-		prev = flde;
-                if (range_within(&flde->fce_range, seq)) {
-                        *range = flde->fce_range;
+	hit = cfs_percpt_current(cache->fci_hits);
+	spin_lock(&hit->fch_lock);
+	if (hit->fch_generation == cfs_atomic_read(&cache->fci_generation) &&
+	    range_within(&hit->fch_range, seq)) {
+		*range = hit->fch_range;
+		spin_unlock(&hit->fch_lock);
 
-                        cache->fci_stat.fst_cache++;
-			read_unlock(&cache->fci_lock);
-			RETURN(0);
-		}
+		cache->fci_stat.fst_cache++;
+		RETURN(0);
+	}
+	spin_unlock(&hit->fch_lock);
+
+	read_lock(&cache->fci_lock);
+	fld_cache_search(cache, seq, seq, &query);
+	flde = query.fcq_found;
+	if (flde == NULL) {
+		read_unlock(&cache->fci_lock);
+		RETURN(-ENOENT);
 	}
+
+	*range = flde->fce_range;
+	generation = cfs_atomic_read(&cache->fci_generation);
+
+	query.fcq_match = fld_cache_match_other;
+	query.fcq_range = &flde->fce_range;
+	query.fcq_found = NULL;
+	fld_cache_search(cache, flde->fce_range.lsr_start,
+			 flde->fce_range.lsr_end - 1, &query);
 	read_unlock(&cache->fci_lock);
-	RETURN(-ENOENT);
+
+	if (query.fcq_found == NULL) {
+		spin_lock(&hit->fch_lock);
+		hit->fch_generation = generation;
+		hit->fch_range = *range;
+		spin_unlock(&hit->fch_lock);
+	}
+
+	cache->fci_stat.fst_cache++;
+	RETURN(0);
 }
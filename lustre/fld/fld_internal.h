@@ -45,6 +45,7 @@
 #include <lustre/lustre_idl.h>
 #include <libcfs/libcfs.h>
 #include <lustre_fld.h>
+#include <interval_tree.h>
 
 enum {
         LUSTRE_FLD_INIT = 1 << 0,
@@ -70,11 +71,28 @@ struct lu_fld_hash {
 struct fld_cache_entry {
         cfs_list_t               fce_lru;
         cfs_list_t               fce_list;
+	/**
+	 * Node in fld_cache::fci_tree, covering [lsr_start, lsr_end - 1], or
+	 * just lsr_start for empty ranges. Entries that cover the same
+	 * extent are linked into a ring through \a fce_twins, and only one
+	 * of them is in the tree. */
+	struct interval_node	 fce_node;
+	cfs_list_t		 fce_twins;
         /**
          * fld cache entries are sorted on range->lsr_start field. */
         struct lu_seq_range      fce_range;
 };
 
+/**
+ * Per-CPT copy of the range that was last found by fld_cache_lookup(); it is
+ * only valid as long as \a fch_generation matches fld_cache::fci_generation.
+ */
+struct fld_cache_hit {
+	spinlock_t		 fch_lock;
+	int			 fch_generation;
+	struct lu_seq_range	 fch_range;
+};
+
 struct fld_cache {
 	/**
 	 * Cache guard, protects fci_hash mostly because others immutable after
@@ -102,6 +120,19 @@ struct fld_cache {
          * sorted fld entries. */
         cfs_list_t               fci_entries_head;
 
+	/**
+	 * Interval tree of fld entries, for looking sequences up. Protected
+	 * by \a fci_lock */
+	struct interval_node	*fci_tree;
+
+	/**
+	 * Bumped whenever fld entries change, to invalidate \a fci_hits */
+	cfs_atomic_t		 fci_generation;
+
+	/**
+	 * Per-CPT last hit caches */
+	struct fld_cache_hit   **fci_hits;
+
         /**
          * Cache statistics. */
         struct fld_stats         fci_stat;
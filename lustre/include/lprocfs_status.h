@@ -395,14 +395,20 @@ static inline void s2dhms(struct dhms *ts, time_t secs)
 
 typedef void (*cntr_init_callback)(struct lprocfs_stats *stats);
 
+struct job_stat_cache;
+
 struct obd_job_stats {
 	cfs_hash_t        *ojs_hash;
-	cfs_list_t         ojs_list;
+	cfs_list_t         ojs_list; /* least recently used first */
 	rwlock_t       ojs_lock; /* protect the obj_list */
 	cntr_init_callback ojs_cntr_init_fn;
 	int                ojs_cntr_num;
 	int                ojs_cleanup_interval;
 	time_t		   ojs_last_cleanup;
+	int		   ojs_count; /* jobs on ojs_list */
+	int		   ojs_max_jobs; /* 0 for no limit */
+	/* per-CPT caches of recently used jobs */
+	struct job_stat_cache **ojs_cache;
 };
 
 #ifdef LPROCFS
@@ -784,6 +790,18 @@ unsigned long lprocfs_oh_sum(struct obd_histogram *oh);
 void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
                            struct lprocfs_counter *cnt);
 
+/* lprocfs_status.c: binary snapshot of the counters of an obd device */
+struct lprocfs_snapshot_buf {
+	char		*lsb_buf;
+	size_t		 lsb_size;	/* allocated */
+	size_t		 lsb_used;	/* needed, may exceed lsb_size */
+	__u32		 lsb_sets;
+};
+
+void lprocfs_snapshot_add_stats(struct lprocfs_snapshot_buf *lsb, __u32 type,
+				const char *name, __u64 timestamp,
+				struct lprocfs_stats *stats);
+
 #ifdef HAVE_SERVER_SUPPORT
 /* lprocfs_status.c: recovery status */
 int lprocfs_obd_rd_recovery_status(char *page, char **start, off_t off,
@@ -884,6 +902,12 @@ int lprocfs_rd_job_interval(char *page, char **start, off_t off,
 			    int count, int *eof, void *data);
 int lprocfs_wr_job_interval(struct file *file, const char *buffer,
 			    unsigned long count, void *data);
+int lprocfs_rd_job_max_entries(char *page, char **start, off_t off,
+			       int count, int *eof, void *data);
+int lprocfs_wr_job_max_entries(struct file *file, const char *buffer,
+			       unsigned long count, void *data);
+void lprocfs_job_stats_snapshot(struct obd_device *obd,
+				struct lprocfs_snapshot_buf *lsb);
 
 /* lproc_ptlrpc.c */
 struct ptlrpc_request;
@@ -1307,6 +1307,8 @@ extern void lustre_swab_ptlrpc_body(struct ptlrpc_body *pb);
 #define OBD_CONNECT_DISP_STRIPE 0x10000000000000ULL/* create stripe disposition*/
 #define OBD_CONNECT_OPEN_BY_FID	0x20000000000000ULL /* open by fid won't pack
 						       name in request */
+#define OBD_CONNECT_QUOTA_BATCH	0x40000000000000ULL /* QUOTA_DQACQ_BATCH is
+						       supported */
 
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
@@ -1351,7 +1353,8 @@ extern void lustre_swab_ptlrpc_body(struct ptlrpc_body *pb);
 				OBD_CONNECT_LVB_TYPE | OBD_CONNECT_LAYOUTLOCK |\
 				OBD_CONNECT_PINGLESS | OBD_CONNECT_MAX_EASIZE |\
 				OBD_CONNECT_FLOCK_DEAD | \
-				OBD_CONNECT_DISP_STRIPE)
+				OBD_CONNECT_DISP_STRIPE | \
+				OBD_CONNECT_QUOTA_BATCH)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
                                 OBD_CONNECT_REQPORTAL | OBD_CONNECT_VERSION | \
@@ -1947,11 +1950,21 @@ struct quota_body {
 /* qb_usage is the current qunit (in kbytes/inodes) when quota_body is used in
  * quota reply */
 #define qb_qunit	qb_usage
+/* in the reply of a QUOTA_DQACQ_BATCH request, every quota_body carries the
+ * return code of the request it answers */
+#define qb_rc		qb_padding
 
 #define QUOTA_DQACQ_FL_ACQ	0x1  /* acquire quota */
 #define QUOTA_DQACQ_FL_PREACQ	0x2  /* pre-acquire */
 #define QUOTA_DQACQ_FL_REL	0x4  /* release quota */
 #define QUOTA_DQACQ_FL_REPORT	0x8  /* report usage */
+#define QUOTA_DQACQ_FL_HINT	0x10 /* ID recently acquiring space on
+				      * another slave, reply only */
+
+/* most quota_body a QUOTA_DQACQ_BATCH request can carry */
+#define QUOTA_BATCH_MAX		16
+/* most hints appended to the reply of a QUOTA_DQACQ_BATCH request */
+#define QUOTA_BATCH_HINTS	8
 
 extern void lustre_swab_quota_body(struct quota_body *b);
 
@@ -2042,6 +2055,7 @@ extern void lustre_swab_lquota_lvb(struct lquota_lvb *lvb);
 typedef enum {
 	QUOTA_DQACQ	= 601,
 	QUOTA_DQREL	= 602,
+	QUOTA_DQACQ_BATCH = 603,
 	QUOTA_LAST_OPC
 } quota_cmd_t;
 #define QUOTA_FIRST_OPC	QUOTA_DQACQ
@@ -1195,6 +1195,53 @@ struct hsm_copy {
 	struct hsm_action_item	hc_hai;
 };
 
+/****** Binary lprocfs snapshot ******/
+
+/*
+ * The stats_snapshot file of an obd device holds a binary copy of all
+ * its lprocfs counters, collected when the file is opened:
+ * an lprocfs_snapshot_header, then lsh_sets sets, each being an
+ * lprocfs_snapshot_set followed by lss_counters counters.  Counters
+ * without any sample are left out.  Everything is in host byte order.
+ */
+#define LPROCFS_SNAPSHOT_MAGIC		0x534e4150	/* "SNAP" */
+#define LPROCFS_SNAPSHOT_VERSION	1
+#define LPROCFS_SNAPSHOT_NAME_LEN	32
+#define LPROCFS_SNAPSHOT_UNITS_LEN	8
+
+struct lprocfs_snapshot_header {
+	__u32	lsh_magic;
+	__u32	lsh_version;
+	__u64	lsh_size;	/* bytes, this header included */
+	__u64	lsh_time_sec;
+	__u32	lsh_time_usec;
+	__u32	lsh_sets;
+};
+
+enum lprocfs_snapshot_type {
+	LPROCFS_SNAP_STATS	= 1,	/* stats file, lss_name is its name */
+	LPROCFS_SNAP_JOB	= 2,	/* job_stats of the job in lss_name */
+};
+
+struct lprocfs_snapshot_set {
+	__u32	lss_type;
+	__u32	lss_counters;
+	__u64	lss_timestamp;	/* last update of a job, in seconds */
+	char	lss_name[LPROCFS_SNAPSHOT_NAME_LEN];
+};
+
+struct lprocfs_snapshot_counter {
+	__u32	lsc_config;	/* LPROCFS_CNTR_* */
+	__u32	lsc_padding;
+	__u64	lsc_count;
+	__u64	lsc_min;
+	__u64	lsc_max;
+	__u64	lsc_sum;
+	__u64	lsc_sumsquare;
+	char	lsc_name[LPROCFS_SNAPSHOT_NAME_LEN];
+	char	lsc_units[LPROCFS_SNAPSHOT_UNITS_LEN];
+};
+
 /** @} lustreuser */
 
 #endif /* _LUSTRE_USER_H */
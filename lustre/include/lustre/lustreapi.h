@@ -160,10 +160,13 @@ struct find_param {
 				 check_stripecount:1,	/* LOV stripe count */
 				 exclude_stripecount:1,
 				 check_layout:1,
-				 exclude_layout:1;
+				 exclude_layout:1,
+				 lazy:1;	/* MDS attributes only, no OST RPC */
 
 	int			 verbose;
 	int			 quiet;
+	/* threads walking directories in parallel, 0 or 1 for a serial walk */
+	int			 threads;
 
 	/* regular expression */
 	char			*pattern;
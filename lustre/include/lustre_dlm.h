@@ -312,6 +312,19 @@ typedef enum {
 	LDLM_NAMESPACE_MODEST = 1 << 1
 } ldlm_appetite_t;
 
+/**
+ * LRU cancel policy of a client namespace, \see ns_lru_policy.
+ */
+typedef enum {
+	/** Keep ns_max_unused locks, or follow the SLV with LRU resize. */
+	LDLM_LRU_POLICY_DEFAULT = 0,
+	/**
+	 * Keep ns_lru_target locks, tuned by the lock match hit rate within
+	 * a memory budget. \see ldlm_cancel_lru_adapt
+	 */
+	LDLM_LRU_POLICY_ADAPTIVE,
+} ldlm_lru_policy_t;
+
 /**
  * Default values for the "max_nolock_size", "contention_time" and
  * "contended_locks" namespace tunables.
@@ -334,6 +347,12 @@ struct ldlm_ns_bucket {
 enum {
 	/** LDLM namespace lock stats */
         LDLM_NSS_LOCKS          = 0,
+	/** locks examined by IBITS compatibility checks, per enqueue */
+	LDLM_NSS_IBITS_EXAMINED,
+	/** usec from a blocking AST to the cancel RPC of the lock */
+	LDLM_NSS_BL_CANCEL_LAT,
+	/** locks per cancel RPC of a batch of blocking ASTs */
+	LDLM_NSS_BL_CANCEL_BATCH,
         LDLM_NSS_LAST
 };
 
@@ -428,6 +447,21 @@ struct ldlm_namespace {
 	unsigned int		ns_max_unused;
 	/** Maximum allowed age (last used time) for locks in the LRU */
 	unsigned int		ns_max_age;
+	/** LRU cancel policy, \see ldlm_lru_policy_t */
+	ldlm_lru_policy_t	ns_lru_policy;
+	/** Number of unused locks kept with LDLM_LRU_POLICY_ADAPTIVE. */
+	unsigned int		ns_lru_target;
+	/** Lock matches which found a cached lock. */
+	cfs_atomic_t		ns_lru_hits;
+	/** Lock matches which found nothing and lead to an enqueue. */
+	cfs_atomic_t		ns_lru_misses;
+	/** ns_lru_hits and ns_lru_misses at the last adaptive LRU step. */
+	int			ns_lru_last_hits;
+	int			ns_lru_last_misses;
+	/** Hit rate in permille seen at the last adaptive LRU step. */
+	int			ns_lru_last_rate;
+	/** Last change of ns_lru_target, its sign is the search direction. */
+	int			ns_lru_step;
 	/**
 	 * Server only: number of times we evicted clients due to lack of reply
 	 * to ASTs.
@@ -503,6 +537,19 @@ struct ldlm_namespace {
 	/** LDLM lock stats */
 	struct lprocfs_stats	*ns_stats;
 
+	/**
+	 * Locks cancelled after a blocking AST while ldlm_bl threads handle
+	 * a batch of blocking ASTs for this namespace. Their cancel RPC is
+	 * deferred so that they are sent together.
+	 * \see ldlm_bl_batch_begin
+	 * Protected by ns_lock.
+	 */
+	cfs_list_t		ns_bl_cancels;
+	/** Number of locks in ns_bl_cancels. */
+	int			ns_bl_cancel_count;
+	/** Number of ldlm_bl threads handling a batch for this namespace. */
+	int			ns_bl_batching;
+
 	/**
 	 * Flag to indicate namespace is being freed. Used to determine if
 	 * recalculation of LDLM pool statistics should be skipped.
@@ -814,6 +861,12 @@ struct ldlm_lock {
 	/** Private storage for lock user. Opaque to LDLM. */
 	void			*l_ast_data;
 
+	/**
+	 * Time the blocking AST for this lock was received, in jiffies.
+	 * Used to account the time until the lock is cancelled.
+	 */
+	cfs_time_t		l_bl_ast_time;
+
 	/*
 	 * Server-side-only members.
 	 */
@@ -894,6 +947,32 @@ struct ldlm_lock {
 	cfs_list_t		l_exp_list;
 };
 
+/**
+ * Number of per-bit slots of an IBITS queue index: one for each known inode
+ * bit, plus one collecting all bits above MDS_INODELOCK_MAXSHIFT.
+ */
+#define LDLM_IBITS_SLOTS	(MDS_INODELOCK_MAXSHIFT + 2)
+
+/** Number of locks of one IBITS queue, by inode bit slot and mode index. */
+struct ldlm_ibits_counts {
+	__u32	lic_count[LDLM_IBITS_SLOTS][LCK_MODE_NUM];
+};
+
+/**
+ * Lock counts of the granted and waiting queues of a server-side IBITS
+ * resource.
+ *
+ * They let the compatibility check skip a whole queue when none of its locks
+ * can conflict with the request, which is the common case for a directory
+ * holding many LOOKUP/UPDATE locks of compatible modes.
+ */
+struct ldlm_ibits_queues {
+	/** locks on lr_granted, counted in their granted mode */
+	struct ldlm_ibits_counts	liq_granted;
+	/** locks on lr_waiting, counted in their requested mode */
+	struct ldlm_ibits_counts	liq_waiting;
+};
+
 /**
  * LDLM resource description.
  * Basically, resource is a representation for a single object.
@@ -946,6 +1025,12 @@ struct ldlm_resource {
 	 */
 	struct ldlm_interval_tree lr_itree[LCK_MODE_NUM];
 
+	/**
+	 * Per-bit lock counts of the granted and waiting queues, only for
+	 * IBITS resources in server namespaces. Protected by lr_lock.
+	 */
+	struct ldlm_ibits_queues *lr_ibits_queues;
+
 	/**
 	 * Server-side-only lock value block elements.
 	 * To serialize lvbo_init.
@@ -181,9 +181,11 @@ struct obd_export {
          * All exports eligible for ping evictor are linked into a list
          * through this field in "most time since last request on this export"
          * order
-         * protected by obd_dev_lock
+         * protected by the ote_lock of obd_exports_timed[exp_timed_cpt]
          */
         cfs_list_t                exp_obd_chain_timed;
+	/** CPT partition of obd_exports_timed this export is linked into */
+	int			  exp_timed_cpt;
         /** Obd device of this export */
         struct obd_device        *exp_obd;
 	/**
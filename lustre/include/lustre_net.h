@@ -134,6 +134,15 @@
 #endif /* __KERNEL__ */
 
 #define PTLRPC_NTHRS_INIT	2
+/** most threads a service partition starts at once when requests queue */
+#define PTLRPC_NTHRS_BATCH	8
+/**
+ * default seconds a thread above ?_NTHRS_INIT may sleep without any work
+ * before it exits, see threads_idle_timeout in /proc; 0 keeps all threads
+ */
+#define PTLRPC_THR_IDLE_TIMEOUT	300
+/** usecs a request may wait in queue before more threads are started */
+#define PTLRPC_THR_WAIT_HIGH	(ONE_MILLION / 10)
 
 /**
  * Buffer Constants
@@ -798,6 +807,26 @@ enum nrs_ctl_orr {
 	NRS_CTL_ORR_WR_SUPP_REQ,
 };
 
+/**
+ * TBF policy operations
+ */
+enum nrs_ctl_tbf {
+	NRS_CTL_TBF_RD_RULE = PTLRPC_NRS_CTL_1ST_POL_SPEC,
+	NRS_CTL_TBF_WR_RULE,
+};
+
+/**
+ * EDF policy operations
+ */
+enum nrs_ctl_edf {
+	NRS_CTL_EDF_RD_WINDOW = PTLRPC_NRS_CTL_1ST_POL_SPEC,
+	NRS_CTL_EDF_WR_WINDOW,
+	NRS_CTL_EDF_RD_WAIT_HIST,
+	NRS_CTL_EDF_CLR_WAIT_HIST,
+	NRS_CTL_EDF_RD_BUDGET,
+	NRS_CTL_EDF_WR_BUDGET,
+};
+
 /**
  * NRS policy operations.
  *
@@ -822,10 +851,13 @@ struct ptlrpc_nrs_pol_ops {
 	 * initialize their resources here; this operation is optional.
 	 *
 	 * \param[in,out] policy The policy being started
+	 * \param[in]	  arg	 An optional, policy-specific argument given by
+	 *			 the user along with the policy name, or NULL
 	 *
 	 * \see nrs_policy_start_locked()
 	 */
-	int	(*op_policy_start) (struct ptlrpc_nrs_policy *policy);
+	int	(*op_policy_start) (struct ptlrpc_nrs_policy *policy,
+				    char *arg);
 	/**
 	 * Called when deactivating a policy via lprocfs; policies deallocate
 	 * their resources here; this operation is optional
@@ -1103,9 +1135,17 @@ struct ptlrpc_nrs {
 	 * unregistration
 	 */
 	unsigned			nrs_stopping:1;
+	/**
+	 * The primary policy is holding back its queued requests for rate
+	 * limiting purposes, and will wake up the service threads once they
+	 * can be handled; cleared from timer context, so it is kept apart
+	 * from the bitfields above.
+	 */
+	int				nrs_throttling;
 };
 
 #define NRS_POL_NAME_MAX		16
+#define NRS_POL_ARG_MAX			16
 
 struct ptlrpc_nrs_pol_desc;
 
@@ -1694,6 +1734,352 @@ struct nrs_orr_req {
 
 /** @} ORR/TRR */
 
+/**
+ * \name TBF
+ *
+ * TBF (Token Bucket Filter) NRS policy; rate limits RPCs per JobID or per
+ * client NID.
+ * @{
+ */
+
+#define NRS_TBF_TYPE_JOBID	"jobid"
+#define NRS_TBF_TYPE_NID	"nid"
+
+/**
+ * What TBF policy instances classify requests by.
+ */
+enum nrs_tbf_flag {
+	NRS_TBF_FLAG_INVALID	= 0,
+	NRS_TBF_FLAG_JOBID	= (1 << 0),
+	NRS_TBF_FLAG_NID	= (1 << 1),
+};
+
+#define NRS_TBF_RULE_NAME_MAX	16
+
+/**
+ * A JobID in the match expression of a TBF rule
+ */
+struct nrs_tbf_jobid {
+	cfs_list_t			 tj_linkage;
+	char				*tj_id;
+};
+
+/**
+ * TBF rule; classes of requests that match the rule's expression share the
+ * rule's RPC rate, but each class has a token bucket of its own.
+ */
+struct nrs_tbf_rule {
+	/**
+	 * Linkage into nrs_tbf_head::th_list
+	 */
+	cfs_list_t			 tr_linkage;
+	/**
+	 * Name of the rule, as given by the user
+	 */
+	char				 tr_name[NRS_TBF_RULE_NAME_MAX];
+	/**
+	 * Whether the rule matches JobIDs or NIDs
+	 */
+	enum nrs_tbf_flag		 tr_type;
+	/**
+	 * The match expression, as given by the user; "*" for the default
+	 * rule, which matches all requests.
+	 */
+	char				*tr_expr;
+	int				 tr_expr_len;
+	/**
+	 * List of parsed NID ranges, for NID instances
+	 */
+	cfs_list_t			 tr_nids;
+	/**
+	 * List of nrs_tbf_jobid, for JobID instances
+	 */
+	cfs_list_t			 tr_jobids;
+	/**
+	 * RPC rate limit, in RPCs per second
+	 */
+	__u64				 tr_rpc_rate;
+	/**
+	 * Time to generate one token, in nanoseconds
+	 */
+	__u64				 tr_nsecs;
+	/**
+	 * Token bucket depth; the maximum burst of RPCs
+	 */
+	__u64				 tr_depth;
+	/**
+	 * # nrs_tbf_client objects classified by this rule, plus one for
+	 * being linked on nrs_tbf_head::th_list
+	 */
+	cfs_atomic_t			 tr_ref;
+	/**
+	 * The rule has been stopped, and is no longer on the head's list
+	 */
+	unsigned			 tr_stopping:1;
+	/**
+	 * This is the default rule of the policy instance
+	 */
+	unsigned			 tr_default:1;
+};
+
+/**
+ * Private data structure for the TBF policy
+ */
+struct nrs_tbf_head {
+	/**
+	 * Resource object for policy instance.
+	 */
+	struct ptlrpc_nrs_resource	 th_res;
+	/**
+	 * What this instance classifies requests by; one of nrs_tbf_flag.
+	 */
+	enum nrs_tbf_flag		 th_type;
+	/**
+	 * Hash of nrs_tbf_client objects, keyed by JobID or NID.
+	 */
+	cfs_hash_t			*th_cli_hash;
+	/**
+	 * Binary heap of nrs_tbf_client objects with queued requests, sorted
+	 * by the time each client can next be served.
+	 */
+	cfs_binheap_t			*th_binheap;
+	/**
+	 * List of rules, most recently started first; the default rule is
+	 * always the last one. Protected by nrs_tbf_head::th_rule_lock.
+	 */
+	cfs_list_t			 th_list;
+	spinlock_t			 th_rule_lock;
+	/**
+	 * Bumped each time the set of rules or a rule's rate changes, so that
+	 * clients know to classify themselves again.
+	 */
+	__u64				 th_generation;
+	/**
+	 * Default rule of the instance
+	 */
+	struct nrs_tbf_rule		*th_rule;
+	/**
+	 * Sequence number assigned to requests, for debugging purposes
+	 */
+	__u64				 th_sequence;
+	/**
+	 * Wakes up service threads when the first queued client is due; and
+	 * the time at which it is set to go off, in nanoseconds.
+	 */
+	struct timer_list		 th_timer;
+	__u64				 th_deadline;
+};
+
+/**
+ * Per-bucket data of nrs_tbf_head::th_cli_hash, used for keeping idle
+ * clients around for a while, so that their token buckets are not reset
+ * between bursts of requests.
+ */
+struct nrs_tbf_bucket {
+	cfs_list_t			 ntb_lru;
+};
+
+/**
+ * A class of requests in the TBF policy, i.e. a JobID or a client NID,
+ * with its own token bucket.
+ */
+struct nrs_tbf_client {
+	struct ptlrpc_nrs_resource	 tc_res;
+	cfs_hlist_node_t		 tc_hnode;
+	/**
+	 * Key of the client; only one of these is used, depending on
+	 * nrs_tbf_head::th_type
+	 */
+	lnet_nid_t			 tc_nid;
+	char				 tc_jobid[JOBSTATS_JOBID_SIZE];
+	/**
+	 * # of active users of this client; it is on the bucket's LRU list
+	 * when this drops to zero.
+	 */
+	int				 tc_ref;
+	cfs_list_t			 tc_lru;
+	/**
+	 * Rule this client has been classified by, and the rule generation
+	 * at the time of classification.
+	 */
+	struct nrs_tbf_rule		*tc_rule;
+	__u64				 tc_rule_generation;
+	/**
+	 * Copies of the rule's parameters, taken when classifying
+	 */
+	__u64				 tc_rpc_rate;
+	__u64				 tc_nsecs;
+	__u64				 tc_depth;
+	/**
+	 * Tokens left in the bucket, as of nrs_tbf_client::tc_check_time
+	 */
+	__u64				 tc_ntoken;
+	/**
+	 * Time the bucket was last updated, in nanoseconds
+	 */
+	__u64				 tc_check_time;
+	/**
+	 * List of queued requests of this client, in arrival order
+	 */
+	cfs_list_t			 tc_list;
+	/**
+	 * Node in nrs_tbf_head::th_binheap
+	 */
+	cfs_binheap_node_t		 tc_node;
+	unsigned			 tc_in_heap:1;
+};
+
+/**
+ * TBF NRS request definition
+ */
+struct nrs_tbf_req {
+	/**
+	 * Linkage into nrs_tbf_client::tc_list
+	 */
+	cfs_list_t			 tr_list;
+	/**
+	 * For debugging purposes.
+	 */
+	__u64				 tr_sequence;
+};
+
+/**
+ * Operations on TBF rules, carried by NRS_CTL_TBF_WR_RULE
+ */
+enum nrs_tbf_cmd_type {
+	NRS_CTL_TBF_START_RULE = 0,
+	NRS_CTL_TBF_STOP_RULE,
+	NRS_CTL_TBF_CHANGE_RATE,
+};
+
+/**
+ * A parsed command written to the nrs_tbf_rule lprocfs file
+ */
+struct nrs_tbf_cmd {
+	enum nrs_tbf_cmd_type		 tc_cmd;
+	char				*tc_name;
+	__u64				 tc_rpc_rate;
+	/**
+	 * For NRS_CTL_TBF_START_RULE, a list of parsed rules, one for each
+	 * NRS head the command is applied to; rules cannot be allocated from
+	 * within ptlrpc_nrs_pol_ops::op_policy_ctl(), as it is called with
+	 * ptlrpc_nrs::nrs_lock held.
+	 */
+	cfs_list_t			 tc_rules;
+};
+
+/** @} TBF */
+
+/**
+ * \name EDF
+ *
+ * EDF (Earliest Deadline First) NRS policy; serves requests in the order of
+ * the deadlines derived from the service time of their opcodes, but never
+ * lets a request wait for longer than a fairness window.
+ * @{
+ */
+
+/**
+ * Time budget of an opcode, used for working out the deadlines of its
+ * requests; in microseconds.
+ */
+struct nrs_edf_opc_time {
+	/**
+	 * Budget set by the user, or 0 if the estimate is to be used
+	 */
+	__u32				 eot_budget;
+	/**
+	 * Moving average of the time it takes to handle requests of this
+	 * opcode, or 0 if none has been handled yet
+	 */
+	__u32				 eot_estimate;
+};
+
+/**
+ * Private data structure for the EDF policy
+ */
+struct nrs_edf_head {
+	/**
+	 * Resource object for policy instance.
+	 */
+	struct ptlrpc_nrs_resource	 eh_res;
+	/**
+	 * Binary heap of queued requests, sorted by deadline.
+	 */
+	cfs_binheap_t			*eh_binheap;
+	/**
+	 * List of queued requests, in arrival order.
+	 */
+	cfs_list_t			 eh_list;
+	/**
+	 * Requests that have been queued for longer than this are served in
+	 * arrival order, ahead of the ones with the earliest deadlines; in
+	 * milliseconds.
+	 */
+	__u32				 eh_window;
+	/**
+	 * Sequence number assigned to requests; used to break deadline ties
+	 * in arrival order.
+	 */
+	__u64				 eh_sequence;
+	/**
+	 * Log2 histograms of the time requests have been queued for, in
+	 * microseconds; one for each opcode, indexed by opcode_offset().
+	 */
+	struct obd_histogram		*eh_wait_hist;
+	/**
+	 * Time budgets of opcodes, indexed by opcode_offset().
+	 */
+	struct nrs_edf_opc_time		*eh_opc_time;
+};
+
+/**
+ * EDF NRS request definition
+ */
+struct nrs_edf_req {
+	/**
+	 * Linkage into nrs_edf_head::eh_binheap
+	 */
+	cfs_binheap_node_t		 er_node;
+	/**
+	 * Linkage into nrs_edf_head::eh_list
+	 */
+	cfs_list_t			 er_list;
+	/**
+	 * Time the request arrived at, and the time by which the client
+	 * expects it to be handled; in microseconds.
+	 */
+	__u64				 er_arrival;
+	__u64				 er_deadline;
+	__u64				 er_sequence;
+	/**
+	 * Time the request started being handled at; in microseconds.
+	 */
+	__u64				 er_start;
+};
+
+/**
+ * Queue wait histograms of EDF policy instances, summed over all service
+ * partitions by NRS_CTL_EDF_RD_WAIT_HIST.
+ */
+struct nrs_edf_wait_stats {
+	unsigned long			 ews_buckets[LUSTRE_MAX_OPCODES]
+						    [OBD_HIST_MAX];
+};
+
+/**
+ * Argument of NRS_CTL_EDF_RD_BUDGET, which reports the largest estimate of
+ * each opcode over all service partitions, and of NRS_CTL_EDF_WR_BUDGET,
+ * which sets the budget of opcode offset \a ebc_offset.
+ */
+struct nrs_edf_budget_cmd {
+	__u32				 ebc_offset;
+	__u32				 ebc_budget;
+	struct nrs_edf_opc_time		 ebc_times[LUSTRE_MAX_OPCODES];
+};
+
+/** @} EDF */
+
 /**
  * NRS request
  *
@@ -1735,6 +2121,14 @@ struct ptlrpc_nrs_request {
 		struct nrs_crrn_req	crr;
 		/** ORR and TRR share the same request definition */
 		struct nrs_orr_req	orr;
+		/**
+		 * TBF request definition
+		 */
+		struct nrs_tbf_req	tbf;
+		/**
+		 * EDF request definition
+		 */
+		struct nrs_edf_req	edf;
 	} nr_u;
 	/**
 	 * Externally-registering policies may want to use this to allocate
@@ -2499,6 +2893,8 @@ struct ptlrpc_service {
 	int				srv_nthrs_cpt_init;
 	/** limit of threads number for each partition */
 	int				srv_nthrs_cpt_limit;
+	/** seconds an extra thread may be idle before exiting, 0 for never */
+	int				srv_thr_idle_timeout;
         /** Root of /proc dir tree for this service */
         cfs_proc_dir_entry_t           *srv_procroot;
         /** Pointer to statistic data for this service */
@@ -2576,6 +2972,10 @@ struct ptlrpc_service_part {
 	int				scp_nthrs_running;
 	/** service threads list */
 	cfs_list_t			scp_threads;
+	/** queue wait of the last request taken by a thread, in usec */
+	long				scp_thr_wait;
+	/** busy threads in tenths of running ones, at each request start */
+	struct obd_histogram		scp_thr_util;
 
 	/**
 	 * serialize the following fields, used for protecting
@@ -3528,6 +3928,7 @@ void ptlrpcd_decref(void);
  * @{
  */
 const char* ll_opcode2str(__u32 opcode);
+__u32 ll_opcode_offset2opcode(__u32 offset);
 #ifdef LPROCFS
 void ptlrpc_lprocfs_register_obd(struct obd_device *obd);
 void ptlrpc_lprocfs_unregister_obd(struct obd_device *obd);
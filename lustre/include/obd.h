@@ -300,6 +300,10 @@ struct timeout_item {
 #define OSC_MAX_DIRTY_DEFAULT  (OSC_MAX_RIF_DEFAULT * 4)
 #define OSC_MAX_DIRTY_MB_MAX   2048     /* arbitrary, but < MAX_LONG bytes */
 #define OSC_DEFAULT_RESENDS      10
+/* default latency budget of write gathering, \see cl_write_gather_ms */
+#define OSC_WRITE_GATHER_MS_DEFAULT	100
+/* default batch of dirty pages per CPT grant cache, \see cl_grant_cache */
+#define OSC_GRANT_CACHE_PAGES_DEFAULT	32
 
 /* possible values for fo_sync_lock_cancel */
 enum {
@@ -341,6 +345,11 @@ struct client_obd {
 	 * grant before trying to dirty a page and unreserve the rest.
 	 * See osc_{reserve|unreserve}_grant for details. */
 	long                 cl_reserved_grant;
+	/* per-CPT caches of grant and dirty page credits taken from the
+	 * totals above in batches of cl_grant_cache_pages, so that most
+	 * writes don't need loi_list_lock. See osc_grant_cache_enter() */
+	struct osc_grant_cache **cl_grant_cache;
+	int                  cl_grant_cache_pages;
 	cfs_list_t           cl_cache_waiters; /* waiting for cache/grant */
 	cfs_time_t           cl_next_shrink_grant;   /* jiffies */
 	cfs_list_t           cl_grant_shrink_list;  /* Timeout event list */
@@ -385,6 +394,13 @@ struct client_obd {
 	cfs_atomic_t             cl_pending_r_pages;
 	__u32			 cl_max_pages_per_rpc;
         int                      cl_max_rpcs_in_flight;
+	/* write gathering: objects with fewer pending write pages are not
+	 * flushed for cache waiters for up to cl_write_gather_ms, 0 is off */
+	int			 cl_write_gather_pages;
+	unsigned int		 cl_write_gather_ms;
+	/* write RPCs, and their pages, sent after being held back */
+	cfs_atomic_t		 cl_write_gathered_rpcs;
+	cfs_atomic_t		 cl_write_gathered_pages;
         struct obd_histogram     cl_read_rpc_hist;
         struct obd_histogram     cl_write_rpc_hist;
         struct obd_histogram     cl_read_page_hist;
@@ -842,6 +858,19 @@ struct obd_llog_group {
 #define OBD_DEVICE_MAGIC        0XAB5CD6EF
 #define OBD_DEV_BY_DEVNAME      0xffffd0de
 
+/*
+ * One partition of the exports eligible for the ping evictor, kept in
+ * "most time since last request" order. There is one per CPT so that request
+ * handling on different CPTs doesn't serialize on a single lock.
+ */
+struct obd_timed_exports {
+	spinlock_t		ote_lock;
+	cfs_list_t		ote_list;
+	/* last request time of the list head, read without ote_lock by
+	 * ptlrpc_update_export_timer(), 0 if unknown */
+	time_t			ote_oldest;
+};
+
 struct obd_device {
 	struct obd_type		*obd_type;
 	__u32			 obd_magic;
@@ -906,8 +935,8 @@ struct obd_device {
 	struct rw_semaphore	obd_observer_link_sem;
         struct obd_notify_upcall obd_upcall;
         struct obd_export       *obd_self_export;
-        /* list of exports in LRU order, for ping evictor, with obd_dev_lock */
-        cfs_list_t              obd_exports_timed;
+	/* per-CPT lists of exports in LRU order, for ping evictor */
+	struct obd_timed_exports **obd_exports_timed;
         time_t                  obd_eviction_timer; /* for ping evictor */
 
         int                              obd_max_recoverable_clients;
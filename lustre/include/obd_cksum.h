@@ -161,7 +161,9 @@ static inline cksum_type_t cksum_types_supported_server(void)
  * input.
  *
  * Currently, calling cksum_type_pack() with a mask will return the fastest
- * checksum type due to its benchmarking at libcfs module load.
+ * checksum type due to its benchmarking at libcfs module load, done on page
+ * vectors the way bulk RPCs are checksummed, see
+ * /proc/sys/lnet/crypto_hash_speeds.
  * Caution is advised, however, since what is fastest on a single client may
  * not be the fastest or most efficient algorithm on the server.  */
 static inline cksum_type_t cksum_type_select(cksum_type_t cksum_types)
@@ -290,6 +290,14 @@ void class_export_put(struct obd_export *exp);
 struct obd_export *class_new_export(struct obd_device *obddev,
                                     struct obd_uuid *cluuid);
 void class_unlink_export(struct obd_export *exp);
+void class_export_untime(struct obd_export *exp);
+
+/* partition of obd_exports_timed the export \a exp belongs to */
+static inline struct obd_timed_exports *
+class_export_timed(struct obd_export *exp)
+{
+	return exp->exp_obd->obd_exports_timed[exp->exp_timed_cpt];
+}
 
 struct obd_import *class_import_get(struct obd_import *);
 void class_import_put(struct obd_import *);
@@ -846,7 +846,8 @@ struct ldlm_interval *ldlm_interval_alloc(struct ldlm_lock *lock)
         struct ldlm_interval *node;
         ENTRY;
 
-        LASSERT(lock->l_resource->lr_type == LDLM_EXTENT);
+	LASSERT(lock->l_resource->lr_type == LDLM_EXTENT ||
+		lock->l_resource->lr_type == LDLM_FLOCK);
 	OBD_SLAB_ALLOC_PTR_GFP(node, ldlm_interval_slab, __GFP_IO);
         if (node == NULL)
                 RETURN(NULL);
@@ -865,12 +866,13 @@ void ldlm_interval_free(struct ldlm_interval *node)
         }
 }
 
-/* interval tree, for LDLM_EXTENT. */
+/* interval tree, for LDLM_EXTENT and LDLM_FLOCK. */
 void ldlm_interval_attach(struct ldlm_interval *n,
                           struct ldlm_lock *l)
 {
         LASSERT(l->l_tree_node == NULL);
-        LASSERT(l->l_resource->lr_type == LDLM_EXTENT);
+	LASSERT(l->l_resource->lr_type == LDLM_EXTENT ||
+		l->l_resource->lr_type == LDLM_FLOCK);
 
         cfs_list_add_tail(&l->l_sl_policy, &n->li_group);
         l->l_tree_node = n;
@@ -890,17 +892,6 @@ struct ldlm_interval *ldlm_interval_detach(struct ldlm_lock *l)
         return (cfs_list_empty(&n->li_group) ? n : NULL);
 }
 
-static inline int lock_mode_to_index(ldlm_mode_t mode)
-{
-        int index;
-
-        LASSERT(mode != 0);
-        LASSERT(IS_PO2(mode));
-        for (index = -1; mode; index++, mode >>= 1) ;
-        LASSERT(index < LCK_MODE_NUM);
-        return index;
-}
-
 /** Add newly granted lock into interval tree for the resource. */
 void ldlm_extent_add_lock(struct ldlm_resource *res,
                           struct ldlm_lock *lock)
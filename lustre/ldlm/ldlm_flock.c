@@ -100,6 +100,106 @@ ldlm_flocks_overlap(struct ldlm_lock *lock, struct ldlm_lock *new)
                 lock->l_policy_data.l_flock.start));
 }
 
+/**
+ * Granted flock locks are indexed by range in the interval tree of their
+ * mode, lr_itree[], so that the locks conflicting with a request, and the
+ * locks of its owner it has to be merged with or split, are found without
+ * walking the whole granted list.
+ *
+ * Unlike extent locks, whose range never changes once granted, a flock lock
+ * is resized whenever its owner locks or unlocks a range touching it. To be
+ * able to move it in the tree at any time without allocating, each flock
+ * lock owns its ldlm_interval, l_tree_node. Locks of identical range share
+ * the node of one of them in the tree and are linked by l_sl_policy on its
+ * li_group. A lock which is not in the tree is alone on its own li_group.
+ */
+static inline struct ldlm_interval_tree *
+ldlm_flock_tree(struct ldlm_lock *lock)
+{
+	return &lock->l_resource->lr_itree[lock_mode_to_index(
+						lock->l_granted_mode)];
+}
+
+static inline int ldlm_flock_in_tree(struct ldlm_lock *lock)
+{
+	struct ldlm_interval *node = lock->l_tree_node;
+
+	/* Either its own node is in the tree, or it left its own node empty
+	 * to join the group of another lock of the same range. */
+	return node != NULL && (interval_is_intree(&node->li_node) ||
+				cfs_list_empty(&node->li_group));
+}
+
+static void ldlm_flock_tree_insert(struct ldlm_lock *lock)
+{
+	struct ldlm_interval_tree *tree = ldlm_flock_tree(lock);
+	struct ldlm_interval *node = lock->l_tree_node;
+	struct interval_node *found;
+
+	LASSERT(node != NULL);
+	LASSERT(!ldlm_flock_in_tree(lock));
+
+	interval_set(&node->li_node, lock->l_policy_data.l_flock.start,
+		     lock->l_policy_data.l_flock.end);
+	found = interval_insert(&node->li_node, &tree->lit_root);
+	if (found != NULL)
+		cfs_list_move_tail(&lock->l_sl_policy,
+				   &to_ldlm_interval(found)->li_group);
+	tree->lit_size++;
+}
+
+static void ldlm_flock_tree_erase(struct ldlm_lock *lock)
+{
+	struct ldlm_interval_tree *tree = ldlm_flock_tree(lock);
+	struct ldlm_interval *node = lock->l_tree_node;
+	struct ldlm_interval *next_node;
+	struct interval_node *found;
+	struct ldlm_lock *next;
+
+	LASSERT(ldlm_flock_in_tree(lock));
+	tree->lit_size--;
+
+	if (!interval_is_intree(&node->li_node)) {
+		/* Leave the group of another lock for our own node. */
+		cfs_list_move(&lock->l_sl_policy, &node->li_group);
+		return;
+	}
+
+	interval_erase(&node->li_node, &tree->lit_root);
+	cfs_list_del_init(&lock->l_sl_policy);
+	if (!cfs_list_empty(&node->li_group)) {
+		/* Hand the rest of the group over to the node of one of its
+		 * locks, which is unused as long as it is in the group. */
+		next = cfs_list_entry(node->li_group.next, struct ldlm_lock,
+				      l_sl_policy);
+		next_node = next->l_tree_node;
+		LASSERT(cfs_list_empty(&next_node->li_group));
+
+		interval_set(&next_node->li_node, interval_low(&node->li_node),
+			     interval_high(&node->li_node));
+		cfs_list_splice_init(&node->li_group, &next_node->li_group);
+		found = interval_insert(&next_node->li_node, &tree->lit_root);
+		LASSERT(found == NULL);
+	}
+	cfs_list_add(&lock->l_sl_policy, &node->li_group);
+}
+
+/** Add granted flock \a lock to the granted list and interval tree. */
+void ldlm_flock_add_lock(struct ldlm_resource *res, struct ldlm_lock *lock)
+{
+	ldlm_resource_add_lock(res, &res->lr_granted, lock);
+	/* destroyed locks are not added */
+	if (!cfs_list_empty(&lock->l_res_link))
+		ldlm_flock_tree_insert(lock);
+}
+
+/** Remove flock \a lock from the interval tree, if it is there. */
+void ldlm_flock_unlink_lock(struct ldlm_lock *lock)
+{
+	if (ldlm_flock_in_tree(lock))
+		ldlm_flock_tree_erase(lock);
+}
+
 static inline void ldlm_flock_blocking_link(struct ldlm_lock *req,
 					    struct ldlm_lock *lock)
 {
@@ -145,7 +245,7 @@ ldlm_flock_destroy(struct ldlm_lock *lock, ldlm_mode_t mode, __u64 flags)
 	/* Safe to not lock here, since it should be empty anyway */
 	LASSERT(cfs_hlist_unhashed(&lock->l_exp_flock_hash));
 
-	cfs_list_del_init(&lock->l_res_link);
+	ldlm_resource_unlink_lock(lock);
 	if (flags == LDLM_FL_WAIT_NOREPROC && !ldlm_is_failed(lock)) {
 		/* client side - set a flag to prevent sending a CANCEL */
 		lock->l_flags |= LDLM_FL_LOCAL_ONLY | LDLM_FL_CBPENDING;
@@ -272,6 +372,124 @@ static void ldlm_flock_cancel_on_deadlock(struct ldlm_lock *lock,
 	}
 }
 
+/**
+ * Call \a cb for the granted locks of \a res whose range intersects
+ * [\a start, \a end], only those of modes conflicting with \a mode if it
+ * is not LCK_MINMODE. The callback gets a node of the tree and walks the
+ * locks of its li_group.
+ */
+static void ldlm_flock_search(struct ldlm_resource *res, ldlm_mode_t mode,
+			      __u64 start, __u64 end, interval_callback_t cb,
+			      void *data)
+{
+	struct interval_node_extent ext = { .start = start, .end = end };
+	struct ldlm_interval_tree *tree;
+	int idx;
+
+	for (idx = 0; idx < LCK_MODE_NUM; idx++) {
+		tree = &res->lr_itree[idx];
+		if (tree->lit_root == NULL)
+			continue;
+
+		if (mode != LCK_MINMODE && lockmode_compat(tree->lit_mode, mode))
+			continue;
+
+		if (interval_search(tree->lit_root, &ext, cb, data) ==
+		    INTERVAL_ITER_STOP)
+			break;
+	}
+}
+
+struct ldlm_flock_conflict_data {
+	struct ldlm_lock	*fcd_req;
+	/* first conflicting lock found */
+	struct ldlm_lock	*fcd_lock;
+	/* check every conflicting lock for a deadlock, stop on the first */
+	int			 fcd_check_deadlock;
+	int			 fcd_deadlock;
+};
+
+static enum interval_iter ldlm_flock_conflict_cb(struct interval_node *n,
+						 void *args)
+{
+	struct ldlm_flock_conflict_data *data = args;
+	struct ldlm_interval *node = to_ldlm_interval(n);
+	struct ldlm_lock *req = data->fcd_req;
+	struct ldlm_lock *lock;
+
+	cfs_list_for_each_entry(lock, &node->li_group, l_sl_policy) {
+		if (ldlm_same_flock_owner(lock, req))
+			continue;
+
+		LASSERT(ldlm_flocks_overlap(lock, req));
+		if (data->fcd_lock == NULL)
+			data->fcd_lock = lock;
+		if (!data->fcd_check_deadlock)
+			return INTERVAL_ITER_STOP;
+
+		if (ldlm_flock_deadlock(req, lock)) {
+			data->fcd_deadlock = 1;
+			return INTERVAL_ITER_STOP;
+		}
+	}
+	return INTERVAL_ITER_CONT;
+}
+
+struct ldlm_flock_owner_data {
+	struct ldlm_lock	*fod_req;
+	cfs_list_t		*fod_locks;
+};
+
+static enum interval_iter ldlm_flock_owner_cb(struct interval_node *n,
+					      void *args)
+{
+	struct ldlm_flock_owner_data *data = args;
+	struct ldlm_interval *node = to_ldlm_interval(n);
+	struct ldlm_lock *lock;
+
+	cfs_list_for_each_entry(lock, &node->li_group, l_sl_policy)
+		if (ldlm_same_flock_owner(lock, data->fod_req))
+			cfs_list_add_tail(&lock->l_sl_mode, data->fod_locks);
+	return INTERVAL_ITER_CONT;
+}
+
+/**
+ * Take the granted locks of the owner of \a req which overlap or adjoin it
+ * out of the interval trees, and link them on \a ownlocks by l_sl_mode,
+ * which flock locks do not use otherwise. They can then be resized freely
+ * and are put back by ldlm_flock_put_ownlocks().
+ */
+static void ldlm_flock_get_ownlocks(struct ldlm_lock *req, cfs_list_t *ownlocks)
+{
+	struct ldlm_flock *flock = &req->l_policy_data.l_flock;
+	struct ldlm_flock_owner_data data = {
+		.fod_req	= req,
+		.fod_locks	= ownlocks,
+	};
+	struct ldlm_lock *lock;
+
+	ldlm_flock_search(req->l_resource, LCK_MINMODE,
+			  flock->start == 0 ? 0 : flock->start - 1,
+			  flock->end == OBD_OBJECT_EOF ? OBD_OBJECT_EOF :
+							 flock->end + 1,
+			  ldlm_flock_owner_cb, &data);
+
+	cfs_list_for_each_entry(lock, ownlocks, l_sl_mode)
+		ldlm_flock_tree_erase(lock);
+}
+
+static void ldlm_flock_put_ownlocks(cfs_list_t *ownlocks)
+{
+	struct ldlm_lock *lock;
+
+	while (!cfs_list_empty(ownlocks)) {
+		lock = cfs_list_entry(ownlocks->next, struct ldlm_lock,
+				      l_sl_mode);
+		cfs_list_del_init(&lock->l_sl_mode);
+		ldlm_flock_tree_insert(lock);
+	}
+}
+
 /**
  * Process a granting attempt for flock lock.
  * Must be called under ns lock held.
@@ -296,9 +514,9 @@ ldlm_process_flock_lock(struct ldlm_lock *req, __u64 *flags, int first_enq,
 {
         struct ldlm_resource *res = req->l_resource;
         struct ldlm_namespace *ns = ldlm_res_to_ns(res);
-        cfs_list_t *tmp;
-        cfs_list_t *ownlocks = NULL;
+	CFS_LIST_HEAD(ownlocks);
         struct ldlm_lock *lock = NULL;
+	struct ldlm_lock *tmp;
         struct ldlm_lock *new = req;
         struct ldlm_lock *new2 = NULL;
         ldlm_mode_t mode = req->l_req_mode;
@@ -328,50 +546,28 @@ ldlm_process_flock_lock(struct ldlm_lock *req, __u64 *flags, int first_enq,
         }
 
 reprocess:
-        if ((*flags == LDLM_FL_WAIT_NOREPROC) || (mode == LCK_NL)) {
-                /* This loop determines where this processes locks start
-                 * in the resource lr_granted list. */
-                cfs_list_for_each(tmp, &res->lr_granted) {
-                        lock = cfs_list_entry(tmp, struct ldlm_lock,
-                                              l_res_link);
-                        if (ldlm_same_flock_owner(lock, req)) {
-                                ownlocks = tmp;
-                                break;
-                        }
-                }
-        } else {
-		int reprocess_failed = 0;
-                lockmode_verify(mode);
-
-                /* This loop determines if there are existing locks
-                 * that conflict with the new lock request. */
-                cfs_list_for_each(tmp, &res->lr_granted) {
-                        lock = cfs_list_entry(tmp, struct ldlm_lock,
-                                              l_res_link);
+	if ((*flags != LDLM_FL_WAIT_NOREPROC) && (mode != LCK_NL)) {
+		struct ldlm_flock_conflict_data data = {
+			.fcd_req		= req,
+			.fcd_check_deadlock	= !first_enq,
+		};
 
-                        if (ldlm_same_flock_owner(lock, req)) {
-                                if (!ownlocks)
-                                        ownlocks = tmp;
-                                continue;
-                        }
-
-                        /* locks are compatible, overlap doesn't matter */
-                        if (lockmode_compat(lock->l_granted_mode, mode))
-                                continue;
+                lockmode_verify(mode);
 
-                        if (!ldlm_flocks_overlap(lock, req))
-                                continue;
+		/* Look up the granted locks of other owners that conflict
+		 * with the new lock request. */
+		ldlm_flock_search(res, mode, req->l_policy_data.l_flock.start,
+				  req->l_policy_data.l_flock.end,
+				  ldlm_flock_conflict_cb, &data);
+		lock = data.fcd_lock;
 
-			if (!first_enq) {
-				reprocess_failed = 1;
-				if (ldlm_flock_deadlock(req, lock)) {
-					ldlm_flock_cancel_on_deadlock(req,
-							work_list);
-					RETURN(LDLM_ITER_CONTINUE);
-				}
-				continue;
-			}
+		if (lock != NULL && !first_enq) {
+			if (data.fcd_deadlock)
+				ldlm_flock_cancel_on_deadlock(req, work_list);
+			RETURN(LDLM_ITER_CONTINUE);
+		}
 
+		if (lock != NULL) {
                         if (*flags & LDLM_FL_BLOCK_NOWAIT) {
                                 ldlm_flock_destroy(req, mode, *flags);
                                 *err = -EAGAIN;
@@ -406,8 +602,6 @@ reprocess:
                         *flags |= LDLM_FL_BLOCK_GRANTED;
                         RETURN(LDLM_ITER_STOP);
                 }
-		if (reprocess_failed)
-			RETURN(LDLM_ITER_CONTINUE);
         }
 
         if (*flags & LDLM_FL_TEST_LOCK) {
@@ -421,18 +615,14 @@ reprocess:
 	 * deadlock detection hash list. */
         ldlm_flock_blocking_unlink(req);
 
-        /* Scan the locks owned by this process that overlap this request.
-         * We may have to merge or split existing locks. */
-
-        if (!ownlocks)
-                ownlocks = &res->lr_granted;
-
-        list_for_remaining_safe(ownlocks, tmp, &res->lr_granted) {
-                lock = cfs_list_entry(ownlocks, struct ldlm_lock, l_res_link);
-
-                if (!ldlm_same_flock_owner(lock, new))
-                        break;
+	/* Take the locks owned by this process that overlap or adjoin this
+	 * request out of the trees. We may have to merge or split them.
+	 * The locks of an owner never overlap each other, and those of the
+	 * same mode never adjoin, so the order they are processed in does
+	 * not matter. */
+	ldlm_flock_get_ownlocks(req, &ownlocks);
 
+	cfs_list_for_each_entry_safe(lock, tmp, &ownlocks, l_sl_mode) {
                 if (lock->l_granted_mode == mode) {
                         /* If the modes are the same then we need to process
                          * locks that overlap OR adjoin the new lock. The extra
@@ -447,7 +637,7 @@ reprocess:
                         if ((new->l_policy_data.l_flock.end <
                              (lock->l_policy_data.l_flock.start - 1))
                             && (lock->l_policy_data.l_flock.start != 0))
-                                break;
+				continue;
 
                         if (new->l_policy_data.l_flock.start <
                             lock->l_policy_data.l_flock.start) {
@@ -468,6 +658,7 @@ reprocess:
                         }
 
                         if (added) {
+				cfs_list_del_init(&lock->l_sl_mode);
                                 ldlm_flock_destroy(lock, mode, *flags);
                         } else {
                                 new = lock;
@@ -482,7 +673,7 @@ reprocess:
 
                 if (new->l_policy_data.l_flock.end <
                     lock->l_policy_data.l_flock.start)
-                        break;
+			continue;
 
                 ++overlaps;
 
@@ -492,8 +683,9 @@ reprocess:
                             lock->l_policy_data.l_flock.end) {
                                 lock->l_policy_data.l_flock.start =
                                         new->l_policy_data.l_flock.end + 1;
-                                break;
+				continue;
                         }
+			cfs_list_del_init(&lock->l_sl_mode);
                         ldlm_flock_destroy(lock, lock->l_req_mode, *flags);
                         continue;
                 }
@@ -517,6 +709,9 @@ reprocess:
                  * release the lr_lock, allocate the new lock,
                  * and restart processing this lock. */
                 if (!new2) {
+			/* nothing was changed yet, as the request is inside
+			 * of this lock and no other lock of the owner */
+			ldlm_flock_put_ownlocks(&ownlocks);
                         unlock_res_and_lock(req);
 			new2 = ldlm_lock_create(ns, &res->lr_name, LDLM_FLOCK,
 						lock->l_granted_mode, &null_cbs,
@@ -557,12 +752,15 @@ reprocess:
                         ldlm_lock_addref_internal_nolock(new2,
                                                          lock->l_granted_mode);
 
-                /* insert new2 at lock */
-                ldlm_resource_add_lock(res, ownlocks, new2);
+		ldlm_flock_add_lock(res, new2);
                 LDLM_LOCK_RELEASE(new2);
                 break;
         }
 
+	/* put the remaining locks back into the trees with their new
+	 * extents */
+	ldlm_flock_put_ownlocks(&ownlocks);
+
         /* if new2 is created but never used, destroy it*/
         if (splitted == 0 && new2 != NULL)
                 ldlm_lock_destroy_nolock(new2);
@@ -572,9 +770,8 @@ reprocess:
 
         /* Add req to the granted queue before calling ldlm_reprocess_all(). */
         if (!added) {
-                cfs_list_del_init(&req->l_res_link);
-                /* insert new lock before ownlocks in list. */
-                ldlm_resource_add_lock(res, ownlocks, req);
+		ldlm_resource_unlink_lock(req);
+		ldlm_flock_add_lock(res, req);
         }
 
         if (*flags != LDLM_FL_WAIT_NOREPROC) {
@@ -756,7 +953,7 @@ granted:
         ldlm_flock_blocking_unlink(lock);
 
         /* ldlm_lock_enqueue() has already placed lock on the granted list. */
-        cfs_list_del_init(&lock->l_res_link);
+	ldlm_resource_unlink_lock(lock);
 
 	if (ldlm_is_flock_deadlock(lock)) {
 		LDLM_DEBUG(lock, "client-side enqueue deadlock received");
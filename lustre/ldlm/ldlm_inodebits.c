@@ -62,12 +62,175 @@
 
 #include "ldlm_internal.h"
 
+/** Bits of a lock policy accounted in \a slot of struct ldlm_ibits_counts. */
+static inline __u64 ldlm_ibits_slot_mask(int slot)
+{
+	if (slot <= MDS_INODELOCK_MAXSHIFT)
+		return 1ULL << slot;
+	return ~(__u64)MDS_INODELOCK_FULL;
+}
+
+/**
+ * Return the counts of the queue \a lock is accounted in and set \a mode to
+ * the mode it is accounted with: granted locks count in their granted mode,
+ * which stays put while a conversion changes l_req_mode, and waiting locks
+ * in their requested mode.
+ */
+static struct ldlm_ibits_counts *
+ldlm_ibits_lock_counts(struct ldlm_lock *lock, ldlm_mode_t *mode)
+{
+	struct ldlm_ibits_queues *liq = lock->l_resource->lr_ibits_queues;
+
+	if (lock->l_granted_mode != LCK_MINMODE) {
+		*mode = lock->l_granted_mode;
+		return &liq->liq_granted;
+	}
+	*mode = lock->l_req_mode;
+	return &liq->liq_waiting;
+}
+
+static void ldlm_ibits_counts_update(struct ldlm_ibits_counts *counts,
+				     struct ldlm_lock *lock, ldlm_mode_t mode,
+				     int delta)
+{
+	__u64 bits = lock->l_policy_data.l_inodebits.bits;
+	int idx = lock_mode_to_index(mode);
+	int slot;
+
+	for (slot = 0; slot < LDLM_IBITS_SLOTS; slot++) {
+		if (!(bits & ldlm_ibits_slot_mask(slot)))
+			continue;
+		LASSERTF(delta > 0 || counts->lic_count[slot][idx] > 0,
+			 "slot %d mode %d\n", slot, mode);
+		counts->lic_count[slot][idx] += delta;
+	}
+}
+
+struct ldlm_ibits_queues *ldlm_ibits_queues_alloc(void)
+{
+	struct ldlm_ibits_queues *liq;
+
+	OBD_ALLOC_PTR(liq);
+	return liq;
+}
+
+void ldlm_ibits_queues_free(struct ldlm_ibits_queues *liq)
+{
+	OBD_FREE_PTR(liq);
+}
+
+/**
+ * Account \a lock, which was just linked on \a queue of its resource, in
+ * the per-bit lock counts of the resource.
+ *
+ * Must be called with the resource lock held.
+ */
+void ldlm_ibits_queues_add(struct ldlm_lock *lock, cfs_list_t *queue)
+{
+	struct ldlm_resource *res = lock->l_resource;
+	struct ldlm_ibits_counts *counts;
+	ldlm_mode_t mode;
+
+	check_res_locked(res);
+	LASSERT(res->lr_ibits_queues != NULL);
+	LASSERT(!cfs_list_empty(&lock->l_res_link));
+
+	/* Only a replayed conversion can get here, which no client sends
+	 * nowadays. Rather than track converting locks, stop using the counts
+	 * for this resource, its queues are just walked in full. */
+	if (queue == &res->lr_converting) {
+		ldlm_ibits_queues_free(res->lr_ibits_queues);
+		res->lr_ibits_queues = NULL;
+		return;
+	}
+
+	counts = ldlm_ibits_lock_counts(lock, &mode);
+	LASSERTF(queue == (counts == &res->lr_ibits_queues->liq_granted ?
+			   &res->lr_granted : &res->lr_waiting),
+		 "lock %p granted mode %d on the wrong queue\n",
+		 lock, lock->l_granted_mode);
+	ldlm_ibits_counts_update(counts, lock, mode, 1);
+}
+
+/**
+ * Drop \a lock, which is about to be unlinked from its queue, from the
+ * per-bit lock counts of its resource.
+ *
+ * Must be called with the resource lock held.
+ */
+void ldlm_ibits_queues_del(struct ldlm_lock *lock)
+{
+	struct ldlm_ibits_counts *counts;
+	ldlm_mode_t mode;
+
+	check_res_locked(lock->l_resource);
+	LASSERT(!cfs_list_empty(&lock->l_res_link));
+
+	counts = ldlm_ibits_lock_counts(lock, &mode);
+	ldlm_ibits_counts_update(counts, lock, mode, -1);
+}
+
 #ifdef HAVE_SERVER_SUPPORT
+/**
+ * Check the lock counts of \a queue for locks which might conflict with
+ * \a req, leaving \a req itself out if it is linked on that queue.
+ *
+ * \retval 0 if no lock on \a queue can conflict with \a req
+ * \retval 1 if some might, and the queue has to be walked to find out:
+ *	   COS locks of the same client and bits above MDS_INODELOCK_MAXSHIFT
+ *	   are not told apart by the counts, nor are the locks queued after
+ *	   \a req on the waiting queue.
+ */
+static int ldlm_ibits_may_conflict(cfs_list_t *queue, struct ldlm_lock *req)
+{
+	struct ldlm_resource *res = req->l_resource;
+	struct ldlm_ibits_counts *counts;
+	ldlm_mode_t req_mode = req->l_req_mode;
+	__u64 req_bits = req->l_policy_data.l_inodebits.bits;
+	int self = -1;
+	int slot;
+	int idx;
+
+	if (res->lr_ibits_queues == NULL)
+		return 1;
+
+	if (queue == &res->lr_granted)
+		counts = &res->lr_ibits_queues->liq_granted;
+	else if (queue == &res->lr_waiting)
+		counts = &res->lr_ibits_queues->liq_waiting;
+	else
+		return 1;
+
+	if (!cfs_list_empty(&req->l_res_link)) {
+		ldlm_mode_t mode;
+
+		if (ldlm_ibits_lock_counts(req, &mode) == counts)
+			self = lock_mode_to_index(mode);
+	}
+
+	for (slot = 0; slot < LDLM_IBITS_SLOTS; slot++) {
+		if (!(req_bits & ldlm_ibits_slot_mask(slot)))
+			continue;
+
+		for (idx = 0; idx < LCK_MODE_NUM; idx++) {
+			__u32 count = counts->lic_count[slot][idx];
+
+			if (idx == self)
+				count--;
+			if (count > 0 && !lockmode_compat(1 << idx, req_mode))
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
 /**
  * Determine if the lock is compatible with all locks on the queue.
  *
  * If \a work_list is provided, conflicting locks are linked there.
  * If \a work_list is not provided, we exit this function on first conflict.
+ * The number of locks looked at is added to \a examined.
  *
  * \retval 0 if there are conflicting locks in the \a queue
  * \retval 1 if the lock is compatible to all locks in \a queue
@@ -76,11 +239,13 @@
  * same-mode/same-bits locks called "skip lists". The First lock in the
  * bunch contains a pointer to the end of the bunch.  This allows us to
  * skip an entire bunch when iterating the list in search for conflicting
- * locks if first lock of the bunch is not conflicting with us.
+ * locks if first lock of the bunch is not conflicting with us. The queue is
+ * not walked at all if its per-bit lock counts show that no lock on it can
+ * conflict.
  */
 static int
 ldlm_inodebits_compat_queue(cfs_list_t *queue, struct ldlm_lock *req,
-                            cfs_list_t *work_list)
+			    cfs_list_t *work_list, int *examined)
 {
         cfs_list_t *tmp;
         struct ldlm_lock *lock;
@@ -93,10 +258,15 @@ ldlm_inodebits_compat_queue(cfs_list_t *queue, struct ldlm_lock *req,
                               I think. Also such a lock would be compatible
                                with any other bit lock */
 
+	/* Nothing on the queue can conflict, don't bother walking it. */
+	if (!ldlm_ibits_may_conflict(queue, req))
+		RETURN(compat);
+
         cfs_list_for_each(tmp, queue) {
                 cfs_list_t *mode_tail;
 
                 lock = cfs_list_entry(tmp, struct ldlm_lock, l_res_link);
+		(*examined)++;
 
 		/* We stop walking the queue if we hit ourselves so we don't
 		 * take conflicting locks enqueued after us into account,
@@ -157,12 +327,24 @@ ldlm_inodebits_compat_queue(cfs_list_t *queue, struct ldlm_lock *req,
                         tmp = tmp->next;
                         lock = cfs_list_entry(tmp, struct ldlm_lock,
                                               l_res_link);
+			(*examined)++;
 		} /* Loop over policy groups within one mode group. */
 	} /* Loop over mode groups within @queue. */
 
 	RETURN(compat);
 }
 
+/* Account the locks examined by one granting attempt in namespace stats. */
+static inline void ldlm_inodebits_examined(struct ldlm_resource *res,
+					   int examined)
+{
+	struct ldlm_namespace *ns = ldlm_res_to_ns(res);
+
+	if (ns->ns_stats != NULL)
+		lprocfs_counter_add(ns->ns_stats, LDLM_NSS_IBITS_EXAMINED,
+				    examined);
+}
+
 /**
  * Process a granting attempt for IBITS lock.
  * Must be called with ns lock held
@@ -184,6 +366,7 @@ int ldlm_process_inodebits_lock(struct ldlm_lock *lock, __u64 *flags,
 {
         struct ldlm_resource *res = lock->l_resource;
         CFS_LIST_HEAD(rpc_list);
+	int examined = 0;
         int rc;
         ENTRY;
 
@@ -196,12 +379,14 @@ int ldlm_process_inodebits_lock(struct ldlm_lock *lock, __u64 *flags,
 		if (*flags & LDLM_FL_BLOCK_NOWAIT)
 			*err = ELDLM_LOCK_WOULDBLOCK;
 
-                rc = ldlm_inodebits_compat_queue(&res->lr_granted, lock, NULL);
-                if (!rc)
-                        RETURN(LDLM_ITER_STOP);
-                rc = ldlm_inodebits_compat_queue(&res->lr_waiting, lock, NULL);
-                if (!rc)
-                        RETURN(LDLM_ITER_STOP);
+		rc = ldlm_inodebits_compat_queue(&res->lr_granted, lock, NULL,
+						 &examined);
+		if (rc)
+			rc = ldlm_inodebits_compat_queue(&res->lr_waiting,
+							 lock, NULL, &examined);
+		ldlm_inodebits_examined(res, examined);
+		if (!rc)
+			RETURN(LDLM_ITER_STOP);
 
                 ldlm_resource_unlink_lock(lock);
                 ldlm_grant_lock(lock, work_list);
@@ -211,8 +396,12 @@ int ldlm_process_inodebits_lock(struct ldlm_lock *lock, __u64 *flags,
         }
 
  restart:
-        rc = ldlm_inodebits_compat_queue(&res->lr_granted, lock, &rpc_list);
-        rc += ldlm_inodebits_compat_queue(&res->lr_waiting, lock, &rpc_list);
+	examined = 0;
+	rc = ldlm_inodebits_compat_queue(&res->lr_granted, lock, &rpc_list,
+					 &examined);
+	rc += ldlm_inodebits_compat_queue(&res->lr_waiting, lock, &rpc_list,
+					  &examined);
+	ldlm_inodebits_examined(res, examined);
 
         if (rc != 2) {
                 /* If either of the compat_queue()s returned 0, then we
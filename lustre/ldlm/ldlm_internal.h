@@ -105,11 +105,24 @@ enum {
                                       * sending nor waiting for any rpcs) */
 };
 
+/* Adaptive LRU policy, \see ldlm_cancel_lru_adapt(). */
+/* Smallest LRU target and target step. */
+#define LDLM_LRU_ADAPT_MIN	64
+/* Lock matches needed in a period before the target is moved. */
+#define LDLM_LRU_ADAPT_SAMPLES	32
+/* Percent of the client memory that unused locks may take. */
+#define LDLM_LRU_MEM_PERCENT	5
+
 int ldlm_cancel_lru(struct ldlm_namespace *ns, int nr,
 		    ldlm_cancel_flags_t sync, int flags);
+unsigned int ldlm_lru_mem_budget(void);
+int ldlm_cancel_lru_adapt(struct ldlm_namespace *ns);
 int ldlm_cancel_lru_local(struct ldlm_namespace *ns,
                           cfs_list_t *cancels, int count, int max,
                           ldlm_cancel_flags_t cancel_flags, int flags);
+void ldlm_bl_batch_begin(struct ldlm_namespace *ns);
+void ldlm_bl_batch_flush(struct ldlm_namespace *ns, int force);
+void ldlm_bl_batch_end(struct ldlm_namespace *ns);
 extern int ldlm_enqueue_min;
 int ldlm_get_enq_timeout(struct ldlm_lock *lock);
 
@@ -192,6 +205,12 @@ int ldlm_process_inodebits_lock(struct ldlm_lock *lock, __u64 *flags,
                                 cfs_list_t *work_list);
 #endif
 
+/* ldlm_inodebits.c */
+struct ldlm_ibits_queues *ldlm_ibits_queues_alloc(void);
+void ldlm_ibits_queues_free(struct ldlm_ibits_queues *liq);
+void ldlm_ibits_queues_add(struct ldlm_lock *lock, cfs_list_t *queue);
+void ldlm_ibits_queues_del(struct ldlm_lock *lock);
+
 /* ldlm_extent.c */
 #ifdef HAVE_SERVER_SUPPORT
 int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
@@ -205,6 +224,8 @@ void ldlm_extent_unlink_lock(struct ldlm_lock *lock);
 int ldlm_process_flock_lock(struct ldlm_lock *req, __u64 *flags,
 			    int first_enq, ldlm_error_t *err,
 			    cfs_list_t *work_list);
+void ldlm_flock_add_lock(struct ldlm_resource *res, struct ldlm_lock *lock);
+void ldlm_flock_unlink_lock(struct ldlm_lock *lock);
 int ldlm_init_flock_export(struct obd_export *exp);
 void ldlm_destroy_flock_export(struct obd_export *exp);
 
@@ -241,6 +262,18 @@ ldlm_interval_extent(struct ldlm_interval *node)
         return &lock->l_policy_data.l_extent;
 }
 
+/* index of a lock mode in per-mode arrays like lr_itree[] */
+static inline int lock_mode_to_index(ldlm_mode_t mode)
+{
+        int index;
+
+        LASSERT(mode != 0);
+        LASSERT(IS_PO2(mode));
+        for (index = -1; mode; index++, mode >>= 1) ;
+        LASSERT(index < LCK_MODE_NUM);
+        return index;
+}
+
 int ldlm_init(void);
 void ldlm_exit(void);
 
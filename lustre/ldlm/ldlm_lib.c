@@ -362,6 +362,10 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 	cfs_atomic_set(&cli->cl_pending_r_pages, 0);
 	cli->cl_r_in_flight = 0;
 	cli->cl_w_in_flight = 0;
+	cli->cl_write_gather_pages = 0;
+	cli->cl_write_gather_ms = OSC_WRITE_GATHER_MS_DEFAULT;
+	cfs_atomic_set(&cli->cl_write_gathered_rpcs, 0);
+	cfs_atomic_set(&cli->cl_write_gathered_pages, 0);
 
 	spin_lock_init(&cli->cl_read_rpc_hist.oh_lock);
 	spin_lock_init(&cli->cl_write_rpc_hist.oh_lock);
@@ -1130,9 +1134,7 @@ dont_check_exports:
                 export->exp_libclient = 1;
 		spin_unlock(&export->exp_lock);
 
-		spin_lock(&target->obd_dev_lock);
-		cfs_list_del_init(&export->exp_obd_chain_timed);
-		spin_unlock(&target->obd_dev_lock);
+		class_export_untime(export);
 	} else {
 		spin_unlock(&export->exp_lock);
 	}
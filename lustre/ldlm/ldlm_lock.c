@@ -927,10 +927,15 @@ void ldlm_lock_decref_internal(struct ldlm_lock *lock, __u32 mode)
 
                 /* Call ldlm_cancel_lru() only if EARLY_CANCEL and LRU RESIZE
                  * are not supported by the server, otherwise, it is done on
-                 * enqueue. */
-                if (!exp_connect_cancelset(lock->l_conn_export) &&
-                    !ns_connect_lru_resize(ns))
+		 * enqueue. The adaptive policy ignores the SLV, so trim the
+		 * LRU here as soon as it grows past the target. */
+		if (ns->ns_lru_policy == LDLM_LRU_POLICY_ADAPTIVE) {
+			if (ns->ns_nr_unused > ns->ns_lru_target)
+				ldlm_cancel_lru(ns, 0, LCF_ASYNC, 0);
+		} else if (!exp_connect_cancelset(lock->l_conn_export) &&
+			   !ns_connect_lru_resize(ns)) {
 			ldlm_cancel_lru(ns, 0, LCF_ASYNC, 0);
+		}
         } else {
                 LDLM_DEBUG(lock, "do not add lock into lru list");
                 unlock_res_and_lock(lock);
@@ -1110,6 +1115,10 @@ static void ldlm_granted_list_add_lock(struct ldlm_lock *lock,
 	if (&lock->l_sl_policy != prev->policy_link)
 		cfs_list_add(&lock->l_sl_policy, prev->policy_link);
 
+	if (res->lr_ibits_queues != NULL &&
+	    !cfs_list_empty(&lock->l_res_link))
+		ldlm_ibits_queues_add(lock, &res->lr_granted);
+
         EXIT;
 }
 
@@ -1152,6 +1161,8 @@ void ldlm_grant_lock(struct ldlm_lock *lock, cfs_list_t *work_list)
                 ldlm_grant_lock_with_skiplist(lock);
         else if (res->lr_type == LDLM_EXTENT)
                 ldlm_extent_add_lock(res, lock);
+	else if (res->lr_type == LDLM_FLOCK)
+		ldlm_flock_add_lock(res, lock);
         else
                 ldlm_resource_add_lock(res, &res->lr_granted, lock);
 
@@ -1292,6 +1303,24 @@ void ldlm_lock_allow_match(struct ldlm_lock *lock)
 }
 EXPORT_SYMBOL(ldlm_lock_allow_match);
 
+/**
+ * Account a lock match on a client namespace, the hit rate drives the
+ * adaptive LRU policy. Test-only matches and re-matches of a known lock
+ * do not save an enqueue, so they are not counted.
+ */
+static void ldlm_lock_match_account(struct ldlm_namespace *ns, __u64 flags,
+				    struct ldlm_lock *old_lock, int rc)
+{
+	if (old_lock != NULL || (flags & LDLM_FL_TEST_LOCK) ||
+	    !ns_is_client(ns))
+		return;
+
+	if (rc)
+		cfs_atomic_inc(&ns->ns_lru_hits);
+	else
+		cfs_atomic_inc(&ns->ns_lru_misses);
+}
+
 /**
  * Attempt to find a lock with specified properties.
  *
@@ -1345,6 +1374,7 @@ ldlm_mode_t ldlm_lock_match(struct ldlm_namespace *ns, __u64 flags,
         res = ldlm_resource_get(ns, NULL, res_id, type, 0);
         if (res == NULL) {
                 LASSERT(old_lock == NULL);
+		ldlm_lock_match_account(ns, flags, old_lock, 0);
                 RETURN(0);
         }
 
@@ -1439,6 +1469,7 @@ ldlm_mode_t ldlm_lock_match(struct ldlm_namespace *ns, __u64 flags,
                                   (type == LDLM_PLAIN || type == LDLM_IBITS) ?
                                         res_id->name[3] : policy->l_extent.end);
         }
+	ldlm_lock_match_account(ns, flags, old_lock, rc);
         if (old_lock)
                 LDLM_LOCK_PUT(old_lock);
 
@@ -1616,8 +1647,9 @@ struct ldlm_lock *ldlm_lock_create(struct ldlm_namespace *ns,
         }
 
         lock->l_tree_node = NULL;
-        /* if this is the extent lock, allocate the interval tree node */
-        if (type == LDLM_EXTENT) {
+	/* if this is the extent or flock lock, allocate the interval tree
+	 * node */
+	if (type == LDLM_EXTENT || type == LDLM_FLOCK) {
                 if (ldlm_interval_alloc(lock) == NULL)
                         GOTO(out, 0);
         }
@@ -92,30 +92,57 @@ static inline unsigned int ldlm_get_rq_timeout(void)
 #define ELT_READY     1
 #define ELT_TERMINATE 2
 
-struct ldlm_bl_pool {
-	spinlock_t		blp_lock;
+struct ldlm_bl_pool;
+
+/**
+ * Blocking callback queues and threads of one CPU partition. Callbacks are
+ * queued on the partition of the thread which received them, and handled
+ * by the ldlm_bl threads bound to it.
+ */
+struct ldlm_bl_pool_part {
+	spinlock_t		blpp_lock;
 
 	/*
-	 * blp_prio_list is used for callbacks that should be handled
+	 * blpp_prio_list is used for callbacks that should be handled
 	 * as a priority. It is used for LDLM_FL_DISCARD_DATA requests.
 	 * see bug 13843
 	 */
-	cfs_list_t              blp_prio_list;
+	cfs_list_t		blpp_prio_list;
 
 	/*
-	 * blp_list is used for all other callbacks which are likely
+	 * blpp_list is used for all other callbacks which are likely
 	 * to take longer to process.
 	 */
-	cfs_list_t              blp_list;
-
-	wait_queue_head_t       blp_waitq;
-	struct completion       blp_comp;
-	cfs_atomic_t            blp_num_threads;
-	cfs_atomic_t            blp_busy_threads;
-	int                     blp_min_threads;
-	int                     blp_max_threads;
+	cfs_list_t		blpp_list;
+
+	wait_queue_head_t	blpp_waitq;
+	cfs_atomic_t		blpp_num_threads;
+	cfs_atomic_t		blpp_busy_threads;
+	/* rotor to take from blpp_list at least every blpp_num_threads */
+	unsigned int		blpp_num_bl;
+	/* cpu partition id */
+	int			blpp_cpt;
+	struct ldlm_bl_pool	*blpp_pool;
 };
 
+struct ldlm_bl_pool {
+	/* CPU partition table, it's just cfs_cpt_table for now */
+	struct cfs_cpt_table	*blp_cptable;
+	/* partition data */
+	struct ldlm_bl_pool_part **blp_parts;
+	struct completion	blp_comp;
+	/* thread limits of each partition */
+	int			blp_min_threads;
+	int			blp_max_threads;
+};
+
+/**
+ * Maximum number of blocking callbacks for single locks of a namespace
+ * handled as one batch, and how far to look for them in the queue.
+ */
+#define LDLM_BL_BATCH_MAX	64
+#define LDLM_BL_BATCH_SCAN	(2 * LDLM_BL_BATCH_MAX)
+
 struct ldlm_bl_work_item {
         cfs_list_t              blwi_entry;
         struct ldlm_namespace  *blwi_ns;
@@ -1887,20 +1914,23 @@ static int __ldlm_bl_to_thread(struct ldlm_bl_work_item *blwi,
 			       ldlm_cancel_flags_t cancel_flags)
 {
 	struct ldlm_bl_pool *blp = ldlm_state->ldlm_bl_pool;
+	struct ldlm_bl_pool_part *blpp;
 	ENTRY;
 
-	spin_lock(&blp->blp_lock);
+	blpp = blp->blp_parts[cfs_cpt_current(blp->blp_cptable, 1)];
+
+	spin_lock(&blpp->blpp_lock);
 	if (blwi->blwi_lock &&
 	    ldlm_is_discard_data(blwi->blwi_lock)) {
 		/* add LDLM_FL_DISCARD_DATA requests to the priority list */
-		cfs_list_add_tail(&blwi->blwi_entry, &blp->blp_prio_list);
+		cfs_list_add_tail(&blwi->blwi_entry, &blpp->blpp_prio_list);
 	} else {
 		/* other blocking callbacks are added to the regular list */
-		cfs_list_add_tail(&blwi->blwi_entry, &blp->blp_list);
+		cfs_list_add_tail(&blwi->blwi_entry, &blpp->blpp_list);
 	}
-	spin_unlock(&blp->blp_lock);
+	spin_unlock(&blpp->blpp_lock);
 
-	wake_up(&blp->blp_waitq);
+	wake_up(&blpp->blpp_waitq);
 
 	/* can not check blwi->blwi_flags as blwi could be already freed in
 	   LCF_ASYNC mode */
@@ -2226,6 +2256,7 @@ static int ldlm_callback_handler(struct ptlrpc_request *req)
 		 * Let ldlm_cancel_lru() be fast. */
                 ldlm_lock_remove_from_lru(lock);
 		ldlm_set_bl_ast(lock);
+		lock->l_bl_ast_time = cfs_time_current();
         }
         unlock_res_and_lock(lock);
 
@@ -2481,56 +2512,147 @@ EXPORT_SYMBOL(ldlm_revoke_export_locks);
 #endif /* HAVE_SERVER_SUPPORT */
 
 #ifdef __KERNEL__
-static struct ldlm_bl_work_item *ldlm_bl_get_work(struct ldlm_bl_pool *blp)
+static struct ldlm_bl_work_item *
+ldlm_bl_get_work(struct ldlm_bl_pool_part *blpp)
 {
 	struct ldlm_bl_work_item *blwi = NULL;
-	static unsigned int num_bl = 0;
-
-	spin_lock(&blp->blp_lock);
-        /* process a request from the blp_list at least every blp_num_threads */
-        if (!cfs_list_empty(&blp->blp_list) &&
-            (cfs_list_empty(&blp->blp_prio_list) || num_bl == 0))
-                blwi = cfs_list_entry(blp->blp_list.next,
-                                      struct ldlm_bl_work_item, blwi_entry);
-        else
-                if (!cfs_list_empty(&blp->blp_prio_list))
-                        blwi = cfs_list_entry(blp->blp_prio_list.next,
-                                              struct ldlm_bl_work_item,
-                                              blwi_entry);
-
-        if (blwi) {
-                if (++num_bl >= cfs_atomic_read(&blp->blp_num_threads))
-                        num_bl = 0;
-                cfs_list_del(&blwi->blwi_entry);
-        }
-	spin_unlock(&blp->blp_lock);
+
+	spin_lock(&blpp->blpp_lock);
+	/* process a request from the blpp_list at least every
+	 * blpp_num_threads */
+	if (!cfs_list_empty(&blpp->blpp_list) &&
+	    (cfs_list_empty(&blpp->blpp_prio_list) || blpp->blpp_num_bl == 0))
+		blwi = cfs_list_entry(blpp->blpp_list.next,
+				      struct ldlm_bl_work_item, blwi_entry);
+	else
+		if (!cfs_list_empty(&blpp->blpp_prio_list))
+			blwi = cfs_list_entry(blpp->blpp_prio_list.next,
+					      struct ldlm_bl_work_item,
+					      blwi_entry);
+
+	if (blwi) {
+		if (++blpp->blpp_num_bl >=
+		    cfs_atomic_read(&blpp->blpp_num_threads))
+			blpp->blpp_num_bl = 0;
+		cfs_list_del(&blwi->blwi_entry);
+	}
+	spin_unlock(&blpp->blpp_lock);
 
 	return blwi;
 }
 
+/** Whether \a blwi is a blocking callback which can be part of a batch. */
+static inline int ldlm_bl_can_batch(struct ldlm_bl_work_item *blwi)
+{
+	return blwi->blwi_ns != NULL && blwi->blwi_count == 0 &&
+	       blwi->blwi_lock != NULL && (blwi->blwi_flags & LCF_ASYNC) &&
+	       !blwi->blwi_mem_pressure &&
+	       !ldlm_is_discard_data(blwi->blwi_lock);
+}
+
+/**
+ * Move the blocking callbacks for other single locks of the namespace of
+ * \a blwi, queued on \a blpp, to \a batch so that they are handled along
+ * with \a blwi and their locks cancelled with as few RPCs as possible.
+ *
+ * \retval number of work items moved to \a batch
+ */
+static int ldlm_bl_get_batch(struct ldlm_bl_pool_part *blpp,
+			     struct ldlm_bl_work_item *blwi,
+			     cfs_list_t *batch)
+{
+	struct ldlm_bl_work_item *item;
+	struct ldlm_bl_work_item *next;
+	int scanned = 0;
+	int count = 0;
+
+	if (!ldlm_bl_can_batch(blwi))
+		return 0;
+
+	spin_lock(&blpp->blpp_lock);
+	cfs_list_for_each_entry_safe(item, next, &blpp->blpp_list,
+				     blwi_entry) {
+		if (count == LDLM_BL_BATCH_MAX - 1 ||
+		    ++scanned > LDLM_BL_BATCH_SCAN)
+			break;
+
+		if (item->blwi_ns != blwi->blwi_ns || !ldlm_bl_can_batch(item))
+			continue;
+
+		cfs_list_move_tail(&item->blwi_entry, batch);
+		count++;
+	}
+	spin_unlock(&blpp->blpp_lock);
+
+	return count;
+}
+
+/**
+ * Whether the blocking AST of \a lock may have to write back dirty pages,
+ * i.e. it is a write lock on file data.
+ */
+static inline int ldlm_bl_may_flush(struct ldlm_lock *lock)
+{
+	return lock->l_resource->lr_type == LDLM_EXTENT &&
+	       (lock->l_granted_mode & (LCK_PW | LCK_EX | LCK_GROUP));
+}
+
+/** Run the blocking AST of \a blwi, which is part of a batch. */
+static void ldlm_bl_handle_batched(struct ldlm_namespace *ns,
+				   struct ldlm_bl_work_item *blwi)
+{
+	ldlm_bl_batch_flush(ns, ldlm_bl_may_flush(blwi->blwi_lock));
+	ldlm_handle_bl_callback(ns, &blwi->blwi_ld, blwi->blwi_lock);
+}
+
+/**
+ * Handle the blocking callbacks of \a blwi and the work items in \a batch,
+ * all for single locks of the same namespace, with their cancel RPCs
+ * deferred until all of them are handled. Deferred cancels are sent early
+ * when they have waited for too long, or before a blocking AST which may
+ * take long to write back dirty pages.
+ */
+static void ldlm_bl_handle_batch(struct ldlm_bl_work_item *blwi,
+				 cfs_list_t *batch)
+{
+	struct ldlm_namespace *ns = blwi->blwi_ns;
+	struct ldlm_bl_work_item *item;
+	struct ldlm_bl_work_item *next;
+
+	ldlm_bl_batch_begin(ns);
+	ldlm_bl_handle_batched(ns, blwi);
+	cfs_list_for_each_entry_safe(item, next, batch, blwi_entry) {
+		cfs_list_del(&item->blwi_entry);
+		ldlm_bl_handle_batched(ns, item);
+		LASSERT(item->blwi_flags & LCF_ASYNC);
+		OBD_FREE(item, sizeof(*item));
+	}
+	ldlm_bl_batch_end(ns);
+}
+
 /* This only contains temporary data until the thread starts */
 struct ldlm_bl_thread_data {
 	char			bltd_name[CFS_CURPROC_COMM_MAX];
-	struct ldlm_bl_pool	*bltd_blp;
+	struct ldlm_bl_pool_part *bltd_blpp;
 	struct completion	bltd_comp;
 	int			bltd_num;
 };
 
 static int ldlm_bl_thread_main(void *arg);
 
-static int ldlm_bl_thread_start(struct ldlm_bl_pool *blp)
+static int ldlm_bl_thread_start(struct ldlm_bl_pool_part *blpp)
 {
-	struct ldlm_bl_thread_data bltd = { .bltd_blp = blp };
+	struct ldlm_bl_thread_data bltd = { .bltd_blpp = blpp };
 	struct task_struct *task;
 
 	init_completion(&bltd.bltd_comp);
-	bltd.bltd_num = cfs_atomic_read(&blp->blp_num_threads);
+	bltd.bltd_num = cfs_atomic_read(&blpp->blpp_num_threads);
 	snprintf(bltd.bltd_name, sizeof(bltd.bltd_name) - 1,
-		"ldlm_bl_%02d", bltd.bltd_num);
+		 "ldlm_bl_%02d_%02d", blpp->blpp_cpt, bltd.bltd_num);
 	task = kthread_run(ldlm_bl_thread_main, &bltd, bltd.bltd_name);
 	if (IS_ERR(task)) {
-		CERROR("cannot start LDLM thread ldlm_bl_%02d: rc %ld\n",
-		       cfs_atomic_read(&blp->blp_num_threads), PTR_ERR(task));
+		CERROR("cannot start LDLM thread %s: rc %ld\n",
+		       bltd.bltd_name, PTR_ERR(task));
 		return PTR_ERR(task);
 	}
 	wait_for_completion(&bltd.bltd_comp);
@@ -2547,80 +2669,182 @@ static int ldlm_bl_thread_start(struct ldlm_bl_pool *blp)
  */
 static int ldlm_bl_thread_main(void *arg)
 {
-        struct ldlm_bl_pool *blp;
-        ENTRY;
+	struct ldlm_bl_pool_part *blpp;
+	struct ldlm_bl_pool *blp;
+	int rc;
+	ENTRY;
 
-        {
-                struct ldlm_bl_thread_data *bltd = arg;
+	{
+		struct ldlm_bl_thread_data *bltd = arg;
 
-                blp = bltd->bltd_blp;
+		blpp = bltd->bltd_blpp;
+		blp = blpp->blpp_pool;
 
-		cfs_atomic_inc(&blp->blp_num_threads);
-                cfs_atomic_inc(&blp->blp_busy_threads);
+		cfs_atomic_inc(&blpp->blpp_num_threads);
+		cfs_atomic_inc(&blpp->blpp_busy_threads);
 
 		complete(&bltd->bltd_comp);
-                /* cannot use bltd after this, it is only on caller's stack */
-        }
-
-        while (1) {
-                struct l_wait_info lwi = { 0 };
-                struct ldlm_bl_work_item *blwi = NULL;
-                int busy;
+		/* cannot use bltd after this, it is only on caller's stack */
+	}
 
-                blwi = ldlm_bl_get_work(blp);
+	rc = cfs_cpt_bind(blp->blp_cptable, blpp->blpp_cpt);
+	if (rc != 0)
+		CWARN("Failed to bind ldlm_bl thread on CPT %d: rc = %d\n",
+		      blpp->blpp_cpt, rc);
 
-                if (blwi == NULL) {
-                        cfs_atomic_dec(&blp->blp_busy_threads);
-                        l_wait_event_exclusive(blp->blp_waitq,
-                                         (blwi = ldlm_bl_get_work(blp)) != NULL,
-                                         &lwi);
-                        busy = cfs_atomic_inc_return(&blp->blp_busy_threads);
-                } else {
-                        busy = cfs_atomic_read(&blp->blp_busy_threads);
-                }
+	while (1) {
+		struct l_wait_info lwi = { 0 };
+		struct ldlm_bl_work_item *blwi = NULL;
+		CFS_LIST_HEAD(batch);
+		int busy;
+
+		blwi = ldlm_bl_get_work(blpp);
+
+		if (blwi == NULL) {
+			cfs_atomic_dec(&blpp->blpp_busy_threads);
+			l_wait_event_exclusive(blpp->blpp_waitq,
+					(blwi = ldlm_bl_get_work(blpp)) != NULL,
+					&lwi);
+			busy = cfs_atomic_inc_return(&blpp->blpp_busy_threads);
+		} else {
+			busy = cfs_atomic_read(&blpp->blpp_busy_threads);
+		}
 
-                if (blwi->blwi_ns == NULL)
-                        /* added by ldlm_cleanup() */
-                        break;
+		if (blwi->blwi_ns == NULL)
+			/* added by ldlm_cleanup() */
+			break;
 
-                /* Not fatal if racy and have a few too many threads */
-                if (unlikely(busy < blp->blp_max_threads &&
-                             busy >= cfs_atomic_read(&blp->blp_num_threads) &&
-                             !blwi->blwi_mem_pressure))
-                        /* discard the return value, we tried */
-                        ldlm_bl_thread_start(blp);
+		/* Not fatal if racy and have a few too many threads */
+		if (unlikely(busy < blp->blp_max_threads &&
+			     busy >= cfs_atomic_read(&blpp->blpp_num_threads) &&
+			     !blwi->blwi_mem_pressure))
+			/* discard the return value, we tried */
+			ldlm_bl_thread_start(blpp);
 
-                if (blwi->blwi_mem_pressure)
+		if (blwi->blwi_mem_pressure)
 			memory_pressure_set();
 
-                if (blwi->blwi_count) {
-                        int count;
+		if (blwi->blwi_count) {
+			int count;
 			/* The special case when we cancel locks in LRU
-                         * asynchronously, we pass the list of locks here.
-                         * Thus locks are marked LDLM_FL_CANCELING, but NOT
-                         * canceled locally yet. */
-                        count = ldlm_cli_cancel_list_local(&blwi->blwi_head,
-                                                           blwi->blwi_count,
-                                                           LCF_BL_AST);
+			 * asynchronously, we pass the list of locks here.
+			 * Thus locks are marked LDLM_FL_CANCELING, but NOT
+			 * canceled locally yet. */
+			count = ldlm_cli_cancel_list_local(&blwi->blwi_head,
+							   blwi->blwi_count,
+							   LCF_BL_AST);
 			ldlm_cli_cancel_list(&blwi->blwi_head, count, NULL,
 					     blwi->blwi_flags);
-                } else {
-                        ldlm_handle_bl_callback(blwi->blwi_ns, &blwi->blwi_ld,
-                                                blwi->blwi_lock);
-                }
-                if (blwi->blwi_mem_pressure)
+		} else if (ldlm_bl_get_batch(blpp, blwi, &batch) > 0) {
+			ldlm_bl_handle_batch(blwi, &batch);
+		} else {
+			ldlm_handle_bl_callback(blwi->blwi_ns, &blwi->blwi_ld,
+						blwi->blwi_lock);
+		}
+		if (blwi->blwi_mem_pressure)
 			memory_pressure_clr();
 
 		if (blwi->blwi_flags & LCF_ASYNC)
 			OBD_FREE(blwi, sizeof(*blwi));
 		else
 			complete(&blwi->blwi_comp);
-        }
+	}
 
-        cfs_atomic_dec(&blp->blp_busy_threads);
-        cfs_atomic_dec(&blp->blp_num_threads);
+	cfs_atomic_dec(&blpp->blpp_busy_threads);
+	cfs_atomic_dec(&blpp->blpp_num_threads);
 	complete(&blp->blp_comp);
-        RETURN(0);
+	RETURN(0);
+}
+
+static void ldlm_bl_pool_fini(void)
+{
+	struct ldlm_bl_pool *blp = ldlm_state->ldlm_bl_pool;
+	struct ldlm_bl_pool_part *blpp;
+	int i;
+
+	if (blp == NULL)
+		return;
+
+	if (blp->blp_parts != NULL) {
+		cfs_percpt_for_each(blpp, i, blp->blp_parts) {
+			while (cfs_atomic_read(&blpp->blpp_num_threads) > 0) {
+				struct ldlm_bl_work_item blwi = {
+					.blwi_ns = NULL };
+
+				init_completion(&blp->blp_comp);
+
+				spin_lock(&blpp->blpp_lock);
+				cfs_list_add_tail(&blwi.blwi_entry,
+						  &blpp->blpp_list);
+				wake_up(&blpp->blpp_waitq);
+				spin_unlock(&blpp->blpp_lock);
+
+				wait_for_completion(&blp->blp_comp);
+			}
+		}
+		cfs_percpt_free(blp->blp_parts);
+	}
+
+	OBD_FREE(blp, sizeof(*blp));
+	ldlm_state->ldlm_bl_pool = NULL;
+}
+
+static int ldlm_bl_pool_init(void)
+{
+	struct ldlm_bl_pool *blp;
+	struct ldlm_bl_pool_part *blpp;
+	int ncpts;
+	int rc;
+	int i;
+	int j;
+
+	OBD_ALLOC(blp, sizeof(*blp));
+	if (blp == NULL)
+		return -ENOMEM;
+	ldlm_state->ldlm_bl_pool = blp;
+
+	blp->blp_cptable = cfs_cpt_table;
+	ncpts = cfs_cpt_number(blp->blp_cptable);
+
+	/* spread the thread limits over the CPU partitions */
+	if (ldlm_num_threads == 0) {
+		blp->blp_min_threads = LDLM_NTHRS_INIT;
+		blp->blp_max_threads = LDLM_NTHRS_MAX;
+	} else {
+		blp->blp_min_threads = blp->blp_max_threads = \
+			min_t(int, LDLM_NTHRS_MAX, max_t(int, LDLM_NTHRS_INIT,
+							 ldlm_num_threads));
+	}
+	blp->blp_min_threads = max(blp->blp_min_threads / ncpts, 1);
+	blp->blp_max_threads = max(blp->blp_max_threads / ncpts,
+				   blp->blp_min_threads);
+
+	blp->blp_parts = cfs_percpt_alloc(blp->blp_cptable, sizeof(*blpp));
+	if (blp->blp_parts == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	cfs_percpt_for_each(blpp, i, blp->blp_parts) {
+		spin_lock_init(&blpp->blpp_lock);
+		CFS_INIT_LIST_HEAD(&blpp->blpp_list);
+		CFS_INIT_LIST_HEAD(&blpp->blpp_prio_list);
+		init_waitqueue_head(&blpp->blpp_waitq);
+		cfs_atomic_set(&blpp->blpp_num_threads, 0);
+		cfs_atomic_set(&blpp->blpp_busy_threads, 0);
+		blpp->blpp_cpt = i;
+		blpp->blpp_pool = blp;
+	}
+
+	cfs_percpt_for_each(blpp, i, blp->blp_parts) {
+		for (j = 0; j < blp->blp_min_threads; j++) {
+			rc = ldlm_bl_thread_start(blpp);
+			if (rc < 0)
+				GOTO(out, rc);
+		}
+	}
+	return 0;
+out:
+	ldlm_bl_pool_fini();
+	return rc;
 }
 
 #endif
@@ -2774,11 +2998,7 @@ EXPORT_SYMBOL(ldlm_destroy_export);
 static int ldlm_setup(void)
 {
 	static struct ptlrpc_service_conf	conf;
-	struct ldlm_bl_pool			*blp = NULL;
         int rc = 0;
-#ifdef __KERNEL__
-        int i;
-#endif
         ENTRY;
 
         if (ldlm_state != NULL)
@@ -2876,33 +3096,10 @@ static int ldlm_setup(void)
 	}
 #endif
 
-	OBD_ALLOC(blp, sizeof(*blp));
-	if (blp == NULL)
-		GOTO(out, rc = -ENOMEM);
-	ldlm_state->ldlm_bl_pool = blp;
-
-	spin_lock_init(&blp->blp_lock);
-	CFS_INIT_LIST_HEAD(&blp->blp_list);
-	CFS_INIT_LIST_HEAD(&blp->blp_prio_list);
-	init_waitqueue_head(&blp->blp_waitq);
-	cfs_atomic_set(&blp->blp_num_threads, 0);
-	cfs_atomic_set(&blp->blp_busy_threads, 0);
-
 #ifdef __KERNEL__
-	if (ldlm_num_threads == 0) {
-		blp->blp_min_threads = LDLM_NTHRS_INIT;
-		blp->blp_max_threads = LDLM_NTHRS_MAX;
-	} else {
-		blp->blp_min_threads = blp->blp_max_threads = \
-			min_t(int, LDLM_NTHRS_MAX, max_t(int, LDLM_NTHRS_INIT,
-							 ldlm_num_threads));
-	}
-
-	for (i = 0; i < blp->blp_min_threads; i++) {
-		rc = ldlm_bl_thread_start(blp);
-		if (rc < 0)
-			GOTO(out, rc);
-	}
+	rc = ldlm_bl_pool_init();
+	if (rc < 0)
+		GOTO(out, rc);
 
 # ifdef HAVE_SERVER_SUPPORT
 	CFS_INIT_LIST_HEAD(&expired_lock_thread.elt_expired_locks);
@@ -2951,24 +3148,7 @@ static int ldlm_cleanup(void)
 #ifdef __KERNEL__
         ldlm_pools_fini();
 
-	if (ldlm_state->ldlm_bl_pool != NULL) {
-		struct ldlm_bl_pool *blp = ldlm_state->ldlm_bl_pool;
-
-		while (cfs_atomic_read(&blp->blp_num_threads) > 0) {
-			struct ldlm_bl_work_item blwi = { .blwi_ns = NULL };
-
-			init_completion(&blp->blp_comp);
-
-			spin_lock(&blp->blp_lock);
-			cfs_list_add_tail(&blwi.blwi_entry, &blp->blp_list);
-			wake_up(&blp->blp_waitq);
-			spin_unlock(&blp->blp_lock);
-
-			wait_for_completion(&blp->blp_comp);
-		}
-
-		OBD_FREE(blp, sizeof(*blp));
-	}
+	ldlm_bl_pool_fini();
 #endif /* __KERNEL__ */
 
 	if (ldlm_state->ldlm_cb_service != NULL)
@@ -506,6 +506,13 @@ static int ldlm_cli_pool_recalc(struct ldlm_pool *pl)
                             recalc_interval_sec);
 	spin_unlock(&pl->pl_lock);
 
+	/*
+	 * The adaptive policy moves its own LRU target instead of
+	 * following the SLV.
+	 */
+	if (ldlm_pl2ns(pl)->ns_lru_policy == LDLM_LRU_POLICY_ADAPTIVE)
+		RETURN(ldlm_cancel_lru_adapt(ldlm_pl2ns(pl)));
+
         /*
          * Do not cancel locks in case lru resize is disabled for this ns.
          */
@@ -538,7 +545,8 @@ static int ldlm_cli_pool_shrink(struct ldlm_pool *pl,
         /*
          * Do not cancel locks in case lru resize is disabled for this ns.
          */
-        if (!ns_connect_lru_resize(ns))
+	if (!ns_connect_lru_resize(ns) &&
+	    ns->ns_lru_policy != LDLM_LRU_POLICY_ADAPTIVE)
                 RETURN(0);
 
         /*
@@ -548,6 +556,14 @@ static int ldlm_cli_pool_shrink(struct ldlm_pool *pl,
 
 	spin_lock(&ns->ns_lock);
 	unused = ns->ns_nr_unused;
+	/*
+	 * Memory is short, lower the adaptive target as well so that the
+	 * hit rate does not grow the LRU right back.
+	 */
+	if (nr && ns->ns_lru_policy == LDLM_LRU_POLICY_ADAPTIVE) {
+		ns->ns_lru_target = max(unused - nr, LDLM_LRU_ADAPT_MIN);
+		ns->ns_lru_step = -1;
+	}
 	spin_unlock(&ns->ns_lock);
 
         if (nr) {
@@ -1154,6 +1154,21 @@ static __u64 ldlm_cli_cancel_local(struct ldlm_lock *lock)
         RETURN(rc);
 }
 
+/** Account the time from the blocking AST of \a lock to its cancel RPC. */
+static void ldlm_bl_cancel_latency(struct ldlm_lock *lock)
+{
+	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct timeval tv;
+
+	if (ns->ns_stats == NULL)
+		return;
+
+	cfs_duration_usec(cfs_time_sub(cfs_time_current(),
+				       lock->l_bl_ast_time), &tv);
+	lprocfs_counter_add(ns->ns_stats, LDLM_NSS_BL_CANCEL_LAT,
+			    tv.tv_sec * 1000000 + tv.tv_usec);
+}
+
 /**
  * Pack \a count locks in \a head into ldlm_request buffer of request \a req.
  */
@@ -1186,6 +1201,8 @@ static void ldlm_cancel_pack(struct ptlrpc_request *req,
                 LDLM_DEBUG(lock, "packing");
                 dlm->lock_handle[dlm->lock_count++] = lock->l_remote_handle;
                 packed++;
+		if (lock->l_bl_ast_time != 0)
+			ldlm_bl_cancel_latency(lock);
         }
         CDEBUG(D_DLMTRACE, "%d locks packed\n", packed);
         EXIT;
@@ -1336,6 +1353,145 @@ int ldlm_cli_update_pool(struct ptlrpc_request *req)
 }
 EXPORT_SYMBOL(ldlm_cli_update_pool);
 
+/**
+ * Longest time the cancel RPC of a lock is deferred for after its blocking
+ * AST was received, so that deferring it does not get close to the lock
+ * callback timeout of the server.
+ */
+#define LDLM_BL_CANCEL_DEFER_MAX	(cfs_time_seconds(1) / 10)
+
+/** Send the cancel RPCs of the \a count locks of a batch in \a cancels. */
+static void ldlm_bl_batch_send(struct ldlm_namespace *ns, cfs_list_t *cancels,
+			       int count)
+{
+	if (count == 0)
+		return;
+
+	if (ns->ns_stats != NULL)
+		lprocfs_counter_add(ns->ns_stats, LDLM_NSS_BL_CANCEL_BATCH,
+				    count);
+	ldlm_cli_cancel_list(cancels, count, NULL, LCF_ASYNC);
+}
+
+/**
+ * Whether the oldest cancel RPC deferred for \a ns has waited for long
+ * enough since its blocking AST. Called with ns_lock held.
+ */
+static int ldlm_bl_batch_expired(struct ldlm_namespace *ns)
+{
+	struct ldlm_lock *lock;
+
+	if (cfs_list_empty(&ns->ns_bl_cancels))
+		return 0;
+
+	lock = cfs_list_entry(ns->ns_bl_cancels.next, struct ldlm_lock,
+			      l_bl_ast);
+	return cfs_time_aftereq(cfs_time_current(),
+				cfs_time_add(lock->l_bl_ast_time,
+					     LDLM_BL_CANCEL_DEFER_MAX));
+}
+
+/**
+ * Defer the cancel RPC of \a lock, cancelled locally after a blocking AST,
+ * if ldlm_bl threads are handling a batch of blocking ASTs for its
+ * namespace. It is sent by ldlm_bl_batch_end() or ldlm_bl_batch_flush()
+ * along with those of the other locks of the batch, as soon as there are
+ * enough locks to fill a cancel RPC, or once the oldest deferred one has
+ * waited for LDLM_BL_CANCEL_DEFER_MAX.
+ *
+ * \retval 1 if the cancel RPC was deferred
+ * \retval 0 if the caller has to send it
+ */
+static int ldlm_cli_cancel_defer(struct ldlm_lock *lock,
+				 ldlm_cancel_flags_t cancel_flags)
+{
+	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct obd_export *exp = lock->l_conn_export;
+	CFS_LIST_HEAD(cancels);
+	int count = 0;
+	int avail;
+
+	if (!(cancel_flags & LCF_ASYNC) || !ldlm_is_bl_ast(lock) ||
+	    !exp_connect_cancelset(exp))
+		return 0;
+
+	avail = ldlm_format_handles_avail(class_exp2cliimp(exp),
+					  &RQF_LDLM_CANCEL, RCL_CLIENT, 0);
+	LASSERT(avail > 0);
+
+	spin_lock(&ns->ns_lock);
+	if (ns->ns_bl_batching == 0) {
+		spin_unlock(&ns->ns_lock);
+		return 0;
+	}
+	cfs_list_add_tail(&lock->l_bl_ast, &ns->ns_bl_cancels);
+	if (++ns->ns_bl_cancel_count >= avail || ldlm_bl_batch_expired(ns)) {
+		cfs_list_splice_init(&ns->ns_bl_cancels, &cancels);
+		count = ns->ns_bl_cancel_count;
+		ns->ns_bl_cancel_count = 0;
+	}
+	spin_unlock(&ns->ns_lock);
+
+	ldlm_bl_batch_send(ns, &cancels, count);
+	return 1;
+}
+
+/**
+ * Start handling a batch of blocking ASTs for \a ns. Until the matching
+ * ldlm_bl_batch_end(), the cancel RPCs of the locks cancelled after a
+ * blocking AST are deferred so that they are sent together, instead of one
+ * RPC per lock.
+ */
+void ldlm_bl_batch_begin(struct ldlm_namespace *ns)
+{
+	spin_lock(&ns->ns_lock);
+	ns->ns_bl_batching++;
+	spin_unlock(&ns->ns_lock);
+}
+
+/**
+ * Send the cancel RPCs deferred so far for \a ns while a batch of blocking
+ * ASTs is being handled; if \a force is not set, only do so if the oldest
+ * one has been deferred for too long. Called before each blocking AST of a
+ * batch, and with \a force set before one which may have to flush dirty
+ * pages, as the server keeps waiting for the deferred cancels meanwhile.
+ */
+void ldlm_bl_batch_flush(struct ldlm_namespace *ns, int force)
+{
+	CFS_LIST_HEAD(cancels);
+	int count = 0;
+
+	spin_lock(&ns->ns_lock);
+	if (force || ldlm_bl_batch_expired(ns)) {
+		cfs_list_splice_init(&ns->ns_bl_cancels, &cancels);
+		count = ns->ns_bl_cancel_count;
+		ns->ns_bl_cancel_count = 0;
+	}
+	spin_unlock(&ns->ns_lock);
+
+	ldlm_bl_batch_send(ns, &cancels, count);
+}
+
+/**
+ * Finish handling a batch of blocking ASTs for \a ns, and send the cancel
+ * RPCs deferred so far.
+ */
+void ldlm_bl_batch_end(struct ldlm_namespace *ns)
+{
+	CFS_LIST_HEAD(cancels);
+	int count;
+
+	spin_lock(&ns->ns_lock);
+	LASSERT(ns->ns_bl_batching > 0);
+	ns->ns_bl_batching--;
+	cfs_list_splice_init(&ns->ns_bl_cancels, &cancels);
+	count = ns->ns_bl_cancel_count;
+	ns->ns_bl_cancel_count = 0;
+	spin_unlock(&ns->ns_lock);
+
+	ldlm_bl_batch_send(ns, &cancels, count);
+}
+
 /**
  * Client side lock cancel.
  *
@@ -1368,6 +1524,9 @@ int ldlm_cli_cancel(struct lustre_handle *lockh,
 	 * RPC which goes to canceld portal, so we can cancel other LRU locks
 	 * here and send them all as one LDLM_CANCEL RPC. */
         LASSERT(cfs_list_empty(&lock->l_bl_ast));
+	if (ldlm_cli_cancel_defer(lock, cancel_flags))
+		RETURN(0);
+
         cfs_list_add(&lock->l_bl_ast, &cancels);
 
         exp = lock->l_conn_export;
@@ -1582,6 +1741,13 @@ ldlm_cancel_lru_policy(struct ldlm_namespace *ns, int flags)
         if (flags & LDLM_CANCEL_NO_WAIT)
                 return ldlm_cancel_no_wait_policy;
 
+	if (ns->ns_lru_policy == LDLM_LRU_POLICY_ADAPTIVE) {
+		/* The LRU is sized by ns_lru_target rather than the SLV. */
+		if (flags & (LDLM_CANCEL_SHRINK | LDLM_CANCEL_PASSED))
+			return ldlm_cancel_passed_policy;
+		return ldlm_cancel_aged_policy;
+	}
+
         if (ns_connect_lru_resize(ns)) {
                 if (flags & LDLM_CANCEL_SHRINK)
                         /* We kill passed number of old locks. */
@@ -1643,8 +1809,12 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns, cfs_list_t *cancels,
         unused = ns->ns_nr_unused;
         remained = unused;
 
-        if (!ns_connect_lru_resize(ns))
-                count += unused - ns->ns_max_unused;
+	if (ns->ns_lru_policy == LDLM_LRU_POLICY_ADAPTIVE) {
+		if (!(flags & (LDLM_CANCEL_SHRINK | LDLM_CANCEL_PASSED)))
+			count += unused - ns->ns_lru_target;
+	} else if (!ns_connect_lru_resize(ns)) {
+		count += unused - ns->ns_max_unused;
+	}
 
         pf = ldlm_cancel_lru_policy(ns, flags);
         LASSERT(pf != NULL);
@@ -1802,6 +1972,93 @@ int ldlm_cancel_lru(struct ldlm_namespace *ns, int nr,
 	RETURN(0);
 }
 
+/**
+ * Number of unused locks each client namespace may keep with the adaptive
+ * LRU policy: LDLM_LRU_MEM_PERCENT of the client memory, shared evenly.
+ */
+unsigned int ldlm_lru_mem_budget(void)
+{
+	__u64 budget;
+	int nr;
+
+	nr = max(ldlm_namespace_nr_read(LDLM_NAMESPACE_CLIENT), 1);
+	budget = (__u64)NUM_CACHEPAGES * PAGE_CACHE_SIZE *
+		 LDLM_LRU_MEM_PERCENT / 100;
+	do_div(budget, sizeof(struct ldlm_lock) + sizeof(struct ldlm_resource));
+	do_div(budget, nr);
+
+	return max_t(__u64, min_t(__u64, budget, INT_MAX),
+		     LDLM_LRU_ADAPT_MIN);
+}
+
+/**
+ * Moves the LRU target of an adaptive namespace one step further to the
+ * best lock match hit rate, and cancels the locks above the new target.
+ *
+ * This is a hill climb: the target keeps moving in the same direction while
+ * the hit rate of the last period improves, and turns around when it drops.
+ * When the hit rate stays the same the target shrinks, as the extra locks
+ * only cost memory. A target that is not filled is not grown any further.
+ * The target always stays within [LDLM_LRU_ADAPT_MIN, ldlm_lru_mem_budget()].
+ *
+ * Called once per pool recalc period, \see ldlm_cli_pool_recalc.
+ */
+int ldlm_cancel_lru_adapt(struct ldlm_namespace *ns)
+{
+	unsigned int budget = ldlm_lru_mem_budget();
+	int hits, misses, rate, step, trim;
+	__u64 tmp;
+	ENTRY;
+
+	hits = cfs_atomic_read(&ns->ns_lru_hits);
+	misses = cfs_atomic_read(&ns->ns_lru_misses);
+
+	spin_lock(&ns->ns_lock);
+	hits -= ns->ns_lru_last_hits;
+	misses -= ns->ns_lru_last_misses;
+	if (hits + misses >= LDLM_LRU_ADAPT_SAMPLES) {
+		tmp = (__u64)hits * 1000;
+		do_div(tmp, hits + misses);
+		rate = (int)tmp;
+
+		step = max_t(int, ns->ns_lru_target / 8, LDLM_LRU_ADAPT_MIN);
+		if (rate > ns->ns_lru_last_rate)
+			step = ns->ns_lru_step < 0 ? -step : step;
+		else if (rate < ns->ns_lru_last_rate)
+			step = ns->ns_lru_step < 0 ? step : -step;
+		else
+			step = -step;
+		/* a target which is not filled keeps the last direction */
+		if (step > 0 && ns->ns_nr_unused < ns->ns_lru_target)
+			step = 0;
+
+		if (step < 0 && ns->ns_lru_target < LDLM_LRU_ADAPT_MIN - step)
+			ns->ns_lru_target = LDLM_LRU_ADAPT_MIN;
+		else
+			ns->ns_lru_target += step;
+
+		CDEBUG(D_DLMTRACE, "%s: hit rate %d -> %d, LRU target %u "
+		       "(step %d)\n", ldlm_ns_name(ns), ns->ns_lru_last_rate,
+		       rate, ns->ns_lru_target, step);
+
+		if (step != 0)
+			ns->ns_lru_step = step;
+		ns->ns_lru_last_rate = rate;
+		ns->ns_lru_last_hits += hits;
+		ns->ns_lru_last_misses += misses;
+	}
+	if (ns->ns_lru_target > budget)
+		ns->ns_lru_target = budget;
+	else if (ns->ns_lru_target < LDLM_LRU_ADAPT_MIN)
+		ns->ns_lru_target = LDLM_LRU_ADAPT_MIN;
+	trim = ns->ns_nr_unused > ns->ns_lru_target;
+	spin_unlock(&ns->ns_lock);
+
+	if (!trim)
+		RETURN(0);
+	RETURN(ldlm_cancel_lru(ns, 0, LCF_ASYNC, 0));
+}
+
 /**
  * Find and cancel locally unused locks found on resource, matched to the
  * given policy, mode. GET the found locks and add them into the \a cancels
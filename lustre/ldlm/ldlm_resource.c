@@ -183,6 +183,46 @@ static int lprocfs_rd_ns_locks(char *page, char **start, off_t off,
         return lprocfs_rd_u64(page, start, off, count, eof, &locks);
 }
 
+static int lprocfs_rd_ns_ibits_examined(char *page, char **start, off_t off,
+					int count, int *eof, void *data)
+{
+	struct ldlm_namespace *ns = data;
+	__u64 enqueues;
+	__u64 examined;
+
+	enqueues = lprocfs_stats_collector(ns->ns_stats,
+					   LDLM_NSS_IBITS_EXAMINED,
+					   LPROCFS_FIELDS_FLAGS_COUNT);
+	examined = lprocfs_stats_collector(ns->ns_stats,
+					   LDLM_NSS_IBITS_EXAMINED,
+					   LPROCFS_FIELDS_FLAGS_SUM);
+	*eof = 1;
+	return snprintf(page, count, "enqueues: "LPU64"\n"
+			"locks_examined: "LPU64"\n", enqueues, examined);
+}
+
+static int lprocfs_rd_ns_bl_cancel_stats(char *page, char **start, off_t off,
+					 int count, int *eof, void *data)
+{
+	struct ldlm_namespace *ns = data;
+	struct lprocfs_counter lat;
+	struct lprocfs_counter batch;
+
+	lprocfs_stats_collect(ns->ns_stats, LDLM_NSS_BL_CANCEL_LAT, &lat);
+	lprocfs_stats_collect(ns->ns_stats, LDLM_NSS_BL_CANCEL_BATCH, &batch);
+	*eof = 1;
+	return snprintf(page, count, "cancels: "LPD64"\n"
+			"latency_usec_avg: "LPD64"\n"
+			"latency_usec_min: "LPD64"\n"
+			"latency_usec_max: "LPD64"\n"
+			"batches: "LPD64"\n"
+			"batched_locks: "LPD64"\n",
+			lat.lc_count,
+			lat.lc_count != 0 ? lat.lc_sum / lat.lc_count : 0,
+			lat.lc_count != 0 ? lat.lc_min : 0, lat.lc_max,
+			batch.lc_count, batch.lc_sum);
+}
+
 static int lprocfs_rd_lru_size(char *page, char **start, off_t off,
                                int count, int *eof, void *data)
 {
@@ -210,7 +250,8 @@ static int lprocfs_wr_lru_size(struct file *file, const char *buffer,
                 CDEBUG(D_DLMTRACE,
                        "dropping all unused locks from namespace %s\n",
                        ldlm_ns_name(ns));
-                if (ns_connect_lru_resize(ns)) {
+		if (ns_connect_lru_resize(ns) ||
+		    ns->ns_lru_policy == LDLM_LRU_POLICY_ADAPTIVE) {
                         int canceled, unused  = ns->ns_nr_unused;
 
                         /* Try to cancel all @ns_nr_unused locks. */
@@ -281,6 +322,82 @@ static int lprocfs_wr_lru_size(struct file *file, const char *buffer,
         return count;
 }
 
+static const char *ldlm_lru_policy_names[] = {
+	[LDLM_LRU_POLICY_DEFAULT]	= "default",
+	[LDLM_LRU_POLICY_ADAPTIVE]	= "adaptive",
+};
+
+static int lprocfs_rd_lru_policy(char *page, char **start, off_t off,
+				 int count, int *eof, void *data)
+{
+	struct ldlm_namespace *ns = data;
+
+	*eof = 1;
+	return snprintf(page, count, "%s\n",
+			ldlm_lru_policy_names[ns->ns_lru_policy]);
+}
+
+static int lprocfs_wr_lru_policy(struct file *file, const char *buffer,
+				 unsigned long count, void *data)
+{
+	struct ldlm_namespace *ns = data;
+	char kernbuf[16];
+	int i;
+
+	if (count >= sizeof(kernbuf))
+		return -EINVAL;
+	if (copy_from_user(kernbuf, buffer, count))
+		return -EFAULT;
+	kernbuf[count] = '\0';
+	if (count > 0 && kernbuf[count - 1] == '\n')
+		kernbuf[count - 1] = '\0';
+
+	for (i = 0; i < ARRAY_SIZE(ldlm_lru_policy_names); i++)
+		if (strcmp(kernbuf, ldlm_lru_policy_names[i]) == 0)
+			break;
+	if (i == ARRAY_SIZE(ldlm_lru_policy_names))
+		return -EINVAL;
+
+	spin_lock(&ns->ns_lock);
+	if (ns->ns_lru_policy != i &&
+	    i == LDLM_LRU_POLICY_ADAPTIVE) {
+		/* start the search from the current LRU size */
+		ns->ns_lru_target = max_t(unsigned int, ns->ns_nr_unused,
+					  LDLM_LRU_ADAPT_MIN);
+		ns->ns_lru_last_hits = cfs_atomic_read(&ns->ns_lru_hits);
+		ns->ns_lru_last_misses = cfs_atomic_read(&ns->ns_lru_misses);
+		ns->ns_lru_last_rate = 0;
+		ns->ns_lru_step = 0;
+	}
+	ns->ns_lru_policy = i;
+	spin_unlock(&ns->ns_lock);
+
+	CDEBUG(D_DLMTRACE, "namespace %s LRU policy set to %s\n",
+	       ldlm_ns_name(ns), ldlm_lru_policy_names[i]);
+	return count;
+}
+
+static int lprocfs_rd_lru_stats(char *page, char **start, off_t off,
+				int count, int *eof, void *data)
+{
+	struct ldlm_namespace *ns = data;
+	unsigned int hits = cfs_atomic_read(&ns->ns_lru_hits);
+	unsigned int misses = cfs_atomic_read(&ns->ns_lru_misses);
+
+	*eof = 1;
+	return snprintf(page, count, "policy: %s\n"
+			"unused: %d\n"
+			"target: %u\n"
+			"budget: %u\n"
+			"hits: %u\n"
+			"misses: %u\n"
+			"hit_rate_permille: %d\n",
+			ldlm_lru_policy_names[ns->ns_lru_policy],
+			ns->ns_nr_unused, ns->ns_lru_target,
+			ldlm_lru_mem_budget(), hits, misses,
+			ns->ns_lru_last_rate);
+}
+
 static int lprocfs_rd_elc(char *page, char **start, off_t off,
 			  int count, int *eof, void *data)
 {
@@ -338,6 +455,13 @@ int ldlm_namespace_proc_register(struct ldlm_namespace *ns)
 
         lprocfs_counter_init(ns->ns_stats, LDLM_NSS_LOCKS,
                              LPROCFS_CNTR_AVGMINMAX, "locks", "locks");
+	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_IBITS_EXAMINED,
+			     LPROCFS_CNTR_AVGMINMAX, "ibits_examined", "locks");
+	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_BL_CANCEL_LAT,
+			     LPROCFS_CNTR_AVGMINMAX, "bl_cancel_latency",
+			     "usec");
+	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_BL_CANCEL_BATCH,
+			     LPROCFS_CNTR_AVGMINMAX, "bl_cancel_batch", "locks");
 
         lock_name[MAX_STRING_SIZE] = '\0';
 
@@ -383,6 +507,27 @@ int ldlm_namespace_proc_register(struct ldlm_namespace *ns)
 		lock_vars[0].read_fptr = lprocfs_rd_elc;
 		lock_vars[0].write_fptr = lprocfs_wr_elc;
 		lprocfs_add_vars(ldlm_ns_proc_dir, lock_vars, 0);
+
+		snprintf(lock_name, MAX_STRING_SIZE, "%s/bl_cancel_stats",
+			 ldlm_ns_name(ns));
+		lock_vars[0].data = ns;
+		lock_vars[0].read_fptr = lprocfs_rd_ns_bl_cancel_stats;
+		lock_vars[0].write_fptr = NULL;
+		lprocfs_add_vars(ldlm_ns_proc_dir, lock_vars, 0);
+
+		snprintf(lock_name, MAX_STRING_SIZE, "%s/lru_policy",
+			 ldlm_ns_name(ns));
+		lock_vars[0].data = ns;
+		lock_vars[0].read_fptr = lprocfs_rd_lru_policy;
+		lock_vars[0].write_fptr = lprocfs_wr_lru_policy;
+		lprocfs_add_vars(ldlm_ns_proc_dir, lock_vars, 0);
+
+		snprintf(lock_name, MAX_STRING_SIZE, "%s/lru_stats",
+			 ldlm_ns_name(ns));
+		lock_vars[0].data = ns;
+		lock_vars[0].read_fptr = lprocfs_rd_lru_stats;
+		lock_vars[0].write_fptr = NULL;
+		lprocfs_add_vars(ldlm_ns_proc_dir, lock_vars, 0);
         } else {
                 snprintf(lock_name, MAX_STRING_SIZE, "%s/ctime_age_limit",
                          ldlm_ns_name(ns));
@@ -424,6 +569,13 @@ int ldlm_namespace_proc_register(struct ldlm_namespace *ns)
                 lock_vars[0].read_fptr = lprocfs_rd_uint;
                 lock_vars[0].write_fptr = lprocfs_wr_uint;
                 lprocfs_add_vars(ldlm_ns_proc_dir, lock_vars, 0);
+
+		snprintf(lock_name, MAX_STRING_SIZE, "%s/ibits_examined",
+			 ldlm_ns_name(ns));
+		lock_vars[0].data = ns;
+		lock_vars[0].read_fptr = lprocfs_rd_ns_ibits_examined;
+		lock_vars[0].write_fptr = NULL;
+		lprocfs_add_vars(ldlm_ns_proc_dir, lock_vars, 0);
         }
         return 0;
 }
@@ -663,6 +815,7 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 
 	CFS_INIT_LIST_HEAD(&ns->ns_list_chain);
 	CFS_INIT_LIST_HEAD(&ns->ns_unused_list);
+	CFS_INIT_LIST_HEAD(&ns->ns_bl_cancels);
 	spin_lock_init(&ns->ns_lock);
 	cfs_atomic_set(&ns->ns_bref, 0);
 	init_waitqueue_head(&ns->ns_waitq);
@@ -675,6 +828,14 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
         ns->ns_nr_unused          = 0;
         ns->ns_max_unused         = LDLM_DEFAULT_LRU_SIZE;
         ns->ns_max_age            = LDLM_DEFAULT_MAX_ALIVE;
+	ns->ns_lru_policy         = LDLM_LRU_POLICY_DEFAULT;
+	ns->ns_lru_target         = LDLM_DEFAULT_LRU_SIZE;
+	cfs_atomic_set(&ns->ns_lru_hits, 0);
+	cfs_atomic_set(&ns->ns_lru_misses, 0);
+	ns->ns_lru_last_hits      = 0;
+	ns->ns_lru_last_misses    = 0;
+	ns->ns_lru_last_rate      = 0;
+	ns->ns_lru_step           = 0;
         ns->ns_ctime_age_limit    = LDLM_CTIME_AGE_LIMIT;
         ns->ns_timeouts           = 0;
         ns->ns_orig_connect_flags = 0;
@@ -1063,7 +1224,8 @@ struct ldlm_namespace *ldlm_namespace_first_locked(ldlm_side_t client)
 }
 
 /** Create and initialize new resource. */
-static struct ldlm_resource *ldlm_resource_new(void)
+static struct ldlm_resource *ldlm_resource_new(struct ldlm_namespace *ns,
+					       ldlm_type_t type)
 {
         struct ldlm_resource *res;
         int idx;
@@ -1072,6 +1234,15 @@ static struct ldlm_resource *ldlm_resource_new(void)
         if (res == NULL)
                 return NULL;
 
+	/* Only servers check IBITS locks for compatibility. */
+	if (type == LDLM_IBITS && ns_is_server(ns)) {
+		res->lr_ibits_queues = ldlm_ibits_queues_alloc();
+		if (res->lr_ibits_queues == NULL) {
+			OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+			return NULL;
+		}
+	}
+
         CFS_INIT_LIST_HEAD(&res->lr_granted);
         CFS_INIT_LIST_HEAD(&res->lr_converting);
         CFS_INIT_LIST_HEAD(&res->lr_waiting);
@@ -1095,6 +1266,13 @@ static struct ldlm_resource *ldlm_resource_new(void)
 	return res;
 }
 
+static void ldlm_resource_free(struct ldlm_resource *res)
+{
+	if (res->lr_ibits_queues != NULL)
+		ldlm_ibits_queues_free(res->lr_ibits_queues);
+	OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+}
+
 /**
  * Return a reference to resource with given name, creating it if necessary.
  * Args: namespace with ns_lock unlocked
@@ -1142,7 +1320,7 @@ ldlm_resource_get(struct ldlm_namespace *ns, struct ldlm_resource *parent,
 
         LASSERTF(type >= LDLM_MIN_TYPE && type < LDLM_MAX_TYPE,
                  "type: %d\n", type);
-        res = ldlm_resource_new();
+        res = ldlm_resource_new(ns, type);
         if (!res)
                 return NULL;
 
@@ -1162,7 +1340,7 @@ ldlm_resource_get(struct ldlm_namespace *ns, struct ldlm_resource *parent,
 		lu_ref_fini(&res->lr_reference);
 		/* We have taken lr_lvb_mutex. Drop it. */
 		mutex_unlock(&res->lr_lvb_mutex);
-		OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+		ldlm_resource_free(res);
 
 		res = cfs_hlist_entry(hnode, struct ldlm_resource, lr_hash);
 		/* Synchronize with regard to resource creation. */
@@ -1273,7 +1451,7 @@ int ldlm_resource_putref(struct ldlm_resource *res)
                 cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
                 if (ns->ns_lvbo && ns->ns_lvbo->lvbo_free)
                         ns->ns_lvbo->lvbo_free(res);
-                OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+		ldlm_resource_free(res);
                 return 1;
         }
         return 0;
@@ -1303,7 +1481,7 @@ int ldlm_resource_putref_locked(struct ldlm_resource *res)
                  */
                 if (ns->ns_lvbo && ns->ns_lvbo->lvbo_free)
                         ns->ns_lvbo->lvbo_free(res);
-                OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+		ldlm_resource_free(res);
 
                 cfs_hash_bd_lock(ns->ns_rs_hash, &bd, 1);
                 return 1;
@@ -1329,6 +1507,8 @@ void ldlm_resource_add_lock(struct ldlm_resource *res, cfs_list_t *head,
 	LASSERT(cfs_list_empty(&lock->l_res_link));
 
 	cfs_list_add_tail(&lock->l_res_link, head);
+	if (res->lr_ibits_queues != NULL)
+		ldlm_ibits_queues_add(lock, head);
 }
 
 /**
@@ -1366,6 +1546,11 @@ void ldlm_resource_unlink_lock(struct ldlm_lock *lock)
                 ldlm_unlink_lock_skiplist(lock);
         else if (type == LDLM_EXTENT)
                 ldlm_extent_unlink_lock(lock);
+	else if (type == LDLM_FLOCK)
+		ldlm_flock_unlink_lock(lock);
+	if (lock->l_resource->lr_ibits_queues != NULL &&
+	    !cfs_list_empty(&lock->l_res_link))
+		ldlm_ibits_queues_del(lock);
         cfs_list_del_init(&lock->l_res_link);
 }
 EXPORT_SYMBOL(ldlm_resource_unlink_lock);
@@ -331,6 +331,12 @@ enum ra_stat {
         RA_STAT_EOF,
         RA_STAT_MAX_IN_FLIGHT,
         RA_STAT_WRONG_GRAB_PAGE,
+        RA_STAT_HIT_SEQUENTIAL,
+        RA_STAT_HIT_STRIDE,
+        RA_STAT_HIT_REVERSE,
+        RA_STAT_HIT_NESTED,
+        RA_STAT_PATTERN_MISS,
+        RA_STAT_ASYNC,
         _NR_RA_STAT,
 };
 
@@ -416,6 +422,7 @@ enum stats_track_type {
 #define LL_SBI_LAYOUT_LOCK    0x20000 /* layout lock support */
 #define LL_SBI_USER_FID2PATH  0x40000 /* allow fid2path by unprivileged users */
 #define LL_SBI_XATTR_CACHE    0x80000 /* support for xattr cache */
+#define LL_SBI_RA_ASYNC      0x100000 /* pattern read-ahead in ll_ra thread */
 
 #define LL_SBI_FLAGS { 	\
 	"nolck",	\
@@ -438,6 +445,7 @@ enum stats_track_type {
 	"layout",	\
 	"user_fid2path",\
 	"xattr",	\
+	"ra_async",	\
 }
 
 /* default value for ll_sb_info->contention_time */
@@ -493,6 +501,7 @@ struct ll_sb_info {
 
         cfs_list_t                ll_orphan_dentry_list; /*please don't ask -p*/
         struct ll_close_queue    *ll_lcq;
+	struct ll_ra_queue	 *ll_raq;
 
         struct lprocfs_stats     *ll_stats; /* lprocfs stats counter */
 
@@ -549,6 +558,25 @@ struct ll_ra_read {
         cfs_list_t          lrr_linkage;
 };
 
+/* number of request deltas remembered per file descriptor */
+#define LL_RA_HISTORY	16
+/* most requests prefetched ahead of the application for one pattern */
+#define LL_RA_PREDICT	8
+
+enum ras_pattern {
+	RAS_PATTERN_NONE = 0,
+	/* equal requests, each one before the previous one */
+	RAS_PATTERN_REVERSE,
+	/* a repeating sequence of two or more different strides */
+	RAS_PATTERN_NESTED,
+};
+
+/* extent of a request predicted from the read pattern, in pages */
+struct ll_ra_extent {
+	pgoff_t		re_start;
+	unsigned long	re_count;
+};
+
 /*
  * per file-descriptor read-ahead data.
  */
@@ -633,6 +661,28 @@ struct ll_readahead_state {
          * stride read-ahead will be enable
          */
         unsigned long   ras_consecutive_stride_requests;
+	/*
+	 * Distances, in pages, between the starts of the last read(2)
+	 * requests which were not contiguous with their predecessor, oldest
+	 * first. Repeating sequences in this history find the patterns the
+	 * window and stride detectors above cannot follow: backward scans
+	 * and strides nested in other strides.
+	 */
+	long		ras_deltas[LL_RA_HISTORY];
+	unsigned int	ras_nr_deltas;
+	/* first page and length of the last read(2) request */
+	pgoff_t		ras_req_start;
+	unsigned long	ras_req_len;
+	/*
+	 * Pattern found in ras_deltas, the number of deltas it repeats
+	 * after, and the ->ras_requests of the last request predicted from
+	 * it whose pages were already prefetched.
+	 */
+	enum ras_pattern ras_pattern;
+	unsigned int	ras_pattern_period;
+	unsigned long	ras_pattern_issued;
+	/* prefetch for this file descriptor is queued to the ll_ra thread */
+	unsigned int	ras_async_pending:1;
 };
 
 extern struct kmem_cache *ll_file_data_slab;
@@ -939,6 +989,15 @@ struct ll_close_queue {
 	cfs_atomic_t		lcq_stop;
 };
 
+/* queue of pattern prefetches served by the per-mount ll_ra thread */
+struct ll_ra_queue {
+	spinlock_t		raq_lock;
+	cfs_list_t		raq_head;
+	wait_queue_head_t	raq_waitq;
+	struct completion	raq_comp;
+	cfs_atomic_t		raq_stop;
+};
+
 struct ccc_object *cl_inode2ccc(struct inode *inode);
 
 
@@ -1046,6 +1105,7 @@ struct vvp_thread_info {
         struct iovec         vti_local_iov;
         struct vvp_io_args   vti_args;
         struct ra_io_arg     vti_ria;
+	struct ll_ra_extent  vti_ra_pred[LL_RA_PREDICT];
         struct kiocb         vti_kiocb;
         struct ll_cl_context vti_io_ctx;
 };
@@ -1242,6 +1302,8 @@ void ras_update(struct ll_sb_info *sbi, struct inode *inode,
 void ll_ra_count_put(struct ll_sb_info *sbi, unsigned long len);
 int ll_is_file_contended(struct file *file);
 void ll_ra_stats_inc(struct address_space *mapping, enum ra_stat which);
+int ll_ra_thread_start(struct ll_ra_queue **raq_ret);
+void ll_ra_thread_shutdown(struct ll_ra_queue *raq);
 
 /* llite/llite_rmtacl.c */
 #ifdef CONFIG_FS_POSIX_ACL
@@ -144,6 +144,9 @@ static struct ll_sb_info *ll_init_sbi(void)
         cfs_atomic_set(&sbi->ll_agl_total, 0);
         sbi->ll_flags |= LL_SBI_AGL_ENABLED;
 
+	/* pattern read-ahead is issued by the ll_ra thread by default */
+	sbi->ll_flags |= LL_SBI_RA_ASYNC;
+
         RETURN(sbi);
 }
 
@@ -555,6 +558,15 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
                 GOTO(out_root, err);
         }
 
+	/* without the thread, pattern read-ahead is done by the reader */
+	err = ll_ra_thread_start(&sbi->ll_raq);
+	if (err) {
+		CWARN("%s: cannot start read-ahead thread: rc = %d\n",
+		      ll_get_fsname(sb, NULL, 0), err);
+		sbi->ll_raq = NULL;
+		err = 0;
+	}
+
 #ifdef CONFIG_FS_POSIX_ACL
         if (sbi->ll_flags & LL_SBI_RMT_CLIENT) {
                 rct_init(&sbi->ll_rct);
@@ -609,6 +621,10 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
 
         RETURN(err);
 out_root:
+	if (sbi->ll_raq != NULL) {
+		ll_ra_thread_shutdown(sbi->ll_raq);
+		sbi->ll_raq = NULL;
+	}
         if (root)
                 iput(root);
 out_lock_cn_cb:
@@ -702,6 +718,8 @@ void client_common_put_super(struct super_block *sb)
         }
 #endif
 
+	if (sbi->ll_raq != NULL)
+		ll_ra_thread_shutdown(sbi->ll_raq);
         ll_close_thread_shutdown(sbi->ll_lcq);
 
         cl_sb_fini(sb);
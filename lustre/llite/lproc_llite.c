@@ -396,6 +396,36 @@ static int ll_wr_max_read_ahead_whole_mb(struct file *file, const char *buffer,
 	return count;
 }
 
+static int ll_rd_read_ahead_async(char *page, char **start, off_t off,
+				  int count, int *eof, void *data)
+{
+	struct super_block *sb = data;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+
+	return snprintf(page, count, "%u\n",
+			sbi->ll_flags & LL_SBI_RA_ASYNC ? 1 : 0);
+}
+
+/* 0 issues pattern read-ahead from the reading thread itself */
+static int ll_wr_read_ahead_async(struct file *file, const char *buffer,
+				  unsigned long count, void *data)
+{
+	struct super_block *sb = data;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+	int val, rc;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	if (val)
+		sbi->ll_flags |= LL_SBI_RA_ASYNC;
+	else
+		sbi->ll_flags &= ~LL_SBI_RA_ASYNC;
+
+	return count;
+}
+
 static int ll_rd_max_cached_mb(char *page, char **start, off_t off,
                                int count, int *eof, void *data)
 {
@@ -820,6 +850,8 @@ static struct lprocfs_vars lprocfs_llite_obd_vars[] = {
                                         ll_wr_max_readahead_per_file_mb, 0 },
         { "max_read_ahead_whole_mb", ll_rd_max_read_ahead_whole_mb,
                                      ll_wr_max_read_ahead_whole_mb, 0 },
+	{ "read_ahead_async", ll_rd_read_ahead_async,
+			      ll_wr_read_ahead_async, 0 },
         { "max_cached_mb",    ll_rd_max_cached_mb, ll_wr_max_cached_mb, 0 },
         { "checksum_pages",   ll_rd_checksum, ll_wr_checksum, 0 },
         { "max_rw_chunk",     ll_rd_max_rw_chunk, ll_wr_max_rw_chunk, 0 },
@@ -922,6 +954,12 @@ static const char *ra_stat_string[] = {
         [RA_STAT_EOF] = "read-ahead to EOF",
         [RA_STAT_MAX_IN_FLIGHT] = "hit max r-a issue",
         [RA_STAT_WRONG_GRAB_PAGE] = "wrong page from grab_cache_page",
+	[RA_STAT_HIT_SEQUENTIAL] = "sequential hits",
+	[RA_STAT_HIT_STRIDE] = "stride hits",
+	[RA_STAT_HIT_REVERSE] = "reverse hits",
+	[RA_STAT_HIT_NESTED] = "nested stride hits",
+	[RA_STAT_PATTERN_MISS] = "pattern mispredicted",
+	[RA_STAT_ASYNC] = "async read-ahead",
 };
 
 
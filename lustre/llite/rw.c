@@ -569,6 +569,353 @@ static int ll_read_ahead_pages(const struct lu_env *env,
         return count;
 }
 
+/* called with the ras_lock held */
+static void ras_pattern_reset(struct ll_readahead_state *ras)
+{
+	ras->ras_nr_deltas = 0;
+	ras->ras_pattern = RAS_PATTERN_NONE;
+	ras->ras_pattern_period = 0;
+}
+
+/*
+ * Find the shortest period the tail of the delta history repeats with.
+ * A single delta has to be seen three times in a row, longer sequences
+ * twice, before they are believed.
+ */
+static unsigned int ras_pattern_period(struct ll_readahead_state *ras)
+{
+	unsigned int n = ras->ras_nr_deltas;
+	unsigned int p;
+	unsigned int i;
+
+	for (p = 1; p + max(p, 2U) <= n; p++) {
+		for (i = 1; i <= max(p, 2U); i++) {
+			if (ras->ras_deltas[n - i] != ras->ras_deltas[n - i - p])
+				break;
+		}
+		if (i > max(p, 2U))
+			return p;
+	}
+	return 0;
+}
+
+/*
+ * Record the start of a new read(2) request in the delta history and
+ * check it against the pattern found so far, or look for a new one.
+ * Contiguous requests are left to the read-ahead window. Called with the
+ * ras_lock held.
+ */
+static void ras_pattern_update(struct ll_sb_info *sbi,
+			       struct ll_readahead_state *ras,
+			       pgoff_t start, unsigned long count)
+{
+	long delta = (long)(start - ras->ras_req_start);
+	unsigned int n;
+	unsigned int p;
+	long sum;
+
+	if (ras->ras_requests <= 1 ||
+	    start == ras->ras_req_start + ras->ras_req_len) {
+		ras_pattern_reset(ras);
+		goto out;
+	}
+
+	if (ras->ras_pattern != RAS_PATTERN_NONE) {
+		n = ras->ras_nr_deltas;
+		p = ras->ras_pattern_period;
+		if (delta != ras->ras_deltas[n - p]) {
+			ll_ra_stats_inc_sbi(sbi, RA_STAT_PATTERN_MISS);
+			ras->ras_pattern = RAS_PATTERN_NONE;
+			ras->ras_pattern_period = 0;
+		}
+	}
+
+	if (ras->ras_nr_deltas == LL_RA_HISTORY) {
+		memmove(ras->ras_deltas, ras->ras_deltas + 1,
+			(LL_RA_HISTORY - 1) * sizeof(ras->ras_deltas[0]));
+		ras->ras_nr_deltas--;
+	}
+	ras->ras_deltas[ras->ras_nr_deltas++] = delta;
+
+	if (ras->ras_pattern != RAS_PATTERN_NONE)
+		goto out;
+
+	p = ras_pattern_period(ras);
+	if (p == 0)
+		goto out;
+
+	/* forward strides of a single size belong to the stride detector,
+	 * and a sequence which comes back to where it started needs no
+	 * read-ahead at all */
+	for (n = ras->ras_nr_deltas - p, sum = 0; n < ras->ras_nr_deltas; n++)
+		sum += ras->ras_deltas[n];
+	if (sum == 0 || (p == 1 && delta > 0))
+		goto out;
+
+	ras->ras_pattern = p == 1 ? RAS_PATTERN_REVERSE : RAS_PATTERN_NESTED;
+	ras->ras_pattern_period = p;
+	ras->ras_pattern_issued = ras->ras_requests;
+	CDEBUG(D_READA, "%s pattern, period %u, last delta %ld\n",
+	       p == 1 ? "reverse" : "nested stride", p, delta);
+out:
+	ras->ras_req_start = start;
+	ras->ras_req_len = count;
+}
+
+/*
+ * Predict up to LL_RA_PREDICT requests following the current one from the
+ * pattern, within the per-file read-ahead budget and the file size, and
+ * store the ones not prefetched yet in \a ext. Called with the ras_lock
+ * held.
+ *
+ * \retval number of extents stored in \a ext
+ */
+static int ras_pattern_predict(struct ll_readahead_state *ras,
+			       struct ll_ra_info *ra, pgoff_t last,
+			       struct ll_ra_extent *ext)
+{
+	unsigned int n = ras->ras_nr_deltas;
+	unsigned int p = ras->ras_pattern_period;
+	unsigned long len = ras->ras_req_len;
+	unsigned long budget = ra->ra_max_pages_per_file;
+	pgoff_t start = ras->ras_req_start;
+	int nr = 0;
+	int k;
+
+	if (ras->ras_pattern == RAS_PATTERN_NONE || len == 0)
+		return 0;
+
+	for (k = 1; k <= LL_RA_PREDICT && budget >= len; k++) {
+		long delta = ras->ras_deltas[n - p + (k - 1) % p];
+
+		if (delta < 0 && start < (pgoff_t)-delta)
+			break;
+		start += delta;
+		if (start > last)
+			break;
+		budget -= len;
+
+		if (ras->ras_requests + k <= ras->ras_pattern_issued)
+			continue;
+		ext[nr].re_start = start;
+		ext[nr].re_count = min(len, last - start + 1);
+		nr++;
+		ras->ras_pattern_issued = ras->ras_requests + k;
+	}
+	return nr;
+}
+
+/**
+ * Read ahead one extent predicted from the read pattern into \a queue.
+ *
+ * \retval number of pages added to \a queue
+ */
+static int ll_ra_issue_extent(const struct lu_env *env, struct cl_io *io,
+			      struct cl_page_list *queue,
+			      struct address_space *mapping,
+			      struct ll_ra_extent *ext)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(mapping->host);
+	struct ra_io_arg *ria = &vvp_env_info(env)->vti_ria;
+	unsigned long reserved;
+	unsigned long ra_end;
+	int count;
+
+	/* ria_pages == ria_length keeps the extent as it is, neither
+	 * trimmed to an RPC boundary nor treated as a stride */
+	memset(ria, 0, sizeof(*ria));
+	ria->ria_start = ext->re_start;
+	ria->ria_end = ext->re_start + ext->re_count - 1;
+	ria->ria_stoff = ext->re_start;
+	ria->ria_length = ext->re_count;
+	ria->ria_pages = ext->re_count;
+
+	reserved = ll_ra_count_get(sbi, ria, ext->re_count);
+	if (reserved < ext->re_count)
+		ll_ra_stats_inc_sbi(sbi, RA_STAT_MAX_IN_FLIGHT);
+
+	count = ll_read_ahead_pages(env, io, queue, ria, &reserved, mapping,
+				    &ra_end);
+	if (reserved != 0)
+		ll_ra_count_put(sbi, reserved);
+
+	return count;
+}
+
+/* prefetch of predicted extents queued to the ll_ra thread */
+struct ll_ra_work {
+	cfs_list_t		rw_list;
+	/* file reference held until the prefetch is submitted */
+	struct file		*rw_file;
+	int			rw_nr;
+	struct ll_ra_extent	rw_ext[LL_RA_PREDICT];
+};
+
+/**
+ * Hand the extents predicted for the file being read over to the ll_ra
+ * thread, so that the application does not wait for their pages to be
+ * found and locked.
+ *
+ * \retval 0 the prefetch is queued
+ * \retval -ENOMEM the caller should read the extents ahead itself
+ */
+static int ll_ra_queue_pattern(const struct lu_env *env,
+			       struct ll_readahead_state *ras,
+			       struct ll_ra_extent *ext, int nr)
+{
+	struct file *file = ccc_env_io(env)->cui_fd->fd_file;
+	struct ll_ra_queue *raq = ll_i2sbi(file->f_dentry->d_inode)->ll_raq;
+	struct ll_ra_work *work;
+
+	LASSERT(ras == ll_ras_get(file));
+	LASSERT(nr > 0 && nr <= LL_RA_PREDICT);
+
+	OBD_ALLOC_PTR(work);
+	if (work == NULL)
+		return -ENOMEM;
+
+	get_file(file);
+	work->rw_file = file;
+	work->rw_nr = nr;
+	memcpy(work->rw_ext, ext, nr * sizeof(*ext));
+
+	spin_lock(&raq->raq_lock);
+	cfs_list_add_tail(&work->rw_list, &raq->raq_head);
+	spin_unlock(&raq->raq_lock);
+	wake_up(&raq->raq_waitq);
+	return 0;
+}
+
+static void ll_ra_work_handle(struct ll_ra_work *work)
+{
+	struct file *file = work->rw_file;
+	struct inode *inode = file->f_dentry->d_inode;
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct ll_readahead_state *ras = ll_ras_get(file);
+	struct cl_object *clob = ll_i2info(inode)->lli_clob;
+	struct lu_env *env;
+	struct cl_io *io;
+	struct cl_2queue *queue;
+	int refcheck;
+	int rc;
+	int i;
+	ENTRY;
+
+	env = cl_env_get(&refcheck);
+	if (IS_ERR(env))
+		GOTO(out, rc = PTR_ERR(env));
+
+	io = ccc_env_thread_io(env);
+	io->ci_obj = clob;
+	io->ci_ignore_layout = 1;
+	rc = cl_io_init(env, io, CIT_MISC, clob);
+	if (rc == 0) {
+		queue = &io->ci_queue;
+		cl_2queue_init(queue);
+		for (i = 0; i < work->rw_nr; i++) {
+			if (ll_ra_issue_extent(env, io, &queue->c2_qin,
+					       inode->i_mapping,
+					       &work->rw_ext[i]) > 0)
+				ll_ra_stats_inc_sbi(sbi, RA_STAT_ASYNC);
+		}
+		if (queue->c2_qin.pl_nr > 0)
+			rc = cl_io_submit_rw(env, io, CRT_READ, queue);
+		/* unlock pages which were not sent */
+		cl_page_list_disown(env, io, &queue->c2_qin);
+		cl_2queue_fini(env, queue);
+	}
+	cl_io_fini(env, io);
+	cl_env_put(env, &refcheck);
+	EXIT;
+out:
+	if (rc < 0)
+		CDEBUG(D_READA, DFID": read-ahead of %d extents failed: %d\n",
+		       PFID(ll_inode2fid(inode)), work->rw_nr, rc);
+
+	spin_lock(&ras->ras_lock);
+	ras->ras_async_pending = 0;
+	spin_unlock(&ras->ras_lock);
+
+	fput(file);
+	OBD_FREE_PTR(work);
+}
+
+static struct ll_ra_work *ll_ra_next_work(struct ll_ra_queue *raq)
+{
+	struct ll_ra_work *work = NULL;
+
+	spin_lock(&raq->raq_lock);
+	if (!cfs_list_empty(&raq->raq_head)) {
+		work = cfs_list_entry(raq->raq_head.next, struct ll_ra_work,
+				      rw_list);
+		cfs_list_del_init(&work->rw_list);
+	} else if (cfs_atomic_read(&raq->raq_stop)) {
+		work = ERR_PTR(-EALREADY);
+	}
+	spin_unlock(&raq->raq_lock);
+	return work;
+}
+
+static int ll_ra_thread(void *arg)
+{
+	struct ll_ra_queue *raq = arg;
+	ENTRY;
+
+	complete(&raq->raq_comp);
+
+	while (1) {
+		struct l_wait_info lwi = { 0 };
+		struct ll_ra_work *work;
+
+		l_wait_event_exclusive(raq->raq_waitq,
+				       (work = ll_ra_next_work(raq)) != NULL,
+				       &lwi);
+		if (IS_ERR(work))
+			break;
+
+		ll_ra_work_handle(work);
+	}
+
+	CDEBUG(D_INFO, "ll_ra exiting\n");
+	complete(&raq->raq_comp);
+	RETURN(0);
+}
+
+int ll_ra_thread_start(struct ll_ra_queue **raq_ret)
+{
+	struct ll_ra_queue *raq;
+	struct task_struct *task;
+
+	OBD_ALLOC_PTR(raq);
+	if (raq == NULL)
+		return -ENOMEM;
+
+	spin_lock_init(&raq->raq_lock);
+	CFS_INIT_LIST_HEAD(&raq->raq_head);
+	init_waitqueue_head(&raq->raq_waitq);
+	init_completion(&raq->raq_comp);
+
+	task = kthread_run(ll_ra_thread, raq, "ll_ra");
+	if (IS_ERR(task)) {
+		OBD_FREE_PTR(raq);
+		return PTR_ERR(task);
+	}
+
+	wait_for_completion(&raq->raq_comp);
+	*raq_ret = raq;
+	return 0;
+}
+
+/* queued prefetches are still submitted before the thread exits */
+void ll_ra_thread_shutdown(struct ll_ra_queue *raq)
+{
+	init_completion(&raq->raq_comp);
+	cfs_atomic_inc(&raq->raq_stop);
+	wake_up(&raq->raq_waitq);
+	wait_for_completion(&raq->raq_comp);
+	OBD_FREE_PTR(raq);
+}
+
 int ll_readahead(const struct lu_env *env, struct cl_io *io,
                  struct ll_readahead_state *ras, struct address_space *mapping,
                  struct cl_page_list *queue, int flags)
@@ -583,6 +930,9 @@ int ll_readahead(const struct lu_env *env, struct cl_io *io,
         struct ra_io_arg *ria = &vti->vti_ria;
         struct ll_inode_info *lli;
         struct cl_object *clob;
+	struct ll_sb_info *sbi;
+	int async = 0;
+	int npred = 0;
         int ret = 0;
         __u64 kms;
         ENTRY;
@@ -590,6 +940,7 @@ int ll_readahead(const struct lu_env *env, struct cl_io *io,
         inode = mapping->host;
         lli = ll_i2info(inode);
         clob = lli->lli_clob;
+	sbi = ll_i2sbi(inode);
 
         memset(ria, 0, sizeof *ria);
 
@@ -622,6 +973,23 @@ int ll_readahead(const struct lu_env *env, struct cl_io *io,
                 start = ras->ras_next_readahead;
                 end = ras->ras_window_start + ras->ras_window_len - 1;
         }
+	/* With a pattern known, pages following the request are not going
+	 * to be read next, only batch the request itself here. */
+	if (ras->ras_pattern != RAS_PATTERN_NONE && bead != NULL &&
+	    end >= bead->lrr_start + bead->lrr_count)
+		end = bead->lrr_start + bead->lrr_count - 1;
+
+	/* Only one prefetch per file descriptor is queued at a time, the
+	 * requests it skips are predicted again once it is done. */
+	if (sbi->ll_flags & LL_SBI_RA_ASYNC && sbi->ll_raq != NULL)
+		async = 1;
+	if (!(async && ras->ras_async_pending)) {
+		npred = ras_pattern_predict(ras, &sbi->ll_ra_info,
+					    (kms - 1) >> PAGE_CACHE_SHIFT,
+					    vti->vti_ra_pred);
+		if (npred > 0 && async)
+			ras->ras_async_pending = 1;
+	}
         if (end != 0) {
                 unsigned long rpc_boundary;
                 /*
@@ -660,11 +1028,11 @@ int ll_readahead(const struct lu_env *env, struct cl_io *io,
 
         if (end == 0) {
                 ll_ra_stats_inc(mapping, RA_STAT_ZERO_WINDOW);
-                RETURN(0);
+		GOTO(out_pattern, ret = 0);
         }
         len = ria_page_count(ria);
         if (len == 0)
-                RETURN(0);
+		GOTO(out_pattern, ret = 0);
 
         reserved = ll_ra_count_get(ll_i2sbi(inode), ria, len);
         if (reserved < len)
@@ -702,6 +1070,21 @@ int ll_readahead(const struct lu_env *env, struct cl_io *io,
 		spin_unlock(&ras->ras_lock);
 	}
 
+out_pattern:
+	if (npred > 0 &&
+	    (!async || ll_ra_queue_pattern(env, ras, vti->vti_ra_pred,
+					   npred) != 0)) {
+		int i;
+
+		for (i = 0; i < npred; i++)
+			ll_ra_issue_extent(env, io, queue, mapping,
+					   &vti->vti_ra_pred[i]);
+		if (async) {
+			spin_lock(&ras->ras_lock);
+			ras->ras_async_pending = 0;
+			spin_unlock(&ras->ras_lock);
+		}
+	}
 	RETURN(ret);
 }
 
@@ -738,7 +1121,9 @@ void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras)
 {
 	spin_lock_init(&ras->ras_lock);
 	ras_reset(inode, ras, 0);
+	ras_pattern_reset(ras);
 	ras->ras_requests = 0;
+	ras->ras_async_pending = 0;
 	CFS_INIT_LIST_HEAD(&ras->ras_read_beads);
 }
 
@@ -866,6 +1251,27 @@ void ras_update(struct ll_sb_info *sbi, struct inode *inode,
 	spin_lock(&ras->ras_lock);
 
         ll_ra_stats_inc_sbi(sbi, hit ? RA_STAT_HIT : RA_STAT_MISS);
+	if (hit) {
+		enum ra_stat which = RA_STAT_HIT_SEQUENTIAL;
+
+		if (ras->ras_pattern == RAS_PATTERN_REVERSE)
+			which = RA_STAT_HIT_REVERSE;
+		else if (ras->ras_pattern == RAS_PATTERN_NESTED)
+			which = RA_STAT_HIT_NESTED;
+		else if (stride_io_mode(ras))
+			which = RA_STAT_HIT_STRIDE;
+		ll_ra_stats_inc_sbi(sbi, which);
+	}
+
+	if (ras->ras_request_index == 0) {
+		struct ll_ra_read *bead = ll_ra_read_get_locked(ras);
+
+		if (bead != NULL)
+			ras_pattern_update(sbi, ras, bead->lrr_start,
+					   bead->lrr_count);
+		else
+			ras_pattern_update(sbi, ras, index, 1);
+	}
 
         /* reset the read-ahead window in two cases.  First when the app seeks
          * or reads to some other part of the file.  Secondly if we get a
@@ -186,21 +186,19 @@ static int mdt_coordinator_cb(const struct lu_env *env,
 			break;
 
 		/* first search if the request if known in the list we have
-		 * build and if there is room in the request vector */
+		 * build and if there is room in the request vector, slots
+		 * are filled in order so only the used ones are checked */
 		empty_slot = -1;
 		found = -1;
-		for (i = 0; i < hsd->max_requests &&
-			    (empty_slot == -1 || found == -1); i++) {
-			if (hsd->request[i].hal == NULL) {
-				empty_slot = i;
-				continue;
-			}
+		for (i = 0; i < hsd->request_cnt; i++) {
 			if (hsd->request[i].hal->hal_compound_id ==
-				larr->arr_compound_id) {
+			    larr->arr_compound_id) {
 				found = i;
-				continue;
+				break;
 			}
 		}
+		if (hsd->request_cnt < hsd->max_requests)
+			empty_slot = hsd->request_cnt;
 		if (found == -1 && empty_slot == -1)
 			/* unknown request and no more room for new request,
 			 * continue scan for to find other entries for
@@ -223,7 +221,7 @@ static int mdt_coordinator_cb(const struct lu_env *env,
 				CERROR("%s: Cannot allocate memory (%d o)"
 				       "for compound "LPX64"\n",
 				       mdt_obd_name(mdt),
-				       hsd->request[i].hal_sz,
+				       hsd->request[empty_slot].hal_sz,
 				       larr->arr_compound_id);
 				RETURN(-ENOMEM);
 			}
@@ -340,7 +338,7 @@ static int mdt_coordinator_cb(const struct lu_env *env,
 
 			/* add the cookie to the list of record to be
 			 * canceled by caller */
-			if (hsd->max_cookie == (hsd->cookie_cnt - 1)) {
+			if (hsd->max_cookie == hsd->cookie_cnt) {
 				__u64 *ptr, *old_ptr;
 				int old_sz, new_sz, new_cnt;
 
@@ -404,7 +402,24 @@ int hsm_cdt_procfs_init(struct mdt_device *mdt)
 		RETURN(rc);
 	}
 
-	RETURN(0);
+	cdt->cdt_stats = lprocfs_alloc_stats(CDT_STATS_LAST, 0);
+	if (cdt->cdt_stats == NULL)
+		RETURN(-ENOMEM);
+
+	lprocfs_counter_init(cdt->cdt_stats, CDT_STATS_SCAN_TIME,
+			     LPROCFS_CNTR_AVGMINMAX, "scan_time", "usec");
+	lprocfs_counter_init(cdt->cdt_stats, CDT_STATS_DISPATCHED,
+			     LPROCFS_CNTR_AVGMINMAX, "dispatched", "reqs");
+
+	rc = lprocfs_register_stats(cdt->cdt_proc_dir, "stats",
+				    cdt->cdt_stats);
+	if (rc) {
+		CERROR("%s: Cannot create 'hsm/stats' in mdt proc dir,"
+		       " rc=%d\n", mdt_obd_name(mdt), rc);
+		lprocfs_free_stats(&cdt->cdt_stats);
+	}
+
+	RETURN(rc);
 }
 
 /**
@@ -418,6 +433,8 @@ void  hsm_cdt_procfs_fini(struct mdt_device *mdt)
 	LASSERT(cdt->cdt_state == CDT_STOPPED);
 	if (cdt->cdt_proc_dir != NULL)
 		lprocfs_remove(&cdt->cdt_proc_dir);
+	if (cdt->cdt_stats != NULL)
+		lprocfs_free_stats(&cdt->cdt_stats);
 }
 
 /**
@@ -469,8 +486,15 @@ static int mdt_coordinator(void *data)
 	obd_uuid2fsname(hsd.fs_name, mdt_obd_name(mdt), MTI_NAME_MAXLEN);
 
 	while (1) {
-		struct l_wait_info lwi;
-		int i;
+		struct l_wait_info	 lwi;
+		struct timeval		 scan_start;
+		struct timeval		 scan_end;
+		__u64			*cookies;
+		int			 cookies_sz;
+		int			 cookie_cnt;
+		int			 started_cnt;
+		int			 waiting_cnt;
+		int			 i;
 
 		lwi = LWI_TIMEOUT(cfs_time_seconds(cdt->cdt_loop_period),
 				  NULL, NULL);
@@ -527,8 +551,13 @@ static int mdt_coordinator(void *data)
 		}
 		hsd.request_cnt = 0;
 
+		do_gettimeofday(&scan_start);
 		rc = cdt_llog_process(mti->mti_env, mdt,
 				      mdt_coordinator_cb, &hsd);
+		do_gettimeofday(&scan_end);
+		lprocfs_counter_add(cdt->cdt_stats, CDT_STATS_SCAN_TIME,
+				    cfs_timeval_sub(&scan_end, &scan_start,
+						    NULL));
 		if (rc < 0)
 			goto clean_cb_alloc;
 
@@ -556,22 +585,38 @@ static int mdt_coordinator(void *data)
 			goto clean_cb_alloc;
 		}
 
-		/* here hsd contains a list of requests to be started */
-		for (i = 0; i < hsd.max_requests; i++) {
+		/* here hsd contains a list of requests to be started, their
+		 * llog records are updated together after all are sent, so
+		 * that the llog is scanned once per status and not once per
+		 * request: cookies of started requests fill the vector from
+		 * its start, the ones of requests to retry from its end */
+		cookie_cnt = 0;
+		for (i = 0; i < hsd.request_cnt; i++)
+			cookie_cnt += hsd.request[i].hal->hal_count;
+		if (cookie_cnt == 0)
+			goto clean_cb_alloc;
+
+		cookies_sz = cookie_cnt * sizeof(__u64);
+		OBD_ALLOC(cookies, cookies_sz);
+		if (cookies == NULL) {
+			CERROR("%s: Cannot allocate memory (%d o) "
+			       "for cookies vector\n",
+			       mdt_obd_name(mdt), cookies_sz);
+			goto clean_cb_alloc;
+		}
+		started_cnt = 0;
+		waiting_cnt = 0;
+
+		for (i = 0; i < hsd.request_cnt; i++) {
 			struct hsm_action_list	*hal;
 			struct hsm_action_item	*hai;
-			__u64			*cookies;
-			int			 sz, j;
-			enum agent_req_status	 status;
+			int			 j;
 
 			/* still room for work ? */
 			if (atomic_read(&cdt->cdt_request_count) ==
 			    cdt->cdt_max_requests)
 				break;
 
-			if (hsd.request[i].hal == NULL)
-				continue;
-
 			/* found a request, we start it */
 			/* kuc payload allocation so we avoid an additionnal
 			 * allocation in mdt_hsm_agent_send()
@@ -594,41 +639,48 @@ static int mdt_coordinator(void *data)
 			 * if the copy tool failed to do the request
 			 * it has to use hsm_progress
 			 */
-			status = (rc ? ARS_WAITING : ARS_STARTED);
-
-			/* set up cookie vector to set records status
-			 * after copy tools start or failed
-			 */
-			sz = hsd.request[i].hal->hal_count * sizeof(__u64);
-			OBD_ALLOC(cookies, sz);
-			if (cookies == NULL) {
-				CERROR("%s: Cannot allocate memory (%d o) "
-				       "for cookies vector "LPX64"\n",
-				       mdt_obd_name(mdt), sz,
-				       hsd.request[i].hal->hal_compound_id);
-				kuc_free(hal, hsd.request[i].hal_used_sz);
-				continue;
-			}
 			hai = hai_first(hal);
-			for (j = 0; j < hsd.request[i].hal->hal_count; j++) {
-				cookies[j] = hai->hai_cookie;
+			for (j = 0; j < hal->hal_count; j++) {
+				if (rc == 0)
+					cookies[started_cnt++] =
+							hai->hai_cookie;
+				else
+					cookies[cookie_cnt - ++waiting_cnt] =
+							hai->hai_cookie;
 				hai = hai_next(hai);
 			}
 
+			kuc_free(hal, hsd.request[i].hal_used_sz);
+		}
+
+		/* set records status after copy tools start or failed */
+		if (started_cnt > 0) {
 			rc = mdt_agent_record_update(mti->mti_env, mdt, cookies,
-						hsd.request[i].hal->hal_count,
-						status);
+						     started_cnt, ARS_STARTED);
 			if (rc)
 				CERROR("%s: mdt_agent_record_update() failed, "
 				       "rc=%d, cannot update status to %s "
 				       "for %d cookies\n",
 				       mdt_obd_name(mdt), rc,
-				       agent_req_status2name(status),
-				       hsd.request[i].hal->hal_count);
-
-			OBD_FREE(cookies, sz);
-			kuc_free(hal, hsd.request[i].hal_used_sz);
+				       agent_req_status2name(ARS_STARTED),
+				       started_cnt);
 		}
+		if (waiting_cnt > 0) {
+			rc = mdt_agent_record_update(mti->mti_env, mdt,
+						cookies + cookie_cnt - waiting_cnt,
+						waiting_cnt, ARS_WAITING);
+			if (rc)
+				CERROR("%s: mdt_agent_record_update() failed, "
+				       "rc=%d, cannot update status to %s "
+				       "for %d cookies\n",
+				       mdt_obd_name(mdt), rc,
+				       agent_req_status2name(ARS_WAITING),
+				       waiting_cnt);
+		}
+		lprocfs_counter_add(cdt->cdt_stats, CDT_STATS_DISPATCHED,
+				    started_cnt);
+
+		OBD_FREE(cookies, cookies_sz);
 clean_cb_alloc:
 		/* free cookie vector allocated for/by callback */
 		if (hsd.cookies) {
@@ -874,10 +926,16 @@ int mdt_hsm_cdt_init(struct mdt_device *mdt)
 	CFS_INIT_LIST_HEAD(&cdt->cdt_agents);
 	CFS_INIT_LIST_HEAD(&cdt->cdt_restore_hdl);
 
-	rc = lu_env_init(&cdt->cdt_env, LCT_MD_THREAD);
+	rc = mdt_cdt_init_request_hash(cdt);
 	if (rc < 0)
 		RETURN(rc);
 
+	rc = lu_env_init(&cdt->cdt_env, LCT_MD_THREAD);
+	if (rc < 0) {
+		mdt_cdt_fini_request_hash(cdt);
+		RETURN(rc);
+	}
+
 	/* for mdt_ucred(), lu_ucred stored in lu_ucred_key */
 	rc = lu_context_init(&cdt->cdt_session, LCT_SERVER_SESSION);
 	if (rc == 0) {
@@ -885,6 +943,7 @@ int mdt_hsm_cdt_init(struct mdt_device *mdt)
 		cdt->cdt_env.le_ses = &cdt->cdt_session;
 	} else {
 		lu_env_fini(&cdt->cdt_env);
+		mdt_cdt_fini_request_hash(cdt);
 		RETURN(rc);
 	}
 
@@ -922,6 +981,8 @@ int  mdt_hsm_cdt_fini(struct mdt_device *mdt)
 
 	lu_env_fini(&cdt->cdt_env);
 
+	mdt_cdt_fini_request_hash(cdt);
+
 	RETURN(0);
 }
 
@@ -1029,7 +1090,7 @@ int mdt_hsm_cdt_stop(struct mdt_device *mdt)
 	down_write(&cdt->cdt_request_lock);
 	list_for_each_entry_safe(car, tmp1, &cdt->cdt_requests,
 				 car_request_list) {
-		list_del(&car->car_request_list);
+		mdt_cdt_unlink_request_nolock(cdt, car);
 		mdt_cdt_free_request(car);
 	}
 	up_write(&cdt->cdt_request_lock);
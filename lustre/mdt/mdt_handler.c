@@ -2074,6 +2074,26 @@ int mdt_quota_dqacq(struct tgt_session_info *tsi)
 	RETURN(rc);
 }
 
+/*
+ * Batched quota acquire/release request. The reply size depends on the
+ * number of requests in the batch, so the handler packs it itself.
+ */
+static int mdt_quota_dqacq_batch(struct tgt_session_info *tsi)
+{
+	struct mdt_device	*mdt = mdt_exp2dev(tsi->tsi_exp);
+	struct lu_device	*qmt = mdt->mdt_qmt_dev;
+	int			 rc;
+	ENTRY;
+
+	/* only sent by slaves which negotiated it at connect time */
+	if (qmt == NULL ||
+	    !(exp_connect_flags(tsi->tsi_exp) & OBD_CONNECT_QUOTA_BATCH))
+		RETURN(err_serious(-EOPNOTSUPP));
+
+	rc = qmt_hdls.qmth_dqacq_batch(tsi->tsi_env, qmt, tgt_ses_req(tsi));
+	RETURN(rc);
+}
+
 struct mdt_object *mdt_object_new(const struct lu_env *env,
 				  struct mdt_device *d,
 				  const struct lu_fid *f)
@@ -4109,6 +4129,7 @@ TGT_SEC_HDL_VAR(0,			SEC_CTX_FINI,	  mdt_sec_ctx_handle)
 
 static struct tgt_handler mdt_quota_ops[] = {
 TGT_QUOTA_HDL(HABEO_REFERO,		QUOTA_DQACQ,	  mdt_quota_dqacq),
+TGT_QUOTA_HDL(0,			QUOTA_DQACQ_BATCH, mdt_quota_dqacq_batch),
 };
 
 static struct tgt_opc_slice mdt_common_slice[] = {
@@ -4783,6 +4804,12 @@ static int mdt_connect_internal(struct obd_export *exp,
 	if (!mdt->mdt_som_conf)
 		data->ocd_connect_flags &= ~OBD_CONNECT_SOM;
 
+	/* batched quota requests are handled by the quota master only,
+	 * OBD_FAIL_QUOTA_NO_BATCH makes the MDT look like an older one */
+	if (mdt->mdt_qmt_dev == NULL ||
+	    OBD_FAIL_CHECK(OBD_FAIL_QUOTA_NO_BATCH))
+		data->ocd_connect_flags &= ~OBD_CONNECT_QUOTA_BATCH;
+
 	if (data->ocd_connect_flags & OBD_CONNECT_BRW_SIZE) {
 		data->ocd_brw_size = min(data->ocd_brw_size,
 					 (__u32)MD_MAX_BRW_SIZE);
@@ -4831,9 +4858,7 @@ static int mdt_connect_internal(struct obd_export *exp,
 
 	if (OCD_HAS_FLAG(data, PINGLESS)) {
 		if (ptlrpc_pinger_suppress_pings()) {
-			spin_lock(&exp->exp_obd->obd_dev_lock);
-			list_del_init(&exp->exp_obd_chain_timed);
-			spin_unlock(&exp->exp_obd->obd_dev_lock);
+			class_export_untime(exp);
 		} else {
 			data->ocd_connect_flags &= ~OBD_CONNECT_PINGLESS;
 		}
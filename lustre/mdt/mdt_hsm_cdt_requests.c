@@ -38,8 +38,156 @@
 #include <obd_support.h>
 #include <lustre/lustre_user.h>
 #include <lprocfs_status.h>
+#include <lustre_fid.h>
 #include "mdt_internal.h"
 
+/* started requests are indexed by cookie and by FID, the hashes grow with
+ * the number of requests in flight */
+#define CDT_REQ_HASH_CUR_BITS	10
+#define CDT_REQ_HASH_MAX_BITS	20
+#define CDT_REQ_HASH_BKT_BITS	6
+#define CDT_REQ_HASH_FLAGS	(CFS_HASH_DEFAULT | CFS_HASH_NO_ITEMREF)
+
+static unsigned cdt_req_cookie_hash(cfs_hash_t *hs, const void *key,
+				    unsigned mask)
+{
+	return cfs_hash_u64_hash(*(__u64 *)key, mask);
+}
+
+static void *cdt_req_cookie_key(cfs_hlist_node_t *hnode)
+{
+	struct cdt_agent_req *car;
+
+	car = cfs_hlist_entry(hnode, struct cdt_agent_req, car_cookie_hash);
+	return &car->car_hai->hai_cookie;
+}
+
+static int cdt_req_cookie_keycmp(const void *key, cfs_hlist_node_t *hnode)
+{
+	return *(__u64 *)key == *(__u64 *)cdt_req_cookie_key(hnode);
+}
+
+static void *cdt_req_cookie_object(cfs_hlist_node_t *hnode)
+{
+	return cfs_hlist_entry(hnode, struct cdt_agent_req, car_cookie_hash);
+}
+
+static void cdt_req_cookie_get(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
+{
+	mdt_cdt_get_request(cdt_req_cookie_object(hnode));
+}
+
+static void cdt_req_cookie_put_locked(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
+{
+	mdt_cdt_put_request(cdt_req_cookie_object(hnode));
+}
+
+static cfs_hash_ops_t cdt_req_cookie_hash_ops = {
+	.hs_hash	= cdt_req_cookie_hash,
+	.hs_key		= cdt_req_cookie_key,
+	.hs_keycmp	= cdt_req_cookie_keycmp,
+	.hs_object	= cdt_req_cookie_object,
+	.hs_get		= cdt_req_cookie_get,
+	.hs_put_locked	= cdt_req_cookie_put_locked,
+};
+
+static unsigned cdt_req_fid_hash(cfs_hash_t *hs, const void *key,
+				 unsigned mask)
+{
+	return cfs_hash_u64_hash(fid_flatten(key), mask);
+}
+
+static void *cdt_req_fid_key(cfs_hlist_node_t *hnode)
+{
+	struct cdt_agent_req *car;
+
+	car = cfs_hlist_entry(hnode, struct cdt_agent_req, car_fid_hash);
+	return &car->car_hai->hai_fid;
+}
+
+static int cdt_req_fid_keycmp(const void *key, cfs_hlist_node_t *hnode)
+{
+	return lu_fid_eq(key, cdt_req_fid_key(hnode));
+}
+
+static void *cdt_req_fid_object(cfs_hlist_node_t *hnode)
+{
+	return cfs_hlist_entry(hnode, struct cdt_agent_req, car_fid_hash);
+}
+
+static void cdt_req_fid_get(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
+{
+	mdt_cdt_get_request(cdt_req_fid_object(hnode));
+}
+
+static void cdt_req_fid_put_locked(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
+{
+	mdt_cdt_put_request(cdt_req_fid_object(hnode));
+}
+
+static cfs_hash_ops_t cdt_req_fid_hash_ops = {
+	.hs_hash	= cdt_req_fid_hash,
+	.hs_key		= cdt_req_fid_key,
+	.hs_keycmp	= cdt_req_fid_keycmp,
+	.hs_object	= cdt_req_fid_object,
+	.hs_get		= cdt_req_fid_get,
+	.hs_put_locked	= cdt_req_fid_put_locked,
+};
+
+/**
+ * create the hashes indexing the started requests
+ * \param cdt [IN] coordinator
+ * \retval 0 success
+ * \retval -ve failure
+ */
+int mdt_cdt_init_request_hash(struct coordinator *cdt)
+{
+	ENTRY;
+
+	cdt->cdt_request_cookie_hash = cfs_hash_create("CDT_REQ_COOKIE",
+						       CDT_REQ_HASH_CUR_BITS,
+						       CDT_REQ_HASH_MAX_BITS,
+						       CDT_REQ_HASH_BKT_BITS, 0,
+						       CFS_HASH_MIN_THETA,
+						       CFS_HASH_MAX_THETA,
+						       &cdt_req_cookie_hash_ops,
+						       CDT_REQ_HASH_FLAGS);
+	if (cdt->cdt_request_cookie_hash == NULL)
+		RETURN(-ENOMEM);
+
+	cdt->cdt_request_fid_hash = cfs_hash_create("CDT_REQ_FID",
+						    CDT_REQ_HASH_CUR_BITS,
+						    CDT_REQ_HASH_MAX_BITS,
+						    CDT_REQ_HASH_BKT_BITS, 0,
+						    CFS_HASH_MIN_THETA,
+						    CFS_HASH_MAX_THETA,
+						    &cdt_req_fid_hash_ops,
+						    CDT_REQ_HASH_FLAGS);
+	if (cdt->cdt_request_fid_hash == NULL) {
+		cfs_hash_putref(cdt->cdt_request_cookie_hash);
+		cdt->cdt_request_cookie_hash = NULL;
+		RETURN(-ENOMEM);
+	}
+
+	RETURN(0);
+}
+
+/**
+ * destroy the hashes indexing the started requests, which must be empty
+ * \param cdt [IN] coordinator
+ */
+void mdt_cdt_fini_request_hash(struct coordinator *cdt)
+{
+	if (cdt->cdt_request_fid_hash != NULL) {
+		cfs_hash_putref(cdt->cdt_request_fid_hash);
+		cdt->cdt_request_fid_hash = NULL;
+	}
+	if (cdt->cdt_request_cookie_hash != NULL) {
+		cfs_hash_putref(cdt->cdt_request_cookie_hash);
+		cdt->cdt_request_cookie_hash = NULL;
+	}
+}
+
 /**
  * dump requests list
  * \param cdt [IN] coordinator
@@ -69,143 +217,111 @@ void dump_requests(char *prefix, struct coordinator *cdt)
 	up_read(&cdt->cdt_request_lock);
 }
 
-struct req_interval_data {
-	struct cdt_req_progress	*crp;
-	__u64			 done_sz;
-};
-
 /**
- * interval tree cb, used to go through all the tree of extent done
- */
-static enum interval_iter req_interval_cb(struct interval_node *node,
-					  void *args)
-{
-	struct req_interval_data	*data;
-	ENTRY;
-
-	data = args;
-	data->done_sz += node->in_extent.end - node->in_extent.start;
-	RETURN(INTERVAL_ITER_CONT);
-}
-
-/**
- * scan the interval tree associated to a request
- * to compute the amount of work done
+ * get the amount of work done for a request
  * \param car [IN] request
  * \param done_sz [OUT] will be set to the size of work done
  */
 void mdt_cdt_get_work_done(struct cdt_agent_req *car, __u64 *done_sz)
 {
-	struct req_interval_data	 rid;
-	struct cdt_req_progress		*crp = &car->car_progress;
+	struct cdt_req_progress	*crp = &car->car_progress;
 
 	mutex_lock(&crp->crp_lock);
-
-	rid.crp = crp;
-	rid.done_sz = 0;
-	interval_iterate(crp->crp_root, req_interval_cb, &rid);
-	*done_sz = rid.done_sz;
-
+	*done_sz = crp->crp_done;
 	mutex_unlock(&crp->crp_lock);
 }
 
-#define NODE_VECTOR_SZ 256
 /**
  * free the interval tree associated to a request
  */
 static void mdt_cdt_free_request_tree(struct cdt_req_progress *crp)
 {
-	struct interval_node	*node, *vn;
-	int			 i;
+	struct interval_node	*node;
 	ENTRY;
 
 	mutex_lock(&crp->crp_lock);
-
-	if (crp->crp_max == 0)
-		goto out;
-
-	/* remove all nodes from tree */
-	for (i = 0 ; i < crp->crp_cnt ; i++) {
-		vn = crp->crp_node[i / NODE_VECTOR_SZ];
-		node = &vn[i % NODE_VECTOR_SZ];
+	while (crp->crp_root != NULL) {
+		node = crp->crp_root;
 		interval_erase(node, &crp->crp_root);
+		OBD_FREE_PTR(node);
 	}
-	/* free all sub vectors */
-	for (i = 0 ; i <= crp->crp_max / NODE_VECTOR_SZ ; i++)
-		OBD_FREE(crp->crp_node[i],
-			 NODE_VECTOR_SZ * sizeof(crp->crp_node[i][0]));
-
-	/* free main vector */
-	OBD_FREE(crp->crp_node,
-		 sizeof(crp->crp_node[0]) *
-		  (crp->crp_max / NODE_VECTOR_SZ + 1));
-
 	crp->crp_cnt = 0;
-	crp->crp_max = 0;
-out:
+	crp->crp_done = 0;
 	mutex_unlock(&crp->crp_lock);
 	EXIT;
 }
 
+/**
+ * interval tree cb, returns the first extent found
+ */
+static enum interval_iter req_interval_cb(struct interval_node *node,
+					  void *args)
+{
+	*(struct interval_node **)args = node;
+	return INTERVAL_ITER_STOP;
+}
+
 /**
  * update data moved information during a request
+ *
+ * The tree only holds disjoint extents: the new extent is merged with
+ * the extents it overlaps or touches, and the amount of work done is
+ * updated with what it adds, so that it never needs to be recomputed.
  */
 static int hsm_update_work(struct cdt_req_progress *crp,
 			   const struct hsm_extent *extent)
 {
-	int			  rc, osz, nsz;
-	struct interval_node	**new_vv;
-	struct interval_node	 *v, *node;
+	struct interval_node_extent	 ext;
+	struct interval_node		*node = NULL;
+	struct interval_node		*found;
+	__u64				 start, end;
 	ENTRY;
 
+	start = extent->offset;
+	end = extent->offset + extent->length;
+	if (end < start)
+		end = OBD_OBJECT_EOF;
+
 	mutex_lock(&crp->crp_lock);
-	/* new node index */
+	while (1) {
+		/* extents are stored as [start, end), so searching for
+		 * [start, end] also finds the ones just touching */
+		ext.start = start;
+		ext.end = end;
+		found = NULL;
+		interval_search(crp->crp_root, &ext, req_interval_cb, &found);
+		if (found == NULL)
+			break;
 
-	if (crp->crp_cnt >= crp->crp_max) {
-		/* no more room */
-		/* allocate a new vector */
-		OBD_ALLOC(v, NODE_VECTOR_SZ * sizeof(v[0]));
-		if (v == NULL)
-			GOTO(out, rc = -ENOMEM);
+		interval_erase(found, &crp->crp_root);
+		crp->crp_cnt--;
+		crp->crp_done -= interval_high(found) - interval_low(found);
+		start = min(start, interval_low(found));
+		end = max(end, interval_high(found));
 
-		if (crp->crp_max == 0)
-			osz = 0;
+		/* reuse the first extent merged for the result */
+		if (node == NULL)
+			node = found;
 		else
-			osz = sizeof(new_vv[0]) *
-			      (crp->crp_max / NODE_VECTOR_SZ + 1);
-
-		nsz = osz + sizeof(new_vv[0]);
-		/* increase main vector size */
-		OBD_ALLOC(new_vv, nsz);
-		if (new_vv == NULL) {
-			OBD_FREE(v, NODE_VECTOR_SZ * sizeof(v[0]));
-			GOTO(out, rc = -ENOMEM);
-		}
+			OBD_FREE_PTR(found);
+	}
 
-		if (osz == 0) {
-			crp->crp_max = NODE_VECTOR_SZ - 1;
-		} else {
-			memcpy(new_vv, crp->crp_node, osz);
-			OBD_FREE(crp->crp_node, osz);
-			crp->crp_max += NODE_VECTOR_SZ;
+	if (node == NULL) {
+		OBD_ALLOC_PTR(node);
+		if (node == NULL) {
+			mutex_unlock(&crp->crp_lock);
+			RETURN(-ENOMEM);
 		}
-
-		crp->crp_node = new_vv;
-		crp->crp_node[crp->crp_max / NODE_VECTOR_SZ] = v;
 	}
 
-	v = crp->crp_node[crp->crp_cnt / NODE_VECTOR_SZ];
-	node = &v[crp->crp_cnt % NODE_VECTOR_SZ];
-	interval_set(node, extent->offset, extent->offset + extent->length);
-	/* try to insert, if entry already exist ignore the new one
-	 * it can happen if ct sends 2 times the same progress */
-	if (interval_insert(node, &crp->crp_root) == NULL)
-		crp->crp_cnt++;
-
-	rc = 0;
-out:
+	interval_set(node, start, end);
+	found = interval_insert(node, &crp->crp_root);
+	LASSERT(found == NULL);
+	crp->crp_cnt++;
+	crp->crp_done += end - start;
 	mutex_unlock(&crp->crp_lock);
-	return rc;
+
+	RETURN(0);
 }
 
 /**
@@ -216,7 +332,7 @@ static void mdt_cdt_init_request_tree(struct cdt_req_progress *crp)
 	mutex_init(&crp->crp_lock);
 	crp->crp_root = NULL;
 	crp->crp_cnt = 0;
-	crp->crp_max = 0;
+	crp->crp_done = 0;
 }
 
 /** Allocate/init a agent request and its sub-structures.
@@ -245,6 +361,8 @@ struct cdt_agent_req *mdt_cdt_alloc_request(__u64 compound_id, __u32 archive_id,
 	car->car_archive_id = archive_id;
 	car->car_flags = flags;
 	car->car_canceled = 0;
+	CFS_INIT_HLIST_NODE(&car->car_cookie_hash);
+	CFS_INIT_HLIST_NODE(&car->car_fid_hash);
 	car->car_req_start = cfs_time_current_sec();
 	car->car_req_update = car->car_req_start;
 	car->car_uuid = *uuid;
@@ -293,7 +411,7 @@ void mdt_cdt_put_request(struct cdt_agent_req *car)
 }
 
 /**
- * find request in the list by cookie or by fid
+ * find request by cookie or by fid
  * lock cdt_request_lock needs to be hold by caller
  * \param cdt [IN] coordinator
  * \param cookie [IN] request cookie
@@ -305,19 +423,14 @@ static struct cdt_agent_req *cdt_find_request_nolock(struct coordinator *cdt,
 						     const struct lu_fid *fid)
 {
 	struct cdt_agent_req *car;
-	struct cdt_agent_req *found = NULL;
 	ENTRY;
 
-	list_for_each_entry(car, &cdt->cdt_requests, car_request_list) {
-		if (car->car_hai->hai_cookie == cookie ||
-		    (fid != NULL && lu_fid_eq(fid, &car->car_hai->hai_fid))) {
-			mdt_cdt_get_request(car);
-			found = car;
-			break;
-		}
-	}
+	/* cfs_hash_lookup() takes a reference on the request */
+	car = cfs_hash_lookup(cdt->cdt_request_cookie_hash, &cookie);
+	if (car == NULL && fid != NULL)
+		car = cfs_hash_lookup(cdt->cdt_request_fid_hash, fid);
 
-	RETURN(found);
+	RETURN(car);
 }
 
 /**
@@ -344,6 +457,10 @@ int mdt_cdt_add_request(struct coordinator *cdt, struct cdt_agent_req *new_car)
 	}
 
 	list_add_tail(&new_car->car_request_list, &cdt->cdt_requests);
+	cfs_hash_add(cdt->cdt_request_cookie_hash,
+		     &new_car->car_hai->hai_cookie, &new_car->car_cookie_hash);
+	cfs_hash_add(cdt->cdt_request_fid_hash,
+		     &new_car->car_hai->hai_fid, &new_car->car_fid_hash);
 	up_write(&cdt->cdt_request_lock);
 
 	mdt_hsm_agent_update_statistics(cdt, 0, 0, 1, &new_car->car_uuid);
@@ -374,6 +491,22 @@ struct cdt_agent_req *mdt_cdt_find_request(struct coordinator *cdt,
 	RETURN(car);
 }
 
+/**
+ * remove request from the list and the hashes
+ * lock cdt_request_lock needs to be hold for write by caller
+ * \param cdt [IN] coordinator
+ * \param car [IN] request
+ */
+void mdt_cdt_unlink_request_nolock(struct coordinator *cdt,
+				   struct cdt_agent_req *car)
+{
+	list_del(&car->car_request_list);
+	cfs_hash_del(cdt->cdt_request_cookie_hash, &car->car_hai->hai_cookie,
+		     &car->car_cookie_hash);
+	cfs_hash_del(cdt->cdt_request_fid_hash, &car->car_hai->hai_fid,
+		     &car->car_fid_hash);
+}
+
 /**
  * remove request from the list
  * \param cdt [IN] coordinator
@@ -388,7 +521,7 @@ int mdt_cdt_remove_request(struct coordinator *cdt, __u64 cookie)
 	down_write(&cdt->cdt_request_lock);
 	car = cdt_find_request_nolock(cdt, cookie, NULL);
 	if (car != NULL) {
-		list_del(&car->car_request_list);
+		mdt_cdt_unlink_request_nolock(cdt, car);
 		up_write(&cdt->cdt_request_lock);
 
 		/* reference from cdt_requests list */
@@ -448,32 +581,29 @@ struct cdt_agent_req *mdt_cdt_update_request(struct coordinator *cdt,
 	RETURN(car);
 }
 
+/**
+ * the requests shown by an open active_requests file; they are all
+ * referenced at open so that cdt_request_lock is not held while the
+ * seq_file is filled
+ */
+struct cdt_requests_dump {
+	struct cdt_agent_req	**crd_cars;
+	int			  crd_count;
+	int			  crd_max;
+};
+
 /**
  * seq_file method called to start access to /proc file
  */
 static void *mdt_hsm_active_requests_proc_start(struct seq_file *s, loff_t *p)
 {
-	struct mdt_device	*mdt = s->private;
-	struct coordinator	*cdt = &mdt->mdt_coordinator;
-	struct list_head	*pos;
-	loff_t			 i;
+	struct cdt_requests_dump	*crd = s->private;
 	ENTRY;
 
-	down_read(&cdt->cdt_request_lock);
-
-	if (list_empty(&cdt->cdt_requests))
+	if (*p >= crd->crd_count)
 		RETURN(NULL);
 
-	if (*p == 0)
-		RETURN(SEQ_START_TOKEN);
-
-	i = 0;
-	list_for_each(pos, &cdt->cdt_requests) {
-		i++;
-		if (i >= *p)
-			RETURN(pos);
-	}
-	RETURN(NULL);
+	RETURN(&crd->crd_cars[*p]);
 }
 
 /**
@@ -483,21 +613,10 @@ static void *mdt_hsm_active_requests_proc_start(struct seq_file *s, loff_t *p)
 static void *mdt_hsm_active_requests_proc_next(struct seq_file *s, void *v,
 					       loff_t *p)
 {
-	struct mdt_device	*mdt = s->private;
-	struct coordinator	*cdt = &mdt->mdt_coordinator;
-	struct list_head	*pos = v;
 	ENTRY;
 
-	if (pos == SEQ_START_TOKEN)
-		pos = cdt->cdt_requests.next;
-	else
-		pos = pos->next;
-
 	(*p)++;
-	if (pos != &cdt->cdt_requests)
-		RETURN(pos);
-	else
-		RETURN(NULL);
+	RETURN(mdt_hsm_active_requests_proc_start(s, p));
 }
 
 /**
@@ -505,16 +624,11 @@ static void *mdt_hsm_active_requests_proc_next(struct seq_file *s, void *v,
  */
 static int mdt_hsm_active_requests_proc_show(struct seq_file *s, void *v)
 {
-	struct list_head	*pos = v;
-	struct cdt_agent_req	*car;
+	struct cdt_agent_req	*car = *(struct cdt_agent_req **)v;
 	char			 buf[12];
 	__u64			 data_moved;
 	ENTRY;
 
-	if (pos == SEQ_START_TOKEN)
-		RETURN(0);
-
-	car = list_entry(pos, struct cdt_agent_req, car_request_list);
 	mdt_cdt_get_work_done(car, &data_moved);
 
 	seq_printf(s, "fid="DFID" dfid="DFID
@@ -541,13 +655,6 @@ static int mdt_hsm_active_requests_proc_show(struct seq_file *s, void *v)
  */
 static void mdt_hsm_active_requests_proc_stop(struct seq_file *s, void *v)
 {
-	struct mdt_device	*mdt = s->private;
-	struct coordinator	*cdt = &mdt->mdt_coordinator;
-	ENTRY;
-
-	up_read(&cdt->cdt_request_lock);
-
-	EXIT;
 }
 
 /* hsm agent list proc functions */
@@ -558,6 +665,63 @@ static const struct seq_operations mdt_hsm_active_requests_proc_ops = {
 	.stop		= mdt_hsm_active_requests_proc_stop,
 };
 
+static void cdt_requests_dump_free(struct cdt_requests_dump *crd)
+{
+	int	i;
+
+	for (i = 0; i < crd->crd_count; i++)
+		mdt_cdt_put_request(crd->crd_cars[i]);
+	if (crd->crd_cars != NULL)
+		OBD_FREE_LARGE(crd->crd_cars,
+			       crd->crd_max * sizeof(crd->crd_cars[0]));
+	OBD_FREE_PTR(crd);
+}
+
+/**
+ * take a reference on every request in the list
+ * \param cdt [IN] coordinator
+ * \retval the list of requests, or an ERR_PTR()
+ */
+static struct cdt_requests_dump *
+cdt_requests_dump_alloc(struct coordinator *cdt)
+{
+	struct cdt_requests_dump	*crd;
+	struct cdt_agent_req		*car;
+	ENTRY;
+
+	OBD_ALLOC_PTR(crd);
+	if (crd == NULL)
+		RETURN(ERR_PTR(-ENOMEM));
+
+	/* leave room for the requests added before the list is locked */
+	crd->crd_max = atomic_read(&cdt->cdt_request_count) + 64;
+again:
+	OBD_ALLOC_LARGE(crd->crd_cars, crd->crd_max * sizeof(crd->crd_cars[0]));
+	if (crd->crd_cars == NULL) {
+		OBD_FREE_PTR(crd);
+		RETURN(ERR_PTR(-ENOMEM));
+	}
+
+	down_read(&cdt->cdt_request_lock);
+	list_for_each_entry(car, &cdt->cdt_requests, car_request_list) {
+		if (crd->crd_count == crd->crd_max) {
+			up_read(&cdt->cdt_request_lock);
+			while (crd->crd_count > 0)
+				mdt_cdt_put_request(
+					crd->crd_cars[--crd->crd_count]);
+			OBD_FREE_LARGE(crd->crd_cars, crd->crd_max *
+						      sizeof(crd->crd_cars[0]));
+			crd->crd_max *= 2;
+			goto again;
+		}
+		mdt_cdt_get_request(car);
+		crd->crd_cars[crd->crd_count++] = car;
+	}
+	up_read(&cdt->cdt_request_lock);
+
+	RETURN(crd);
+}
+
 /**
  * public function called at open of /proc file to get
  * list of agents
@@ -565,29 +729,46 @@ static const struct seq_operations mdt_hsm_active_requests_proc_ops = {
 static int lprocfs_open_hsm_active_requests(struct inode *inode,
 					    struct file *file)
 {
-	struct seq_file	*s;
-	int		 rc;
+	struct mdt_device		*mdt;
+	struct cdt_requests_dump	*crd;
+	struct seq_file			*s;
+	int				 rc;
 	ENTRY;
 
 	if (LPROCFS_ENTRY_CHECK(PDE(inode)))
 		RETURN(-ENOENT);
 
+	mdt = PDE(inode)->data;
+	crd = cdt_requests_dump_alloc(&mdt->mdt_coordinator);
+	if (IS_ERR(crd))
+		RETURN(PTR_ERR(crd));
+
 	rc = seq_open(file, &mdt_hsm_active_requests_proc_ops);
 	if (rc) {
+		cdt_requests_dump_free(crd);
 		RETURN(rc);
 	}
 	s = file->private_data;
-	s->private = PDE(inode)->data;
+	s->private = crd;
 
 	RETURN(rc);
 }
 
+static int lprocfs_release_hsm_active_requests(struct inode *inode,
+					       struct file *file)
+{
+	struct seq_file	*s = file->private_data;
+
+	cdt_requests_dump_free(s->private);
+	return lprocfs_seq_release(inode, file);
+}
+
 /* methods to access hsm request list */
 const struct file_operations mdt_hsm_active_requests_fops = {
 	.owner		= THIS_MODULE,
 	.open		= lprocfs_open_hsm_active_requests,
 	.read		= seq_read,
 	.llseek		= seq_lseek,
-	.release	= lprocfs_seq_release,
+	.release	= lprocfs_release_hsm_active_requests,
 };
 
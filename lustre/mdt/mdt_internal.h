@@ -96,6 +96,14 @@ struct mdt_file_data {
  */
 #define CDT_DEFAULT_POLICY		CDT_NORETRY_ACTION
 
+/* counters of lustre/mdt/mdt_coordinator.c::cdt_stats, one sample per
+ * coordinator pass */
+enum cdt_stats_idx {
+	CDT_STATS_SCAN_TIME = 0,	/* llog scan duration, usec */
+	CDT_STATS_DISPATCHED,		/* requests sent to agents */
+	CDT_STATS_LAST
+};
+
 enum cdt_states { CDT_STOPPED = 0,
 		  CDT_INIT,
 		  CDT_RUNNING,
@@ -141,6 +149,12 @@ struct coordinator {
 						       * started requests */
 	struct list_head	 cdt_requests;	      /**< list of started
 						       * requests */
+	cfs_hash_t		*cdt_request_cookie_hash; /**< started
+						       * requests by cookie */
+	cfs_hash_t		*cdt_request_fid_hash; /**< started requests
+						       * by FID */
+	struct lprocfs_stats	*cdt_stats;	      /**< coordinator pass
+						       * stats */
 	struct list_head	 cdt_agents;	      /**< list of register
 						       * agents */
 	struct list_head	 cdt_restore_hdl;     /**< list of restore lock
@@ -508,17 +522,18 @@ struct mdt_opc_slice {
 
 struct cdt_req_progress {
 	struct mutex		 crp_lock;	/**< protect tree */
-	struct interval_node	*crp_root;	/**< tree to track extent
-						 *   moved */
-	struct interval_node	**crp_node;	/**< buffer for tree nodes
-						 *   vector of fixed size
-						 *   vectors */
-	int			 crp_cnt;	/**< # of used nodes */
-	int			 crp_max;	/**< # of allocated nodes */
+	struct interval_node	*crp_root;	/**< tree of the disjoint
+						 *   extents moved */
+	int			 crp_cnt;	/**< # of extents in tree */
+	__u64			 crp_done;	/**< bytes in the tree */
 };
 
 struct cdt_agent_req {
 	cfs_list_t		 car_request_list; /**< to chain all the req. */
+	cfs_hlist_node_t	 car_cookie_hash;  /**< cdt_request_cookie_hash
+						    *   linkage */
+	cfs_hlist_node_t	 car_fid_hash;     /**< cdt_request_fid_hash
+						    *   linkage */
 	atomic_t		 car_refcount;     /**< reference counter */
 	__u64			 car_compound_id;  /**< compound id */
 	__u64			 car_flags;        /**< request original flags */
@@ -888,11 +903,15 @@ bool mdt_hsm_restore_is_running(struct mdt_thread_info *mti,
 /* mdt/mdt_hsm_cdt_requests.c */
 extern const struct file_operations mdt_hsm_active_requests_fops;
 void dump_requests(char *prefix, struct coordinator *cdt);
+int mdt_cdt_init_request_hash(struct coordinator *cdt);
+void mdt_cdt_fini_request_hash(struct coordinator *cdt);
 struct cdt_agent_req *mdt_cdt_alloc_request(__u64 compound_id, __u32 archive_id,
 					    __u64 flags, struct obd_uuid *uuid,
 					    struct hsm_action_item *hai);
 void mdt_cdt_free_request(struct cdt_agent_req *car);
 int mdt_cdt_add_request(struct coordinator *cdt, struct cdt_agent_req *new_car);
+void mdt_cdt_unlink_request_nolock(struct coordinator *cdt,
+				   struct cdt_agent_req *car);
 struct cdt_agent_req *mdt_cdt_find_request(struct coordinator *cdt,
 					   const __u64 cookie,
 					   const struct lu_fid *fid);
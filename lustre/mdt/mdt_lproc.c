@@ -1017,6 +1017,9 @@ static struct lprocfs_vars lprocfs_mdt_obd_vars[] = {
 	{ "job_cleanup_interval",       lprocfs_rd_job_interval,
 					lprocfs_wr_job_interval,
 					NULL, NULL, 0 },
+	{ "job_max_entries",		lprocfs_rd_job_max_entries,
+					lprocfs_wr_job_max_entries,
+					NULL, NULL, 0 },
 	{ "enable_remote_dir",		lprocfs_rd_enable_remote_dir,
 					lprocfs_wr_enable_remote_dir,
 					NULL, NULL, 0},
@@ -93,6 +93,8 @@ static void obd_device_free(struct obd_device *obd)
                 LBUG();
         }
         lu_ref_fini(&obd->obd_reference);
+	if (obd->obd_exports_timed != NULL)
+		cfs_percpt_free(obd->obd_exports_timed);
         OBD_SLAB_FREE_PTR(obd, obd_device_cachep);
 }
 
@@ -858,6 +860,7 @@ struct obd_export *class_new_export(struct obd_device *obd,
                                     struct obd_uuid *cluuid)
 {
         struct obd_export *export;
+	struct obd_timed_exports *ote;
         cfs_hash_t *hash = NULL;
         int rc = 0;
         ENTRY;
@@ -927,8 +930,15 @@ struct obd_export *class_new_export(struct obd_device *obd,
 
         class_incref(obd, "export", export);
         cfs_list_add(&export->exp_obd_chain, &export->exp_obd->obd_exports);
-        cfs_list_add_tail(&export->exp_obd_chain_timed,
-                          &export->exp_obd->obd_exports_timed);
+	/* requests from a client are mostly handled on the CPT which handled
+	 * its connect request, so time the export on that partition */
+	export->exp_timed_cpt = cfs_cpt_current(cfs_cpt_table, 1);
+	ote = class_export_timed(export);
+	spin_lock(&ote->ote_lock);
+	if (cfs_list_empty(&ote->ote_list))
+		ote->ote_oldest = export->exp_last_request_time;
+	cfs_list_add_tail(&export->exp_obd_chain_timed, &ote->ote_list);
+	spin_unlock(&ote->ote_lock);
         export->exp_obd->obd_num_exports++;
 	spin_unlock(&obd->obd_dev_lock);
 	cfs_hash_putref(hash);
@@ -959,13 +969,26 @@ void class_unlink_export(struct obd_export *exp)
 			     &exp->exp_uuid_hash);
 
 	cfs_list_move(&exp->exp_obd_chain, &exp->exp_obd->obd_unlinked_exports);
-	cfs_list_del_init(&exp->exp_obd_chain_timed);
+	class_export_untime(exp);
 	exp->exp_obd->obd_num_exports--;
 	spin_unlock(&exp->exp_obd->obd_dev_lock);
 	class_export_put(exp);
 }
 EXPORT_SYMBOL(class_unlink_export);
 
+/**
+ * Stop timing export \a exp, so that the ping evictor never evicts it.
+ */
+void class_export_untime(struct obd_export *exp)
+{
+	struct obd_timed_exports *ote = class_export_timed(exp);
+
+	spin_lock(&ote->ote_lock);
+	cfs_list_del_init(&exp->exp_obd_chain_timed);
+	spin_unlock(&ote->ote_lock);
+}
+EXPORT_SYMBOL(class_export_untime);
+
 /* Import management functions */
 void class_import_destroy(struct obd_import *imp)
 {
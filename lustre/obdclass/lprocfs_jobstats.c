@@ -66,6 +66,11 @@
  *   JobID env var: Same as PBS.
  */
 
+/* number of recently used jobs cached on each CPU partition */
+#define JOB_STAT_CACHE_SIZE	8
+/* default limit on the number of jobs tracked by a target */
+#define JOB_STATS_MAX_DEFAULT	8192
+
 struct job_stat {
 	cfs_hlist_node_t      js_hash;
 	cfs_list_t            js_list;
@@ -74,6 +79,18 @@ struct job_stat {
 	time_t                js_timestamp; /* seconds */
 	struct lprocfs_stats *js_stats;
 	struct obd_job_stats *js_jobstats;
+	/* off ojs_list and being removed from the hash, under ojs_lock */
+	unsigned int	      js_unlinked:1;
+};
+
+/*
+ * The jobs most recently logged on a CPU partition, most recent first.
+ * Each entry holds a reference on its job, so that a hit takes neither
+ * a hash bucket lock nor ojs_lock.
+ */
+struct job_stat_cache {
+	spinlock_t	      jsc_lock;
+	struct job_stat	     *jsc_jobs[JOB_STAT_CACHE_SIZE];
 };
 
 static unsigned job_stat_hash(cfs_hash_t *hs, const void *key, unsigned mask)
@@ -112,10 +129,7 @@ static void job_free(struct job_stat *job)
 {
 	LASSERT(atomic_read(&job->js_refcount) == 0);
 	LASSERT(job->js_jobstats);
-
-	write_lock(&job->js_jobstats->ojs_lock);
-	cfs_list_del_init(&job->js_list);
-	write_unlock(&job->js_jobstats->ojs_lock);
+	LASSERT(cfs_list_empty(&job->js_list));
 
 	lprocfs_free_stats(&job->js_stats);
 	OBD_FREE_PTR(job);
@@ -150,35 +164,158 @@ static cfs_hash_ops_t job_stats_hash_ops = {
 	.hs_exit       = job_stat_exit,
 };
 
+/*
+ * Take @job off the LRU list before it is removed from the hash.  The
+ * lookups that still find it in a cache or in the hash meanwhile just
+ * account to a job which is going away.
+ */
+static void job_unlink_locked(struct obd_job_stats *stats,
+			      struct job_stat *job)
+{
+	if (job->js_unlinked)
+		return;
+
+	job->js_unlinked = 1;
+	if (!cfs_list_empty(&job->js_list)) {
+		cfs_list_del_init(&job->js_list);
+		stats->ojs_count--;
+	}
+}
+
 static int job_iter_callback(cfs_hash_t *hs, cfs_hash_bd_t *bd,
 			     cfs_hlist_node_t *hnode, void *data)
 {
-	time_t oldest = *((time_t *)data);
 	struct job_stat *job;
+	struct obd_job_stats *stats;
 
 	job = cfs_hlist_entry(hnode, struct job_stat, js_hash);
-	if (!oldest || job->js_timestamp < oldest)
-		cfs_hash_bd_del_locked(hs, bd, hnode);
+	stats = job->js_jobstats;
+
+	write_lock(&stats->ojs_lock);
+	job_unlink_locked(stats, job);
+	write_unlock(&stats->ojs_lock);
+	cfs_hash_bd_del_locked(hs, bd, hnode);
 
 	return 0;
 }
 
-static void lprocfs_job_cleanup(struct obd_job_stats *stats, bool force)
+static struct job_stat *job_cache_lookup(struct job_stat_cache *jsc,
+					 const char *jobid)
 {
-	time_t oldest, now;
+	struct job_stat *job = NULL;
+	struct job_stat *stale = NULL;
+	int i;
+
+	spin_lock(&jsc->jsc_lock);
+	for (i = 0; i < JOB_STAT_CACHE_SIZE; i++) {
+		if (jsc->jsc_jobs[i] == NULL ||
+		    strcmp(jsc->jsc_jobs[i]->js_jobid, jobid) != 0)
+			continue;
+
+		if (jsc->jsc_jobs[i]->js_unlinked) {
+			/* dropped since it was cached */
+			stale = jsc->jsc_jobs[i];
+			jsc->jsc_jobs[i] = NULL;
+			break;
+		}
 
-	if (stats->ojs_cleanup_interval == 0)
-		return;
+		job = jsc->jsc_jobs[i];
+		memmove(&jsc->jsc_jobs[1], &jsc->jsc_jobs[0],
+			i * sizeof(jsc->jsc_jobs[0]));
+		jsc->jsc_jobs[0] = job;
+		cfs_atomic_inc(&job->js_refcount);
+		break;
+	}
+	spin_unlock(&jsc->jsc_lock);
+
+	if (stale != NULL)
+		job_putref(stale);
+	return job;
+}
+
+static void job_cache_insert(struct job_stat_cache *jsc, struct job_stat *job)
+{
+	struct job_stat *old;
+
+	cfs_atomic_inc(&job->js_refcount);
+
+	spin_lock(&jsc->jsc_lock);
+	old = jsc->jsc_jobs[JOB_STAT_CACHE_SIZE - 1];
+	memmove(&jsc->jsc_jobs[1], &jsc->jsc_jobs[0],
+		(JOB_STAT_CACHE_SIZE - 1) * sizeof(jsc->jsc_jobs[0]));
+	jsc->jsc_jobs[0] = job;
+	spin_unlock(&jsc->jsc_lock);
+
+	if (old != NULL)
+		job_putref(old);
+}
+
+static void job_cache_flush(struct obd_job_stats *stats)
+{
+	struct job_stat_cache *jsc;
+	struct job_stat *job;
+	int i;
+	int j;
+
+	cfs_percpt_for_each(jsc, i, stats->ojs_cache) {
+		for (j = 0; j < JOB_STAT_CACHE_SIZE; j++) {
+			spin_lock(&jsc->jsc_lock);
+			job = jsc->jsc_jobs[j];
+			jsc->jsc_jobs[j] = NULL;
+			spin_unlock(&jsc->jsc_lock);
+
+			if (job != NULL)
+				job_putref(job);
+		}
+	}
+}
+
+static inline bool job_stats_over_limit(struct obd_job_stats *stats)
+{
+	return stats->ojs_max_jobs != 0 &&
+	       stats->ojs_count > stats->ojs_max_jobs;
+}
+
+/*
+ * Drop the jobs idle for longer than ojs_cleanup_interval, and the least
+ * recently used ones beyond ojs_max_jobs.  ojs_list is kept in LRU order,
+ * so only the jobs being dropped are looked at.
+ */
+static void lprocfs_job_cleanup(struct obd_job_stats *stats, bool force)
+{
+	struct job_stat *job;
+	struct job_stat *tmp;
+	CFS_LIST_HEAD(victims);
+	time_t oldest = 0;
+	time_t now;
 
 	now = cfs_time_current_sec();
-	if (!force && now < stats->ojs_last_cleanup +
-			    stats->ojs_cleanup_interval)
+	if (stats->ojs_cleanup_interval != 0 &&
+	    (force || now >= stats->ojs_last_cleanup +
+			     stats->ojs_cleanup_interval)) {
+		oldest = now - stats->ojs_cleanup_interval;
+		stats->ojs_last_cleanup = now;
+	}
+
+	if (oldest == 0 && !job_stats_over_limit(stats))
 		return;
 
-	oldest = now - stats->ojs_cleanup_interval;
-	cfs_hash_for_each_safe(stats->ojs_hash, job_iter_callback,
-			       &oldest);
-	stats->ojs_last_cleanup = cfs_time_current_sec();
+	write_lock(&stats->ojs_lock);
+	cfs_list_for_each_entry_safe(job, tmp, &stats->ojs_list, js_list) {
+		if (job->js_timestamp >= oldest && !job_stats_over_limit(stats))
+			break;
+
+		job_unlink_locked(stats, job);
+		cfs_atomic_inc(&job->js_refcount);
+		cfs_list_add_tail(&job->js_list, &victims);
+	}
+	write_unlock(&stats->ojs_lock);
+
+	cfs_list_for_each_entry_safe(job, tmp, &victims, js_list) {
+		cfs_list_del_init(&job->js_list);
+		cfs_hash_del(stats->ojs_hash, job->js_jobid, &job->js_hash);
+		job_putref(job);
+	}
 }
 
 static struct job_stat *job_alloc(char *jobid, struct obd_job_stats *jobs)
@@ -191,7 +328,9 @@ static struct job_stat *job_alloc(char *jobid, struct obd_job_stats *jobs)
 	if (job == NULL)
 		return NULL;
 
-	job->js_stats = lprocfs_alloc_stats(jobs->ojs_cntr_num, 0);
+	/* the counters are per-CPU, and only summed up when read */
+	job->js_stats = lprocfs_alloc_stats(jobs->ojs_cntr_num,
+					    LPROCFS_STATS_FLAG_NONE);
 	if (job->js_stats == NULL) {
 		OBD_FREE_PTR(job);
 		return NULL;
@@ -213,7 +352,9 @@ int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
 			  int event, long amount)
 {
 	struct obd_job_stats *stats = &obd->u.obt.obt_jobstats;
+	struct job_stat_cache *jsc;
 	struct job_stat *job, *job2;
+	time_t now;
 	ENTRY;
 
 	LASSERT(stats && stats->ojs_hash);
@@ -229,10 +370,15 @@ int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
 		RETURN(-EINVAL);
 	}
 
-	job = cfs_hash_lookup(stats->ojs_hash, jobid);
+	jsc = cfs_percpt_current(stats->ojs_cache);
+	job = job_cache_lookup(jsc, jobid);
 	if (job)
 		goto found;
 
+	job = cfs_hash_lookup(stats->ojs_hash, jobid);
+	if (job)
+		goto cache;
+
 	job = job_alloc(jobid, stats);
 	if (job == NULL)
 		RETURN(-ENOMEM);
@@ -250,14 +396,32 @@ int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
 	} else {
 		LASSERT(cfs_list_empty(&job->js_list));
 		write_lock(&stats->ojs_lock);
-		cfs_list_add_tail(&job->js_list, &stats->ojs_list);
+		if (!job->js_unlinked) {
+			cfs_list_add_tail(&job->js_list, &stats->ojs_list);
+			stats->ojs_count++;
+		}
 		write_unlock(&stats->ojs_lock);
+
+		if (job_stats_over_limit(stats))
+			lprocfs_job_cleanup(stats, false);
 	}
 
+cache:
+	job_cache_insert(jsc, job);
 found:
 	LASSERT(stats == job->js_jobstats);
 	LASSERT(stats->ojs_cntr_num > event);
-	job->js_timestamp = cfs_time_current_sec();
+
+	/* keep ojs_list in LRU order, at a granularity of one second so
+	 * that a busy job takes ojs_lock at most once a second */
+	now = cfs_time_current_sec();
+	if (job->js_timestamp != now) {
+		job->js_timestamp = now;
+		write_lock(&stats->ojs_lock);
+		if (!job->js_unlinked)
+			cfs_list_move_tail(&job->js_list, &stats->ojs_list);
+		write_unlock(&stats->ojs_lock);
+	}
 	lprocfs_counter_add(job->js_stats, event, amount);
 
 	job_putref(job);
@@ -268,13 +432,15 @@ EXPORT_SYMBOL(lprocfs_job_stats_log);
 void lprocfs_job_stats_fini(struct obd_device *obd)
 {
 	struct obd_job_stats *stats = &obd->u.obt.obt_jobstats;
-	time_t oldest = 0;
 
 	if (stats->ojs_hash == NULL)
 		return;
-	cfs_hash_for_each_safe(stats->ojs_hash, job_iter_callback, &oldest);
+	job_cache_flush(stats);
+	cfs_hash_for_each_safe(stats->ojs_hash, job_iter_callback, NULL);
 	cfs_hash_putref(stats->ojs_hash);
 	stats->ojs_hash = NULL;
+	cfs_percpt_free(stats->ojs_cache);
+	stats->ojs_cache = NULL;
 	LASSERT(cfs_list_empty(&stats->ojs_list));
 }
 EXPORT_SYMBOL(lprocfs_job_stats_fini);
@@ -455,9 +621,9 @@ static ssize_t lprocfs_jobstats_seq_write(struct file *file, const char *buf,
 
 	LASSERT(stats->ojs_hash);
 	if (all) {
-		time_t oldest = 0;
 		cfs_hash_for_each_safe(stats->ojs_hash, job_iter_callback,
-				       &oldest);
+				       NULL);
+		job_cache_flush(stats);
 		return len;
 	}
 
@@ -468,7 +634,10 @@ static ssize_t lprocfs_jobstats_seq_write(struct file *file, const char *buf,
 	if (!job)
 		return -EINVAL;
 
-	cfs_hash_del_key(stats->ojs_hash, jobid);
+	write_lock(&stats->ojs_lock);
+	job_unlink_locked(stats, job);
+	write_unlock(&stats->ojs_lock);
+	cfs_hash_del(stats->ojs_hash, jobid, &job->js_hash);
 
 	job_putref(job);
 	return len;
@@ -488,6 +657,8 @@ int lprocfs_job_stats_init(struct obd_device *obd, int cntr_num,
 {
 	struct proc_dir_entry *entry;
 	struct obd_job_stats *stats;
+	struct job_stat_cache *jsc;
+	int i;
 	ENTRY;
 
 	LASSERT(obd->obd_proc_entry != NULL);
@@ -512,12 +683,23 @@ int lprocfs_job_stats_init(struct obd_device *obd, int cntr_num,
 	if (stats->ojs_hash == NULL)
 		RETURN(-ENOMEM);
 
+	stats->ojs_cache = cfs_percpt_alloc(cfs_cpt_table, sizeof(*jsc));
+	if (stats->ojs_cache == NULL) {
+		cfs_hash_putref(stats->ojs_hash);
+		stats->ojs_hash = NULL;
+		RETURN(-ENOMEM);
+	}
+	cfs_percpt_for_each(jsc, i, stats->ojs_cache)
+		spin_lock_init(&jsc->jsc_lock);
+
 	CFS_INIT_LIST_HEAD(&stats->ojs_list);
 	rwlock_init(&stats->ojs_lock);
 	stats->ojs_cntr_num = cntr_num;
 	stats->ojs_cntr_init_fn = init_fn;
 	stats->ojs_cleanup_interval = 600; /* 10 mins by default */
 	stats->ojs_last_cleanup = cfs_time_current_sec();
+	stats->ojs_count = 0;
+	stats->ojs_max_jobs = JOB_STATS_MAX_DEFAULT;
 
 	LPROCFS_WRITE_ENTRY();
 	entry = create_proc_entry("job_stats", 0644, obd->obd_proc_entry);
@@ -533,6 +715,29 @@ int lprocfs_job_stats_init(struct obd_device *obd, int cntr_num,
 }
 EXPORT_SYMBOL(lprocfs_job_stats_init);
 
+/* add the counters of every job to the stats_snapshot of @obd */
+void lprocfs_job_stats_snapshot(struct obd_device *obd,
+				struct lprocfs_snapshot_buf *lsb)
+{
+	struct obd_job_stats *stats;
+	struct job_stat *job;
+
+	if (strcmp(obd->obd_type->typ_name, LUSTRE_MDT_NAME) &&
+	    strcmp(obd->obd_type->typ_name, LUSTRE_OST_NAME))
+		return;
+
+	stats = &obd->u.obt.obt_jobstats;
+	if (stats->ojs_hash == NULL)
+		return;
+
+	read_lock(&stats->ojs_lock);
+	cfs_list_for_each_entry(job, &stats->ojs_list, js_list)
+		lprocfs_snapshot_add_stats(lsb, LPROCFS_SNAP_JOB,
+					   job->js_jobid, job->js_timestamp,
+					   job->js_stats);
+	read_unlock(&stats->ojs_lock);
+}
+
 int lprocfs_rd_job_interval(char *page, char **start, off_t off,
 			    int count, int *eof, void *data)
 {
@@ -568,4 +773,40 @@ int lprocfs_wr_job_interval(struct file *file, const char *buffer,
 }
 EXPORT_SYMBOL(lprocfs_wr_job_interval);
 
+int lprocfs_rd_job_max_entries(char *page, char **start, off_t off,
+			       int count, int *eof, void *data)
+{
+	struct obd_device *obd = (struct obd_device *)data;
+	struct obd_job_stats *stats;
+
+	LASSERT(obd != NULL);
+	stats = &obd->u.obt.obt_jobstats;
+	*eof = 1;
+	return snprintf(page, count, "%d\n", stats->ojs_max_jobs);
+}
+EXPORT_SYMBOL(lprocfs_rd_job_max_entries);
+
+int lprocfs_wr_job_max_entries(struct file *file, const char *buffer,
+			       unsigned long count, void *data)
+{
+	struct obd_device *obd = (struct obd_device *)data;
+	struct obd_job_stats *stats;
+	int val, rc;
+
+	LASSERT(obd != NULL);
+	stats = &obd->u.obt.obt_jobstats;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+	if (val < 0)
+		return -EINVAL;
+
+	stats->ojs_max_jobs = val;
+	lprocfs_job_cleanup(stats, false);
+
+	return count;
+}
+EXPORT_SYMBOL(lprocfs_wr_job_max_entries);
+
 #endif /* LPROCFS*/
@@ -873,6 +873,169 @@ void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
 }
 EXPORT_SYMBOL(lprocfs_stats_collect);
 
+/**
+ * Append the counters of \a stats with samples to the snapshot \a lsb, as a
+ * set of type \a type.  Once the buffer is full, only the space needed is
+ * accounted, so that the caller can retry with a large enough buffer.
+ */
+void lprocfs_snapshot_add_stats(struct lprocfs_snapshot_buf *lsb, __u32 type,
+				const char *name, __u64 timestamp,
+				struct lprocfs_stats *stats)
+{
+	struct lprocfs_snapshot_set	*set;
+	struct lprocfs_snapshot_counter	*lsc;
+	struct lprocfs_counter_header	*hdr;
+	struct lprocfs_counter		 ctr;
+	size_t				 need;
+	int				 i;
+
+	if (stats == NULL)
+		return;
+
+	need = sizeof(*set) + stats->ls_num * sizeof(*lsc);
+	if (lsb->lsb_used + need > lsb->lsb_size) {
+		lsb->lsb_used += need;
+		return;
+	}
+
+	set = (struct lprocfs_snapshot_set *)(lsb->lsb_buf + lsb->lsb_used);
+	memset(set, 0, sizeof(*set));
+	set->lss_type = type;
+	set->lss_timestamp = timestamp;
+	strncpy(set->lss_name, name, sizeof(set->lss_name) - 1);
+
+	lsc = (struct lprocfs_snapshot_counter *)(set + 1);
+	for (i = 0; i < stats->ls_num; i++) {
+		hdr = &stats->ls_cnt_header[i];
+		if (hdr->lc_name == NULL)
+			continue;
+
+		lprocfs_stats_collect(stats, i, &ctr);
+		if (ctr.lc_count == 0)
+			continue;
+
+		memset(lsc, 0, sizeof(*lsc));
+		lsc->lsc_config = hdr->lc_config;
+		lsc->lsc_count = ctr.lc_count;
+		lsc->lsc_min = ctr.lc_min;
+		lsc->lsc_max = ctr.lc_max;
+		lsc->lsc_sum = ctr.lc_sum;
+		lsc->lsc_sumsquare = ctr.lc_sumsquare;
+		strncpy(lsc->lsc_name, hdr->lc_name,
+			sizeof(lsc->lsc_name) - 1);
+		if (hdr->lc_units != NULL)
+			strncpy(lsc->lsc_units, hdr->lc_units,
+				sizeof(lsc->lsc_units) - 1);
+		set->lss_counters++;
+		lsc++;
+	}
+
+	lsb->lsb_used = (char *)lsc - lsb->lsb_buf;
+	lsb->lsb_sets++;
+}
+EXPORT_SYMBOL(lprocfs_snapshot_add_stats);
+
+static void lprocfs_snapshot_fill(struct obd_device *obd,
+				  struct lprocfs_snapshot_buf *lsb)
+{
+	struct lprocfs_snapshot_header	*lsh;
+	struct timeval			 now;
+
+	lsb->lsb_used = sizeof(*lsh);
+	lsb->lsb_sets = 0;
+	do_gettimeofday(&now);
+
+	lprocfs_snapshot_add_stats(lsb, LPROCFS_SNAP_STATS, "stats", 0,
+				   obd->obd_stats);
+	lprocfs_snapshot_add_stats(lsb, LPROCFS_SNAP_STATS, "md_stats", 0,
+				   obd->obd_md_stats);
+	lprocfs_snapshot_add_stats(lsb, LPROCFS_SNAP_STATS, "svc_stats", 0,
+				   obd->obd_svc_stats);
+	lprocfs_job_stats_snapshot(obd, lsb);
+
+	if (lsb->lsb_used > lsb->lsb_size)
+		return;
+
+	lsh = (struct lprocfs_snapshot_header *)lsb->lsb_buf;
+	lsh->lsh_magic = LPROCFS_SNAPSHOT_MAGIC;
+	lsh->lsh_version = LPROCFS_SNAPSHOT_VERSION;
+	lsh->lsh_size = lsb->lsb_used;
+	lsh->lsh_time_sec = now.tv_sec;
+	lsh->lsh_time_usec = now.tv_usec;
+	lsh->lsh_sets = lsb->lsb_sets;
+}
+
+/*
+ * All the counters are collected when the file is opened, so that the
+ * reader gets a consistent snapshot however it reads the file.
+ */
+static int lprocfs_snapshot_open(struct inode *inode, struct file *file)
+{
+	struct obd_device		*obd = PDE_DATA(inode);
+	struct lprocfs_snapshot_buf	*lsb;
+	size_t				 size = PAGE_CACHE_SIZE;
+
+#ifndef HAVE_ONLY_PROCFS_SEQ
+	if (LPROCFS_ENTRY_CHECK(PDE(inode)))
+		return -ENOENT;
+#endif
+	OBD_ALLOC_PTR(lsb);
+	if (lsb == NULL)
+		return -ENOMEM;
+
+	while (1) {
+		OBD_ALLOC_LARGE(lsb->lsb_buf, size);
+		if (lsb->lsb_buf == NULL) {
+			OBD_FREE_PTR(lsb);
+			return -ENOMEM;
+		}
+		lsb->lsb_size = size;
+
+		lprocfs_snapshot_fill(obd, lsb);
+		if (lsb->lsb_used <= lsb->lsb_size)
+			break;
+
+		/* leave some room for the jobs added meanwhile */
+		OBD_FREE_LARGE(lsb->lsb_buf, size);
+		size = lsb->lsb_used + lsb->lsb_used / 8;
+	}
+
+	file->private_data = lsb;
+	return 0;
+}
+
+static ssize_t lprocfs_snapshot_read(struct file *file, char __user *buf,
+				     size_t count, loff_t *ppos)
+{
+	struct lprocfs_snapshot_buf *lsb = file->private_data;
+
+	return simple_read_from_buffer(buf, count, ppos, lsb->lsb_buf,
+				       lsb->lsb_used);
+}
+
+static int lprocfs_snapshot_release(struct inode *inode, struct file *file)
+{
+	struct lprocfs_snapshot_buf *lsb = file->private_data;
+
+	OBD_FREE_LARGE(lsb->lsb_buf, lsb->lsb_size);
+	OBD_FREE_PTR(lsb);
+	return 0;
+}
+
+static struct file_operations lprocfs_snapshot_fops = {
+	.owner   = THIS_MODULE,
+	.open    = lprocfs_snapshot_open,
+	.read    = lprocfs_snapshot_read,
+	.release = lprocfs_snapshot_release,
+};
+
+static void lprocfs_obd_register_snapshot(struct obd_device *obd)
+{
+	if (proc_create_data("stats_snapshot", 0444, obd->obd_proc_entry,
+			     &lprocfs_snapshot_fops, obd) == NULL)
+		CWARN("%s: cannot create stats_snapshot\n", obd->obd_name);
+}
+
 /**
  * Append a space separated list of current set flags to str.
  */
@@ -952,6 +1115,8 @@ static const char *obd_connect_names[] = {
 	"pingless",
 	"flock_deadlock",
 	"disp_stripe",
+	"open_by_fid",
+	"quota_batch",
 	"unknown",
 	NULL
 };
@@ -1780,6 +1945,8 @@ int lprocfs_obd_setup(struct obd_device *obd, struct lprocfs_vars *list)
 		rc = PTR_ERR(obd->obd_proc_entry);
 		CERROR("error %d setting up lprocfs for %s\n",rc,obd->obd_name);
 		obd->obd_proc_entry = NULL;
+	} else {
+		lprocfs_obd_register_snapshot(obd);
 	}
 	return rc;
 }
@@ -1803,6 +1970,8 @@ lprocfs_seq_obd_setup(struct obd_device *obd)
 		rc = PTR_ERR(obd->obd_proc_entry);
 		CERROR("error %d setting up lprocfs for %s\n",rc,obd->obd_name);
 		obd->obd_proc_entry = NULL;
+	} else {
+		lprocfs_obd_register_snapshot(obd);
 	}
 	return rc;
 }
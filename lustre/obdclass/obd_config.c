@@ -340,8 +340,9 @@ EXPORT_SYMBOL(class_match_net);
 int class_attach(struct lustre_cfg *lcfg)
 {
         struct obd_device *obd = NULL;
+	struct obd_timed_exports *ote;
         char *typename, *name, *uuid;
-        int rc, len;
+        int rc, len, i;
         ENTRY;
 
         if (!LUSTRE_CFG_BUFLEN(lcfg, 1)) {
@@ -389,7 +390,6 @@ int class_attach(struct lustre_cfg *lcfg)
 	CFS_INIT_LIST_HEAD(&obd->obd_exports);
 	CFS_INIT_LIST_HEAD(&obd->obd_unlinked_exports);
 	CFS_INIT_LIST_HEAD(&obd->obd_delayed_exports);
-	CFS_INIT_LIST_HEAD(&obd->obd_exports_timed);
 	CFS_INIT_LIST_HEAD(&obd->obd_nid_stats);
 	spin_lock_init(&obd->obd_nid_lock);
 	spin_lock_init(&obd->obd_dev_lock);
@@ -399,6 +399,15 @@ int class_attach(struct lustre_cfg *lcfg)
 	 * past to guarantee a fresh statfs is fetched on mount. */
 	obd->obd_osfs_age = cfs_time_shift_64(-1000);
 
+	obd->obd_exports_timed = cfs_percpt_alloc(cfs_cpt_table,
+						  sizeof(*ote));
+	if (obd->obd_exports_timed == NULL)
+		GOTO(out, rc = -ENOMEM);
+	cfs_percpt_for_each(ote, i, obd->obd_exports_timed) {
+		spin_lock_init(&ote->ote_lock);
+		CFS_INIT_LIST_HEAD(&ote->ote_list);
+	}
+
 	/* XXX belongs in setup not attach  */
 	init_rwsem(&obd->obd_observer_link_sem);
 	/* recovery data */
@@ -532,7 +541,7 @@ int class_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
                 GOTO(err_hash, err = PTR_ERR(exp));
 
         obd->obd_self_export = exp;
-        cfs_list_del_init(&exp->exp_obd_chain_timed);
+	class_export_untime(exp);
         class_export_put(exp);
 
         err = obd_setup(obd, lcfg);
@@ -3074,9 +3074,7 @@ static int echo_client_setup(const struct lu_env *env,
         rc = obd_connect(env, &ec->ec_exp, tgt, &echo_uuid, ocd, NULL);
         if (rc == 0) {
                 /* Turn off pinger because it connects to tgt obd directly. */
-		spin_lock(&tgt->obd_dev_lock);
-		cfs_list_del_init(&ec->ec_exp->exp_obd_chain_timed);
-		spin_unlock(&tgt->obd_dev_lock);
+		class_export_untime(ec->ec_exp);
         }
 
         OBD_FREE(ocd, sizeof(*ocd));
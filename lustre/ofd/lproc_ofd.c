@@ -535,6 +535,8 @@ static struct lprocfs_vars lprocfs_ofd_obd_vars[] = {
 	{ "capa_count",		 lprocfs_ofd_rd_capa_count, 0, 0 },
 	{ "job_cleanup_interval", lprocfs_rd_job_interval,
 				  lprocfs_wr_job_interval, 0},
+	{ "job_max_entries",	 lprocfs_rd_job_max_entries,
+				 lprocfs_wr_job_max_entries, 0},
 	{ "soft_sync_limit",	 lprocfs_ofd_rd_soft_sync_limit,
 				 lprocfs_ofd_wr_soft_sync_limit, 0},
 	{ 0 }
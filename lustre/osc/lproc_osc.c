@@ -152,6 +152,7 @@ static ssize_t osc_max_dirty_mb_seq_write(struct file *file, const char *buffer,
 
 	client_obd_list_lock(&cli->cl_loi_list_lock);
 	cli->cl_dirty_max = (obd_count)(pages_number << PAGE_CACHE_SHIFT);
+	osc_grant_cache_drain(cli);
 	osc_wake_cache_waiters(cli);
 	client_obd_list_unlock(&cli->cl_loi_list_lock);
 
@@ -217,6 +218,7 @@ static int osc_cur_dirty_bytes_seq_show(struct seq_file *m, void *v)
 	int rc;
 
 	client_obd_list_lock(&cli->cl_loi_list_lock);
+	osc_grant_cache_drain(cli);
 	rc = seq_printf(m, "%lu\n", cli->cl_dirty);
 	client_obd_list_unlock(&cli->cl_loi_list_lock);
 	return rc;
@@ -230,6 +232,7 @@ static int osc_cur_grant_bytes_seq_show(struct seq_file *m, void *v)
 	int rc;
 
 	client_obd_list_lock(&cli->cl_loi_list_lock);
+	osc_grant_cache_drain(cli);
 	rc = seq_printf(m, "%lu\n", cli->cl_avail_grant);
 	client_obd_list_unlock(&cli->cl_loi_list_lock);
 	return rc;
@@ -423,6 +426,93 @@ static ssize_t osc_resend_count_seq_write(struct file *file, const char *buffer,
 }
 LPROC_SEQ_FOPS(osc_resend_count);
 
+static int osc_write_gather_pages_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *obd = m->private;
+
+	return seq_printf(m, "%d\n", obd->u.cli.cl_write_gather_pages);
+}
+
+static ssize_t osc_write_gather_pages_seq_write(struct file *file,
+						const char *buffer,
+						size_t count, loff_t *off)
+{
+	struct obd_device *obd = ((struct seq_file *)file->private_data)->private;
+	struct client_obd *cli = &obd->u.cli;
+	int val, rc;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	if (val < 0 || val > cli->cl_max_pages_per_rpc)
+		return -ERANGE;
+
+	client_obd_list_lock(&cli->cl_loi_list_lock);
+	cli->cl_write_gather_pages = val;
+	client_obd_list_unlock(&cli->cl_loi_list_lock);
+
+	return count;
+}
+LPROC_SEQ_FOPS(osc_write_gather_pages);
+
+static int osc_write_gather_latency_ms_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *obd = m->private;
+
+	return seq_printf(m, "%u\n", obd->u.cli.cl_write_gather_ms);
+}
+
+static ssize_t osc_write_gather_latency_ms_seq_write(struct file *file,
+						     const char *buffer,
+						     size_t count, loff_t *off)
+{
+	struct obd_device *obd = ((struct seq_file *)file->private_data)->private;
+	int val, rc;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	if (val < 0)
+		return -ERANGE;
+
+	obd->u.cli.cl_write_gather_ms = val;
+	return count;
+}
+LPROC_SEQ_FOPS(osc_write_gather_latency_ms);
+
+static int osc_grant_cache_pages_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *obd = m->private;
+
+	return seq_printf(m, "%d\n", obd->u.cli.cl_grant_cache_pages);
+}
+
+static ssize_t osc_grant_cache_pages_seq_write(struct file *file,
+					       const char *buffer,
+					       size_t count, loff_t *off)
+{
+	struct obd_device *obd = ((struct seq_file *)file->private_data)->private;
+	struct client_obd *cli = &obd->u.cli;
+	int val, rc;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	if (val < 0 || val > cli->cl_max_pages_per_rpc)
+		return -ERANGE;
+
+	client_obd_list_lock(&cli->cl_loi_list_lock);
+	cli->cl_grant_cache_pages = val;
+	osc_grant_cache_drain(cli);
+	client_obd_list_unlock(&cli->cl_loi_list_lock);
+
+	return count;
+}
+LPROC_SEQ_FOPS(osc_grant_cache_pages);
+
 static int osc_contention_seconds_seq_show(struct seq_file *m, void *v)
 {
 	struct obd_device *obd = m->private;
@@ -567,6 +657,9 @@ struct lprocfs_seq_vars lprocfs_osc_obd_vars[] = {
 	{ "checksums",		&osc_checksum_fops		},
 	{ "checksum_type",	&osc_checksum_type_fops		},
 	{ "resend_count",	&osc_resend_count_fops		},
+	{ "write_gather_pages",	&osc_write_gather_pages_fops	},
+	{ "write_gather_latency_ms", &osc_write_gather_latency_ms_fops },
+	{ "grant_cache_pages",	&osc_grant_cache_pages_fops	},
 	{ "timeouts",		&osc_timeouts_fops		},
 	{ "contention_seconds",	&osc_contention_seconds_fops	},
 	{ "lockless_truncate",	&osc_lockless_truncate_fops	},
@@ -601,6 +694,11 @@ static int osc_rpc_stats_seq_show(struct seq_file *seq, void *v)
 		   cfs_atomic_read(&cli->cl_pending_w_pages));
         seq_printf(seq, "pending read pages:   %d\n",
 		   cfs_atomic_read(&cli->cl_pending_r_pages));
+	seq_printf(seq, "write gathering:      %d pages %u ms\n",
+		   cli->cl_write_gather_pages, cli->cl_write_gather_ms);
+	seq_printf(seq, "gathered write RPCs:  %d (%d pages)\n",
+		   cfs_atomic_read(&cli->cl_write_gathered_rpcs),
+		   cfs_atomic_read(&cli->cl_write_gathered_pages));
 
         seq_printf(seq, "\n\t\t\tread\t\t\twrite\n");
         seq_printf(seq, "pages per rpc         rpcs   %% cum %% |");
@@ -689,6 +787,8 @@ static ssize_t osc_rpc_stats_seq_write(struct file *file, const char *buf,
         lprocfs_oh_clear(&cli->cl_write_page_hist);
         lprocfs_oh_clear(&cli->cl_read_offset_hist);
         lprocfs_oh_clear(&cli->cl_write_offset_hist);
+	cfs_atomic_set(&cli->cl_write_gathered_rpcs, 0);
+	cfs_atomic_set(&cli->cl_write_gathered_pages, 0);
 
         return len;
 }
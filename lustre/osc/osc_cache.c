@@ -1408,6 +1408,26 @@ static void __osc_unreserve_grant(struct client_obd *cli,
 void osc_unreserve_grant(struct client_obd *cli,
 			 unsigned int reserved, unsigned int unused)
 {
+	struct osc_grant_cache *ogc;
+	long limit = (long)cli->cl_grant_cache_pages << PAGE_CACHE_SHIFT;
+	int cached = 0;
+
+	/* unused grant goes back to the local cache unless somebody is
+	 * waiting for it, or it would leave too much of it there */
+	if (limit > 0 && unused <= reserved &&
+	    cfs_list_empty(&cli->cl_cache_waiters)) {
+		ogc = cfs_percpt_current(cli->cl_grant_cache);
+		spin_lock(&ogc->ogc_lock);
+		if (ogc->ogc_grant + unused <= 2 * limit) {
+			ogc->ogc_reserved -= reserved;
+			ogc->ogc_grant += unused;
+			cached = 1;
+		}
+		spin_unlock(&ogc->ogc_lock);
+		if (cached)
+			return;
+	}
+
 	client_obd_list_lock(&cli->cl_loi_list_lock);
 	__osc_unreserve_grant(cli, reserved, unused);
 	if (unused > 0)
@@ -1494,6 +1514,181 @@ static int osc_enter_cache_try(struct client_obd *cli,
 	return rc;
 }
 
+/**
+ * Grant cache.
+ *
+ * With many threads writing through one OSC, taking loi_list_lock for every
+ * dirtied page makes it the hottest lock on the client. Instead, each CPU
+ * partition keeps a small stock of grant and dirty page credits, refilled
+ * under loi_list_lock cl_grant_cache_pages at a time, which writers consume
+ * under the partition's own lock. The caches are only refilled while there
+ * is plenty of room left under cl_dirty_max, obd_max_dirty_pages and
+ * cl_avail_grant; close to any of these limits the old path is used so that
+ * waiters see exactly what is left. Cached credits are returned to the
+ * client totals by osc_grant_cache_drain().
+ */
+int osc_grant_cache_setup(struct client_obd *cli)
+{
+	struct osc_grant_cache *ogc;
+	int i;
+
+	cli->cl_grant_cache = cfs_percpt_alloc(cfs_cpt_table, sizeof(*ogc));
+	if (cli->cl_grant_cache == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(ogc, i, cli->cl_grant_cache)
+		spin_lock_init(&ogc->ogc_lock);
+	cli->cl_grant_cache_pages = OSC_GRANT_CACHE_PAGES_DEFAULT;
+	return 0;
+}
+
+void osc_grant_cache_cleanup(struct client_obd *cli)
+{
+	if (cli->cl_grant_cache == NULL)
+		return;
+
+	client_obd_list_lock(&cli->cl_loi_list_lock);
+	cli->cl_grant_cache_pages = 0;
+	osc_grant_cache_drain(cli);
+	client_obd_list_unlock(&cli->cl_loi_list_lock);
+
+	cfs_percpt_free(cli->cl_grant_cache);
+	cli->cl_grant_cache = NULL;
+}
+
+/**
+ * Return everything the per-CPT caches hold to the client totals.
+ *
+ * caller must hold loi_list_lock
+ */
+void osc_grant_cache_drain(struct client_obd *cli)
+{
+	struct osc_grant_cache *ogc;
+	int i;
+
+	if (cli->cl_grant_cache == NULL)
+		return;
+
+	cfs_percpt_for_each(ogc, i, cli->cl_grant_cache) {
+		spin_lock(&ogc->ogc_lock);
+		cli->cl_avail_grant += ogc->ogc_grant;
+		cli->cl_reserved_grant += ogc->ogc_reserved;
+		cli->cl_dirty -= ogc->ogc_dirty << PAGE_CACHE_SHIFT;
+		cfs_atomic_sub(ogc->ogc_dirty, &obd_dirty_pages);
+		ogc->ogc_grant = 0;
+		ogc->ogc_reserved = 0;
+		ogc->ogc_dirty = 0;
+		spin_unlock(&ogc->ogc_lock);
+	}
+}
+
+/**
+ * Sum up the grant held by the per-CPT caches, free or reserved, and the
+ * bytes they have charged to cl_dirty without dirtying a page yet.
+ *
+ * caller must hold loi_list_lock
+ */
+void osc_grant_cache_sum(struct client_obd *cli, long *grant, long *dirty)
+{
+	struct osc_grant_cache *ogc;
+	int i;
+
+	*grant = 0;
+	*dirty = 0;
+	if (cli->cl_grant_cache == NULL)
+		return;
+
+	cfs_percpt_for_each(ogc, i, cli->cl_grant_cache) {
+		spin_lock(&ogc->ogc_lock);
+		*grant += ogc->ogc_grant + ogc->ogc_reserved;
+		*dirty += ogc->ogc_dirty << PAGE_CACHE_SHIFT;
+		spin_unlock(&ogc->ogc_lock);
+	}
+}
+
+/* caller must hold ogc_lock */
+static int osc_grant_cache_take(struct osc_grant_cache *ogc,
+				struct osc_async_page *oap, int bytes)
+{
+	LASSERT(!(oap->oap_brw_page.flag & OBD_BRW_FROM_GRANT));
+	if (ogc->ogc_dirty == 0 || ogc->ogc_grant < bytes)
+		return 0;
+
+	ogc->ogc_dirty--;
+	ogc->ogc_grant -= bytes;
+	ogc->ogc_reserved += bytes;
+	oap->oap_brw_page.flag |= OBD_BRW_FROM_GRANT;
+	return 1;
+}
+
+/**
+ * Whether the caches may take another \a pages dirty pages and \a grant
+ * bytes of grant: every partition must be able to do so without getting the
+ * client near its limits.
+ *
+ * caller must hold loi_list_lock
+ */
+static int osc_grant_cache_may_refill(struct client_obd *cli, long pages,
+				      long grant)
+{
+	/* leave one more batch for the uncached path */
+	long nr = cfs_percpt_number(cli->cl_grant_cache) + 1;
+
+	return cfs_list_empty(&cli->cl_cache_waiters) &&
+	       cli->cl_avail_grant >= nr * grant &&
+	       cli->cl_dirty + ((nr * pages) << PAGE_CACHE_SHIFT) <=
+	       cli->cl_dirty_max &&
+	       cfs_atomic_read(&obd_unstable_pages) +
+	       cfs_atomic_read(&obd_dirty_pages) + nr * pages <=
+	       obd_max_dirty_pages;
+}
+
+/**
+ * Same as osc_enter_cache_try(), but takes the page and grant from the local
+ * grant cache when it can. Called without loi_list_lock.
+ */
+static int osc_grant_cache_enter(struct client_obd *cli,
+				 struct osc_async_page *oap, int bytes)
+{
+	struct osc_grant_cache *ogc;
+	long pages = cli->cl_grant_cache_pages;
+	long grant = bytes + (pages << PAGE_CACHE_SHIFT);
+	int rc;
+
+	if (pages == 0) {
+		client_obd_list_lock(&cli->cl_loi_list_lock);
+		rc = osc_enter_cache_try(cli, oap, bytes, 0);
+		client_obd_list_unlock(&cli->cl_loi_list_lock);
+		return rc;
+	}
+
+	ogc = cfs_percpt_current(cli->cl_grant_cache);
+	spin_lock(&ogc->ogc_lock);
+	rc = osc_grant_cache_take(ogc, oap, bytes);
+	spin_unlock(&ogc->ogc_lock);
+	if (rc)
+		return rc;
+
+	client_obd_list_lock(&cli->cl_loi_list_lock);
+	if (osc_grant_cache_may_refill(cli, pages, grant)) {
+		cli->cl_avail_grant -= grant;
+		cli->cl_dirty += pages << PAGE_CACHE_SHIFT;
+		cfs_atomic_add(pages, &obd_dirty_pages);
+		osc_update_next_shrink(cli);
+
+		spin_lock(&ogc->ogc_lock);
+		ogc->ogc_grant += grant;
+		ogc->ogc_dirty += pages;
+		rc = osc_grant_cache_take(ogc, oap, bytes);
+		spin_unlock(&ogc->ogc_lock);
+		LASSERT(rc == 1);
+	} else {
+		rc = osc_enter_cache_try(cli, oap, bytes, 0);
+	}
+	client_obd_list_unlock(&cli->cl_loi_list_lock);
+	return rc;
+}
+
 static int ocw_granted(struct client_obd *cli, struct osc_cache_waiter *ocw)
 {
 	int rc;
@@ -1523,16 +1718,21 @@ static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 
 	OSC_DUMP_GRANT(D_CACHE, cli, "need:%d.\n", bytes);
 
-	client_obd_list_lock(&cli->cl_loi_list_lock);
-
 	/* force the caller to try sync io.  this can jump the list
 	 * of queued writes and create a discontiguous rpc stream */
 	if (OBD_FAIL_CHECK(OBD_FAIL_OSC_NO_GRANT) ||
 	    cli->cl_dirty_max < PAGE_CACHE_SIZE     ||
 	    cli->cl_ar.ar_force_sync || loi->loi_ar.ar_force_sync)
-		GOTO(out, rc = -EDQUOT);
+		RETURN(-EDQUOT);
 
 	/* Hopefully normal case - cache space and write credits available */
+	if (osc_grant_cache_enter(cli, oap, bytes))
+		RETURN(0);
+
+	client_obd_list_lock(&cli->cl_loi_list_lock);
+
+	/* what other partitions hold may be just enough */
+	osc_grant_cache_drain(cli);
 	if (osc_enter_cache_try(cli, oap, bytes, 0))
 		GOTO(out, rc = 0);
 
@@ -1605,6 +1805,9 @@ void osc_wake_cache_waiters(struct client_obd *cli)
 	struct osc_cache_waiter *ocw;
 
 	ENTRY;
+	if (!cfs_list_empty(&cli->cl_cache_waiters))
+		osc_grant_cache_drain(cli);
+
 	cfs_list_for_each_safe(l, tmp, &cli->cl_cache_waiters) {
 		ocw = cfs_list_entry(l, struct osc_cache_waiter, ocw_entry);
 		cfs_list_del_init(&ocw->ocw_entry);
@@ -1640,6 +1843,31 @@ static int osc_max_rpc_in_flight(struct client_obd *cli, struct osc_object *osc)
 	return rpcs_in_flight(cli) >= cli->cl_max_rpcs_in_flight + hprpc;
 }
 
+/**
+ * Write gathering. Cache waiters force out every object with dirty pages,
+ * which for many small files means a stream of nearly empty RPCs. Hold
+ * back the objects with fewer than cl_write_gather_pages pending so that
+ * the RPC slots go to fuller objects first and the small ones get a chance
+ * to grow. An object is held back for at most cl_write_gather_ms, and only
+ * while write RPCs are in flight: their completion unplugs the queue again.
+ *
+ * Pages of one RPC still belong to a single object, as the OST handles one
+ * obd_ioobj per BRW.
+ */
+static int osc_write_gather(struct client_obd *cli, struct osc_object *osc)
+{
+	cfs_duration_t budget;
+
+	if (cfs_atomic_read(&osc->oo_nr_writes) >= cli->cl_write_gather_pages)
+		return 0;
+	if (cli->cl_w_in_flight == 0)
+		return 0;
+
+	budget = cfs_time_seconds(cli->cl_write_gather_ms) / 1000;
+	return cfs_time_before(cfs_time_current(),
+			       cfs_time_add(osc->oo_write_start, budget));
+}
+
 /* This maintains the lists of pending pages to read/write for a given object
  * (lop).  This is used by osc_check_rpcs->osc_next_obj() and osc_list_maint()
  * to quickly find objects that are ready to send an RPC. */
@@ -1675,6 +1903,12 @@ static int osc_makes_rpc(struct client_obd *cli, struct osc_object *osc,
 		 * waiting for space.  as they're waiting, they're not going to
 		 * create more pages to coalesce with what's waiting.. */
 		if (!cfs_list_empty(&cli->cl_cache_waiters)) {
+			if (osc_write_gather(cli, osc)) {
+				CDEBUG(D_CACHE, "gathering %d pages\n",
+				       cfs_atomic_read(&osc->oo_nr_writes));
+				osc->oo_write_gathered = 1;
+				RETURN(0);
+			}
 			CDEBUG(D_CACHE, "cache waiters forcing RPC\n");
 			RETURN(1);
 		}
@@ -1700,7 +1934,9 @@ static void osc_update_pending(struct osc_object *obj, int cmd, int delta)
 {
 	struct client_obd *cli = osc_cli(obj);
 	if (cmd & OBD_BRW_WRITE) {
-		cfs_atomic_add(delta, &obj->oo_nr_writes);
+		if (cfs_atomic_add_return(delta, &obj->oo_nr_writes) == delta &&
+		    delta > 0)
+			obj->oo_write_start = cfs_time_current();
 		cfs_atomic_add(delta, &cli->cl_pending_w_pages);
 		LASSERT(cfs_atomic_read(&obj->oo_nr_writes) >= 0);
 	} else {
@@ -2045,6 +2281,11 @@ osc_send_write_rpc(const struct lu_env *env, struct client_obd *cli,
 		RETURN(0);
 
 	osc_update_pending(osc, OBD_BRW_WRITE, -page_count);
+	if (osc->oo_write_gathered) {
+		osc->oo_write_gathered = 0;
+		cfs_atomic_inc(&cli->cl_write_gathered_rpcs);
+		cfs_atomic_add(page_count, &cli->cl_write_gathered_pages);
+	}
 
 	cfs_list_for_each_entry(ext, &rpclist, oe_link) {
 		LASSERT(ext->oe_state == OES_CACHE ||
@@ -2144,6 +2385,7 @@ osc_send_read_rpc(const struct lu_env *env, struct client_obd *cli,
  * we could be sending.  These lists are maintained by osc_makes_rpc(). */
 static struct osc_object *osc_next_obj(struct client_obd *cli)
 {
+	struct osc_object *osc;
 	ENTRY;
 
 	/* First return objects that have blocked locks so that they
@@ -2158,9 +2400,16 @@ static struct osc_object *osc_next_obj(struct client_obd *cli)
 	 * writes.  This is especially important when many small files
 	 * have filled up the cache and not been fired into rpcs because
 	 * they don't pass the nr_pending/object threshhold */
-	if (!cfs_list_empty(&cli->cl_cache_waiters) &&
-	    !cfs_list_empty(&cli->cl_loi_write_list))
-		RETURN(list_to_obj(&cli->cl_loi_write_list, write_item));
+	if (!cfs_list_empty(&cli->cl_cache_waiters)) {
+		/* skip the objects held back by write gathering, they stay
+		 * on the list and osc_makes_rpc() would not send them */
+		cfs_list_for_each_entry(osc, &cli->cl_loi_write_list,
+					oo_write_item)
+			if (!osc_write_gather(cli, osc)) {
+				cfs_list_del_init(&osc->oo_write_item);
+				RETURN(osc);
+			}
+	}
 
 	/* then return all queued objects when we have an invalid import
 	 * so that they get flushed */
@@ -2397,9 +2646,7 @@ int osc_queue_async_io(const struct lu_env *env, struct cl_io *io,
 			grants = 0;
 
 		/* it doesn't need any grant to dirty this page */
-		client_obd_list_lock(&cli->cl_loi_list_lock);
-		rc = osc_enter_cache_try(cli, oap, grants, 0);
-		client_obd_list_unlock(&cli->cl_loi_list_lock);
+		rc = osc_grant_cache_enter(cli, oap, grants);
 		if (rc == 0) { /* try failed */
 			grants = 0;
 			need_release = 1;
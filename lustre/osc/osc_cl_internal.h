@@ -172,6 +172,10 @@ struct osc_object {
 
 	cfs_atomic_t	 oo_nr_reads;
 	cfs_atomic_t	 oo_nr_writes;
+	/** when oo_nr_writes last became non-zero, for write gathering */
+	cfs_time_t	 oo_write_start;
+	/** the pending writes were held back by write gathering */
+	int		 oo_write_gathered;
 
 	/** Protect extent tree. Will be used to protect
 	 * oo_{read|write}_pages soon. */
@@ -91,12 +91,33 @@ struct osc_cache_waiter {
 	int                     ocw_rc;
 };
 
+/**
+ * Write credits cached for one CPU partition. Grant is moved here from
+ * cl_avail_grant and dirty pages are charged to cl_dirty and obd_dirty_pages
+ * when the cache is refilled, so the sums over all partitions must be added
+ * back whenever the client totals are reported to the OST.
+ */
+struct osc_grant_cache {
+	spinlock_t		ogc_lock;
+	/* bytes of grant free for reservation */
+	long			ogc_grant;
+	/* bytes reserved from this cache, or unreserved into it; may be
+	 * negative if the reservation was made on another partition */
+	long			ogc_reserved;
+	/* pages already accounted as dirty but not used yet */
+	long			ogc_dirty;
+};
+
 int osc_create(const struct lu_env *env, struct obd_export *exp,
                struct obdo *oa, struct lov_stripe_md **ea,
                struct obd_trans_info *oti);
 int osc_real_create(struct obd_export *exp, struct obdo *oa,
                     struct lov_stripe_md **ea, struct obd_trans_info *oti);
 void osc_wake_cache_waiters(struct client_obd *cli);
+int osc_grant_cache_setup(struct client_obd *cli);
+void osc_grant_cache_cleanup(struct client_obd *cli);
+void osc_grant_cache_drain(struct client_obd *cli);
+void osc_grant_cache_sum(struct client_obd *cli, long *grant, long *dirty);
 int osc_shrink_grant_to_target(struct client_obd *cli, __u64 target_bytes);
 void osc_update_next_shrink(struct client_obd *cli);
 
@@ -97,6 +97,8 @@ static int osc_object_init(const struct lu_env *env, struct lu_object *obj,
 	CFS_INIT_LIST_HEAD(&osc->oo_reading_exts);
 	cfs_atomic_set(&osc->oo_nr_reads, 0);
 	cfs_atomic_set(&osc->oo_nr_writes, 0);
+	osc->oo_write_start = 0;
+	osc->oo_write_gathered = 0;
 	spin_lock_init(&osc->oo_lock);
 	spin_lock_init(&osc->oo_tree_lock);
 
@@ -827,16 +827,22 @@ static void osc_announce_cached(struct client_obd *cli, struct obdo *oa,
                                 long writing_bytes)
 {
         obd_flag bits = OBD_MD_FLBLOCKS|OBD_MD_FLGRANT;
+	long cached_grant;
+	long cached_dirty;
+	long dirty;
 
         LASSERT(!(oa->o_valid & bits));
 
         oa->o_valid |= bits;
         client_obd_list_lock(&cli->cl_loi_list_lock);
-        oa->o_dirty = cli->cl_dirty;
-	if (unlikely(cli->cl_dirty - cli->cl_dirty_transit >
-		     cli->cl_dirty_max)) {
+	/* the OST must see what is really dirty and all grant we hold,
+	 * including credits sitting in the per-CPT caches */
+	osc_grant_cache_sum(cli, &cached_grant, &cached_dirty);
+	dirty = cli->cl_dirty - cached_dirty;
+	oa->o_dirty = dirty;
+	if (unlikely(dirty - cli->cl_dirty_transit > cli->cl_dirty_max)) {
 		CERROR("dirty %lu - %lu > dirty_max %lu\n",
-		       cli->cl_dirty, cli->cl_dirty_transit, cli->cl_dirty_max);
+		       dirty, cli->cl_dirty_transit, cli->cl_dirty_max);
 		oa->o_undirty = 0;
 	} else if (unlikely(cfs_atomic_read(&obd_unstable_pages) +
 			    cfs_atomic_read(&obd_dirty_pages) -
@@ -852,9 +858,9 @@ static void osc_announce_cached(struct client_obd *cli, struct obdo *oa,
 		       cfs_atomic_read(&obd_dirty_transit_pages),
 		       obd_max_dirty_pages);
 		oa->o_undirty = 0;
-	} else if (unlikely(cli->cl_dirty_max - cli->cl_dirty > 0x7fffffff)) {
+	} else if (unlikely(cli->cl_dirty_max - dirty > 0x7fffffff)) {
 		CERROR("dirty %lu - dirty_max %lu too big???\n",
-		       cli->cl_dirty, cli->cl_dirty_max);
+		       dirty, cli->cl_dirty_max);
 		oa->o_undirty = 0;
 	} else {
 		long max_in_flight = (cli->cl_max_pages_per_rpc <<
@@ -862,7 +868,8 @@ static void osc_announce_cached(struct client_obd *cli, struct obdo *oa,
 				     (cli->cl_max_rpcs_in_flight + 1);
                 oa->o_undirty = max(cli->cl_dirty_max, max_in_flight);
         }
-	oa->o_grant = cli->cl_avail_grant + cli->cl_reserved_grant;
+	oa->o_grant = cli->cl_avail_grant + cli->cl_reserved_grant +
+		      cached_grant;
         oa->o_dropped = cli->cl_lost_grant;
         cli->cl_lost_grant = 0;
         client_obd_list_unlock(&cli->cl_loi_list_lock);
@@ -922,6 +929,7 @@ out:
 static void osc_shrink_grant_local(struct client_obd *cli, struct obdo *oa)
 {
         client_obd_list_lock(&cli->cl_loi_list_lock);
+	osc_grant_cache_drain(cli);
         oa->o_grant = cli->cl_avail_grant / 4;
         cli->cl_avail_grant -= oa->o_grant;
         client_obd_list_unlock(&cli->cl_loi_list_lock);
@@ -943,6 +951,7 @@ static int osc_shrink_grant(struct client_obd *cli)
 			     (cli->cl_max_pages_per_rpc << PAGE_CACHE_SHIFT);
 
 	client_obd_list_lock(&cli->cl_loi_list_lock);
+	osc_grant_cache_drain(cli);
 	if (cli->cl_avail_grant <= target_bytes)
 		target_bytes = cli->cl_max_pages_per_rpc << PAGE_CACHE_SHIFT;
 	client_obd_list_unlock(&cli->cl_loi_list_lock);
@@ -957,6 +966,7 @@ int osc_shrink_grant_to_target(struct client_obd *cli, __u64 target_bytes)
 	ENTRY;
 
 	client_obd_list_lock(&cli->cl_loi_list_lock);
+	osc_grant_cache_drain(cli);
 	/* Don't shrink if we are already above or below the desired limit
 	 * We don't want to shrink below a single RPC, as that will negatively
 	 * impact block allocation and long-term performance. */
@@ -1067,6 +1077,7 @@ static void osc_init_grant(struct client_obd *cli, struct obd_connect_data *ocd)
          * left EVICTED state, then cl_dirty must be 0 already.
          */
         client_obd_list_lock(&cli->cl_loi_list_lock);
+	osc_grant_cache_drain(cli);
         if (cli->cl_import->imp_state == LUSTRE_IMP_EVICTED)
                 cli->cl_avail_grant = ocd->ocd_grant;
         else
@@ -3354,6 +3365,7 @@ static int osc_reconnect(const struct lu_env *env,
                 long lost_grant;
 
                 client_obd_list_lock(&cli->cl_loi_list_lock);
+		osc_grant_cache_drain(cli);
                 data->ocd_grant = (cli->cl_avail_grant + cli->cl_dirty) ?:
 				2 * cli_brw_size(obd);
                 lost_grant = cli->cl_lost_grant;
@@ -3424,6 +3436,7 @@ static int osc_import_event(struct obd_device *obd,
         case IMP_EVENT_DISCON: {
                 cli = &obd->u.cli;
                 client_obd_list_lock(&cli->cl_loi_list_lock);
+		osc_grant_cache_drain(cli);
                 cli->cl_avail_grant = 0;
                 cli->cl_lost_grant = 0;
                 client_obd_list_unlock(&cli->cl_loi_list_lock);
@@ -3542,6 +3555,10 @@ int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 		GOTO(out_ptlrpcd_work, rc = PTR_ERR(handler));
 	cli->cl_lru_work = handler;
 
+	rc = osc_grant_cache_setup(cli);
+	if (rc)
+		GOTO(out_ptlrpcd_work, rc);
+
 	rc = osc_quota_setup(obd);
 	if (rc)
 		GOTO(out_ptlrpcd_work, rc);
@@ -3571,6 +3588,7 @@ int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 	RETURN(rc);
 
 out_ptlrpcd_work:
+	osc_grant_cache_cleanup(cli);
 	if (cli->cl_writeback_work != NULL) {
 		ptlrpcd_destroy_work(cli->cl_writeback_work);
 		cli->cl_writeback_work = NULL;
@@ -3655,6 +3673,7 @@ int osc_cleanup(struct obd_device *obd)
 
         /* free memory of osc quota cache */
         osc_quota_cleanup(obd);
+	osc_grant_cache_cleanup(cli);
 
         rc = client_obd_cleanup(obd);
 
@@ -128,6 +128,11 @@ static const struct req_msg_field *quota_body_only[] = {
 	&RMF_QUOTA_BODY
 };
 
+static const struct req_msg_field *quota_batch_only[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_QUOTA_BATCH
+};
+
 static const struct req_msg_field *ldlm_intent_quota_client[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_DLM_REQ,
@@ -783,6 +788,7 @@ static struct req_format *req_formats[] = {
 	&RQF_LDLM_INTENT_GETXATTR,
 	&RQF_LDLM_INTENT_QUOTA,
 	&RQF_QUOTA_DQACQ,
+	&RQF_QUOTA_DQACQ_BATCH,
         &RQF_LOG_CANCEL,
         &RQF_LLOG_ORIGIN_HANDLE_CREATE,
         &RQF_LLOG_ORIGIN_HANDLE_DESTROY,
@@ -926,6 +932,11 @@ struct req_msg_field RMF_QUOTA_BODY =
 		    sizeof(struct quota_body), lustre_swab_quota_body, NULL);
 EXPORT_SYMBOL(RMF_QUOTA_BODY);
 
+struct req_msg_field RMF_QUOTA_BATCH =
+	DEFINE_MSGF("quota_batch", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct quota_body), lustre_swab_quota_body, NULL);
+EXPORT_SYMBOL(RMF_QUOTA_BATCH);
+
 struct req_msg_field RMF_MDT_EPOCH =
         DEFINE_MSGF("mdt_ioepoch", 0,
                     sizeof(struct mdt_ioepoch), lustre_swab_mdt_ioepoch, NULL);
@@ -1294,6 +1305,11 @@ struct req_format RQF_QUOTA_DQACQ =
 	DEFINE_REQ_FMT0("QUOTA_DQACQ", quota_body_only, quota_body_only);
 EXPORT_SYMBOL(RQF_QUOTA_DQACQ);
 
+struct req_format RQF_QUOTA_DQACQ_BATCH =
+	DEFINE_REQ_FMT0("QUOTA_DQACQ_BATCH", quota_batch_only,
+			quota_batch_only);
+EXPORT_SYMBOL(RQF_QUOTA_DQACQ_BATCH);
+
 struct req_format RQF_LDLM_INTENT_QUOTA =
 	DEFINE_REQ_FMT0("LDLM_INTENT_QUOTA",
 			ldlm_intent_quota_client,
@@ -131,6 +131,7 @@ struct ll_rpc_opcode {
         { LLOG_ORIGIN_HANDLE_DESTROY,    "llog_origin_handle_destroy" },
         { QUOTA_DQACQ,      "quota_acquire" },
         { QUOTA_DQREL,      "quota_release" },
+	{ QUOTA_DQACQ_BATCH, "quota_acquire_batch" },
         { SEQ_QUERY,        "seq_query" },
         { SEC_CTX_INIT,     "sec_ctx_init" },
         { SEC_CTX_INIT_CONT,"sec_ctx_init_cont" },
@@ -179,6 +180,18 @@ const char *ll_opcode2str(__u32 opcode)
         return ll_rpc_opcode_table[offset].opname;
 }
 
+/**
+ * Returns the opcode whose statistics are kept at index \a offset, as
+ * returned by opcode_offset().
+ */
+__u32 ll_opcode_offset2opcode(__u32 offset)
+{
+	LASSERTF(offset < LUSTRE_MAX_OPCODES,
+		 "offset %u >= LUSTRE_MAX_OPCODES %u\n",
+		 offset, LUSTRE_MAX_OPCODES);
+	return ll_rpc_opcode_table[offset].opcode;
+}
+
 const char* ll_eopcode2str(__u32 opcode)
 {
         LASSERT(ll_eopcode_table[opcode].opcode == opcode);
@@ -415,6 +428,93 @@ ptlrpc_lprocfs_threads_max_seq_write(struct file *file, const char *buffer,
 }
 LPROC_SEQ_FOPS(ptlrpc_lprocfs_threads_max);
 
+static int
+ptlrpc_lprocfs_threads_idle_timeout_seq_show(struct seq_file *m, void *n)
+{
+	struct ptlrpc_service *svc = m->private;
+
+	return seq_printf(m, "%d\n", svc->srv_thr_idle_timeout);
+}
+
+static ssize_t
+ptlrpc_lprocfs_threads_idle_timeout_seq_write(struct file *file,
+					      const char *buffer,
+					      size_t count, loff_t *off)
+{
+	struct seq_file		*m = file->private_data;
+	struct ptlrpc_service	*svc = m->private;
+	int	val;
+	int	rc = lprocfs_write_helper(buffer, count, &val);
+
+	if (rc < 0)
+		return rc;
+
+	/* 0 keeps every thread that was ever started */
+	if (val < 0)
+		return -ERANGE;
+
+	spin_lock(&svc->srv_lock);
+	svc->srv_thr_idle_timeout = val;
+	spin_unlock(&svc->srv_lock);
+
+	return count;
+}
+LPROC_SEQ_FOPS(ptlrpc_lprocfs_threads_idle_timeout);
+
+#define pct(a, b) (b ? a * 100 / b : 0)
+
+/**
+ * For each partition, how busy its threads were when a request was taken
+ * for handling: the share of running threads serving requests, including
+ * the new one, in 10% steps. Mostly 100% means requests queue for threads,
+ * mostly low values mean threads sit idle. Writing anything clears it.
+ */
+static int
+ptlrpc_lprocfs_threads_util_seq_show(struct seq_file *m, void *n)
+{
+	struct ptlrpc_service		*svc = m->private;
+	struct ptlrpc_service_part	*svcpt;
+	unsigned long			 total;
+	unsigned long			 cum;
+	unsigned long			 cnt;
+	int				 i;
+	int				 j;
+
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		seq_printf(m, "partition %d: %d threads running, "
+			   "last queue wait %ld usec\n", i,
+			   svcpt->scp_nthrs_running, svcpt->scp_thr_wait);
+		seq_printf(m, "busy threads      reqs   %% cum %%\n");
+
+		total = lprocfs_oh_sum(&svcpt->scp_thr_util);
+		cum = 0;
+		for (j = 0; j <= 10; j++) {
+			cnt = svcpt->scp_thr_util.oh_buckets[j];
+			cum += cnt;
+			seq_printf(m, "%3d%%:\t   %10lu %3lu %3lu\n", j * 10,
+				   cnt, pct(cnt, total), pct(cum, total));
+		}
+	}
+
+	return 0;
+}
+
+static ssize_t
+ptlrpc_lprocfs_threads_util_seq_write(struct file *file, const char *buffer,
+				      size_t count, loff_t *off)
+{
+	struct seq_file			*m = file->private_data;
+	struct ptlrpc_service		*svc = m->private;
+	struct ptlrpc_service_part	*svcpt;
+	int				 i;
+
+	ptlrpc_service_for_each_part(svcpt, i, svc)
+		lprocfs_oh_clear(&svcpt->scp_thr_util);
+
+	return count;
+}
+LPROC_SEQ_FOPS(ptlrpc_lprocfs_threads_util);
+
 /**
  * \addtogoup nrs
  * @{
@@ -626,16 +726,18 @@ out:
 
 /**
  * The longest valid command string is the maxium policy name size, plus the
- * length of the " reg" substring
+ * maximum policy argument size, plus the length of the " reg" substring
  */
-#define LPROCFS_NRS_WR_MAX_CMD	(NRS_POL_NAME_MAX + sizeof(" reg") - 1)
+#define LPROCFS_NRS_WR_MAX_CMD	(NRS_POL_NAME_MAX + NRS_POL_ARG_MAX + \
+				 sizeof(" reg") - 1)
 
 /**
  * Starts and stops a given policy on a PTLRPC service.
  *
- * Commands consist of the policy name, followed by an optional [reg|hp] token;
- * if the optional token is omitted, the operation is performed on both the
- * regular and high-priority (if the service has one) NRS head.
+ * Commands consist of the policy name, followed by an optional policy-specific
+ * argument (e.g. "tbf jobid"), followed by an optional [reg|hp] token; if the
+ * latter is omitted, the operation is performed on both the regular and
+ * high-priority (if the service has one) NRS head.
  */
 static ssize_t
 ptlrpc_lprocfs_nrs_seq_write(struct file *file, const char *buffer,
@@ -647,6 +749,7 @@ ptlrpc_lprocfs_nrs_seq_write(struct file *file, const char *buffer,
 	char			       *cmd;
 	char			       *cmd_copy = NULL;
 	char			       *token;
+	char			       *arg = NULL;
 	int				rc = 0;
 	ENTRY;
 
@@ -672,14 +775,24 @@ ptlrpc_lprocfs_nrs_seq_write(struct file *file, const char *buffer,
 		GOTO(out, rc = -EINVAL);
 
 	/**
-	 * No [reg|hp] token has been specified
+	 * No argument or [reg|hp] token has been specified
 	 */
 	if (cmd == NULL)
 		goto default_queue;
 
 	/**
-	 * The second token is either NULL, or an optional [reg|hp] string
+	 * The second token is either an optional [reg|hp] string, or a
+	 * policy-specific argument, which may be followed by a [reg|hp] string.
 	 */
+	if (strcmp(cmd, "reg") != 0 && strcmp(cmd, "hp") != 0) {
+		arg = strsep(&cmd, " ");
+		if (strlen(arg) > NRS_POL_ARG_MAX - 1)
+			GOTO(out, rc = -EINVAL);
+
+		if (cmd == NULL)
+			goto default_queue;
+	}
+
 	if (strcmp(cmd, "reg") == 0)
 		queue = PTLRPC_NRS_QUEUE_REG;
 	else if (strcmp(cmd, "hp") == 0)
@@ -701,7 +814,7 @@ default_queue:
 	mutex_lock(&nrs_core.nrs_mutex);
 
 	rc = ptlrpc_nrs_policy_control(svc, queue, token, PTLRPC_NRS_CTL_START,
-				       false, NULL);
+				       false, arg);
 
 	mutex_unlock(&nrs_core.nrs_mutex);
 out:
@@ -1069,6 +1182,12 @@ void ptlrpc_lprocfs_register_service(struct proc_dir_entry *entry,
 		{ .name = "threads_started",
 		  .fops = &ptlrpc_lprocfs_threads_started_fops,
 		  .data = svc },
+		{ .name = "threads_idle_timeout",
+		  .fops = &ptlrpc_lprocfs_threads_idle_timeout_fops,
+		  .data = svc },
+		{ .name = "threads_utilisation",
+		  .fops = &ptlrpc_lprocfs_threads_util_fops,
+		  .data = svc },
 		{ .name = "timeouts",
 		  .fops = &ptlrpc_lprocfs_timeouts_fops,
 		  .data = svc },
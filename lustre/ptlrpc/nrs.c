@@ -199,8 +199,13 @@ static void nrs_policy_stop_primary(struct ptlrpc_nrs *nrs)
  * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPING, and if there are no outstanding
  * references on the policy to ptlrpc_nrs_pol_stae::NRS_POL_STATE_STOPPED. In
  * this case, the fallback policy is only left active in the NRS head.
+ *
+ * \param[in] policy the policy to start
+ * \param[in] arg    optional policy-specific argument, passed on to
+ *		     ptlrpc_nrs_pol_ops::op_policy_start(); may be NULL
  */
-static int nrs_policy_start_locked(struct ptlrpc_nrs_policy *policy)
+static int nrs_policy_start_locked(struct ptlrpc_nrs_policy *policy,
+				   char *arg)
 {
 	struct ptlrpc_nrs      *nrs = policy->pol_nrs;
 	int			rc = 0;
@@ -244,8 +249,13 @@ static int nrs_policy_start_locked(struct ptlrpc_nrs_policy *policy)
 		if (nrs->nrs_policy_fallback == NULL)
 			RETURN(-EPERM);
 
+		/**
+		 * An argument is only consumed when the policy starts; don't
+		 * let the user believe it has been applied to a running
+		 * instance, the policy needs to be restarted for that.
+		 */
 		if (policy->pol_state == NRS_POL_STATE_STARTED)
-			RETURN(0);
+			RETURN(arg == NULL ? 0 : -EALREADY);
 	}
 
 	/**
@@ -270,7 +280,7 @@ static int nrs_policy_start_locked(struct ptlrpc_nrs_policy *policy)
 	if (policy->pol_desc->pd_ops->op_policy_start) {
 		spin_unlock(&nrs->nrs_lock);
 
-		rc = policy->pol_desc->pd_ops->op_policy_start(policy);
+		rc = policy->pol_desc->pd_ops->op_policy_start(policy, arg);
 
 		spin_lock(&nrs->nrs_lock);
 		if (rc != 0) {
@@ -666,7 +676,7 @@ static int nrs_policy_ctl(struct ptlrpc_nrs *nrs, char *name,
 		 * Start \e policy
 		 */
 	case PTLRPC_NRS_CTL_START:
-		rc = nrs_policy_start_locked(policy);
+		rc = nrs_policy_start_locked(policy, arg);
 		break;
 	}
 out:
@@ -801,7 +811,7 @@ static int nrs_policy_register(struct ptlrpc_nrs *nrs,
 	nrs->nrs_num_pols++;
 
 	if (policy->pol_flags & PTLRPC_NRS_FL_REG_START)
-		rc = nrs_policy_start_locked(policy);
+		rc = nrs_policy_start_locked(policy, NULL);
 
 	spin_unlock(&nrs->nrs_lock);
 
@@ -1624,6 +1634,27 @@ bool ptlrpc_nrs_req_pending_nolock(struct ptlrpc_service_part *svcpt, bool hp)
 	return nrs->nrs_req_queued > 0;
 };
 
+/**
+ * Returns whether the primary policy of service partition's \a svcpt NRS head
+ * specified by \a hp is currently holding back its queued requests, e.g. for
+ * rate limiting purposes. Service threads should not try to obtain requests
+ * from the head until the policy wakes them up again.
+ *
+ * \param[in] svcpt the service partition to enquire.
+ * \param[in] hp    whether the regular or high-priority NRS head is to be
+ *		    enquired.
+ *
+ * \retval false the indicated NRS head is not throttling requests.
+ * \retval true	 the indicated NRS head is throttling requests.
+ */
+bool ptlrpc_nrs_req_throttling_nolock(struct ptlrpc_service_part *svcpt,
+				      bool hp)
+{
+	struct ptlrpc_nrs *nrs = nrs_svcpt2nrs(svcpt, hp);
+
+	return nrs->nrs_throttling != 0;
+};
+
 /**
  * Moves request \a req from the regular to the high-priority NRS head.
  *
@@ -1745,6 +1776,10 @@ extern struct ptlrpc_nrs_pol_conf nrs_conf_crrn;
 /* ptlrpc/nrs_orr.c */
 extern struct ptlrpc_nrs_pol_conf nrs_conf_orr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_trr;
+/* ptlrpc/nrs_tbf.c */
+extern struct ptlrpc_nrs_pol_conf nrs_conf_tbf;
+/* ptlrpc/nrs_edf.c */
+extern struct ptlrpc_nrs_pol_conf nrs_conf_edf;
 #endif
 
 /**
@@ -1778,6 +1813,14 @@ int ptlrpc_nrs_init(void)
 	rc = ptlrpc_nrs_policy_register(&nrs_conf_trr);
 	if (rc != 0)
 		GOTO(fail, rc);
+
+	rc = ptlrpc_nrs_policy_register(&nrs_conf_tbf);
+	if (rc != 0)
+		GOTO(fail, rc);
+
+	rc = ptlrpc_nrs_policy_register(&nrs_conf_edf);
+	if (rc != 0)
+		GOTO(fail, rc);
 #endif
 
 	RETURN(rc);
@@ -177,11 +177,12 @@ static cfs_hash_ops_t nrs_crrn_hash_ops = {
  * Called when a CRR-N policy instance is started.
  *
  * \param[in] policy the policy
+ * \param[in] arg    unused
  *
  * \retval -ENOMEM OOM error
  * \retval 0	   success
  */
-static int nrs_crrn_start(struct ptlrpc_nrs_policy *policy)
+static int nrs_crrn_start(struct ptlrpc_nrs_policy *policy, char *arg)
 {
 	struct nrs_crrn_net    *net;
 	int			rc = 0;
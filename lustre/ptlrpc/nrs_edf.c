@@ -0,0 +1,1127 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.  A copy is
+ * included in the COPYING file that accompanied this code.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * GPL HEADER END
+ */
+/*
+ * Copyright (c) 2013, Intel Corporation.
+ */
+/*
+ * lustre/ptlrpc/nrs_edf.c
+ *
+ * Network Request Scheduler (NRS) EDF policy
+ *
+ * Earliest Deadline First request ordering for metadata services, bounded by
+ * a fairness window
+ */
+/**
+ * \addtogoup nrs
+ * @{
+ */
+#ifdef HAVE_SERVER_SUPPORT
+
+#define DEBUG_SUBSYSTEM S_RPC
+#ifndef __KERNEL__
+#include <liblustre.h>
+#endif
+#include <obd_support.h>
+#include <obd_class.h>
+#include <lustre_net.h>
+#include <lprocfs_status.h>
+#include <libcfs/libcfs.h>
+#include "ptlrpc_internal.h"
+
+/**
+ * \name EDF policy
+ *
+ * Earliest Deadline First scheduling of metadata requests
+ *
+ * The deadline of every request is its arrival time plus the time budget of
+ * its opcode, and the policy serves the request with the earliest deadline
+ * first. The budget of an opcode is a moving average of the time it has taken
+ * to handle its requests, unless one has been set through nrs_edf_budget.
+ * Cheap requests (e.g. getattr, statfs) thus overtake long queues of heavier
+ * ones, such as the creates of a metadata benchmark. Opcodes which have not
+ * been seen yet fall back to the service time the client expects, as
+ * estimated by Adaptive Timeouts.
+ *
+ * As long deadlines could otherwise be postponed indefinitely, requests that
+ * have been queued for longer than a fairness window are served in arrival
+ * order, ahead of all other requests.
+ *
+ * @{
+ */
+
+#define NRS_POL_NAME_EDF	"edf"
+
+/**
+ * Default and maximum fairness window, in milliseconds
+ */
+#define NRS_EDF_WINDOW_DEF	1000
+#define NRS_EDF_WINDOW_MAX	60000
+
+/**
+ * Maximum opcode budget, in microseconds
+ */
+#define NRS_EDF_BUDGET_MAX	(600 * ONE_MILLION)
+
+/**
+ * The service time estimate of an opcode moves by 1/2^NRS_EDF_EST_SHIFT of
+ * the difference with every new sample.
+ */
+#define NRS_EDF_EST_SHIFT	3
+
+#define NRS_LPROCFS_WINDOW_NAME_REG	"reg_window:"
+#define NRS_LPROCFS_WINDOW_NAME_HP	"hp_window:"
+
+#define LPROCFS_NRS_WR_WINDOW_MAX_CMD					       \
+	sizeof(NRS_LPROCFS_WINDOW_NAME_REG __stringify(NRS_EDF_WINDOW_MAX) " " \
+	       NRS_LPROCFS_WINDOW_NAME_HP __stringify(NRS_EDF_WINDOW_MAX))
+
+static inline __u64 nrs_edf_tv2usec(struct timeval *tv)
+{
+	return (__u64)tv->tv_sec * ONE_MILLION + tv->tv_usec;
+}
+
+static inline __u64 nrs_edf_now(void)
+{
+	struct timeval tv;
+
+	do_gettimeofday(&tv);
+	return nrs_edf_tv2usec(&tv);
+}
+
+/**
+ * Binary heap predicate.
+ *
+ * Sorts requests by deadline, and requests with the same deadline in arrival
+ * order.
+ *
+ * \param[in] e1 the first binheap node to compare
+ * \param[in] e2 the second binheap node to compare
+ *
+ * \retval 0 e1 > e2
+ * \retval 1 e1 <= e2
+ */
+static int edf_req_compare(cfs_binheap_node_t *e1, cfs_binheap_node_t *e2)
+{
+	struct ptlrpc_nrs_request *nrq1;
+	struct ptlrpc_nrs_request *nrq2;
+
+	nrq1 = container_of(e1, struct ptlrpc_nrs_request, nr_u.edf.er_node);
+	nrq2 = container_of(e2, struct ptlrpc_nrs_request, nr_u.edf.er_node);
+
+	if (nrq1->nr_u.edf.er_deadline != nrq2->nr_u.edf.er_deadline)
+		return nrq1->nr_u.edf.er_deadline < nrq2->nr_u.edf.er_deadline;
+
+	return nrq1->nr_u.edf.er_sequence < nrq2->nr_u.edf.er_sequence;
+}
+
+static cfs_binheap_ops_t nrs_edf_heap_ops = {
+	.hop_enter	= NULL,
+	.hop_exit	= NULL,
+	.hop_compare	= edf_req_compare,
+};
+
+/**
+ * The EDF policy is only compatible with the metadata services of the MDT,
+ * i.e. "mdt", "mdt_readpage" and "mdt_setattr".
+ */
+static bool nrs_edf_compat(const struct ptlrpc_service *svc,
+			   const struct ptlrpc_nrs_pol_desc *desc)
+{
+	return strcmp(svc->srv_name, LUSTRE_MDT_NAME) == 0 ||
+	       strcmp(svc->srv_name, LUSTRE_MDT_NAME "_readpage") == 0 ||
+	       strcmp(svc->srv_name, LUSTRE_MDT_NAME "_setattr") == 0;
+}
+
+/**
+ * Is called before the policy transitions into
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STARTED; allocates and initializes a
+ * policy-specific private data structure.
+ *
+ * \param[in] policy the policy to start
+ * \param[in] arg    unused
+ *
+ * \retval -ENOMEM OOM error
+ * \retval  0	   success
+ *
+ * \see nrs_policy_register()
+ * \see nrs_policy_ctl()
+ */
+static int nrs_edf_start(struct ptlrpc_nrs_policy *policy, char *arg)
+{
+	struct nrs_edf_head	*head;
+	int			 i;
+	int			 rc = 0;
+	ENTRY;
+
+	OBD_CPT_ALLOC_PTR(head, nrs_pol2cptab(policy), nrs_pol2cptid(policy));
+	if (head == NULL)
+		RETURN(-ENOMEM);
+
+	OBD_CPT_ALLOC_LARGE(head->eh_wait_hist, nrs_pol2cptab(policy),
+			    nrs_pol2cptid(policy),
+			    LUSTRE_MAX_OPCODES * sizeof(*head->eh_wait_hist));
+	if (head->eh_wait_hist == NULL)
+		GOTO(failed, rc = -ENOMEM);
+
+	for (i = 0; i < LUSTRE_MAX_OPCODES; i++)
+		spin_lock_init(&head->eh_wait_hist[i].oh_lock);
+
+	OBD_CPT_ALLOC_LARGE(head->eh_opc_time, nrs_pol2cptab(policy),
+			    nrs_pol2cptid(policy),
+			    LUSTRE_MAX_OPCODES * sizeof(*head->eh_opc_time));
+	if (head->eh_opc_time == NULL)
+		GOTO(failed, rc = -ENOMEM);
+
+	head->eh_binheap = cfs_binheap_create(&nrs_edf_heap_ops,
+					      CBH_FLAG_ATOMIC_GROW, 4096, NULL,
+					      nrs_pol2cptab(policy),
+					      nrs_pol2cptid(policy));
+	if (head->eh_binheap == NULL)
+		GOTO(failed, rc = -ENOMEM);
+
+	CFS_INIT_LIST_HEAD(&head->eh_list);
+	head->eh_window = NRS_EDF_WINDOW_DEF;
+	policy->pol_private = head;
+
+	RETURN(rc);
+
+failed:
+	if (head->eh_opc_time != NULL)
+		OBD_FREE_LARGE(head->eh_opc_time,
+			       LUSTRE_MAX_OPCODES *
+			       sizeof(*head->eh_opc_time));
+	if (head->eh_wait_hist != NULL)
+		OBD_FREE_LARGE(head->eh_wait_hist,
+			       LUSTRE_MAX_OPCODES *
+			       sizeof(*head->eh_wait_hist));
+	OBD_FREE_PTR(head);
+
+	RETURN(rc);
+}
+
+/**
+ * Is called before the policy transitions into
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED; deallocates the policy-specific
+ * private data structure.
+ *
+ * \param[in] policy the policy to stop
+ *
+ * \see nrs_policy_stop0()
+ */
+static void nrs_edf_stop(struct ptlrpc_nrs_policy *policy)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+
+	LASSERT(head != NULL);
+	LASSERT(head->eh_binheap != NULL);
+	LASSERT(cfs_binheap_is_empty(head->eh_binheap));
+	LASSERT(cfs_list_empty(&head->eh_list));
+
+	cfs_binheap_destroy(head->eh_binheap);
+	OBD_FREE_LARGE(head->eh_opc_time,
+		       LUSTRE_MAX_OPCODES * sizeof(*head->eh_opc_time));
+	OBD_FREE_LARGE(head->eh_wait_hist,
+		       LUSTRE_MAX_OPCODES * sizeof(*head->eh_wait_hist));
+	OBD_FREE_PTR(head);
+}
+
+/**
+ * Performs a policy-specific ctl function on EDF policy instances; similar
+ * to ioctl.
+ *
+ * \param[in]	  policy the policy instance
+ * \param[in]	  opc	 the opcode
+ * \param[in,out] arg	 used for passing parameters and information
+ *
+ * \pre spin_is_locked(&policy->pol_nrs->nrs_lock)
+ * \post spin_is_locked(&policy->pol_nrs->nrs_lock)
+ *
+ * \retval 0   operation carried out successfully
+ * \retval -ve error
+ */
+int nrs_edf_ctl(struct ptlrpc_nrs_policy *policy, enum ptlrpc_nrs_ctl opc,
+		void *arg)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+	int		     i;
+	int		     j;
+
+	LASSERT(spin_is_locked(&policy->pol_nrs->nrs_lock));
+
+	switch ((enum nrs_ctl_edf)opc) {
+	default:
+		RETURN(-EINVAL);
+
+	/**
+	 * Read the fairness window of a policy instance.
+	 */
+	case NRS_CTL_EDF_RD_WINDOW:
+		*(__u32 *)arg = head->eh_window;
+		break;
+
+	/**
+	 * Write the fairness window of a policy instance.
+	 */
+	case NRS_CTL_EDF_WR_WINDOW:
+		head->eh_window = *(__u32 *)arg;
+		break;
+
+	/**
+	 * Add the queue wait histograms of a policy instance to the ones in
+	 * \a arg; histograms may be updated while they are being read.
+	 */
+	case NRS_CTL_EDF_RD_WAIT_HIST: {
+		struct nrs_edf_wait_stats *stats = arg;
+
+		for (i = 0; i < LUSTRE_MAX_OPCODES; i++)
+			for (j = 0; j < OBD_HIST_MAX; j++)
+				stats->ews_buckets[i][j] +=
+					head->eh_wait_hist[i].oh_buckets[j];
+		break;
+	}
+	/**
+	 * Clear the queue wait histograms of a policy instance.
+	 */
+	case NRS_CTL_EDF_CLR_WAIT_HIST:
+		for (i = 0; i < LUSTRE_MAX_OPCODES; i++)
+			lprocfs_oh_clear(&head->eh_wait_hist[i]);
+		break;
+
+	/**
+	 * Read the opcode budgets of a policy instance, keeping the largest
+	 * estimates of the ones already in \a arg.
+	 */
+	case NRS_CTL_EDF_RD_BUDGET: {
+		struct nrs_edf_budget_cmd *cmd = arg;
+
+		for (i = 0; i < LUSTRE_MAX_OPCODES; i++) {
+			cmd->ebc_times[i].eot_budget =
+				head->eh_opc_time[i].eot_budget;
+			cmd->ebc_times[i].eot_estimate =
+				max(cmd->ebc_times[i].eot_estimate,
+				    head->eh_opc_time[i].eot_estimate);
+		}
+		break;
+	}
+	/**
+	 * Set the budget of an opcode of a policy instance.
+	 */
+	case NRS_CTL_EDF_WR_BUDGET: {
+		struct nrs_edf_budget_cmd *cmd = arg;
+
+		LASSERT(cmd->ebc_offset < LUSTRE_MAX_OPCODES);
+		head->eh_opc_time[cmd->ebc_offset].eot_budget =
+			cmd->ebc_budget;
+		break;
+	}
+	}
+
+	RETURN(0);
+}
+
+/**
+ * Is called for obtaining an EDF policy resource.
+ *
+ * \param[in]  policy	  the policy on which the request is being asked for
+ * \param[in]  nrq	  the request for which resources are being taken
+ * \param[in]  parent	  parent resource, unused in this policy
+ * \param[out] resp	  resources references are placed in this array
+ * \param[in]  moving_req signifies limited caller context; unused in this
+ *			  policy
+ *
+ * \retval 1 the EDF policy only has a one-level resource hierarchy, as the
+ *	     priority of requests is determined by their own deadlines alone.
+ *
+ * \see nrs_resource_get_safe()
+ */
+static int nrs_edf_res_get(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq,
+			   const struct ptlrpc_nrs_resource *parent,
+			   struct ptlrpc_nrs_resource **resp, bool moving_req)
+{
+	*resp = &((struct nrs_edf_head *)policy->pol_private)->eh_res;
+	return 1;
+}
+
+/**
+ * Called when getting a request from the EDF policy for handling, or just
+ * peeking; removes the request from the policy when it is to be handled.
+ *
+ * The oldest request is returned if it has been queued for longer than the
+ * fairness window; otherwise, the one with the earliest deadline is.
+ *
+ * \param[in] policy the policy
+ * \param[in] peek   when set, signifies that we just want to examine the
+ *		     request, and not handle it, so the request is not removed
+ *		     from the policy.
+ * \param[in] force  force the policy to return a request; unused in this
+ *		     policy
+ *
+ * \retval the request to be handled
+ * \retval NULL no request available
+ *
+ * \see ptlrpc_nrs_req_get_nolock()
+ * \see nrs_request_get()
+ */
+static
+struct ptlrpc_nrs_request *nrs_edf_req_get(struct ptlrpc_nrs_policy *policy,
+					   bool peek, bool force)
+{
+	struct nrs_edf_head	  *head = policy->pol_private;
+	struct ptlrpc_nrs_request *nrq;
+	struct ptlrpc_request	  *req;
+	cfs_binheap_node_t	  *node;
+	__u64			   now;
+	__u64			   wait;
+	int			   offset;
+
+	if (unlikely(cfs_list_empty(&head->eh_list)))
+		return NULL;
+
+	now = nrs_edf_now();
+	nrq = cfs_list_entry(head->eh_list.next, struct ptlrpc_nrs_request,
+			     nr_u.edf.er_list);
+
+	if (now < nrq->nr_u.edf.er_arrival + head->eh_window * 1000ULL) {
+		node = cfs_binheap_root(head->eh_binheap);
+		LASSERT(node != NULL);
+		nrq = container_of(node, struct ptlrpc_nrs_request,
+				   nr_u.edf.er_node);
+	}
+
+	if (peek)
+		return nrq;
+
+	cfs_binheap_remove(head->eh_binheap, &nrq->nr_u.edf.er_node);
+	cfs_list_del_init(&nrq->nr_u.edf.er_list);
+	nrq->nr_u.edf.er_start = now;
+
+	req = container_of(nrq, struct ptlrpc_request, rq_nrq);
+	offset = opcode_offset(lustre_msg_get_opc(req->rq_reqmsg));
+	if (likely(offset >= 0 && offset < LUSTRE_MAX_OPCODES)) {
+		wait = now > nrq->nr_u.edf.er_arrival ?
+		       now - nrq->nr_u.edf.er_arrival : 0;
+		lprocfs_oh_tally_log2(&head->eh_wait_hist[offset],
+				      (unsigned int)min_t(__u64, wait,
+							  UINT_MAX));
+	}
+
+	CDEBUG(D_RPCTRACE,
+	       "NRS: starting to handle %s request from %s, seq: "LPU64
+	       ", deadline: "LPU64"\n", NRS_POL_NAME_EDF,
+	       libcfs_id2str(req->rq_peer), nrq->nr_u.edf.er_sequence,
+	       nrq->nr_u.edf.er_deadline);
+
+	return nrq;
+}
+
+/**
+ * Works out the time budget of request \a req, in microseconds.
+ *
+ * This is the budget set for its opcode, or else the estimated service time
+ * of its opcode. If neither is known, it is the service time its client
+ * expects, which has been recorded as ptlrpc_request::rq_deadline by
+ * ptlrpc_server_handle_req_in().
+ */
+static __u64 nrs_edf_req_budget(struct nrs_edf_head *head,
+				struct ptlrpc_request *req)
+{
+	struct nrs_edf_opc_time	*time;
+	int			 offset;
+
+	offset = opcode_offset(lustre_msg_get_opc(req->rq_reqmsg));
+	if (likely(offset >= 0 && offset < LUSTRE_MAX_OPCODES)) {
+		time = &head->eh_opc_time[offset];
+		if (time->eot_budget != 0)
+			return time->eot_budget;
+		if (time->eot_estimate != 0)
+			return time->eot_estimate;
+	}
+
+	if (req->rq_deadline <= req->rq_arrival_time.tv_sec)
+		return 0;
+
+	return (__u64)(req->rq_deadline - req->rq_arrival_time.tv_sec) *
+	       ONE_MILLION;
+}
+
+/**
+ * Adds request \a nrq to an EDF \a policy instance's set of queued requests
+ *
+ * The deadline of the request is the time it arrived at, plus the time budget
+ * of its opcode.
+ *
+ * \param[in] policy the policy
+ * \param[in] nrq    the request to add
+ *
+ * \retval 0	request successfully added
+ * \retval != 0 error
+ */
+static int nrs_edf_req_add(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_edf_head	*head;
+	struct ptlrpc_request	*req;
+	int			 rc;
+
+	head = container_of(nrs_request_resource(nrq), struct nrs_edf_head,
+			    eh_res);
+	req = container_of(nrq, struct ptlrpc_request, rq_nrq);
+
+	nrq->nr_u.edf.er_arrival = nrs_edf_tv2usec(&req->rq_arrival_time);
+	nrq->nr_u.edf.er_deadline = nrq->nr_u.edf.er_arrival +
+				    nrs_edf_req_budget(head, req);
+	nrq->nr_u.edf.er_sequence = head->eh_sequence++;
+
+	rc = cfs_binheap_insert(head->eh_binheap, &nrq->nr_u.edf.er_node);
+	if (rc != 0)
+		return rc;
+
+	cfs_list_add_tail(&nrq->nr_u.edf.er_list, &head->eh_list);
+
+	return 0;
+}
+
+/**
+ * Removes request \a nrq from an EDF \a policy instance's set of queued
+ * requests.
+ *
+ * \param[in] policy the policy
+ * \param[in] nrq    the request to remove
+ */
+static void nrs_edf_req_del(struct ptlrpc_nrs_policy *policy,
+			    struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_edf_head *head;
+
+	head = container_of(nrs_request_resource(nrq), struct nrs_edf_head,
+			    eh_res);
+
+	LASSERT(!cfs_list_empty(&nrq->nr_u.edf.er_list));
+	cfs_binheap_remove(head->eh_binheap, &nrq->nr_u.edf.er_node);
+	cfs_list_del_init(&nrq->nr_u.edf.er_list);
+}
+
+/**
+ * Called right before the request \a nrq stops being handled; folds the time
+ * it took to handle it into the service time estimate of its opcode.
+ *
+ * \param[in] policy the policy handling the request
+ * \param[in] nrq    the request being handled
+ *
+ * \see ptlrpc_server_finish_request()
+ * \see ptlrpc_nrs_req_stop_nolock()
+ */
+static void nrs_edf_req_stop(struct ptlrpc_nrs_policy *policy,
+			     struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_edf_head	*head = policy->pol_private;
+	struct ptlrpc_request	*req = container_of(nrq, struct ptlrpc_request,
+						    rq_nrq);
+	struct nrs_edf_opc_time	*time;
+	__u64			 now = nrs_edf_now();
+	__u32			 svc_time;
+	int			 offset;
+
+	svc_time = now > nrq->nr_u.edf.er_start ?
+		   min_t(__u64, now - nrq->nr_u.edf.er_start,
+			 NRS_EDF_BUDGET_MAX) : 1;
+	offset = opcode_offset(lustre_msg_get_opc(req->rq_reqmsg));
+	if (likely(offset >= 0 && offset < LUSTRE_MAX_OPCODES)) {
+		time = &head->eh_opc_time[offset];
+		if (time->eot_estimate == 0)
+			time->eot_estimate = max_t(__u32, svc_time, 1);
+		else if (svc_time > time->eot_estimate)
+			time->eot_estimate += (svc_time - time->eot_estimate) >>
+					      NRS_EDF_EST_SHIFT;
+		else
+			time->eot_estimate -= (time->eot_estimate - svc_time) >>
+					      NRS_EDF_EST_SHIFT;
+	}
+
+	CDEBUG(D_RPCTRACE,
+	       "NRS: finished handling %s request from %s, seq: "LPU64
+	       ", usec: %u\n", NRS_POL_NAME_EDF, libcfs_id2str(req->rq_peer),
+	       nrq->nr_u.edf.er_sequence, svc_time);
+}
+
+#ifdef LPROCFS
+
+/**
+ * lprocfs interface
+ */
+
+/**
+ * Retrieves the fairness window of EDF policy instances on both the regular
+ * and high-priority NRS head of a service, as long as a policy instance is
+ * not in the ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+ *
+ * Window values are in milliseconds, and output is in YAML format.
+ *
+ * For example:
+ *
+ *	reg_window:1000
+ *	hp_window:1000
+ */
+static int
+ptlrpc_lprocfs_nrs_edf_window_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service	*svc = m->private;
+	__u32			 window;
+	int			 rc;
+
+	/**
+	 * Perform two separate calls to this as only one of the NRS heads'
+	 * policies may be in the ptlrpc_nrs_pol_state::NRS_POL_STATE_STARTED or
+	 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPING state.
+	 */
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_RD_WINDOW,
+				       true, &window);
+	if (rc == 0) {
+		seq_printf(m, NRS_LPROCFS_WINDOW_NAME_REG"%-5u\n", window);
+		/**
+		 * Ignore -ENODEV as the regular NRS head's policy may be in the
+		 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+		 */
+	} else if (rc != -ENODEV) {
+		return rc;
+	}
+
+	if (!nrs_svc_has_hp(svc))
+		goto no_hp;
+
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+				       NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_RD_WINDOW,
+				       true, &window);
+	if (rc == 0) {
+		seq_printf(m, NRS_LPROCFS_WINDOW_NAME_HP"%-5u\n", window);
+		/**
+		 * Ignore -ENODEV as the high priority NRS head's policy may be
+		 * in the ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+		 */
+	} else if (rc != -ENODEV) {
+		return rc;
+	}
+
+no_hp:
+	return rc;
+}
+
+/**
+ * Sets the fairness window of EDF policy instances of a service, in
+ * milliseconds. The user can set the window for the regular or high priority
+ * NRS head individually by specifying each value, or both together in a
+ * single invocation.
+ *
+ * For example:
+ *
+ * lctl set_param mds.MDS.mdt.nrs_edf_window=reg_window:500, to set the
+ * regular request window of the mdt service to 500ms
+ *
+ * lctl set_param mds.MDS.*.nrs_edf_window=200, to set both the regular and
+ * high priority request windows of all MDT services to 200ms.
+ *
+ * A window of 0 turns EDF ordering off, i.e. requests are served in arrival
+ * order.
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_edf_window_seq_write(struct file *file,
+					const char *buffer, size_t count,
+					loff_t *off)
+{
+	struct ptlrpc_service	    *svc = ((struct seq_file *)file->private_data)->private;
+	enum ptlrpc_nrs_queue_type   queue = 0;
+	char			     kernbuf[LPROCFS_NRS_WR_WINDOW_MAX_CMD];
+	char			    *val;
+	long			     window_reg;
+	long			     window_hp;
+	/** lprocfs_find_named_value() modifies its argument, so keep a copy */
+	size_t			     count_copy;
+	__u32			     window;
+	int			     rc = 0;
+	int			     rc2 = 0;
+
+	if (count > (sizeof(kernbuf) - 1))
+		return -EINVAL;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		return -EFAULT;
+
+	kernbuf[count] = '\0';
+
+	count_copy = count;
+
+	/**
+	 * Check if the regular window value has been specified
+	 */
+	val = lprocfs_find_named_value(kernbuf, NRS_LPROCFS_WINDOW_NAME_REG,
+				       &count_copy);
+	if (val != kernbuf) {
+		window_reg = simple_strtol(val, NULL, 10);
+
+		queue |= PTLRPC_NRS_QUEUE_REG;
+	}
+
+	count_copy = count;
+
+	/**
+	 * Check if the high priority window value has been specified
+	 */
+	val = lprocfs_find_named_value(kernbuf, NRS_LPROCFS_WINDOW_NAME_HP,
+				       &count_copy);
+	if (val != kernbuf) {
+		if (!nrs_svc_has_hp(svc))
+			return -ENODEV;
+
+		window_hp = simple_strtol(val, NULL, 10);
+
+		queue |= PTLRPC_NRS_QUEUE_HP;
+	}
+
+	/**
+	 * If none of the queues has been specified, look for a valid numerical
+	 * value
+	 */
+	if (queue == 0) {
+		if (!isdigit(kernbuf[0]))
+			return -EINVAL;
+
+		window_reg = simple_strtol(kernbuf, NULL, 10);
+
+		queue = PTLRPC_NRS_QUEUE_REG;
+
+		if (nrs_svc_has_hp(svc)) {
+			queue |= PTLRPC_NRS_QUEUE_HP;
+			window_hp = window_reg;
+		}
+	}
+
+	if ((((queue & PTLRPC_NRS_QUEUE_REG) != 0) &&
+	    ((window_reg > NRS_EDF_WINDOW_MAX || window_reg < 0))) ||
+	    (((queue & PTLRPC_NRS_QUEUE_HP) != 0) &&
+	    ((window_hp > NRS_EDF_WINDOW_MAX || window_hp < 0))))
+		return -EINVAL;
+
+	/**
+	 * As for nrs_crrn_quantum, the values on the regular and HP NRS heads
+	 * are changed separately, and -ENODEV is only returned if the
+	 * operation fails with -ENODEV on all heads specified by the command.
+	 */
+	if ((queue & PTLRPC_NRS_QUEUE_REG) != 0) {
+		window = window_reg;
+		rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+					       NRS_POL_NAME_EDF,
+					       NRS_CTL_EDF_WR_WINDOW, false,
+					       &window);
+		if ((rc < 0 && rc != -ENODEV) ||
+		    (rc == -ENODEV && queue == PTLRPC_NRS_QUEUE_REG))
+			return rc;
+	}
+
+	if ((queue & PTLRPC_NRS_QUEUE_HP) != 0) {
+		window = window_hp;
+		rc2 = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+						NRS_POL_NAME_EDF,
+						NRS_CTL_EDF_WR_WINDOW, false,
+						&window);
+		if ((rc2 < 0 && rc2 != -ENODEV) ||
+		    (rc2 == -ENODEV && queue == PTLRPC_NRS_QUEUE_HP))
+			return rc2;
+	}
+
+	return rc == -ENODEV && rc2 == -ENODEV ? -ENODEV : count;
+}
+LPROC_SEQ_FOPS(ptlrpc_lprocfs_nrs_edf_window);
+
+/**
+ * Prints the queue wait histograms of the EDF policy instances on NRS head
+ * \a queue of service \a svc, summed over all service partitions; only
+ * opcodes that have been seen are printed, up to their largest bucket.
+ */
+static int nrs_edf_wait_hist_show(struct seq_file *m,
+				  struct ptlrpc_service *svc,
+				  enum ptlrpc_nrs_queue_type queue,
+				  struct nrs_edf_wait_stats *stats)
+{
+	unsigned long	count;
+	int		last;
+	int		rc;
+	int		i;
+	int		j;
+
+	memset(stats, 0, sizeof(*stats));
+	rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_RD_WAIT_HIST, false, stats);
+	if (rc != 0)
+		return rc;
+
+	for (i = 0; i < LUSTRE_MAX_OPCODES; i++) {
+		count = 0;
+		last = -1;
+		for (j = 0; j < OBD_HIST_MAX; j++) {
+			if (stats->ews_buckets[i][j] == 0)
+				continue;
+			count += stats->ews_buckets[i][j];
+			last = j;
+		}
+		if (count == 0)
+			continue;
+
+		seq_printf(m, "  - { opcode: %s, samples: %lu, usec: { ",
+			   ll_opcode2str(ll_opcode_offset2opcode(i)), count);
+		for (j = 0; j <= last; j++)
+			seq_printf(m, "%lu: %lu%s", j == 0 ? 0 : 1UL << (j - 1),
+				   stats->ews_buckets[i][j],
+				   j == last ? " } }\n" : ", ");
+	}
+
+	return 0;
+}
+
+/**
+ * Retrieves the queue wait histograms of EDF policy instances on both the
+ * regular and high-priority NRS heads of a service, per opcode. Each bucket
+ * is labelled with the lower bound of the wait times it counts, in
+ * microseconds.
+ *
+ * For example:
+ *
+ *	regular_requests:
+ *	  - { opcode: mds_getattr, samples: 12, usec: { 0: 0, 1: 2, 2: 10 } }
+ *	high_priority_requests:
+ */
+static int
+ptlrpc_lprocfs_nrs_edf_wait_hist_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service		*svc = m->private;
+	struct nrs_edf_wait_stats	*stats;
+	int				 rc;
+
+	OBD_ALLOC_LARGE(stats, sizeof(*stats));
+	if (stats == NULL)
+		return -ENOMEM;
+
+	seq_printf(m, "regular_requests:\n");
+	rc = nrs_edf_wait_hist_show(m, svc, PTLRPC_NRS_QUEUE_REG, stats);
+	/**
+	 * Ignore -ENODEV as the regular NRS head's policy may be in the
+	 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+	 */
+	if (rc != 0 && rc != -ENODEV)
+		GOTO(out, rc);
+
+	if (!nrs_svc_has_hp(svc))
+		GOTO(out, rc = 0);
+
+	seq_printf(m, "high_priority_requests:\n");
+	rc = nrs_edf_wait_hist_show(m, svc, PTLRPC_NRS_QUEUE_HP, stats);
+	if (rc == -ENODEV)
+		rc = 0;
+out:
+	OBD_FREE_LARGE(stats, sizeof(*stats));
+
+	return rc;
+}
+
+/**
+ * Clears the queue wait histograms of EDF policy instances of a service,
+ * on writing "clear"; e.g.
+ *
+ * lctl set_param mds.MDS.mdt.nrs_edf_wait_hist=clear
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_edf_wait_hist_seq_write(struct file *file,
+					   const char *buffer, size_t count,
+					   loff_t *off)
+{
+	struct ptlrpc_service	*svc = ((struct seq_file *)file->private_data)->private;
+	char			 kernbuf[sizeof("clear\n")];
+	int			 rc;
+
+	if (count > (sizeof(kernbuf) - 1))
+		return -EINVAL;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		return -EFAULT;
+
+	kernbuf[count] = '\0';
+	if (strncmp(kernbuf, "clear", 5) != 0)
+		return -EINVAL;
+
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_CLR_WAIT_HIST, false, NULL);
+	if (rc != 0 && rc != -ENODEV)
+		return rc;
+
+	if (nrs_svc_has_hp(svc)) {
+		rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+					       NRS_POL_NAME_EDF,
+					       NRS_CTL_EDF_CLR_WAIT_HIST,
+					       false, NULL);
+		if (rc != 0 && rc != -ENODEV)
+			return rc;
+	}
+
+	return count;
+}
+LPROC_SEQ_FOPS(ptlrpc_lprocfs_nrs_edf_wait_hist);
+
+/**
+ * Prints the opcode budgets of the EDF policy instances on NRS head \a queue
+ * of service \a svc; only opcodes that have a budget or an estimate are
+ * printed.
+ */
+static int nrs_edf_budget_show(struct seq_file *m, struct ptlrpc_service *svc,
+			       enum ptlrpc_nrs_queue_type queue,
+			       struct nrs_edf_budget_cmd *cmd)
+{
+	int	rc;
+	int	i;
+
+	memset(cmd, 0, sizeof(*cmd));
+	rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_RD_BUDGET, false, cmd);
+	if (rc != 0)
+		return rc;
+
+	for (i = 0; i < LUSTRE_MAX_OPCODES; i++) {
+		if (cmd->ebc_times[i].eot_budget == 0 &&
+		    cmd->ebc_times[i].eot_estimate == 0)
+			continue;
+
+		seq_printf(m, "  - { opcode: %s, budget: %u, estimate: %u }\n",
+			   ll_opcode2str(ll_opcode_offset2opcode(i)),
+			   cmd->ebc_times[i].eot_budget,
+			   cmd->ebc_times[i].eot_estimate);
+	}
+
+	return 0;
+}
+
+/**
+ * Retrieves the time budgets of opcodes of EDF policy instances on both the
+ * regular and high-priority NRS heads of a service, in microseconds. The
+ * estimate is the largest one over all service partitions, and is used when
+ * no budget has been set.
+ *
+ * For example:
+ *
+ *	regular_requests:
+ *	  - { opcode: mds_getattr, budget: 0, estimate: 41 }
+ *	  - { opcode: mds_reint, budget: 0, estimate: 530 }
+ *	high_priority_requests:
+ */
+static int
+ptlrpc_lprocfs_nrs_edf_budget_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service		*svc = m->private;
+	struct nrs_edf_budget_cmd	*cmd;
+	int				 rc;
+
+	OBD_ALLOC_LARGE(cmd, sizeof(*cmd));
+	if (cmd == NULL)
+		return -ENOMEM;
+
+	seq_printf(m, "regular_requests:\n");
+	rc = nrs_edf_budget_show(m, svc, PTLRPC_NRS_QUEUE_REG, cmd);
+	if (rc != 0 && rc != -ENODEV)
+		GOTO(out, rc);
+
+	if (!nrs_svc_has_hp(svc))
+		GOTO(out, rc = 0);
+
+	seq_printf(m, "high_priority_requests:\n");
+	rc = nrs_edf_budget_show(m, svc, PTLRPC_NRS_QUEUE_HP, cmd);
+	if (rc == -ENODEV)
+		rc = 0;
+out:
+	OBD_FREE_LARGE(cmd, sizeof(*cmd));
+
+	return rc;
+}
+
+/**
+ * Sets the time budget of an opcode on EDF policy instances of a service, in
+ * microseconds, for both the regular and high priority NRS heads. A budget
+ * of 0 makes the policy use the estimated service time of the opcode again.
+ *
+ * For example:
+ *
+ * lctl set_param mds.MDS.mdt.nrs_edf_budget=mds_reint:500000
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_edf_budget_seq_write(struct file *file,
+					const char *buffer, size_t count,
+					loff_t *off)
+{
+	struct ptlrpc_service	  *svc = ((struct seq_file *)file->private_data)->private;
+	struct nrs_edf_budget_cmd *cmd;
+	char			   kernbuf[64];
+	char			  *val;
+	char			  *end;
+	unsigned long		   budget;
+	int			   i;
+	int			   rc;
+	int			   rc2 = -ENODEV;
+
+	if (count > (sizeof(kernbuf) - 1))
+		return -EINVAL;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		return -EFAULT;
+
+	kernbuf[count] = '\0';
+
+	val = strchr(kernbuf, ':');
+	if (val == NULL)
+		return -EINVAL;
+	*val++ = '\0';
+
+	budget = simple_strtoul(val, &end, 10);
+	if (end == val || (*end != '\0' && *end != '\n') ||
+	    budget > NRS_EDF_BUDGET_MAX)
+		return -EINVAL;
+
+	for (i = 0; i < LUSTRE_MAX_OPCODES; i++) {
+		if (strcmp(kernbuf,
+			   ll_opcode2str(ll_opcode_offset2opcode(i))) == 0)
+			break;
+	}
+	if (i == LUSTRE_MAX_OPCODES)
+		return -EINVAL;
+
+	OBD_ALLOC_LARGE(cmd, sizeof(*cmd));
+	if (cmd == NULL)
+		return -ENOMEM;
+
+	cmd->ebc_offset = i;
+	cmd->ebc_budget = budget;
+
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_WR_BUDGET, false, cmd);
+	if (rc != 0 && rc != -ENODEV)
+		GOTO(out, rc);
+
+	if (nrs_svc_has_hp(svc)) {
+		rc2 = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+						NRS_POL_NAME_EDF,
+						NRS_CTL_EDF_WR_BUDGET, false,
+						cmd);
+		if (rc2 != 0 && rc2 != -ENODEV)
+			GOTO(out, rc = rc2);
+	}
+
+	/**
+	 * -ENODEV is only returned if the policy is stopped on all heads
+	 */
+	rc = rc == -ENODEV && rc2 == -ENODEV ? -ENODEV : count;
+out:
+	OBD_FREE_LARGE(cmd, sizeof(*cmd));
+
+	return rc;
+}
+LPROC_SEQ_FOPS(ptlrpc_lprocfs_nrs_edf_budget);
+
+/**
+ * Initializes an EDF policy's lprocfs interface for service \a svc
+ *
+ * \param[in] svc the service
+ *
+ * \retval 0	success
+ * \retval != 0	error
+ */
+int nrs_edf_lprocfs_init(struct ptlrpc_service *svc)
+{
+	struct lprocfs_seq_vars nrs_edf_lprocfs_vars[] = {
+		{ .name		= "nrs_edf_window",
+		  .fops		= &ptlrpc_lprocfs_nrs_edf_window_fops,
+		  .data = svc },
+		{ .name		= "nrs_edf_wait_hist",
+		  .fops		= &ptlrpc_lprocfs_nrs_edf_wait_hist_fops,
+		  .data = svc },
+		{ .name		= "nrs_edf_budget",
+		  .fops		= &ptlrpc_lprocfs_nrs_edf_budget_fops,
+		  .data = svc },
+		{ NULL }
+	};
+
+	if (svc->srv_procroot == NULL)
+		return 0;
+
+	return lprocfs_seq_add_vars(svc->srv_procroot, nrs_edf_lprocfs_vars,
+				    NULL);
+}
+
+/**
+ * Cleans up an EDF policy's lprocfs interface for service \a svc
+ *
+ * \param[in] svc the service
+ */
+void nrs_edf_lprocfs_fini(struct ptlrpc_service *svc)
+{
+	if (svc->srv_procroot == NULL)
+		return;
+
+	lprocfs_remove_proc_entry("nrs_edf_window", svc->srv_procroot);
+	lprocfs_remove_proc_entry("nrs_edf_wait_hist", svc->srv_procroot);
+	lprocfs_remove_proc_entry("nrs_edf_budget", svc->srv_procroot);
+}
+
+#endif /* LPROCFS */
+
+/**
+ * EDF policy operations
+ */
+static const struct ptlrpc_nrs_pol_ops nrs_edf_ops = {
+	.op_policy_start	= nrs_edf_start,
+	.op_policy_stop		= nrs_edf_stop,
+	.op_policy_ctl		= nrs_edf_ctl,
+	.op_res_get		= nrs_edf_res_get,
+	.op_req_get		= nrs_edf_req_get,
+	.op_req_enqueue		= nrs_edf_req_add,
+	.op_req_dequeue		= nrs_edf_req_del,
+	.op_req_stop		= nrs_edf_req_stop,
+#ifdef LPROCFS
+	.op_lprocfs_init	= nrs_edf_lprocfs_init,
+	.op_lprocfs_fini	= nrs_edf_lprocfs_fini,
+#endif
+};
+
+/**
+ * EDF policy configuration
+ */
+struct ptlrpc_nrs_pol_conf nrs_conf_edf = {
+	.nc_name		= NRS_POL_NAME_EDF,
+	.nc_ops			= &nrs_edf_ops,
+	.nc_compat		= nrs_edf_compat,
+};
+
+/** @} EDF policy */
+
+/** @} nrs */
+
+#endif /* HAVE_SERVER_SUPPORT */
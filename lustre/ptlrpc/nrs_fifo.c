@@ -72,6 +72,7 @@
  * policy-specific private data structure.
  *
  * \param[in] policy The policy to start
+ * \param[in] arg    unused
  *
  * \retval -ENOMEM OOM error
  * \retval  0	   success
@@ -79,7 +80,7 @@
  * \see nrs_policy_register()
  * \see nrs_policy_ctl()
  */
-static int nrs_fifo_start(struct ptlrpc_nrs_policy *policy)
+static int nrs_fifo_start(struct ptlrpc_nrs_policy *policy, char *arg)
 {
 	struct nrs_fifo_head *head;
 
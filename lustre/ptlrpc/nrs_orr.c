@@ -605,11 +605,12 @@ static int nrs_orr_init(struct ptlrpc_nrs_policy *policy)
  * Called when an ORR policy instance is started.
  *
  * \param[in] policy the policy
+ * \param[in] arg    unused
  *
  * \retval -ENOMEM OOM error
  * \retval 0	   success
  */
-static int nrs_orr_start(struct ptlrpc_nrs_policy *policy)
+static int nrs_orr_start(struct ptlrpc_nrs_policy *policy, char *arg)
 {
 	struct nrs_orr_data    *orrd;
 	cfs_hash_ops_t	       *ops;
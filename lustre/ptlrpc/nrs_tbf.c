@@ -0,0 +1,1531 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.  A copy is
+ * included in the COPYING file that accompanied this code.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * GPL HEADER END
+ */
+/*
+ * Copyright (c) 2013, Intel Corporation.
+ */
+/*
+ * lustre/ptlrpc/nrs_tbf.c
+ *
+ * Network Request Scheduler (NRS) Token Bucket Filter (TBF) policy
+ *
+ * Rate limits RPCs per JobID or per client NID
+ */
+/**
+ * \addtogoup nrs
+ * @{
+ */
+#ifdef HAVE_SERVER_SUPPORT
+
+#define DEBUG_SUBSYSTEM S_RPC
+#ifndef __KERNEL__
+#include <liblustre.h>
+#endif
+#include <obd_support.h>
+#include <obd_class.h>
+#include <lustre_net.h>
+#include <lprocfs_status.h>
+#include <libcfs/libcfs.h>
+#include "ptlrpc_internal.h"
+
+/**
+ * \name TBF policy
+ *
+ * Token Bucket Filter scheduling over JobIDs or client NIDs
+ *
+ * Each class of requests (i.e. each JobID or each client NID) has a token
+ * bucket, which is refilled at the rate of the rule the class matches; a
+ * request can only be handled when its class has a token available. Classes
+ * with queued requests are kept in a binary heap, sorted by the time at which
+ * they can next be served, so that the earliest class is always at the root.
+ *
+ * @{
+ */
+
+#define NRS_POL_NAME_TBF	"tbf"
+
+static int tbf_rate = 10000;
+CFS_MODULE_PARM(tbf_rate, "i", int, 0644,
+		"Default rate limit in RPCs/s of the TBF policy");
+
+static int tbf_depth = 3;
+CFS_MODULE_PARM(tbf_depth, "i", int, 0644,
+		"Default token bucket depth of the TBF policy");
+
+#define NRS_TBF_DEFAULT_RULE	"default"
+#define NRS_TBF_RATE_MAX	65535
+
+/**
+ * nrs_tbf_head::th_cli_hash does not rehash, so that each bucket can keep a
+ * list of idle clients; up to NRS_TBF_BKT_LRU_MAX idle clients are kept per
+ * bucket.
+ */
+#define NRS_TBF_CLI_BITS	12
+#define NRS_TBF_CLI_BKT_BITS	4
+#define NRS_TBF_BKT_LRU_MAX	32
+
+static inline __u64 nrs_tbf_now(void)
+{
+	return ktime_to_ns(ktime_get());
+}
+
+/**
+ * Frees a TBF rule, once nothing refers to it any more.
+ */
+static void nrs_tbf_rule_fini(struct nrs_tbf_rule *rule)
+{
+	struct nrs_tbf_jobid *jobid;
+	struct nrs_tbf_jobid *tmp;
+
+	LASSERT(cfs_atomic_read(&rule->tr_ref) == 0);
+
+	if (!cfs_list_empty(&rule->tr_nids))
+		cfs_free_nidlist(&rule->tr_nids);
+
+	cfs_list_for_each_entry_safe(jobid, tmp, &rule->tr_jobids,
+				     tj_linkage) {
+		cfs_list_del(&jobid->tj_linkage);
+		OBD_FREE(jobid->tj_id, strlen(jobid->tj_id) + 1);
+		OBD_FREE_PTR(jobid);
+	}
+
+	if (rule->tr_expr != NULL)
+		OBD_FREE(rule->tr_expr, rule->tr_expr_len + 1);
+
+	OBD_FREE_PTR(rule);
+}
+
+static inline void nrs_tbf_rule_get(struct nrs_tbf_rule *rule)
+{
+	cfs_atomic_inc(&rule->tr_ref);
+}
+
+static inline void nrs_tbf_rule_put(struct nrs_tbf_rule *rule)
+{
+	if (cfs_atomic_dec_and_test(&rule->tr_ref))
+		nrs_tbf_rule_fini(rule);
+}
+
+static void nrs_tbf_rule_set_rate(struct nrs_tbf_rule *rule, __u64 rate)
+{
+	__u64 nsecs = NSEC_PER_SEC;
+
+	do_div(nsecs, rate);
+
+	rule->tr_rpc_rate = rate;
+	rule->tr_nsecs = nsecs;
+}
+
+/**
+ * Parses a space-separated list of JobIDs into \a rule.
+ */
+static int nrs_tbf_jobid_list_parse(struct nrs_tbf_rule *rule, char *str,
+				    int len)
+{
+	struct cfs_lstr		 src;
+	struct cfs_lstr		 res;
+	struct nrs_tbf_jobid	*jobid;
+
+	src.ls_str = str;
+	src.ls_len = len;
+	while (src.ls_str != NULL) {
+		if (cfs_gettok(&src, ' ', &res) == 0)
+			return -EINVAL;
+
+		if (res.ls_len == 0)
+			continue;
+
+		if (res.ls_len > JOBSTATS_JOBID_SIZE - 1)
+			return -EINVAL;
+
+		OBD_ALLOC_PTR(jobid);
+		if (jobid == NULL)
+			return -ENOMEM;
+
+		OBD_ALLOC(jobid->tj_id, res.ls_len + 1);
+		if (jobid->tj_id == NULL) {
+			OBD_FREE_PTR(jobid);
+			return -ENOMEM;
+		}
+
+		memcpy(jobid->tj_id, res.ls_str, res.ls_len);
+		cfs_list_add_tail(&jobid->tj_linkage, &rule->tr_jobids);
+	}
+
+	return cfs_list_empty(&rule->tr_jobids) ? -EINVAL : 0;
+}
+
+/**
+ * Allocates a TBF rule and parses its match expression.
+ *
+ * \param[in] name the name of the rule
+ * \param[in] type whether the rule matches JobIDs or NIDs
+ * \param[in] expr the match expression, i.e. the contents of the braces of
+ *		   "jobid={...}" or "nid={...}", or "*" for the default rule
+ * \param[in] len  the length of \a expr
+ * \param[in] rate the RPC rate of the rule
+ *
+ * \retval the new rule, holding a single reference
+ * \retval ERR_PTR(-ve) error
+ */
+static struct nrs_tbf_rule *
+nrs_tbf_rule_alloc(const char *name, enum nrs_tbf_flag type, char *expr,
+		   int len, __u64 rate)
+{
+	struct nrs_tbf_rule	*rule;
+	int			 rc = 0;
+
+	OBD_ALLOC_PTR(rule);
+	if (rule == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	strlcpy(rule->tr_name, name, sizeof(rule->tr_name));
+	rule->tr_type = type;
+	rule->tr_depth = tbf_depth > 0 ? tbf_depth : 1;
+	nrs_tbf_rule_set_rate(rule, rate);
+	cfs_atomic_set(&rule->tr_ref, 1);
+	CFS_INIT_LIST_HEAD(&rule->tr_linkage);
+	CFS_INIT_LIST_HEAD(&rule->tr_nids);
+	CFS_INIT_LIST_HEAD(&rule->tr_jobids);
+
+	OBD_ALLOC(rule->tr_expr, len + 1);
+	if (rule->tr_expr == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	memcpy(rule->tr_expr, expr, len);
+	rule->tr_expr_len = len;
+
+	if (strcmp(rule->tr_expr, "*") == 0) {
+		rule->tr_default = 1;
+		GOTO(out, rc = 0);
+	}
+
+	if (type == NRS_TBF_FLAG_NID) {
+		/* cfs_parse_nidlist() modifies its argument */
+		char *tmp;
+
+		OBD_ALLOC(tmp, len + 1);
+		if (tmp == NULL)
+			GOTO(out, rc = -ENOMEM);
+
+		memcpy(tmp, expr, len);
+		if (!cfs_parse_nidlist(tmp, len, &rule->tr_nids))
+			rc = -EINVAL;
+		OBD_FREE(tmp, len + 1);
+	} else {
+		rc = nrs_tbf_jobid_list_parse(rule, rule->tr_expr, len);
+	}
+out:
+	if (rc != 0) {
+		cfs_atomic_set(&rule->tr_ref, 0);
+		nrs_tbf_rule_fini(rule);
+		return ERR_PTR(rc);
+	}
+
+	return rule;
+}
+
+/**
+ * Finds the first rule that matches client \a cli, and takes a reference on
+ * it; the default rule, which is always the last one, matches all clients.
+ *
+ * \pre spin_is_locked(&head->th_rule_lock)
+ */
+static struct nrs_tbf_rule *
+nrs_tbf_rule_match(struct nrs_tbf_head *head, struct nrs_tbf_client *cli)
+{
+	struct nrs_tbf_rule	*rule;
+	struct nrs_tbf_jobid	*jobid;
+
+	cfs_list_for_each_entry(rule, &head->th_list, tr_linkage) {
+		if (rule->tr_default)
+			goto found;
+
+		if (head->th_type == NRS_TBF_FLAG_NID) {
+			if (cfs_match_nid(cli->tc_nid, &rule->tr_nids))
+				goto found;
+			continue;
+		}
+
+		cfs_list_for_each_entry(jobid, &rule->tr_jobids, tj_linkage) {
+			if (strcmp(jobid->tj_id, cli->tc_jobid) == 0)
+				goto found;
+		}
+	}
+	LBUG();
+found:
+	nrs_tbf_rule_get(rule);
+	return rule;
+}
+
+static struct nrs_tbf_rule *
+nrs_tbf_rule_find_locked(struct nrs_tbf_head *head, const char *name)
+{
+	struct nrs_tbf_rule *rule;
+
+	cfs_list_for_each_entry(rule, &head->th_list, tr_linkage) {
+		if (strcmp(rule->tr_name, name) == 0)
+			return rule;
+	}
+	return NULL;
+}
+
+/**
+ * Adds as many tokens to the bucket of \a cli as have been generated since it
+ * was last updated, up to the bucket depth. The time left over from partially
+ * generated tokens is carried over, so that the rate is not rounded down.
+ */
+static void nrs_tbf_cli_refill(struct nrs_tbf_client *cli, __u64 now)
+{
+	__u64 ntoken;
+
+	if (now <= cli->tc_check_time)
+		return;
+
+	if (cli->tc_ntoken >= cli->tc_depth ||
+	    now - cli->tc_check_time >= cli->tc_depth * cli->tc_nsecs) {
+		cli->tc_ntoken = cli->tc_depth;
+		cli->tc_check_time = now;
+		return;
+	}
+
+	ntoken = now - cli->tc_check_time;
+	do_div(ntoken, cli->tc_nsecs);
+
+	cli->tc_ntoken += ntoken;
+	cli->tc_check_time += ntoken * cli->tc_nsecs;
+	if (cli->tc_ntoken >= cli->tc_depth) {
+		cli->tc_ntoken = cli->tc_depth;
+		cli->tc_check_time = now;
+	}
+}
+
+/**
+ * Returns the time at which client \a cli can next have a request served.
+ */
+static inline __u64 nrs_tbf_cli_deadline(struct nrs_tbf_client *cli)
+{
+	return cli->tc_ntoken > 0 ? cli->tc_check_time :
+				    cli->tc_check_time + cli->tc_nsecs;
+}
+
+/**
+ * (Re)classifies client \a cli against the current set of rules of \a head.
+ * A client's token bucket is kept across classifications, but it is not
+ * allowed to hold more tokens than the depth of its new rule.
+ */
+static void nrs_tbf_cli_classify(struct nrs_tbf_head *head,
+				 struct nrs_tbf_client *cli)
+{
+	struct nrs_tbf_rule *old = cli->tc_rule;
+	struct nrs_tbf_rule *rule;
+
+	spin_lock(&head->th_rule_lock);
+	rule = nrs_tbf_rule_match(head, cli);
+	cli->tc_rule = rule;
+	cli->tc_rule_generation = head->th_generation;
+	cli->tc_rpc_rate = rule->tr_rpc_rate;
+	cli->tc_nsecs = rule->tr_nsecs;
+	cli->tc_depth = rule->tr_depth;
+	spin_unlock(&head->th_rule_lock);
+
+	if (cli->tc_ntoken > cli->tc_depth)
+		cli->tc_ntoken = cli->tc_depth;
+
+	if (old != NULL)
+		nrs_tbf_rule_put(old);
+}
+
+static struct nrs_tbf_client *
+nrs_tbf_cli_alloc(struct ptlrpc_nrs_policy *policy, struct nrs_tbf_head *head,
+		  lnet_nid_t nid, const char *jobid, bool moving_req)
+{
+	struct nrs_tbf_client *cli;
+
+	OBD_CPT_ALLOC_GFP(cli, nrs_pol2cptab(policy), nrs_pol2cptid(policy),
+			  sizeof(*cli), moving_req ? GFP_ATOMIC : __GFP_IO);
+	if (cli == NULL)
+		return NULL;
+
+	cli->tc_nid = nid;
+	strlcpy(cli->tc_jobid, jobid, sizeof(cli->tc_jobid));
+	CFS_INIT_LIST_HEAD(&cli->tc_list);
+	CFS_INIT_LIST_HEAD(&cli->tc_lru);
+
+	nrs_tbf_cli_classify(head, cli);
+	/* A new client starts off with a full bucket */
+	cli->tc_ntoken = cli->tc_depth;
+	cli->tc_check_time = nrs_tbf_now();
+
+	return cli;
+}
+
+static void nrs_tbf_cli_free(struct nrs_tbf_client *cli)
+{
+	LASSERT(cfs_list_empty(&cli->tc_list));
+	LASSERT(!cli->tc_in_heap);
+
+	nrs_tbf_rule_put(cli->tc_rule);
+	OBD_FREE_PTR(cli);
+}
+
+/**
+ * Binary heap predicate.
+ *
+ * Sorts nrs_tbf_client objects by the time at which they can next have a
+ * request served, so that the earliest one is at the root of the heap.
+ *
+ * \param[in] e1 the first binheap node to compare
+ * \param[in] e2 the second binheap node to compare
+ *
+ * \retval 0 e1 > e2
+ * \retval 1 e1 <= e2
+ */
+static int tbf_cli_compare(cfs_binheap_node_t *e1, cfs_binheap_node_t *e2)
+{
+	struct nrs_tbf_client	*cli1;
+	struct nrs_tbf_client	*cli2;
+	__u64			 deadline1;
+	__u64			 deadline2;
+
+	cli1 = container_of(e1, struct nrs_tbf_client, tc_node);
+	cli2 = container_of(e2, struct nrs_tbf_client, tc_node);
+
+	deadline1 = nrs_tbf_cli_deadline(cli1);
+	deadline2 = nrs_tbf_cli_deadline(cli2);
+
+	if (deadline1 != deadline2)
+		return deadline1 < deadline2;
+
+	return cli1->tc_check_time <= cli2->tc_check_time;
+}
+
+static cfs_binheap_ops_t nrs_tbf_heap_ops = {
+	.hop_enter	= NULL,
+	.hop_exit	= NULL,
+	.hop_compare	= tbf_cli_compare,
+};
+
+/**
+ * libcfs_hash operations for nrs_tbf_head::th_cli_hash
+ *
+ * The hash is keyed by either ptlrpc_request::rq_peer.nid or by the JobID
+ * found in the request's ptlrpc_body, depending on nrs_tbf_head::th_type.
+ * Client reference counts are maintained under the bucket lock by the policy
+ * itself, so that idle clients can be kept on a per-bucket LRU list; the hash
+ * does not take item references.
+ */
+static unsigned nrs_tbf_nid_hop_hash(cfs_hash_t *hs, const void *key,
+				     unsigned mask)
+{
+	return cfs_hash_djb2_hash(key, sizeof(lnet_nid_t), mask);
+}
+
+static int nrs_tbf_nid_hop_keycmp(const void *key, cfs_hlist_node_t *hnode)
+{
+	struct nrs_tbf_client *cli = cfs_hlist_entry(hnode,
+						     struct nrs_tbf_client,
+						     tc_hnode);
+
+	return *(lnet_nid_t *)key == cli->tc_nid;
+}
+
+static void *nrs_tbf_nid_hop_key(cfs_hlist_node_t *hnode)
+{
+	struct nrs_tbf_client *cli = cfs_hlist_entry(hnode,
+						     struct nrs_tbf_client,
+						     tc_hnode);
+
+	return &cli->tc_nid;
+}
+
+static unsigned nrs_tbf_jobid_hop_hash(cfs_hash_t *hs, const void *key,
+				       unsigned mask)
+{
+	return cfs_hash_djb2_hash(key, strlen(key), mask);
+}
+
+static int nrs_tbf_jobid_hop_keycmp(const void *key, cfs_hlist_node_t *hnode)
+{
+	struct nrs_tbf_client *cli = cfs_hlist_entry(hnode,
+						     struct nrs_tbf_client,
+						     tc_hnode);
+
+	return strcmp(cli->tc_jobid, key) == 0;
+}
+
+static void *nrs_tbf_jobid_hop_key(cfs_hlist_node_t *hnode)
+{
+	struct nrs_tbf_client *cli = cfs_hlist_entry(hnode,
+						     struct nrs_tbf_client,
+						     tc_hnode);
+
+	return cli->tc_jobid;
+}
+
+static void *nrs_tbf_hop_object(cfs_hlist_node_t *hnode)
+{
+	return cfs_hlist_entry(hnode, struct nrs_tbf_client, tc_hnode);
+}
+
+static void nrs_tbf_hop_get(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
+{
+	struct nrs_tbf_client *cli = cfs_hlist_entry(hnode,
+						     struct nrs_tbf_client,
+						     tc_hnode);
+	cli->tc_ref++;
+}
+
+static void nrs_tbf_hop_put(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
+{
+	struct nrs_tbf_client *cli = cfs_hlist_entry(hnode,
+						     struct nrs_tbf_client,
+						     tc_hnode);
+	cli->tc_ref--;
+}
+
+static void nrs_tbf_hop_exit(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
+{
+	struct nrs_tbf_client *cli = cfs_hlist_entry(hnode,
+						     struct nrs_tbf_client,
+						     tc_hnode);
+
+	LASSERTF(cli->tc_ref == 0,
+		 "Busy TBF object for %s %s, with %d refs\n",
+		 cli->tc_rule->tr_type == NRS_TBF_FLAG_NID ? "NID" : "JobID",
+		 cli->tc_rule->tr_type == NRS_TBF_FLAG_NID ?
+		 libcfs_nid2str(cli->tc_nid) : cli->tc_jobid, cli->tc_ref);
+
+	cfs_list_del_init(&cli->tc_lru);
+	nrs_tbf_cli_free(cli);
+}
+
+static cfs_hash_ops_t nrs_tbf_nid_hash_ops = {
+	.hs_hash	= nrs_tbf_nid_hop_hash,
+	.hs_keycmp	= nrs_tbf_nid_hop_keycmp,
+	.hs_key		= nrs_tbf_nid_hop_key,
+	.hs_object	= nrs_tbf_hop_object,
+	.hs_get		= nrs_tbf_hop_get,
+	.hs_put		= nrs_tbf_hop_put,
+	.hs_put_locked	= nrs_tbf_hop_put,
+	.hs_exit	= nrs_tbf_hop_exit,
+};
+
+static cfs_hash_ops_t nrs_tbf_jobid_hash_ops = {
+	.hs_hash	= nrs_tbf_jobid_hop_hash,
+	.hs_keycmp	= nrs_tbf_jobid_hop_keycmp,
+	.hs_key		= nrs_tbf_jobid_hop_key,
+	.hs_object	= nrs_tbf_hop_object,
+	.hs_get		= nrs_tbf_hop_get,
+	.hs_put		= nrs_tbf_hop_put,
+	.hs_put_locked	= nrs_tbf_hop_put,
+	.hs_exit	= nrs_tbf_hop_exit,
+};
+
+/**
+ * Idle clients are left in the hash when the policy is stopped, and are freed
+ * by nrs_tbf_hop_exit() when the hash is destroyed.
+ */
+#define NRS_TBF_HASH_FLAGS	(CFS_HASH_SPIN_BKTLOCK | CFS_HASH_NO_ITEMREF)
+
+/**
+ * Wakes up the service threads of the partition once the client at the root
+ * of the binary heap is due to be served.
+ */
+static void nrs_tbf_timer_cb(ulong_ptr_t data)
+{
+	struct ptlrpc_nrs_policy *policy = (struct ptlrpc_nrs_policy *)data;
+	struct ptlrpc_nrs	 *nrs = policy->pol_nrs;
+
+	nrs->nrs_throttling = 0;
+	smp_mb();
+	wake_up(&nrs->nrs_svcpt->scp_waitq);
+}
+
+/**
+ * Arms the timer of \a head to go off at \a deadline; the timer has jiffy
+ * granularity, so it is rounded up to the next jiffy.
+ */
+static void nrs_tbf_timer_arm(struct nrs_tbf_head *head, __u64 deadline,
+			      __u64 now)
+{
+	__u64 delta = deadline > now ? deadline - now : 0;
+
+	delta = delta * HZ + NSEC_PER_SEC - 1;
+	do_div(delta, NSEC_PER_SEC);
+
+	head->th_deadline = deadline;
+	cfs_timer_arm(&head->th_timer,
+		      cfs_time_add(cfs_time_current(),
+				   (cfs_duration_t)max_t(__u64, delta, 1)));
+}
+
+/**
+ * Called when a TBF policy instance is started.
+ *
+ * \param[in] policy the policy
+ * \param[in] arg    what to classify requests by; one of "nid" (the default
+ *		     if NULL) or "jobid"
+ *
+ * \retval -ENOMEM OOM error
+ * \retval -EINVAL invalid argument
+ * \retval 0	   success
+ */
+static int nrs_tbf_start(struct ptlrpc_nrs_policy *policy, char *arg)
+{
+	struct nrs_tbf_head    *head;
+	struct nrs_tbf_rule    *rule;
+	cfs_hash_ops_t	       *hash_ops;
+	cfs_hash_bd_t		bd;
+	int			i;
+	int			rc = 0;
+	ENTRY;
+
+	if (arg == NULL || strcmp(arg, NRS_TBF_TYPE_NID) == 0)
+		hash_ops = &nrs_tbf_nid_hash_ops;
+	else if (strcmp(arg, NRS_TBF_TYPE_JOBID) == 0)
+		hash_ops = &nrs_tbf_jobid_hash_ops;
+	else
+		RETURN(-EINVAL);
+
+	if (tbf_rate <= 0 || tbf_rate > NRS_TBF_RATE_MAX)
+		RETURN(-EINVAL);
+
+	OBD_CPT_ALLOC_PTR(head, nrs_pol2cptab(policy), nrs_pol2cptid(policy));
+	if (head == NULL)
+		RETURN(-ENOMEM);
+
+	head->th_type = hash_ops == &nrs_tbf_nid_hash_ops ? NRS_TBF_FLAG_NID :
+							    NRS_TBF_FLAG_JOBID;
+	spin_lock_init(&head->th_rule_lock);
+	CFS_INIT_LIST_HEAD(&head->th_list);
+	cfs_timer_init(&head->th_timer, nrs_tbf_timer_cb, policy);
+
+	head->th_binheap = cfs_binheap_create(&nrs_tbf_heap_ops,
+					      CBH_FLAG_ATOMIC_GROW, 4096, NULL,
+					      nrs_pol2cptab(policy),
+					      nrs_pol2cptid(policy));
+	if (head->th_binheap == NULL)
+		GOTO(failed, rc = -ENOMEM);
+
+	head->th_cli_hash = cfs_hash_create("nrs_tbf_hash",
+					    NRS_TBF_CLI_BITS,
+					    NRS_TBF_CLI_BITS,
+					    NRS_TBF_CLI_BKT_BITS,
+					    sizeof(struct nrs_tbf_bucket),
+					    CFS_HASH_MIN_THETA,
+					    CFS_HASH_MAX_THETA,
+					    hash_ops, NRS_TBF_HASH_FLAGS);
+	if (head->th_cli_hash == NULL)
+		GOTO(failed, rc = -ENOMEM);
+
+	cfs_hash_for_each_bucket(head->th_cli_hash, &bd, i) {
+		struct nrs_tbf_bucket *bkt;
+
+		bkt = cfs_hash_bd_extra_get(head->th_cli_hash, &bd);
+		CFS_INIT_LIST_HEAD(&bkt->ntb_lru);
+	}
+
+	rule = nrs_tbf_rule_alloc(NRS_TBF_DEFAULT_RULE, head->th_type, "*", 1,
+				  tbf_rate);
+	if (IS_ERR(rule))
+		GOTO(failed, rc = PTR_ERR(rule));
+
+	cfs_list_add(&rule->tr_linkage, &head->th_list);
+	head->th_rule = rule;
+
+	policy->pol_private = head;
+
+	RETURN(rc);
+
+failed:
+	if (head->th_cli_hash != NULL)
+		cfs_hash_putref(head->th_cli_hash);
+
+	if (head->th_binheap != NULL)
+		cfs_binheap_destroy(head->th_binheap);
+
+	OBD_FREE_PTR(head);
+
+	RETURN(rc);
+}
+
+/**
+ * Called when a TBF policy instance is stopped.
+ *
+ * Called when the policy has been instructed to transition to the
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state and has no more pending
+ * requests to serve.
+ *
+ * \param[in] policy the policy
+ */
+static void nrs_tbf_stop(struct ptlrpc_nrs_policy *policy)
+{
+	struct nrs_tbf_head	*head = policy->pol_private;
+	struct nrs_tbf_rule	*rule;
+	struct nrs_tbf_rule	*tmp;
+	ENTRY;
+
+	LASSERT(head != NULL);
+	LASSERT(head->th_binheap != NULL);
+	LASSERT(head->th_cli_hash != NULL);
+	LASSERT(cfs_binheap_is_empty(head->th_binheap));
+
+	cfs_timer_disarm(&head->th_timer);
+	policy->pol_nrs->nrs_throttling = 0;
+
+	cfs_binheap_destroy(head->th_binheap);
+	cfs_hash_putref(head->th_cli_hash);
+
+	cfs_list_for_each_entry_safe(rule, tmp, &head->th_list, tr_linkage) {
+		cfs_list_del_init(&rule->tr_linkage);
+		nrs_tbf_rule_put(rule);
+	}
+
+	OBD_FREE_PTR(head);
+	EXIT;
+}
+
+/**
+ * Prints the rules of a TBF policy instance to \a m.
+ */
+static void nrs_tbf_rule_dump_all(struct ptlrpc_nrs_policy *policy,
+				  struct nrs_tbf_head *head,
+				  struct seq_file *m)
+{
+	struct nrs_tbf_rule *rule;
+
+	seq_printf(m, "CPT %d:\n", nrs_pol2cptid(policy));
+
+	spin_lock(&head->th_rule_lock);
+	cfs_list_for_each_entry(rule, &head->th_list, tr_linkage) {
+		seq_printf(m, "%s {%s} "LPU64", ref %d\n", rule->tr_name,
+			   rule->tr_expr, rule->tr_rpc_rate,
+			   cfs_atomic_read(&rule->tr_ref) - 1);
+	}
+	spin_unlock(&head->th_rule_lock);
+}
+
+/**
+ * Carries out a rule command written to the nrs_tbf_rule lprocfs file on
+ * policy instance \a head.
+ */
+static int nrs_tbf_command(struct nrs_tbf_head *head, struct nrs_tbf_cmd *cmd)
+{
+	struct nrs_tbf_rule	*rule;
+	int			 rc = 0;
+
+	spin_lock(&head->th_rule_lock);
+	rule = nrs_tbf_rule_find_locked(head, cmd->tc_name);
+
+	switch (cmd->tc_cmd) {
+	default:
+		GOTO(out, rc = -EINVAL);
+
+	case NRS_CTL_TBF_START_RULE: {
+		struct nrs_tbf_rule *new;
+
+		if (rule != NULL)
+			GOTO(out, rc = -EEXIST);
+
+		LASSERT(!cfs_list_empty(&cmd->tc_rules));
+		new = cfs_list_entry(cmd->tc_rules.next, struct nrs_tbf_rule,
+				     tr_linkage);
+		if (new->tr_type != head->th_type)
+			GOTO(out, rc = -EINVAL);
+
+		/* Newer rules take precedence over older ones */
+		cfs_list_move(&new->tr_linkage, &head->th_list);
+		break;
+	}
+	case NRS_CTL_TBF_CHANGE_RATE:
+		if (rule == NULL)
+			GOTO(out, rc = -ENOENT);
+
+		nrs_tbf_rule_set_rate(rule, cmd->tc_rpc_rate);
+		break;
+
+	case NRS_CTL_TBF_STOP_RULE:
+		if (rule == NULL)
+			GOTO(out, rc = -ENOENT);
+
+		if (rule == head->th_rule)
+			GOTO(out, rc = -EPERM);
+
+		cfs_list_del_init(&rule->tr_linkage);
+		rule->tr_stopping = 1;
+		break;
+	}
+
+	/* Have clients classify themselves again on their next request */
+	head->th_generation++;
+out:
+	spin_unlock(&head->th_rule_lock);
+
+	if (rc == 0 && cmd->tc_cmd == NRS_CTL_TBF_STOP_RULE)
+		nrs_tbf_rule_put(rule);
+
+	return rc;
+}
+
+/**
+ * Performs a policy-specific ctl function on TBF policy instances; similar
+ * to ioctl.
+ *
+ * \param[in]	  policy the policy instance
+ * \param[in]	  opc	 the opcode
+ * \param[in,out] arg	 used for passing parameters and information
+ *
+ * \pre spin_is_locked(&policy->pol_nrs->nrs_lock)
+ * \post spin_is_locked(&policy->pol_nrs->nrs_lock)
+ *
+ * \retval 0   operation carried out successfully
+ * \retval -ve error
+ */
+static int nrs_tbf_ctl(struct ptlrpc_nrs_policy *policy,
+		       enum ptlrpc_nrs_ctl opc, void *arg)
+{
+	struct nrs_tbf_head *head = policy->pol_private;
+	int		     rc = 0;
+	ENTRY;
+
+	LASSERT(spin_is_locked(&policy->pol_nrs->nrs_lock));
+
+	switch ((enum nrs_ctl_tbf)opc) {
+	default:
+		RETURN(-EINVAL);
+
+	/**
+	 * Read the rules of a policy instance.
+	 */
+	case NRS_CTL_TBF_RD_RULE:
+		nrs_tbf_rule_dump_all(policy, head, (struct seq_file *)arg);
+		break;
+
+	/**
+	 * Start, change or stop a rule of a policy instance.
+	 */
+	case NRS_CTL_TBF_WR_RULE:
+		rc = nrs_tbf_command(head, (struct nrs_tbf_cmd *)arg);
+		break;
+	}
+
+	RETURN(rc);
+}
+
+/**
+ * Obtains resources from TBF policy instances. The top-level resource lives
+ * inside \e nrs_tbf_head and the second-level resource inside
+ * \e nrs_tbf_client object instances.
+ *
+ * \param[in]  policy	  the policy for which resources are being taken for
+ *			  request \a nrq
+ * \param[in]  nrq	  the request for which resources are being taken
+ * \param[in]  parent	  parent resource, embedded in nrs_tbf_head for the
+ *			  TBF policy
+ * \param[out] resp	  resources references are placed in this array
+ * \param[in]  moving_req signifies limited caller context; used to perform
+ *			  memory allocations in an atomic context in this
+ *			  policy
+ *
+ * \retval 0   we are returning a top-level, parent resource, one that is
+ *	       embedded in an nrs_tbf_head object
+ * \retval 1   we are returning a bottom-level resource, one that is embedded
+ *	       in an nrs_tbf_client object
+ *
+ * \see nrs_resource_get_safe()
+ */
+static int nrs_tbf_res_get(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq,
+			   const struct ptlrpc_nrs_resource *parent,
+			   struct ptlrpc_nrs_resource **resp, bool moving_req)
+{
+	struct nrs_tbf_head	*head;
+	struct nrs_tbf_client	*cli;
+	struct nrs_tbf_client	*tmp;
+	struct ptlrpc_request	*req;
+	cfs_hlist_node_t	*hnode;
+	cfs_hash_bd_t		 bd;
+	char			 jobid[JOBSTATS_JOBID_SIZE] = "";
+	void			*key;
+
+	if (parent == NULL) {
+		*resp = &((struct nrs_tbf_head *)policy->pol_private)->th_res;
+		return 0;
+	}
+
+	head = container_of(parent, struct nrs_tbf_head, th_res);
+	req = container_of(nrq, struct ptlrpc_request, rq_nrq);
+
+	if (head->th_type == NRS_TBF_FLAG_JOBID) {
+		char *id = lustre_msg_get_jobid(req->rq_reqmsg);
+
+		if (id != NULL)
+			strlcpy(jobid, id, sizeof(jobid));
+		key = jobid;
+	} else {
+		key = &req->rq_peer.nid;
+	}
+
+	cfs_hash_bd_get_and_lock(head->th_cli_hash, key, &bd, 1);
+	hnode = cfs_hash_bd_peek_locked(head->th_cli_hash, &bd, key);
+	if (hnode != NULL) {
+		cli = cfs_hlist_entry(hnode, struct nrs_tbf_client, tc_hnode);
+		if (cli->tc_ref++ == 0)
+			cfs_list_del_init(&cli->tc_lru);
+		cfs_hash_bd_unlock(head->th_cli_hash, &bd, 1);
+		goto out;
+	}
+	cfs_hash_bd_unlock(head->th_cli_hash, &bd, 1);
+
+	cli = nrs_tbf_cli_alloc(policy, head, req->rq_peer.nid, jobid,
+				moving_req);
+	if (cli == NULL)
+		return -ENOMEM;
+
+	cfs_hash_bd_lock(head->th_cli_hash, &bd, 1);
+	hnode = cfs_hash_bd_findadd_locked(head->th_cli_hash, &bd, key,
+					   &cli->tc_hnode, 1);
+	tmp = cfs_hlist_entry(hnode, struct nrs_tbf_client, tc_hnode);
+	if (tmp != cli) {
+		if (tmp->tc_ref++ == 0)
+			cfs_list_del_init(&tmp->tc_lru);
+	} else {
+		cli->tc_ref = 1;
+	}
+	cfs_hash_bd_unlock(head->th_cli_hash, &bd, 1);
+
+	if (tmp != cli) {
+		nrs_tbf_cli_free(cli);
+		cli = tmp;
+	}
+out:
+	*resp = &cli->tc_res;
+
+	return 1;
+}
+
+/**
+ * Called when releasing references to the resource hierachy obtained for a
+ * request for scheduling using the TBF policy. Clients that become idle are
+ * kept on their hash bucket's LRU list, so that their token buckets survive
+ * between requests; the least recently used ones are freed once the list
+ * grows beyond NRS_TBF_BKT_LRU_MAX entries.
+ *
+ * \param[in] policy   the policy the resource belongs to
+ * \param[in] res      the resource to be released
+ */
+static void nrs_tbf_res_put(struct ptlrpc_nrs_policy *policy,
+			    const struct ptlrpc_nrs_resource *res)
+{
+	struct nrs_tbf_head	*head;
+	struct nrs_tbf_client	*cli;
+	struct nrs_tbf_client	*tmp;
+	struct nrs_tbf_bucket	*bkt;
+	cfs_hash_bd_t		 bd;
+	CFS_LIST_HEAD		(zombies);
+	int			 nidle = 0;
+
+	/**
+	 * Do nothing for freeing parent, nrs_tbf_head resources
+	 */
+	if (res->res_parent == NULL)
+		return;
+
+	cli = container_of(res, struct nrs_tbf_client, tc_res);
+	head = container_of(res->res_parent, struct nrs_tbf_head, th_res);
+
+	cfs_hash_bd_get_and_lock(head->th_cli_hash,
+				 cfs_hash_key(head->th_cli_hash,
+					      &cli->tc_hnode), &bd, 1);
+	LASSERT(cli->tc_ref > 0);
+	if (--cli->tc_ref == 0) {
+		bkt = cfs_hash_bd_extra_get(head->th_cli_hash, &bd);
+		cfs_list_add_tail(&cli->tc_lru, &bkt->ntb_lru);
+
+		cfs_list_for_each_entry(tmp, &bkt->ntb_lru, tc_lru)
+			nidle++;
+
+		while (nidle-- > NRS_TBF_BKT_LRU_MAX) {
+			tmp = cfs_list_entry(bkt->ntb_lru.next,
+					     struct nrs_tbf_client, tc_lru);
+			cfs_hash_bd_del_locked(head->th_cli_hash, &bd,
+					       &tmp->tc_hnode);
+			cfs_list_move(&tmp->tc_lru, &zombies);
+		}
+	}
+	cfs_hash_bd_unlock(head->th_cli_hash, &bd, 1);
+
+	while (!cfs_list_empty(&zombies)) {
+		tmp = cfs_list_entry(zombies.next, struct nrs_tbf_client,
+				     tc_lru);
+		cfs_list_del_init(&tmp->tc_lru);
+		nrs_tbf_cli_free(tmp);
+	}
+}
+
+/**
+ * Called when getting a request from the TBF policy for handling, so that it
+ * can be served.
+ *
+ * If the client at the root of the binary heap has no tokens left, no client
+ * can be served yet; the NRS head is then marked as throttling, and a timer
+ * is armed to wake up the service threads when the client is due.
+ *
+ * \param[in] policy the policy being polled
+ * \param[in] peek   when set, signifies that we just want to examine the
+ *		     request, and not handle it, so the request is not removed
+ *		     from the policy.
+ * \param[in] force  force the policy to return a request, regardless of the
+ *		     available tokens; used when cleaning up
+ *
+ * \retval the request to be handled
+ * \retval NULL no request available
+ *
+ * \see ptlrpc_nrs_req_get_nolock()
+ * \see nrs_request_get()
+ */
+static
+struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
+					   bool peek, bool force)
+{
+	struct nrs_tbf_head	  *head = policy->pol_private;
+	struct ptlrpc_nrs_request *nrq;
+	struct nrs_tbf_client	  *cli;
+	cfs_binheap_node_t	  *node;
+	__u64			   now;
+
+	node = cfs_binheap_root(head->th_binheap);
+	if (unlikely(node == NULL))
+		return NULL;
+
+	cli = container_of(node, struct nrs_tbf_client, tc_node);
+	LASSERT(cli->tc_in_heap);
+	LASSERT(!cfs_list_empty(&cli->tc_list));
+
+	nrq = cfs_list_entry(cli->tc_list.next, struct ptlrpc_nrs_request,
+			     nr_u.tbf.tr_list);
+	if (peek)
+		return nrq;
+
+	now = nrs_tbf_now();
+	nrs_tbf_cli_refill(cli, now);
+
+	if (cli->tc_ntoken == 0) {
+		if (!force) {
+			policy->pol_nrs->nrs_throttling = 1;
+			nrs_tbf_timer_arm(head, nrs_tbf_cli_deadline(cli),
+					  now);
+			return NULL;
+		}
+	} else {
+		cli->tc_ntoken--;
+	}
+
+	cfs_list_del_init(&nrq->nr_u.tbf.tr_list);
+	if (cfs_list_empty(&cli->tc_list)) {
+		cfs_binheap_remove(head->th_binheap, &cli->tc_node);
+		cli->tc_in_heap = 0;
+	} else {
+		cfs_binheap_relocate(head->th_binheap, &cli->tc_node);
+	}
+
+	CDEBUG(D_RPCTRACE,
+	       "NRS: starting to handle %s request from %s, seq: "LPU64"\n",
+	       NRS_POL_NAME_TBF,
+	       libcfs_id2str(container_of(nrq, struct ptlrpc_request,
+					  rq_nrq)->rq_peer),
+	       nrq->nr_u.tbf.tr_sequence);
+
+	return nrq;
+}
+
+/**
+ * Adds request \a nrq to a TBF \a policy instance's set of queued requests
+ *
+ * If the client has been classified against a rule set that has since
+ * changed, it is classified again; if the NRS head is throttling, and the
+ * client is due to be served before the timer goes off, the timer is rearmed.
+ *
+ * \param[in] policy the policy
+ * \param[in] nrq    the request to add
+ *
+ * \retval 0	request successfully added
+ * \retval != 0 error
+ */
+static int nrs_tbf_req_add(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_tbf_head	*head;
+	struct nrs_tbf_client	*cli;
+	__u64			 now;
+	int			 rc;
+
+	cli = container_of(nrs_request_resource(nrq),
+			   struct nrs_tbf_client, tc_res);
+	head = container_of(nrs_request_resource(nrq)->res_parent,
+			    struct nrs_tbf_head, th_res);
+
+	if (unlikely(cli->tc_rule_generation != head->th_generation)) {
+		nrs_tbf_cli_classify(head, cli);
+		if (cli->tc_in_heap)
+			cfs_binheap_relocate(head->th_binheap, &cli->tc_node);
+	}
+
+	if (cfs_list_empty(&cli->tc_list)) {
+		LASSERT(!cli->tc_in_heap);
+
+		now = nrs_tbf_now();
+		nrs_tbf_cli_refill(cli, now);
+
+		rc = cfs_binheap_insert(head->th_binheap, &cli->tc_node);
+		if (rc != 0)
+			return rc;
+		cli->tc_in_heap = 1;
+
+		if (policy->pol_nrs->nrs_throttling &&
+		    nrs_tbf_cli_deadline(cli) < head->th_deadline)
+			nrs_tbf_timer_arm(head, nrs_tbf_cli_deadline(cli),
+					  now);
+	}
+
+	nrq->nr_u.tbf.tr_sequence = head->th_sequence++;
+	cfs_list_add_tail(&nrq->nr_u.tbf.tr_list, &cli->tc_list);
+
+	return 0;
+}
+
+/**
+ * Removes request \a nrq from a TBF \a policy instance's set of queued
+ * requests.
+ *
+ * \param[in] policy the policy
+ * \param[in] nrq    the request to remove
+ */
+static void nrs_tbf_req_del(struct ptlrpc_nrs_policy *policy,
+			    struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_tbf_head	*head;
+	struct nrs_tbf_client	*cli;
+
+	cli = container_of(nrs_request_resource(nrq),
+			   struct nrs_tbf_client, tc_res);
+	head = container_of(nrs_request_resource(nrq)->res_parent,
+			    struct nrs_tbf_head, th_res);
+
+	LASSERT(!cfs_list_empty(&nrq->nr_u.tbf.tr_list));
+	cfs_list_del_init(&nrq->nr_u.tbf.tr_list);
+	if (cfs_list_empty(&cli->tc_list)) {
+		cfs_binheap_remove(head->th_binheap, &cli->tc_node);
+		cli->tc_in_heap = 0;
+	}
+}
+
+/**
+ * Called right after the request \a nrq finishes being handled by TBF policy
+ * instance \a policy.
+ *
+ * \param[in] policy the policy that handled the request
+ * \param[in] nrq    the request that was handled
+ */
+static void nrs_tbf_req_stop(struct ptlrpc_nrs_policy *policy,
+			     struct ptlrpc_nrs_request *nrq)
+{
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+
+	CDEBUG(D_RPCTRACE,
+	       "NRS: finished handling %s request from %s, seq: "LPU64"\n",
+	       NRS_POL_NAME_TBF, libcfs_id2str(req->rq_peer),
+	       nrq->nr_u.tbf.tr_sequence);
+}
+
+#ifdef LPROCFS
+
+/**
+ * lprocfs interface
+ */
+
+/**
+ * The maximum length of a command written to the nrs_tbf_rule file
+ */
+#define LPROCFS_NRS_WR_TBF_MAX_CMD	4096
+
+/**
+ * Retrieves the rules of TBF policy instances on both the regular and
+ * high-priority NRS head of a service, as long as a policy instance is not in
+ * the ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+ *
+ * For example:
+ *
+ *	regular_requests:
+ *	CPT 0:
+ *	dd {dd.0 dd.1} 100, ref 2
+ *	default {*} 10000, ref 0
+ *	high_priority_requests:
+ *	CPT 0:
+ *	default {*} 10000, ref 0
+ */
+static int
+ptlrpc_lprocfs_nrs_tbf_rule_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service	*svc = m->private;
+	int			 rc;
+
+	seq_printf(m, "regular_requests:\n");
+	/**
+	 * Perform two separate calls to this as only one of the NRS heads'
+	 * policies may be in the ptlrpc_nrs_pol_state::NRS_POL_STATE_STARTED or
+	 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPING state.
+	 */
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_TBF,
+				       NRS_CTL_TBF_RD_RULE,
+				       false, m);
+	/**
+	 * Ignore -ENODEV as the regular NRS head's policy may be in the
+	 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+	 */
+	if (rc != 0 && rc != -ENODEV)
+		return rc;
+
+	if (!nrs_svc_has_hp(svc))
+		return 0;
+
+	seq_printf(m, "high_priority_requests:\n");
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+				       NRS_POL_NAME_TBF,
+				       NRS_CTL_TBF_RD_RULE,
+				       false, m);
+	if (rc != 0 && rc != -ENODEV)
+		return rc;
+
+	return 0;
+}
+
+static void nrs_tbf_cmd_fini(struct nrs_tbf_cmd *cmd)
+{
+	struct nrs_tbf_rule *rule;
+
+	while (!cfs_list_empty(&cmd->tc_rules)) {
+		rule = cfs_list_entry(cmd->tc_rules.next, struct nrs_tbf_rule,
+				      tr_linkage);
+		cfs_list_del_init(&rule->tr_linkage);
+		nrs_tbf_rule_put(rule);
+	}
+}
+
+/**
+ * Parses a "rate=<n>" token into \a rate.
+ */
+static int nrs_tbf_rate_parse(char *str, __u64 *rate)
+{
+	unsigned long val;
+
+	if (str == NULL || strncmp(str, "rate=", 5) != 0)
+		return -EINVAL;
+
+	str += 5;
+	if (!isdigit(*str))
+		return -EINVAL;
+
+	val = simple_strtoul(str, &str, 10);
+	if (*str != '\0' || val == 0 || val > NRS_TBF_RATE_MAX)
+		return -EINVAL;
+
+	*rate = val;
+	return 0;
+}
+
+/**
+ * Applies a parsed TBF rule command to the policy instances on NRS head(s)
+ * \a queue of service \a svc. For rule starting commands, a rule is parsed
+ * from \a type and \a expr for each service partition beforehand, since
+ * rules cannot be allocated while under ptlrpc_nrs::nrs_lock.
+ */
+static int nrs_tbf_cmd_apply(struct ptlrpc_service *svc,
+			     enum ptlrpc_nrs_queue_type queue,
+			     struct nrs_tbf_cmd *cmd, enum nrs_tbf_flag type,
+			     char *expr, int len)
+{
+	struct nrs_tbf_rule	*rule;
+	int			 i;
+	int			 rc = 0;
+
+	CFS_INIT_LIST_HEAD(&cmd->tc_rules);
+
+	if (cmd->tc_cmd == NRS_CTL_TBF_START_RULE) {
+		for (i = 0; i < svc->srv_ncpts; i++) {
+			rule = nrs_tbf_rule_alloc(cmd->tc_name, type, expr,
+						  len, cmd->tc_rpc_rate);
+			if (IS_ERR(rule))
+				GOTO(out, rc = PTR_ERR(rule));
+
+			cfs_list_add_tail(&rule->tr_linkage, &cmd->tc_rules);
+		}
+	}
+
+	rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_TBF,
+				       NRS_CTL_TBF_WR_RULE, false, cmd);
+out:
+	nrs_tbf_cmd_fini(cmd);
+
+	return rc;
+}
+
+/**
+ * Starts, changes or stops a rule of the TBF policy instances of a service.
+ * The user can operate on the regular or high priority NRS head individually
+ * by prefixing the command with "reg" or "hp"; otherwise the command is
+ * carried out on both.
+ *
+ * For example:
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_tbf_rule="start dd jobid={dd.0} rate=100"
+ * to limit the RPCs of JobID dd.0 to 100 per second on each CPT of the ost_io
+ * service, when the policy has been started with "tbf jobid",
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_tbf_rule=\
+ * "start loginnodes nid={192.168.1.[1-4]@tcp} rate=500"
+ * to limit the RPCs of each of the given NIDs, when the policy has been
+ * started with "tbf nid",
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_tbf_rule="change dd rate=200", and
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_tbf_rule="reg stop dd".
+ *
+ * The default rule matches all requests that no other rule matches; its rate
+ * can be changed, but it cannot be stopped.
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_tbf_rule_seq_write(struct file *file, const char *buffer,
+				      size_t count, loff_t *off)
+{
+	struct seq_file		   *m = file->private_data;
+	struct ptlrpc_service	   *svc = m->private;
+	enum ptlrpc_nrs_queue_type  queue = PTLRPC_NRS_QUEUE_BOTH;
+	enum nrs_tbf_flag	    type = NRS_TBF_FLAG_INVALID;
+	struct nrs_tbf_cmd	    cmd;
+	char			   *kernbuf;
+	char			   *str;
+	char			   *token;
+	char			   *expr = NULL;
+	int			    len = 0;
+	int			    rc = 0;
+	int			    rc2 = 0;
+	ENTRY;
+
+	if (count > LPROCFS_NRS_WR_TBF_MAX_CMD - 1)
+		RETURN(-EINVAL);
+
+	OBD_ALLOC(kernbuf, LPROCFS_NRS_WR_TBF_MAX_CMD);
+	if (kernbuf == NULL)
+		RETURN(-ENOMEM);
+
+	if (copy_from_user(kernbuf, buffer, count))
+		GOTO(out, rc = -EFAULT);
+
+	kernbuf[count] = '\0';
+	if (count > 0 && kernbuf[count - 1] == '\n')
+		kernbuf[count - 1] = '\0';
+
+	str = kernbuf;
+	token = strsep(&str, " ");
+	if (strcmp(token, "reg") == 0) {
+		queue = PTLRPC_NRS_QUEUE_REG;
+		token = strsep(&str, " ");
+	} else if (strcmp(token, "hp") == 0) {
+		queue = PTLRPC_NRS_QUEUE_HP;
+		token = strsep(&str, " ");
+	}
+
+	if (token == NULL)
+		GOTO(out, rc = -EINVAL);
+
+	memset(&cmd, 0, sizeof(cmd));
+	if (strcmp(token, "start") == 0)
+		cmd.tc_cmd = NRS_CTL_TBF_START_RULE;
+	else if (strcmp(token, "change") == 0)
+		cmd.tc_cmd = NRS_CTL_TBF_CHANGE_RATE;
+	else if (strcmp(token, "stop") == 0)
+		cmd.tc_cmd = NRS_CTL_TBF_STOP_RULE;
+	else
+		GOTO(out, rc = -EINVAL);
+
+	cmd.tc_name = strsep(&str, " ");
+	if (cmd.tc_name == NULL || cmd.tc_name[0] == '\0' ||
+	    strlen(cmd.tc_name) > NRS_TBF_RULE_NAME_MAX - 1)
+		GOTO(out, rc = -EINVAL);
+
+	switch (cmd.tc_cmd) {
+	case NRS_CTL_TBF_START_RULE: {
+		char *end;
+
+		if (str == NULL)
+			GOTO(out, rc = -EINVAL);
+
+		if (strncmp(str, NRS_TBF_TYPE_JOBID"={", 7) == 0) {
+			type = NRS_TBF_FLAG_JOBID;
+			expr = str + 7;
+		} else if (strncmp(str, NRS_TBF_TYPE_NID"={", 5) == 0) {
+			type = NRS_TBF_FLAG_NID;
+			expr = str + 5;
+		} else {
+			GOTO(out, rc = -EINVAL);
+		}
+
+		end = strchr(expr, '}');
+		if (end == NULL || end == expr)
+			GOTO(out, rc = -EINVAL);
+
+		*end++ = '\0';
+		len = end - expr - 1;
+
+		cmd.tc_rpc_rate = tbf_rate;
+		if (*end == ' ')
+			rc = nrs_tbf_rate_parse(end + 1, &cmd.tc_rpc_rate);
+		else if (*end != '\0')
+			rc = -EINVAL;
+		if (rc != 0)
+			GOTO(out, rc);
+		break;
+	}
+	case NRS_CTL_TBF_CHANGE_RATE:
+		rc = nrs_tbf_rate_parse(str, &cmd.tc_rpc_rate);
+		if (rc != 0)
+			GOTO(out, rc);
+		break;
+
+	case NRS_CTL_TBF_STOP_RULE:
+		if (str != NULL)
+			GOTO(out, rc = -EINVAL);
+		break;
+	}
+
+	if (queue == PTLRPC_NRS_QUEUE_HP && !nrs_svc_has_hp(svc))
+		GOTO(out, rc = -ENODEV);
+	else if (queue == PTLRPC_NRS_QUEUE_BOTH && !nrs_svc_has_hp(svc))
+		queue = PTLRPC_NRS_QUEUE_REG;
+
+	/**
+	 * As for the quantum files of other policies, the regular and HP NRS
+	 * heads are operated on separately, and -ENODEV is only returned if
+	 * the policy is stopped on all heads specified by the command.
+	 */
+	if ((queue & PTLRPC_NRS_QUEUE_REG) != 0) {
+		rc = nrs_tbf_cmd_apply(svc, PTLRPC_NRS_QUEUE_REG, &cmd, type,
+				       expr, len);
+		if ((rc < 0 && rc != -ENODEV) ||
+		    (rc == -ENODEV && queue == PTLRPC_NRS_QUEUE_REG))
+			GOTO(out, rc);
+	}
+
+	if ((queue & PTLRPC_NRS_QUEUE_HP) != 0) {
+		rc2 = nrs_tbf_cmd_apply(svc, PTLRPC_NRS_QUEUE_HP, &cmd, type,
+					expr, len);
+		if ((rc2 < 0 && rc2 != -ENODEV) ||
+		    (rc2 == -ENODEV && queue == PTLRPC_NRS_QUEUE_HP))
+			GOTO(out, rc = rc2);
+	}
+
+	if (rc == -ENODEV && rc2 == -ENODEV)
+		GOTO(out, rc);
+
+	rc = 0;
+out:
+	OBD_FREE(kernbuf, LPROCFS_NRS_WR_TBF_MAX_CMD);
+
+	RETURN(rc < 0 ? rc : count);
+}
+LPROC_SEQ_FOPS(ptlrpc_lprocfs_nrs_tbf_rule);
+
+/**
+ * Initializes a TBF policy's lprocfs interface for service \a svc
+ *
+ * \param[in] svc the service
+ *
+ * \retval 0	success
+ * \retval != 0	error
+ */
+static int nrs_tbf_lprocfs_init(struct ptlrpc_service *svc)
+{
+	struct lprocfs_seq_vars nrs_tbf_lprocfs_vars[] = {
+		{ .name		= "nrs_tbf_rule",
+		  .fops		= &ptlrpc_lprocfs_nrs_tbf_rule_fops,
+		  .data = svc },
+		{ NULL }
+	};
+
+	if (svc->srv_procroot == NULL)
+		return 0;
+
+	return lprocfs_seq_add_vars(svc->srv_procroot, nrs_tbf_lprocfs_vars,
+				    NULL);
+}
+
+/**
+ * Cleans up a TBF policy's lprocfs interface for service \a svc
+ *
+ * \param[in] svc the service
+ */
+void nrs_tbf_lprocfs_fini(struct ptlrpc_service *svc)
+{
+	if (svc->srv_procroot == NULL)
+		return;
+
+	lprocfs_remove_proc_entry("nrs_tbf_rule", svc->srv_procroot);
+}
+
+#endif /* LPROCFS */
+
+/**
+ * TBF policy operations
+ */
+static const struct ptlrpc_nrs_pol_ops nrs_tbf_ops = {
+	.op_policy_start	= nrs_tbf_start,
+	.op_policy_stop		= nrs_tbf_stop,
+	.op_policy_ctl		= nrs_tbf_ctl,
+	.op_res_get		= nrs_tbf_res_get,
+	.op_res_put		= nrs_tbf_res_put,
+	.op_req_get		= nrs_tbf_req_get,
+	.op_req_enqueue		= nrs_tbf_req_add,
+	.op_req_dequeue		= nrs_tbf_req_del,
+	.op_req_stop		= nrs_tbf_req_stop,
+#ifdef LPROCFS
+	.op_lprocfs_init	= nrs_tbf_lprocfs_init,
+	.op_lprocfs_fini	= nrs_tbf_lprocfs_fini,
+#endif
+};
+
+/**
+ * TBF policy configuration
+ */
+struct ptlrpc_nrs_pol_conf nrs_conf_tbf = {
+	.nc_name		= NRS_POL_NAME_TBF,
+	.nc_ops			= &nrs_tbf_ops,
+	.nc_compat		= nrs_policy_compat_all,
+};
+
+/** @} TBF policy */
+
+/** @} nrs */
+
+#endif /* HAVE_SERVER_SUPPORT */
@@ -2297,6 +2297,7 @@ void lustre_swab_quota_body(struct quota_body *b)
 	lustre_swab_lu_fid(&b->qb_fid);
 	lustre_swab_lu_fid((struct lu_fid *)&b->qb_id);
 	__swab32s(&b->qb_flags);
+	__swab32s(&b->qb_rc);
 	__swab64s(&b->qb_count);
 	__swab64s(&b->qb_usage);
 	__swab64s(&b->qb_slv_ver);
@@ -598,10 +598,12 @@ int ping_evictor_wake(struct obd_export *exp)
 
 static int ping_evictor_main(void *arg)
 {
+	struct obd_timed_exports *ote;
         struct obd_device *obd;
         struct obd_export *exp;
         struct l_wait_info lwi = { 0 };
         time_t expire_time;
+	int i;
         ENTRY;
 
 	unshare_fs_struct();
@@ -629,42 +631,49 @@ static int ping_evictor_main(void *arg)
                 CDEBUG(D_HA, "evicting all exports of obd %s older than %ld\n",
                        obd->obd_name, expire_time);
 
-                /* Exports can't be deleted out of the list while we hold
-                 * the obd lock (class_unlink_export), which means we can't
-                 * lose the last ref on the export.  If they've already been
-                 * removed from the list, we won't find them here. */
-		spin_lock(&obd->obd_dev_lock);
-		while (!cfs_list_empty(&obd->obd_exports_timed)) {
-			exp = cfs_list_entry(obd->obd_exports_timed.next,
-					     struct obd_export,
-					     exp_obd_chain_timed);
-			if (expire_time > exp->exp_last_request_time) {
+		/* Exports can't be deleted out of the list while we hold
+		 * the partition lock (class_unlink_export), which means we
+		 * can't lose the last ref on the export.  If they've already
+		 * been removed from the list, we won't find them here.
+		 * Each partition is sorted on its own. */
+		cfs_percpt_for_each(ote, i, obd->obd_exports_timed) {
+			spin_lock(&ote->ote_lock);
+			while (!cfs_list_empty(&ote->ote_list)) {
+				exp = cfs_list_entry(ote->ote_list.next,
+						     struct obd_export,
+						     exp_obd_chain_timed);
+				if (expire_time <= exp->exp_last_request_time)
+					/* List is sorted, so everyone below
+					 * is ok */
+					break;
+
 				class_export_get(exp);
-				spin_unlock(&obd->obd_dev_lock);
-				LCONSOLE_WARN("%s: haven't heard from client %s"
-                                              " (at %s) in %ld seconds. I think"
-                                              " it's dead, and I am evicting"
-                                              " it. exp %p, cur %ld expire %ld"
-                                              " last %ld\n",
-                                              obd->obd_name,
-                                              obd_uuid2str(&exp->exp_client_uuid),
-                                              obd_export_nid2str(exp),
-                                              (long)(cfs_time_current_sec() -
-                                                     exp->exp_last_request_time),
-                                              exp, (long)cfs_time_current_sec(),
-                                              (long)expire_time,
-                                              (long)exp->exp_last_request_time);
-                                CDEBUG(D_HA, "Last request was at %ld\n",
-                                       exp->exp_last_request_time);
-                                class_fail_export(exp);
-                                class_export_put(exp);
-				spin_lock(&obd->obd_dev_lock);
-			} else {
-				/* List is sorted, so everyone below is ok */
-				break;
+				spin_unlock(&ote->ote_lock);
+				LCONSOLE_WARN("%s: haven't heard from client "
+					      "%s (at %s) in %ld seconds. I "
+					      "think it's dead, and I am "
+					      "evicting it. exp %p, cur %ld "
+					      "expire %ld last %ld\n",
+					      obd->obd_name,
+					      obd_uuid2str(&exp->exp_client_uuid),
+					      obd_export_nid2str(exp),
+					      (long)(cfs_time_current_sec() -
+						     exp->exp_last_request_time),
+					      exp, (long)cfs_time_current_sec(),
+					      (long)expire_time,
+					      (long)exp->exp_last_request_time);
+				CDEBUG(D_HA, "Last request was at %ld\n",
+				       exp->exp_last_request_time);
+				class_fail_export(exp);
+				class_export_put(exp);
+				spin_lock(&ote->ote_lock);
 			}
+			if (cfs_list_empty(&ote->ote_list))
+				ote->ote_oldest = 0;
+			else
+				ote->ote_oldest = exp->exp_last_request_time;
+			spin_unlock(&ote->ote_lock);
 		}
-		spin_unlock(&obd->obd_dev_lock);
 
 		spin_lock(&pet_lock);
 		cfs_list_del_init(&obd->obd_evict_list);
@@ -625,6 +625,7 @@ ptlrpc_service_part_init(struct ptlrpc_service *svc,
 
 	svcpt->scp_cpt = cpt;
 	CFS_INIT_LIST_HEAD(&svcpt->scp_threads);
+	spin_lock_init(&svcpt->scp_thr_util.oh_lock);
 
 	/* rqbd and incoming request queue */
 	spin_lock_init(&svcpt->scp_lock);
@@ -780,6 +781,7 @@ ptlrpc_register_service(struct ptlrpc_service_conf *conf,
 	spin_lock_init(&service->srv_lock);
 	service->srv_name		= conf->psc_name;
 	service->srv_watchdog_factor	= conf->psc_watchdog_factor;
+	service->srv_thr_idle_timeout	= PTLRPC_THR_IDLE_TIMEOUT;
 	CFS_INIT_LIST_HEAD(&service->srv_list); /* for safty of cleanup */
 
 	/* buffer configuration */
@@ -1060,8 +1062,10 @@ static void ptlrpc_server_finish_active_request(
  */
 static void ptlrpc_update_export_timer(struct obd_export *exp, long extra_delay)
 {
+	struct obd_timed_exports *ote;
         struct obd_export *oldest_exp;
         time_t oldest_time, new_time;
+	int i;
 
         ENTRY;
 
@@ -1085,22 +1089,32 @@ static void ptlrpc_update_export_timer(struct obd_export *exp, long extra_delay)
 
         /* exports may get disconnected from the chain even though the
            export has references, so we must keep the spin lock while
-           manipulating the lists */
-	spin_lock(&exp->exp_obd->obd_dev_lock);
+           manipulating the lists. Only the partition of the export is
+           locked, the evictor checks all of them. */
+	ote = class_export_timed(exp);
+	spin_lock(&ote->ote_lock);
 
 	if (cfs_list_empty(&exp->exp_obd_chain_timed)) {
 		/* this one is not timed */
-		spin_unlock(&exp->exp_obd->obd_dev_lock);
+		spin_unlock(&ote->ote_lock);
                 RETURN_EXIT;
         }
 
-        cfs_list_move_tail(&exp->exp_obd_chain_timed,
-                           &exp->exp_obd->obd_exports_timed);
+	cfs_list_move_tail(&exp->exp_obd_chain_timed, &ote->ote_list);
 
-        oldest_exp = cfs_list_entry(exp->exp_obd->obd_exports_timed.next,
-                                    struct obd_export, exp_obd_chain_timed);
-        oldest_time = oldest_exp->exp_last_request_time;
-	spin_unlock(&exp->exp_obd->obd_dev_lock);
+	oldest_exp = cfs_list_entry(ote->ote_list.next, struct obd_export,
+				    exp_obd_chain_timed);
+	ote->ote_oldest = oldest_exp->exp_last_request_time;
+	spin_unlock(&ote->ote_lock);
+
+	/* merge the views of all the partitions, a stale value only makes
+	 * the evictor look at a partition for nothing */
+	oldest_time = 0;
+	cfs_percpt_for_each(ote, i, exp->exp_obd->obd_exports_timed) {
+		if (ote->ote_oldest != 0 &&
+		    (oldest_time == 0 || ote->ote_oldest < oldest_time))
+			oldest_time = ote->ote_oldest;
+	}
 
         if (exp->exp_obd->obd_recovering) {
                 /* be nice to everyone during recovery */
@@ -1111,17 +1125,18 @@ static void ptlrpc_update_export_timer(struct obd_export *exp, long extra_delay)
         /* Note - racing to start/reset the obd_eviction timer is safe */
         if (exp->exp_obd->obd_eviction_timer == 0) {
                 /* Check if the oldest entry is expired. */
-                if (cfs_time_current_sec() > (oldest_time + PING_EVICT_TIMEOUT +
-                                              extra_delay)) {
+		if (oldest_time != 0 &&
+		    cfs_time_current_sec() > (oldest_time + PING_EVICT_TIMEOUT +
+					      extra_delay)) {
                         /* We need a second timer, in case the net was down and
                          * it just came back. Since the pinger may skip every
                          * other PING_INTERVAL (see note in ptlrpc_pinger_main),
                          * we better wait for 3. */
                         exp->exp_obd->obd_eviction_timer =
                                 cfs_time_current_sec() + 3 * PING_INTERVAL;
-                        CDEBUG(D_HA, "%s: Think about evicting %s from "CFS_TIME_T"\n",
-                               exp->exp_obd->obd_name, 
-                               obd_export_nid2str(oldest_exp), oldest_time);
+			CDEBUG(D_HA, "%s: Think about evicting exports "
+			       "silent since "CFS_TIME_T"\n",
+			       exp->exp_obd->obd_name, oldest_time);
                 }
         } else {
                 if (cfs_time_current_sec() >
@@ -1717,7 +1732,8 @@ static bool ptlrpc_server_high_pending(struct ptlrpc_service_part *svcpt,
 				       bool force)
 {
 	return ptlrpc_server_allow_high(svcpt, force) &&
-	       ptlrpc_nrs_req_pending_nolock(svcpt, true);
+	       ptlrpc_nrs_req_pending_nolock(svcpt, true) &&
+	       (force || !ptlrpc_nrs_req_throttling_nolock(svcpt, true));
 }
 
 /**
@@ -1759,7 +1775,8 @@ static bool ptlrpc_server_normal_pending(struct ptlrpc_service_part *svcpt,
 					 bool force)
 {
 	return ptlrpc_server_allow_normal(svcpt, force) &&
-	       ptlrpc_nrs_req_pending_nolock(svcpt, false);
+	       ptlrpc_nrs_req_pending_nolock(svcpt, false) &&
+	       (force || !ptlrpc_nrs_req_throttling_nolock(svcpt, false));
 }
 
 /**
@@ -2027,6 +2044,9 @@ ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 
 	do_gettimeofday(&work_start);
 	timediff = cfs_timeval_sub(&work_start, &request->rq_arrival_time,NULL);
+	svcpt->scp_thr_wait = timediff;
+	lprocfs_oh_tally(&svcpt->scp_thr_util, svcpt->scp_nreqs_active * 10 /
+					       max(svcpt->scp_nthrs_running, 1));
 	if (likely(svc->srv_stats != NULL)) {
                 lprocfs_counter_add(svc->srv_stats, PTLRPC_REQWAIT_CNTR,
                                     timediff);
@@ -2385,6 +2405,72 @@ ptlrpc_threads_need_create(struct ptlrpc_service_part *svcpt)
 		ptlrpc_threads_increasable(svcpt);
 }
 
+/**
+ * How many threads \a svcpt should start now: one for each queued request
+ * that no idle thread can take, twice that if the last request waited longer
+ * than PTLRPC_THR_WAIT_HIGH, but no more than PTLRPC_NTHRS_BATCH at once and
+ * never over the partition limit.
+ * Called w/o lock, so the result is only a hint.
+ */
+static int
+ptlrpc_threads_deficit(struct ptlrpc_service_part *svcpt)
+{
+	int	queued;
+	int	idle;
+	int	nr;
+
+	if (!ptlrpc_threads_need_create(svcpt))
+		return 0;
+
+	queued = svcpt->scp_nreqs_incoming + svcpt->scp_nrs_reg.nrs_req_queued;
+	if (svcpt->scp_nrs_hp != NULL)
+		queued += svcpt->scp_nrs_hp->nrs_req_queued;
+
+	idle = svcpt->scp_nthrs_running + svcpt->scp_nthrs_starting -
+	       svcpt->scp_nreqs_active;
+	nr = max(queued - idle, 1);
+	if (svcpt->scp_thr_wait > PTLRPC_THR_WAIT_HIGH)
+		nr *= 2;
+
+	nr = min(nr, PTLRPC_NTHRS_BATCH);
+	return min(nr, svcpt->scp_service->srv_nthrs_cpt_limit -
+		       svcpt->scp_nthrs_running - svcpt->scp_nthrs_starting);
+}
+
+/**
+ * more threads running than the service needs at least, so an idle one can
+ * exit to save its stack and memory
+ */
+static inline int
+ptlrpc_threads_surplus(struct ptlrpc_service_part *svcpt)
+{
+	return svcpt->scp_nthrs_running >
+	       svcpt->scp_service->srv_nthrs_cpt_init;
+}
+
+/**
+ * Called by \a thread after it has been idle for srv_thr_idle_timeout:
+ * stop counting it as running if the partition still has surplus threads.
+ * The decision is made under scp_lock so that idle threads timing out
+ * together never leave fewer than srv_nthrs_cpt_init behind.
+ */
+static int
+ptlrpc_thread_retire(struct ptlrpc_service_part *svcpt,
+		     struct ptlrpc_thread *thread)
+{
+	int	rc = 0;
+
+	spin_lock(&svcpt->scp_lock);
+	if (!thread_is_stopping(thread) && ptlrpc_threads_surplus(svcpt)) {
+		thread_clear_flags(thread, SVC_RUNNING);
+		svcpt->scp_nthrs_running--;
+		rc = 1;
+	}
+	spin_unlock(&svcpt->scp_lock);
+
+	return rc;
+}
+
 static inline int
 ptlrpc_thread_stopping(struct ptlrpc_thread *thread)
 {
@@ -2420,15 +2506,28 @@ static __attribute__((__noinline__)) int
 ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 		  struct ptlrpc_thread *thread)
 {
+	struct ptlrpc_service	*svc = svcpt->scp_service;
 	/* Don't exit while there are replies to be handled */
 	struct l_wait_info lwi = LWI_TIMEOUT(svcpt->scp_rqbd_timeout,
 					     ptlrpc_retry_rqbds, svcpt);
+	int			 idle = 0;
+	int			 rc;
+
+	/* threads beyond srv_nthrs_cpt_init exit once they stay idle; the
+	 * waitq wakes the most recently slept thread first, so it is the
+	 * least used threads that time out */
+	if (lwi.lwi_timeout == 0 && svc->srv_thr_idle_timeout > 0 &&
+	    ptlrpc_threads_surplus(svcpt)) {
+		lwi = LWI_TIMEOUT(cfs_time_seconds(svc->srv_thr_idle_timeout),
+				  NULL, NULL);
+		idle = 1;
+	}
 
 	lc_watchdog_disable(thread->t_watchdog);
 
 	cond_resched();
 
-	l_wait_event_exclusive_head(svcpt->scp_waitq,
+	rc = l_wait_event_exclusive_head(svcpt->scp_waitq,
 				ptlrpc_thread_stopping(thread) ||
 				ptlrpc_server_request_incoming(svcpt) ||
 				ptlrpc_server_request_pending(svcpt, false) ||
@@ -2438,6 +2537,9 @@ ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 	if (ptlrpc_thread_stopping(thread))
 		return -EINTR;
 
+	if (idle && rc == -ETIMEDOUT && ptlrpc_thread_retire(svcpt, thread))
+		return -ETIMEDOUT;
+
 	lc_watchdog_touch(thread->t_watchdog,
 			  ptlrpc_server_get_timeout(svcpt));
 	return 0;
@@ -2460,6 +2562,8 @@ static int ptlrpc_main(void *arg)
 #endif
 	struct lu_env *env;
 	int counter = 0, rc = 0;
+	int retired = 0;
+	int nr;
 	ENTRY;
 
 	thread->t_pid = current_pid();
@@ -2528,7 +2632,7 @@ static int ptlrpc_main(void *arg)
 	LASSERT(thread_is_starting(thread));
 	thread_clear_flags(thread, SVC_STARTING);
 
-	LASSERT(svcpt->scp_nthrs_starting == 1);
+	LASSERT(svcpt->scp_nthrs_starting > 0);
 	svcpt->scp_nthrs_starting--;
 
 	/* SVC_STOPPING may already be set here if someone else is trying
@@ -2555,15 +2659,21 @@ static int ptlrpc_main(void *arg)
 
 	/* XXX maintain a list of all managed devices: insert here */
 	while (!ptlrpc_thread_stopping(thread)) {
-		if (ptlrpc_wait_event(svcpt, thread))
+		rc = ptlrpc_wait_event(svcpt, thread);
+		if (rc != 0) {
+			retired = rc == -ETIMEDOUT;
+			rc = 0;
 			break;
+		}
 
 		ptlrpc_check_rqbd_pool(svcpt);
 
-		if (ptlrpc_threads_need_create(svcpt)) {
-			/* Ignore return code - we tried... */
-			ptlrpc_start_thread(svcpt, 0);
-                }
+		/* grow in batches rather than one thread per wakeup, stop
+		 * on the first failure - we tried... */
+		for (nr = ptlrpc_threads_deficit(svcpt); nr > 0; nr--) {
+			if (ptlrpc_start_thread(svcpt, 0) != 0)
+				break;
+		}
 
 		/* Process all incoming reqs before handling any */
 		if (ptlrpc_server_request_incoming(svcpt)) {
@@ -2601,6 +2711,20 @@ static int ptlrpc_main(void *arg)
         lc_watchdog_delete(thread->t_watchdog);
         thread->t_watchdog = NULL;
 
+	if (retired) {
+		/* retiring while idle, give back the reply state it added */
+		rs = NULL;
+		spin_lock(&svcpt->scp_rep_lock);
+		if (!cfs_list_empty(&svcpt->scp_rep_idle)) {
+			rs = cfs_list_entry(svcpt->scp_rep_idle.next,
+					    struct ptlrpc_reply_state, rs_list);
+			cfs_list_del(&rs->rs_list);
+		}
+		spin_unlock(&svcpt->scp_rep_lock);
+		if (rs != NULL)
+			OBD_FREE_LARGE(rs, svc->srv_max_reply_size);
+	}
+
 out_srv_fini:
         /*
          * deconstruct service specific state created by ptlrpc_start_thread()
@@ -2625,6 +2749,16 @@ out:
 		svcpt->scp_nthrs_running--;
 	}
 
+	if (retired && !thread_is_stopping(thread)) {
+		/* retired thread, nobody waits for it, so free it here */
+		CDEBUG(D_INFO, "%s idle thread %s retired, %d left\n",
+		       svc->srv_name, thread->t_name, svcpt->scp_nthrs_running);
+		cfs_list_del(&thread->t_link);
+		spin_unlock(&svcpt->scp_lock);
+		OBD_FREE_PTR(thread);
+		return 0;
+	}
+
 	thread->t_id = rc;
 	thread_add_flags(thread, SVC_STOPPED);
 
@@ -2866,7 +3000,6 @@ int ptlrpc_start_thread(struct ptlrpc_service_part *svcpt, int wait)
 	       svc->srv_name, svcpt->scp_cpt, svcpt->scp_nthrs_running,
 	       svc->srv_nthrs_cpt_init, svc->srv_nthrs_cpt_limit);
 
- again:
 	if (unlikely(svc->srv_is_stopping))
 		RETURN(-ESRCH);
 
@@ -2887,24 +3020,9 @@ int ptlrpc_start_thread(struct ptlrpc_service_part *svcpt, int wait)
 		RETURN(-EMFILE);
 	}
 
-	if (svcpt->scp_nthrs_starting != 0) {
-		/* serialize starting because some modules (obdfilter)
-		 * might require unique and contiguous t_id */
-		LASSERT(svcpt->scp_nthrs_starting == 1);
-		spin_unlock(&svcpt->scp_lock);
-		OBD_FREE_PTR(thread);
-		if (wait) {
-			CDEBUG(D_INFO, "Waiting for creating thread %s #%d\n",
-			       svc->srv_thread_name, svcpt->scp_thr_nextid);
-			schedule();
-			goto again;
-		}
-
-		CDEBUG(D_INFO, "Creating thread %s #%d race, retry later\n",
-		       svc->srv_thread_name, svcpt->scp_thr_nextid);
-		RETURN(-EAGAIN);
-	}
-
+	/* several threads may be starting at once: t_id stays unique as
+	 * scp_thr_nextid only increases, but it isn't contiguous any more
+	 * since idle threads can retire */
 	svcpt->scp_nthrs_starting++;
 	thread->t_id = svcpt->scp_thr_nextid++;
 	thread_add_flags(thread, SVC_STARTING);
@@ -239,6 +239,7 @@ static int qmt_device_init0(const struct lu_env *env, struct qmt_device *qmt,
 	init_waitqueue_head(&qmt->qmt_reba_thread.t_ctl_waitq);
 	CFS_INIT_LIST_HEAD(&qmt->qmt_reba_list);
 	spin_lock_init(&qmt->qmt_reba_lock);
+	spin_lock_init(&qmt->qmt_hot_lock);
 	rc = qmt_start_reba_thread(qmt);
 	if (rc) {
 		CERROR("%s: failed to start rebalance thread (%d)\n",
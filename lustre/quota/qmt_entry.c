@@ -200,11 +200,7 @@ out:
 			     ", rc:%d", PFID(lu_object_fid(&slv_obj->do_lu)),
 			     rc);
 	} else {
-		restore->qlr_hardlimit = lqe->lqe_hardlimit;
-		restore->qlr_softlimit = lqe->lqe_softlimit;
-		restore->qlr_gracetime = lqe->lqe_gracetime;
-		restore->qlr_granted   = lqe->lqe_granted;
-		restore->qlr_qunit     = lqe->lqe_qunit;
+		qmt_restore_save(lqe, restore);
 	}
 	return th;
 }
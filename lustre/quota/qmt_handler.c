@@ -329,34 +329,92 @@ static int qmt_quotactl(const struct lu_env *env, struct lu_device *ld,
 }
 
 /*
- * Helper function to handle quota request from slave.
+ * Remember that \a lqe just had space granted to a slave which did not own
+ * any for this ID yet, so that it can be hinted to the other slaves.
+ * Called with the lqe write lock held.
+ */
+static void qmt_hot_add(struct lquota_entry *lqe, struct obd_uuid *uuid)
+{
+	struct qmt_device	*qmt = lqe2qpi(lqe)->qpi_qmt;
+	struct qmt_hot_id	*hot;
+
+	spin_lock(&qmt->qmt_hot_lock);
+	hot = &qmt->qmt_hot[qmt->qmt_hot_next];
+	qmt->qmt_hot_next = (qmt->qmt_hot_next + 1) % QMT_HOT_IDS;
+
+	hot->qhi_fid   = *lu_object_fid(&LQE_GLB_OBJ(lqe)->do_lu);
+	hot->qhi_id    = lqe->lqe_id;
+	hot->qhi_qunit = lqe->lqe_qunit;
+	hot->qhi_time  = cfs_time_current_sec();
+	hot->qhi_uuid  = *uuid;
+	spin_unlock(&qmt->qmt_hot_lock);
+}
+
+/*
+ * Fill up to \a max hints with the IDs which most recently acquired space on
+ * slaves other than \a uuid.
+ *
+ * \retval - the number of hints filled
+ */
+static int qmt_hot_fill(struct qmt_device *qmt, struct obd_uuid *uuid,
+			struct quota_body *hints, int max)
+{
+	struct qmt_hot_id	*hot;
+	cfs_time_t		 now = cfs_time_current_sec();
+	int			 nr = 0;
+	int			 i, j;
+
+	spin_lock(&qmt->qmt_hot_lock);
+	/* walk the ring from the newest entry */
+	for (i = 1; i <= QMT_HOT_IDS && nr < max; i++) {
+		hot = &qmt->qmt_hot[(qmt->qmt_hot_next + QMT_HOT_IDS - i) %
+				    QMT_HOT_IDS];
+		if (hot->qhi_time == 0 ||
+		    cfs_time_before(hot->qhi_time + QMT_HOT_AGE, now))
+			break;
+
+		if (obd_uuid_equals(&hot->qhi_uuid, uuid))
+			continue;
+
+		for (j = 0; j < nr; j++)
+			if (lu_fid_eq(&hints[j].qb_fid, &hot->qhi_fid) &&
+			    memcmp(&hints[j].qb_id, &hot->qhi_id,
+				       sizeof(hot->qhi_id)) == 0)
+				break;
+		if (j < nr)
+			continue;
+
+		memset(&hints[nr], 0, sizeof(hints[nr]));
+		hints[nr].qb_fid   = hot->qhi_fid;
+		hints[nr].qb_id    = hot->qhi_id;
+		hints[nr].qb_flags = QUOTA_DQACQ_FL_HINT;
+		hints[nr].qb_qunit = hot->qhi_qunit;
+		nr++;
+	}
+	spin_unlock(&qmt->qmt_hot_lock);
+
+	return nr;
+}
+
+/*
+ * Helper function preparing the processing of a quota request from slave:
+ * initialize the reply and find the slave index file to be updated.
  *
  * \param env     - is the environment passed by the caller
  * \param lqe     - is the lquota_entry subject to the quota request
  * \param qmt     - is the master device
  * \param uuid    - is the uuid associated with the slave
- * \param qb_flags - are the quota request flags as packed in the quota_body
- * \param qb_count - is the amount of quota space the slave wants to
- *                   acquire/release
- * \param qb_usage - is the current space usage on the slave
  * \param repbody - is the quota_body of reply
  *
- * \retval 0            : success
- * \retval -EDQUOT      : out of quota
- *         -EINPROGRESS : inform client to retry write/create
- *         -ve          : other appropriate errors
+ * \retval - the slave index object on success, ERR_PTR on failure
  */
-int qmt_dqacq0(const struct lu_env *env, struct lquota_entry *lqe,
-	       struct qmt_device *qmt, struct obd_uuid *uuid, __u32 qb_flags,
-	       __u64 qb_count, __u64 qb_usage, struct quota_body *repbody)
+static struct dt_object *qmt_dqacq_prep(const struct lu_env *env,
+					struct lquota_entry *lqe,
+					struct qmt_device *qmt,
+					struct obd_uuid *uuid,
+					struct quota_body *repbody)
 {
-	struct qmt_thread_info	*qti = qmt_info(env);
-	__u64			 now, count;
-	struct dt_object	*slv_obj = NULL;
-	__u64			 slv_granted, slv_granted_bck;
-	struct thandle		*th = NULL;
-	int			 rc, ret;
-	ENTRY;
+	struct dt_object	*slv_obj;
 
 	LASSERT(uuid != NULL);
 
@@ -365,30 +423,62 @@ int qmt_dqacq0(const struct lu_env *env, struct lquota_entry *lqe,
 	memcpy(&repbody->qb_id, &lqe->lqe_id, sizeof(repbody->qb_id));
 
 	if (OBD_FAIL_CHECK(OBD_FAIL_QUOTA_RECOVERABLE_ERR))
-		RETURN(-cfs_fail_val);
+		return ERR_PTR(-cfs_fail_val);
 
 	/* look-up index file associated with acquiring slave */
 	slv_obj = lquota_disk_slv_find(env, qmt->qmt_child, LQE_ROOT(lqe),
 				       lu_object_fid(&LQE_GLB_OBJ(lqe)->do_lu),
 				       uuid);
 	if (IS_ERR(slv_obj))
-		GOTO(out, rc = PTR_ERR(slv_obj));
+		return slv_obj;
 
 	/* pack slave fid in reply just for sanity check */
 	memcpy(&repbody->qb_slv_fid, lu_object_fid(&slv_obj->do_lu),
 	       sizeof(struct lu_fid));
+	return slv_obj;
+}
 
-	/* allocate & start transaction with enough credits to update
-	 * global & slave indexes */
-	th = qmt_trans_start_with_slv(env, lqe, slv_obj, &qti->qti_restore);
-	if (IS_ERR(th))
-		GOTO(out, rc = PTR_ERR(th));
+/*
+ * Helper function processing a quota request from slave within transaction
+ * \a th, which has credits reserved to update both the global index and the
+ * slave index \a slv_obj of \a lqe.
+ *
+ * \param env     - is the environment passed by the caller
+ * \param th      - is the transaction handle to be used for the disk writes
+ * \param lqe     - is the lquota_entry subject to the quota request
+ * \param slv_obj - is the slave index file of the requesting slave
+ * \param uuid    - is the uuid associated with the slave
+ * \param qb_flags - are the quota request flags as packed in the quota_body
+ * \param qb_count - is the amount of quota space the slave wants to
+ *                   acquire/release
+ * \param qb_usage - is the current space usage on the slave
+ * \param repbody - is the quota_body of reply, set up by qmt_dqacq_prep()
+ *
+ * \retval 0            : success
+ * \retval -EDQUOT      : out of quota
+ *         -EINPROGRESS : inform client to retry write/create
+ *         -ve          : other appropriate errors
+ */
+static int qmt_dqacq_apply(const struct lu_env *env, struct thandle *th,
+			   struct lquota_entry *lqe, struct dt_object *slv_obj,
+			   struct obd_uuid *uuid, __u32 qb_flags,
+			   __u64 qb_count, __u64 qb_usage,
+			   struct quota_body *repbody)
+{
+	struct qmt_thread_info	*qti = qmt_info(env);
+	__u64			 now, count;
+	__u64			 slv_granted, slv_granted_bck;
+	int			 rc, ret;
+	ENTRY;
 
 	lqe_write_lock(lqe);
 	LQUOTA_DEBUG(lqe, "dqacq starts uuid:%s flags:0x%x wanted:"LPU64
 		     " usage:"LPU64, obd_uuid2str(uuid), qb_flags, qb_count,
 		     qb_usage);
 
+	/* settings to restore if the index update fails */
+	qmt_restore_save(lqe, &qti->qti_restore);
+
 	/* Legal race, limits have been removed on master, but slave didn't
 	 * receive the change yet. Just return EINPROGRESS until the slave gets
 	 * notified. */
@@ -555,16 +645,15 @@ out_write:
 
 	/* clear/set edquot flag and notify slaves via glimpse if needed */
 	qmt_adjust_edquot(lqe, now);
+
+	/* first space for this ID on this slave, other slaves are likely to
+	 * see writes for it soon */
+	if (rc == 0 && req_is_acq(qb_flags) && slv_granted_bck == 0)
+		qmt_hot_add(lqe, uuid);
 out_locked:
 	LQUOTA_DEBUG(lqe, "dqacq ends count:"LPU64" ver:"LPU64" rc:%d",
 		     repbody->qb_count, repbody->qb_slv_ver, rc);
 	lqe_write_unlock(lqe);
-out:
-	if (th != NULL && !IS_ERR(th))
-		dt_trans_stop(env, qmt->qmt_child, th);
-
-	if (slv_obj != NULL && !IS_ERR(slv_obj))
-		lu_object_put(env, &slv_obj->do_lu);
 
 	if ((req_is_acq(qb_flags) || req_is_preacq(qb_flags)) &&
 	    OBD_FAIL_CHECK(OBD_FAIL_QUOTA_EDQUOT)) {
@@ -578,32 +667,76 @@ out:
 }
 
 /*
- * Handle quota request from slave.
+ * Helper function to handle quota request from slave.
  *
- * \param env  - is the environment passed by the caller
- * \param ld   - is the lu device associated with the qmt
- * \param req  - is the quota acquire request
+ * \param env     - is the environment passed by the caller
+ * \param lqe     - is the lquota_entry subject to the quota request
+ * \param qmt     - is the master device
+ * \param uuid    - is the uuid associated with the slave
+ * \param qb_flags - are the quota request flags as packed in the quota_body
+ * \param qb_count - is the amount of quota space the slave wants to
+ *                   acquire/release
+ * \param qb_usage - is the current space usage on the slave
+ * \param repbody - is the quota_body of reply
+ *
+ * \retval 0            : success
+ * \retval -EDQUOT      : out of quota
+ *         -EINPROGRESS : inform client to retry write/create
+ *         -ve          : other appropriate errors
  */
-static int qmt_dqacq(const struct lu_env *env, struct lu_device *ld,
-		     struct ptlrpc_request *req)
+int qmt_dqacq0(const struct lu_env *env, struct lquota_entry *lqe,
+	       struct qmt_device *qmt, struct obd_uuid *uuid, __u32 qb_flags,
+	       __u64 qb_count, __u64 qb_usage, struct quota_body *repbody)
 {
-	struct qmt_device	*qmt = lu2qmt_dev(ld);
-	struct quota_body	*qbody, *repbody;
-	struct obd_uuid		*uuid;
+	struct qmt_thread_info	*qti = qmt_info(env);
+	struct dt_object	*slv_obj;
+	struct thandle		*th;
+	int			 rc;
+	ENTRY;
+
+	slv_obj = qmt_dqacq_prep(env, lqe, qmt, uuid, repbody);
+	if (IS_ERR(slv_obj))
+		RETURN(PTR_ERR(slv_obj));
+
+	/* allocate & start transaction with enough credits to update
+	 * global & slave indexes */
+	th = qmt_trans_start_with_slv(env, lqe, slv_obj, &qti->qti_restore);
+	if (IS_ERR(th))
+		GOTO(out, rc = PTR_ERR(th));
+
+	rc = qmt_dqacq_apply(env, th, lqe, slv_obj, uuid, qb_flags, qb_count,
+			     qb_usage, repbody);
+
+	dt_trans_stop(env, qmt->qmt_child, th);
+	EXIT;
+out:
+	lu_object_put(env, &slv_obj->do_lu);
+	return rc;
+}
+
+/*
+ * Check that a quota request from slave is well formed and sent with valid
+ * locks, then find the quota entry it is about.
+ *
+ * \param env   - is the environment passed by the caller
+ * \param qmt   - is the master device
+ * \param req   - is the quota request
+ * \param qbody - is the quota_body to check
+ * \param lqep  - is where to return the quota entry on success
+ *
+ * \retval 0 on success, appropriate error on failure
+ */
+static int qmt_dqacq_check(const struct lu_env *env, struct qmt_device *qmt,
+			   struct ptlrpc_request *req, struct quota_body *qbody,
+			   struct lquota_entry **lqep)
+{
+	struct obd_uuid		*uuid = &req->rq_export->exp_client_uuid;
 	struct ldlm_lock	*lock;
 	struct lquota_entry	*lqe;
 	int			 pool_id, pool_type, qtype;
 	int			 rc;
 	ENTRY;
 
-	qbody = req_capsule_client_get(&req->rq_pill, &RMF_QUOTA_BODY);
-	if (qbody == NULL)
-		RETURN(err_serious(-EPROTO));
-
-	repbody = req_capsule_server_get(&req->rq_pill, &RMF_QUOTA_BODY);
-	if (repbody == NULL)
-		RETURN(err_serious(-EFAULT));
-
 	/* verify if global lock is stale */
 	if (!lustre_handle_is_used(&qbody->qb_glb_lockh))
 		RETURN(-ENOLCK);
@@ -613,8 +746,6 @@ static int qmt_dqacq(const struct lu_env *env, struct lu_device *ld,
 		RETURN(-ENOLCK);
 	LDLM_LOCK_PUT(lock);
 
-	uuid = &req->rq_export->exp_client_uuid;
-
 	if (req_is_rel(qbody->qb_flags) + req_is_acq(qbody->qb_flags) +
 	    req_is_preacq(qbody->qb_flags) > 1) {
 		CERROR("%s: malformed quota request with conflicting flags set "
@@ -669,9 +800,42 @@ static int qmt_dqacq(const struct lu_env *env, struct lu_device *ld,
 	if (IS_ERR(lqe))
 		RETURN(PTR_ERR(lqe));
 
+	*lqep = lqe;
+	RETURN(0);
+}
+
+/*
+ * Handle quota request from slave.
+ *
+ * \param env  - is the environment passed by the caller
+ * \param ld   - is the lu device associated with the qmt
+ * \param req  - is the quota acquire request
+ */
+static int qmt_dqacq(const struct lu_env *env, struct lu_device *ld,
+		     struct ptlrpc_request *req)
+{
+	struct qmt_device	*qmt = lu2qmt_dev(ld);
+	struct quota_body	*qbody, *repbody;
+	struct lquota_entry	*lqe;
+	int			 rc;
+	ENTRY;
+
+	qbody = req_capsule_client_get(&req->rq_pill, &RMF_QUOTA_BODY);
+	if (qbody == NULL)
+		RETURN(err_serious(-EPROTO));
+
+	repbody = req_capsule_server_get(&req->rq_pill, &RMF_QUOTA_BODY);
+	if (repbody == NULL)
+		RETURN(err_serious(-EFAULT));
+
+	rc = qmt_dqacq_check(env, qmt, req, qbody, &lqe);
+	if (rc)
+		RETURN(rc);
+
 	/* process quota request */
-	rc = qmt_dqacq0(env, lqe, qmt, uuid, qbody->qb_flags, qbody->qb_count,
-			qbody->qb_usage, repbody);
+	rc = qmt_dqacq0(env, lqe, qmt, &req->rq_export->exp_client_uuid,
+			qbody->qb_flags, qbody->qb_count, qbody->qb_usage,
+			repbody);
 
 	if (lustre_handle_is_used(&qbody->qb_lockh))
 		/* return current qunit value only to slaves owning an per-ID
@@ -682,12 +846,140 @@ static int qmt_dqacq(const struct lu_env *env, struct lu_device *ld,
 	RETURN(rc);
 }
 
+/*
+ * Handle a batch of quota requests from slave.
+ * All the index updates are done in a single transaction. The reply carries
+ * one quota_body per request, with the return code of the request in qb_rc,
+ * followed by up to QUOTA_BATCH_HINTS quota_body flagged with
+ * QUOTA_DQACQ_FL_HINT for IDs which just acquired space on other slaves.
+ *
+ * \param env  - is the environment passed by the caller
+ * \param ld   - is the lu device associated with the qmt
+ * \param req  - is the batched quota acquire request
+ */
+static int qmt_dqacq_batch(const struct lu_env *env, struct lu_device *ld,
+			   struct ptlrpc_request *req)
+{
+	struct qmt_device	*qmt = lu2qmt_dev(ld);
+	struct qmt_thread_info	*qti = qmt_info(env);
+	struct req_capsule	*pill = &req->rq_pill;
+	struct obd_uuid		*uuid = &req->rq_export->exp_client_uuid;
+	struct quota_body	*reqbody, *repbody;
+	struct lquota_entry	**lqes = qti->qti_lqes;
+	struct dt_object	**slv_objs = qti->qti_slv_objs;
+	struct dt_object	*slv_obj;
+	struct thandle		*th;
+	int			 nr, nr_hint, nr_valid = 0;
+	int			 i, rc;
+	ENTRY;
+
+	nr = req_capsule_get_size(pill, &RMF_QUOTA_BATCH, RCL_CLIENT) /
+	     sizeof(*reqbody);
+	if (nr == 0 || nr > QUOTA_BATCH_MAX)
+		RETURN(err_serious(-EPROTO));
+
+	reqbody = req_capsule_client_get(pill, &RMF_QUOTA_BATCH);
+	if (reqbody == NULL)
+		RETURN(err_serious(-EPROTO));
+
+	req_capsule_set_size(pill, &RMF_QUOTA_BATCH, RCL_SERVER,
+			     (nr + QUOTA_BATCH_HINTS) * sizeof(*repbody));
+	rc = req_capsule_server_pack(pill);
+	if (rc)
+		RETURN(err_serious(rc));
+
+	repbody = req_capsule_server_get(pill, &RMF_QUOTA_BATCH);
+	if (repbody == NULL)
+		RETURN(err_serious(-EFAULT));
+
+	/* sanity check every request and find the entries & indexes */
+	for (i = 0; i < nr; i++) {
+		lqes[i] = NULL;
+		slv_objs[i] = NULL;
+
+		rc = qmt_dqacq_check(env, qmt, req, &reqbody[i], &lqes[i]);
+		if (rc) {
+			memset(&repbody[i], 0, sizeof(repbody[i]));
+			repbody[i].qb_id = reqbody[i].qb_id;
+		} else {
+			slv_obj = qmt_dqacq_prep(env, lqes[i], qmt, uuid,
+						 &repbody[i]);
+			if (IS_ERR(slv_obj)) {
+				rc = PTR_ERR(slv_obj);
+			} else {
+				slv_objs[i] = slv_obj;
+				nr_valid++;
+			}
+		}
+		repbody[i].qb_rc = rc;
+	}
+
+	if (nr_valid == 0)
+		GOTO(out, rc = 0);
+
+	/* reserve credits for all the index updates */
+	th = dt_trans_create(env, qmt->qmt_child);
+	if (IS_ERR(th))
+		GOTO(out, rc = PTR_ERR(th));
+
+	for (i = 0, rc = 0; i < nr && rc == 0; i++) {
+		if (slv_objs[i] == NULL)
+			continue;
+
+		rc = lquota_disk_declare_write(env, th, LQE_GLB_OBJ(lqes[i]),
+					       &lqes[i]->lqe_id);
+		if (rc == 0)
+			rc = lquota_disk_declare_write(env, th, slv_objs[i],
+						       &lqes[i]->lqe_id);
+	}
+
+	if (rc == 0)
+		rc = dt_trans_start_local(env, qmt->qmt_child, th);
+
+	for (i = 0; i < nr; i++) {
+		if (slv_objs[i] == NULL)
+			continue;
+
+		if (rc == 0)
+			repbody[i].qb_rc = qmt_dqacq_apply(env, th, lqes[i],
+						slv_objs[i], uuid,
+						reqbody[i].qb_flags,
+						reqbody[i].qb_count,
+						reqbody[i].qb_usage,
+						&repbody[i]);
+		else
+			repbody[i].qb_rc = rc;
+
+		if (lustre_handle_is_used(&reqbody[i].qb_lockh))
+			repbody[i].qb_qunit = lqes[i]->lqe_qunit;
+	}
+
+	dt_trans_stop(env, qmt->qmt_child, th);
+	EXIT;
+out:
+	for (i = 0; i < nr; i++) {
+		if (slv_objs[i] != NULL) {
+			if (rc)
+				repbody[i].qb_rc = rc;
+			lu_object_put(env, &slv_objs[i]->do_lu);
+		}
+		if (lqes[i] != NULL)
+			lqe_putref(lqes[i]);
+	}
+
+	nr_hint = qmt_hot_fill(qmt, uuid, &repbody[nr], QUOTA_BATCH_HINTS);
+	req_capsule_shrink(pill, &RMF_QUOTA_BATCH,
+			   (nr + nr_hint) * sizeof(*repbody), RCL_SERVER);
+	return 0;
+}
+
 /* Vector of quota request handlers. This vector is used by the MDT to forward
  * requests to the quota master. */
 struct qmt_handlers qmt_hdls = {
 	/* quota request handlers */
 	.qmth_quotactl		= qmt_quotactl,
 	.qmth_dqacq		= qmt_dqacq,
+	.qmth_dqacq_batch	= qmt_dqacq_batch,
 
 	/* ldlm handlers */
 	.qmth_intent_policy	= qmt_intent_policy,
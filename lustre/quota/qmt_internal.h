@@ -40,6 +40,19 @@
  *
  * That's the structure MDT0 connects to in mdt_quota_init().
  */
+/* number of recently acquired IDs remembered by the master */
+#define QMT_HOT_IDS	32
+/* how long (in seconds) an ID is worth being hinted to slaves */
+#define QMT_HOT_AGE	30
+
+struct qmt_hot_id {
+	struct lu_fid		qhi_fid;
+	union lquota_id		qhi_id;
+	__u64			qhi_qunit;
+	cfs_time_t		qhi_time;
+	struct obd_uuid		qhi_uuid;
+};
+
 struct qmt_device {
 	/* Super-class. dt_device/lu_device for this master target */
 	struct dt_device	qmt_dt_dev;
@@ -82,6 +95,12 @@ struct qmt_device {
 	/* lock protecting rebalancing list */
 	spinlock_t		 qmt_reba_lock;
 
+	/* ring of the IDs which most recently acquired space on a slave not
+	 * owning any yet, hinted to the other slaves in batched replies */
+	struct qmt_hot_id	 qmt_hot[QMT_HOT_IDS];
+	int			 qmt_hot_next;
+	spinlock_t		 qmt_hot_lock;
+
 	unsigned long		 qmt_stopping:1; /* qmt is stopping */
 
 };
@@ -181,6 +200,9 @@ struct qmt_thread_info {
 	union ldlm_gl_desc	qti_gl_desc;
 	struct quota_body	qti_body;
 	struct qmt_lqe_restore	qti_restore;
+	/* entries & slave indexes of a batched quota request */
+	struct lquota_entry	*qti_lqes[QUOTA_BATCH_MAX];
+	struct dt_object	*qti_slv_objs[QUOTA_BATCH_MAX];
 };
 
 extern struct lu_context_key qmt_thread_key;
@@ -227,6 +249,16 @@ static inline __u64 qmt_lqe_grace(struct lquota_entry *lqe)
 	return grace_lqe->lqe_gracetime;
 }
 
+static inline void qmt_restore_save(struct lquota_entry *lqe,
+				    struct qmt_lqe_restore *restore)
+{
+	restore->qlr_hardlimit = lqe->lqe_hardlimit;
+	restore->qlr_softlimit = lqe->lqe_softlimit;
+	restore->qlr_gracetime = lqe->lqe_gracetime;
+	restore->qlr_granted   = lqe->lqe_granted;
+	restore->qlr_qunit     = lqe->lqe_qunit;
+}
+
 static inline void qmt_restore(struct lquota_entry *lqe,
 			       struct qmt_lqe_restore *restore)
 {
@@ -884,6 +884,74 @@ int qsd_op_begin(const struct lu_env *env, struct qsd_instance *qsd,
 }
 EXPORT_SYMBOL(qsd_op_begin);
 
+/**
+ * Add a non-intent quota request to the batch \a batchp, allocating the batch
+ * if needed. The batch is sent as soon as it is full.
+ *
+ * \retval 0 on success, -ENOMEM if no batch could be allocated
+ */
+static int qsd_batch_add(const struct lu_env *env, struct qsd_batch **batchp,
+			 struct qsd_qtype_info *qqi, struct quota_body *qbody,
+			 struct lustre_handle *lockh, struct lquota_entry *lqe)
+{
+	struct qsd_batch	*batch = *batchp;
+	int			 i;
+
+	if (batch == NULL) {
+		OBD_ALLOC_PTR(batch);
+		if (batch == NULL)
+			return -ENOMEM;
+		batch->qbt_qsd = qqi->qqi_qsd;
+		*batchp = batch;
+	}
+
+	i = batch->qbt_nr++;
+	batch->qbt_bodies[i] = *qbody;
+	batch->qbt_lqes[i] = lqe;
+	batch->qbt_qqis[i] = qqi;
+	lustre_handle_copy(&batch->qbt_lockhs[i], lockh);
+
+	if (batch->qbt_nr == QUOTA_BATCH_MAX)
+		qsd_batch_flush(env, batchp);
+	return 0;
+}
+
+/**
+ * Send the quota requests gathered in \a batchp, if any, in a single RPC.
+ * \a batchp is reset, the batch being freed once the RPC completes.
+ * If the master lost the batch support since the requests were gathered
+ * (reconnected to an older one), they are sent one by one.
+ */
+void qsd_batch_flush(const struct lu_env *env, struct qsd_batch **batchp)
+{
+	struct qsd_batch	*batch = *batchp;
+	int			 i;
+
+	if (batch == NULL)
+		return;
+	*batchp = NULL;
+
+	if (batch->qbt_nr != 0 && !qsd_batch_supported(batch->qbt_qsd)) {
+		for (i = 0; i < batch->qbt_nr; i++)
+			qsd_send_dqacq(env, batch->qbt_qsd->qsd_exp,
+				       &batch->qbt_bodies[i], false,
+				       qsd_req_completion, batch->qbt_qqis[i],
+				       &batch->qbt_lockhs[i],
+				       batch->qbt_lqes[i]);
+		batch->qbt_nr = 0;
+	}
+
+	if (batch->qbt_nr == 0) {
+		OBD_FREE_PTR(batch);
+		return;
+	}
+
+	/* the completion function will be called for each request of the
+	 * batch by qsd_send_dqacq_batch */
+	qsd_send_dqacq_batch(env, batch->qbt_qsd->qsd_exp, batch,
+			     qsd_req_completion);
+}
+
 /**
  * Adjust quota space (by acquiring or releasing) hold by the quota slave.
  * This function is called after each quota request completion and during
@@ -893,10 +961,14 @@ EXPORT_SYMBOL(qsd_op_begin);
  *
  * \param env    - the environment passed by the caller
  * \param lqe    - is the qid entry to be processed
+ * \param batchp - if not NULL, requests which don't need an intent are added
+ *                 to this batch instead of being sent right away, the caller
+ *                 being in charge of calling qsd_batch_flush()
  *
  * \retval 0 on success, appropriate errors on failure
  */
-int qsd_adjust(const struct lu_env *env, struct lquota_entry *lqe)
+int qsd_adjust_batch(const struct lu_env *env, struct lquota_entry *lqe,
+		     struct qsd_batch **batchp)
 {
 	struct qsd_thread_info	*qti = qsd_info(env);
 	struct quota_body	*qbody = &qti->qti_body;
@@ -976,6 +1048,11 @@ int qsd_adjust(const struct lu_env *env, struct lquota_entry *lqe)
 	}
 
 	if (!intent) {
+		if (batchp != NULL && qsd_batch_supported(qsd) &&
+		    qsd_batch_add(env, batchp, qqi, qbody, &qti->qti_lockh,
+				  lqe) == 0)
+			RETURN(0);
+
 		rc = qsd_send_dqacq(env, qsd->qsd_exp, qbody, false,
 				    qsd_req_completion, qqi, &qti->qti_lockh,
 				    lqe);
@@ -999,6 +1076,73 @@ out:
 	return rc;
 }
 
+/**
+ * Adjust quota space for \a lqe with a request of its own, see
+ * qsd_adjust_batch().
+ */
+int qsd_adjust(const struct lu_env *env, struct lquota_entry *lqe)
+{
+	return qsd_adjust_batch(env, lqe, NULL);
+}
+
+/**
+ * Acquire space for an ID the master reported as just granted to another
+ * slave, so that the first write for this ID here doesn't have to wait for
+ * the master. Only IDs with no space, no lock and no request in flight on this
+ * slave are acquired. One unit is asked for, the master expands it to qunit.
+ * Called by the writeback thread, see qsd_prefetch_schedule().
+ *
+ * \param env - the environment passed by the caller
+ * \param lqe - is the quota entry of the ID hinted by the master
+ */
+void qsd_prefetch(const struct lu_env *env, struct lquota_entry *lqe)
+{
+	struct qsd_thread_info	*qti = qsd_info(env);
+	struct quota_body	*qbody = &qti->qti_body;
+	struct qsd_qtype_info	*qqi = lqe2qqi(lqe);
+	struct qsd_instance	*qsd = qqi->qqi_qsd;
+	struct lquota_lvb	*lvb;
+	ENTRY;
+
+	memset(qbody, 0, sizeof(*qbody));
+	if (qsd_ready(lqe, &qbody->qb_glb_lockh))
+		RETURN_EXIT;
+
+	lqe_write_lock(lqe);
+	if (!lqe->lqe_enforced || lqe->lqe_edquot || lqe->lqe_granted != 0 ||
+	    lustre_handle_is_used(&lqe->lqe_lockh) ||
+	    qsd_request_enter(lqe) != 0) {
+		lqe_write_unlock(lqe);
+		RETURN_EXIT;
+	}
+	lqe_write_unlock(lqe);
+
+	/* hold a refcount until completion */
+	lqe_getref(lqe);
+
+	qbody->qb_fid   = qqi->qqi_fid;
+	qbody->qb_id    = lqe->lqe_id;
+	qbody->qb_flags = QUOTA_DQACQ_FL_ACQ;
+	qbody->qb_count = 1;
+
+	LQUOTA_DEBUG(lqe, "prefetching on master hint");
+	if (qsd->qsd_stats != NULL)
+		lprocfs_counter_incr(qsd->qsd_stats, QSD_STAT_PREFETCH);
+
+	OBD_ALLOC_PTR(lvb);
+	if (lvb == NULL) {
+		memset(&qti->qti_lockh, 0, sizeof(qti->qti_lockh));
+		qsd_req_completion(env, qqi, qbody, NULL, &qti->qti_lockh,
+				   NULL, lqe, -ENOMEM);
+		RETURN_EXIT;
+	}
+
+	/* the completion function will be called by qsd_intent_lock */
+	qsd_intent_lock(env, qsd->qsd_exp, qbody, false, IT_QUOTA_DQACQ,
+			qsd_req_completion, qqi, lvb, (void *)lqe);
+	EXIT;
+}
+
 /**
  * Post quota operation, pre-acquire/release quota from master.
  *
@@ -55,6 +55,9 @@ struct qsd_instance {
 	 * are exported */
 	cfs_proc_dir_entry_t	*qsd_proc;
 
+	/* quota request statistics, see enum qsd_stat */
+	struct lprocfs_stats	*qsd_stats;
+
 	/* export used for the connection to quota master */
 	struct obd_export	*qsd_exp;
 
@@ -235,6 +238,7 @@ struct qsd_upd_rec {
 	struct lquota_entry    *qur_lqe;
 	__u64			qur_ver;
 	bool			qur_global;
+	bool			qur_prefetch; /* acquire on master hint */
 };
 
 /* Common data shared by qsd-level handlers. This is allocated per-thread to
@@ -288,6 +292,14 @@ static inline int qsd_type_enabled(struct qsd_instance *qsd, int type)
 	return enabled & (1 << type);
 }
 
+/* helper function checking whether the master handles QUOTA_DQACQ_BATCH, as
+ * negotiated on the last (re)connection to it */
+static inline bool qsd_batch_supported(struct qsd_instance *qsd)
+{
+	return qsd->qsd_exp_valid &&
+	       (exp_connect_flags(qsd->qsd_exp) & OBD_CONNECT_QUOTA_BATCH);
+}
+
 /* helper function to set new qunit and compute associated qtune value */
 static inline void qsd_set_qunit(struct lquota_entry *lqe, __u64 qunit)
 {
@@ -319,6 +331,29 @@ static inline void qsd_set_qunit(struct lquota_entry *lqe, __u64 qunit)
 
 #define QSD_WB_INTERVAL	60 /* 60 seconds */
 
+/* counters of the qsd "stats" proc file */
+enum qsd_stat {
+	QSD_STAT_ACQ_SYNC = 0,	/* latency of acquire with waiting threads */
+	QSD_STAT_ACQ_ASYNC,	/* latency of background acquire/release */
+	QSD_STAT_BATCH,		/* latency of batched acquire/release */
+	QSD_STAT_BATCH_SIZE,	/* number of requests per batch */
+	QSD_STAT_PREFETCH,	/* acquire sent on master hint */
+	QSD_STAT_LAST
+};
+
+/*
+ * Non-intent quota requests gathered by the writeback & reintegration threads
+ * to be sent to the master in a single QUOTA_DQACQ_BATCH RPC.
+ */
+struct qsd_batch {
+	struct qsd_instance	*qbt_qsd;
+	int			 qbt_nr;
+	struct quota_body	 qbt_bodies[QUOTA_BATCH_MAX];
+	struct lquota_entry	*qbt_lqes[QUOTA_BATCH_MAX];
+	struct qsd_qtype_info	*qbt_qqis[QUOTA_BATCH_MAX];
+	struct lustre_handle	 qbt_lockhs[QUOTA_BATCH_MAX];
+};
+
 /* helper function calculating how long a service thread should be waiting for
  * quota space */
 static inline int qsd_wait_timeout(struct qsd_instance *qsd)
@@ -361,6 +396,8 @@ int qsd_send_dqacq(const struct lu_env *, struct obd_export *,
 int qsd_intent_lock(const struct lu_env *, struct obd_export *,
 		    struct quota_body *, bool, int, qsd_req_completion_t,
 		    struct qsd_qtype_info *, struct lquota_lvb *, void *);
+int qsd_send_dqacq_batch(const struct lu_env *, struct obd_export *,
+			 struct qsd_batch *, qsd_req_completion_t);
 int qsd_fetch_index(const struct lu_env *, struct obd_export *,
 		    struct idx_info *, unsigned int, struct page **, bool *);
 
@@ -375,6 +412,10 @@ int qsd_process_config(struct lustre_cfg *);
 
 /* qsd_handler.c */
 int qsd_adjust(const struct lu_env *, struct lquota_entry *);
+int qsd_adjust_batch(const struct lu_env *, struct lquota_entry *,
+		     struct qsd_batch **);
+void qsd_batch_flush(const struct lu_env *, struct qsd_batch **);
+void qsd_prefetch(const struct lu_env *, struct lquota_entry *);
 
 /* qsd_writeback.c */
 void qsd_upd_schedule(struct qsd_qtype_info *, struct lquota_entry *,
@@ -383,4 +424,5 @@ void qsd_bump_version(struct qsd_qtype_info *, __u64, bool);
 int qsd_start_upd_thread(struct qsd_instance *);
 void qsd_stop_upd_thread(struct qsd_instance *);
 void qsd_adjust_schedule(struct lquota_entry *, bool, bool);
+void qsd_prefetch_schedule(struct qsd_instance *, struct quota_body *);
 #endif /* _QSD_INTERNAL_H */
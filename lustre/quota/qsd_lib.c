@@ -505,6 +505,9 @@ void qsd_fini(const struct lu_env *env, struct qsd_instance *qsd)
 		qsd->qsd_dev = NULL;
 	}
 
+	if (qsd->qsd_stats != NULL)
+		lprocfs_free_stats(&qsd->qsd_stats);
+
 	CDEBUG(D_QUOTA, "%s: QSD shutdown completed\n", qsd->qsd_svname);
 	OBD_FREE_PTR(qsd);
 	EXIT;
@@ -598,6 +601,32 @@ struct qsd_instance *qsd_init(const struct lu_env *env, char *svname,
 		       svname, rc);
 		GOTO(out, rc);
         }
+
+	/* quota request statistics */
+	qsd->qsd_stats = lprocfs_alloc_stats(QSD_STAT_LAST, 0);
+	if (qsd->qsd_stats != NULL) {
+		lprocfs_counter_init(qsd->qsd_stats, QSD_STAT_ACQ_SYNC,
+				     LPROCFS_CNTR_AVGMINMAX|LPROCFS_CNTR_STDDEV,
+				     "acquire_sync", "usec");
+		lprocfs_counter_init(qsd->qsd_stats, QSD_STAT_ACQ_ASYNC,
+				     LPROCFS_CNTR_AVGMINMAX|LPROCFS_CNTR_STDDEV,
+				     "acquire_async", "usec");
+		lprocfs_counter_init(qsd->qsd_stats, QSD_STAT_BATCH,
+				     LPROCFS_CNTR_AVGMINMAX|LPROCFS_CNTR_STDDEV,
+				     "batch", "usec");
+		lprocfs_counter_init(qsd->qsd_stats, QSD_STAT_BATCH_SIZE,
+				     LPROCFS_CNTR_AVGMINMAX,
+				     "batch_size", "reqs");
+		lprocfs_counter_init(qsd->qsd_stats, QSD_STAT_PREFETCH,
+				     0, "prefetch", "reqs");
+		rc = lprocfs_register_stats(qsd->qsd_proc, "stats",
+					    qsd->qsd_stats);
+		if (rc) {
+			CERROR("%s: fail to register quota slave stats (%d)\n",
+			       svname, rc);
+			GOTO(out, rc);
+		}
+	}
 	EXIT;
 out:
 	if (rc) {
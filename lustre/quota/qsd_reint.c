@@ -298,6 +298,7 @@ static int qsd_reconciliation(const struct lu_env *env,
 	struct dt_it		*it;
 	struct dt_key		*key;
 	struct lquota_entry	*lqe;
+	struct qsd_batch	*batch = NULL;
 	union lquota_id		*qid = &qti->qti_id;
 	int			 rc;
 	ENTRY;
@@ -354,7 +355,8 @@ static int qsd_reconciliation(const struct lu_env *env,
 			GOTO(out, rc);
 		}
 
-		rc = qsd_adjust(env, lqe);
+		/* usage reports are gathered into batched requests */
+		rc = qsd_adjust_batch(env, lqe, &batch);
 		lqe_putref(lqe);
 		if (rc) {
 			CWARN("%s: failed to report quota. "DFID", %d\n",
@@ -372,6 +374,7 @@ next:
 	if (rc > 0)
 		rc = 0;
 out:
+	qsd_batch_flush(env, &batch);
 	iops->put(env, it);
 	iops->fini(env, it);
 	RETURN(rc);
@@ -44,8 +44,27 @@ struct qsd_async_args {
 	struct lquota_lvb     *aa_lvb;
 	struct lustre_handle   aa_lockh;
 	qsd_req_completion_t   aa_completion;
+	struct timeval	       aa_start;
+	int		       aa_stat;
 };
 
+/*
+ * Account the latency of a quota request in counter \a aa_stat of the qsd
+ * stats. A negative aa_stat means the request isn't accounted.
+ */
+static void qsd_req_stat(struct qsd_async_args *aa)
+{
+	struct qsd_instance	*qsd = aa->aa_qqi->qqi_qsd;
+	struct timeval		 now;
+
+	if (aa->aa_stat < 0 || qsd->qsd_stats == NULL)
+		return;
+
+	do_gettimeofday(&now);
+	lprocfs_counter_add(qsd->qsd_stats, aa->aa_stat,
+			    cfs_timeval_sub(&now, &aa->aa_start, NULL));
+}
+
 /*
  * non-intent quota request interpret callback.
  *
@@ -64,6 +83,8 @@ static int qsd_dqacq_interpret(const struct lu_env *env,
 	struct qsd_async_args *aa = (struct qsd_async_args *)arg;
 	ENTRY;
 
+	qsd_req_stat(aa);
+
 	req_qbody = req_capsule_client_get(&req->rq_pill, &RMF_QUOTA_BODY);
 	if (rc == 0 || rc == -EDQUOT || rc == -EINPROGRESS)
 		rep_qbody = req_capsule_server_get(&req->rq_pill,
@@ -124,6 +145,8 @@ int qsd_send_dqacq(const struct lu_env *env, struct obd_export *exp,
 	aa->aa_qqi = qqi;
 	aa->aa_arg = (void *)lqe;
 	aa->aa_completion = completion;
+	aa->aa_stat = sync ? QSD_STAT_ACQ_SYNC : QSD_STAT_ACQ_ASYNC;
+	do_gettimeofday(&aa->aa_start);
 	lustre_handle_copy(&aa->aa_lockh, lockh);
 
 	if (sync) {
@@ -141,6 +164,139 @@ out:
 	return rc;
 }
 
+/*
+ * batched quota request interpret callback.
+ * The completion callback is called for each request of the batch with the
+ * return code returned by the master for this request. Hints appended by the
+ * master to the reply are handed over to qsd_prefetch_schedule().
+ *
+ * \param env    - the environment passed by the caller
+ * \param req    - the batched quota request
+ * \param arg    - qsd_async_args
+ * \param rc     - request status
+ *
+ * \retval 0     - success
+ * \retval -ve   - appropriate errors
+ */
+static int qsd_dqacq_batch_interpret(const struct lu_env *env,
+				     struct ptlrpc_request *req, void *arg,
+				     int rc)
+{
+	struct qsd_async_args	*aa = (struct qsd_async_args *)arg;
+	struct qsd_batch	*batch = (struct qsd_batch *)aa->aa_arg;
+	struct qsd_instance	*qsd = batch->qbt_qsd;
+	struct quota_body	*rep_qbody = NULL, *repbody = NULL;
+	int			 nr_rep = 0;
+	int			 i, ret;
+	ENTRY;
+
+	qsd_req_stat(aa);
+
+	if (rc == 0) {
+		repbody = req_capsule_server_get(&req->rq_pill,
+						 &RMF_QUOTA_BATCH);
+		nr_rep = req_capsule_get_size(&req->rq_pill, &RMF_QUOTA_BATCH,
+					      RCL_SERVER) / sizeof(*repbody);
+		if (repbody == NULL || nr_rep < batch->qbt_nr)
+			rc = -EPROTO;
+	}
+
+	for (i = 0; i < batch->qbt_nr; i++) {
+		ret = rc ? rc : repbody[i].qb_rc;
+		rep_qbody = NULL;
+		if (ret == 0 || ret == -EDQUOT || ret == -EINPROGRESS)
+			rep_qbody = &repbody[i];
+		aa->aa_completion(env, batch->qbt_qqis[i],
+				  &batch->qbt_bodies[i], rep_qbody,
+				  &batch->qbt_lockhs[i], NULL,
+				  batch->qbt_lqes[i], ret);
+	}
+
+	/* lquota entries can't be looked up from ptlrpcd, the hinted IDs
+	 * are handed over to the writeback thread */
+	for (i = batch->qbt_nr; i < nr_rep; i++)
+		if (repbody[i].qb_flags & QUOTA_DQACQ_FL_HINT)
+			qsd_prefetch_schedule(qsd, &repbody[i]);
+
+	OBD_FREE_PTR(batch);
+	RETURN(rc);
+}
+
+/*
+ * Send a batch of non-intent quota requests to master. The batch is always
+ * consumed, the completion callback being called for each of its requests.
+ *
+ * \param env    - the environment passed by the caller
+ * \param exp    - is the export to use to send the batched RPC
+ * \param batch  - is the batch of quota requests, freed on completion
+ * \param completion - completion callback
+ *
+ * \retval 0     - success
+ * \retval -ve   - appropriate errors
+ */
+int qsd_send_dqacq_batch(const struct lu_env *env, struct obd_export *exp,
+			 struct qsd_batch *batch,
+			 qsd_req_completion_t completion)
+{
+	struct ptlrpc_request	*req;
+	struct quota_body	*req_qbody;
+	struct qsd_async_args	*aa;
+	int			 size = batch->qbt_nr * sizeof(*req_qbody);
+	int			 rc, i;
+	ENTRY;
+
+	LASSERT(exp);
+	LASSERT(batch->qbt_nr > 0 && batch->qbt_nr <= QUOTA_BATCH_MAX);
+
+	req = ptlrpc_request_alloc(class_exp2cliimp(exp),
+				   &RQF_QUOTA_DQACQ_BATCH);
+	if (req == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_QUOTA_BATCH, RCL_CLIENT,
+			     size);
+	req->rq_no_resend = req->rq_no_delay = 1;
+	req->rq_no_retry_einprogress = 1;
+	rc = ptlrpc_request_pack(req, LUSTRE_MDS_VERSION, QUOTA_DQACQ_BATCH);
+	if (rc) {
+		ptlrpc_request_free(req);
+		GOTO(out, rc);
+	}
+
+	req_qbody = req_capsule_client_get(&req->rq_pill, &RMF_QUOTA_BATCH);
+	memcpy(req_qbody, batch->qbt_bodies, size);
+
+	/* room for one reply per request and for the master hints */
+	req_capsule_set_size(&req->rq_pill, &RMF_QUOTA_BATCH, RCL_SERVER,
+			     (batch->qbt_nr + QUOTA_BATCH_HINTS) *
+			     sizeof(*req_qbody));
+	ptlrpc_request_set_replen(req);
+
+	CLASSERT(sizeof(*aa) <= sizeof(req->rq_async_args));
+	aa = ptlrpc_req_async_args(req);
+	aa->aa_exp = exp;
+	aa->aa_qqi = batch->qbt_qqis[0];
+	aa->aa_arg = (void *)batch;
+	aa->aa_completion = completion;
+	aa->aa_stat = QSD_STAT_BATCH;
+	do_gettimeofday(&aa->aa_start);
+
+	if (batch->qbt_qsd->qsd_stats != NULL)
+		lprocfs_counter_add(batch->qbt_qsd->qsd_stats,
+				    QSD_STAT_BATCH_SIZE, batch->qbt_nr);
+
+	req->rq_interpret_reply = qsd_dqacq_batch_interpret;
+	ptlrpcd_add_req(req, PDL_POLICY_LOCAL, -1);
+
+	RETURN(0);
+out:
+	for (i = 0; i < batch->qbt_nr; i++)
+		completion(env, batch->qbt_qqis[i], &batch->qbt_bodies[i], NULL,
+			   &batch->qbt_lockhs[i], NULL, batch->qbt_lqes[i], rc);
+	OBD_FREE_PTR(batch);
+	return rc;
+}
+
 /*
  * intent quota request interpret callback.
  *
@@ -167,6 +323,8 @@ static int qsd_intent_interpret(const struct lu_env *env,
 	req_qbody = req_capsule_client_get(&req->rq_pill, &RMF_QUOTA_BODY);
 	lit = req_capsule_client_get(&req->rq_pill, &RMF_LDLM_INTENT);
 
+	qsd_req_stat(aa);
+
 	rc = ldlm_cli_enqueue_fini(aa->aa_exp, req, LDLM_PLAIN, 0, LCK_CR,
 				   &flags, (void *)aa->aa_lvb,
 				   sizeof(struct lquota_lvb), lockh, rc);
@@ -313,6 +471,12 @@ int qsd_intent_lock(const struct lu_env *env, struct obd_export *exp,
 	aa->aa_arg = arg;
 	aa->aa_lvb = lvb;
 	aa->aa_completion = completion;
+	/* only quota acquisition is accounted, not global lock enqueue */
+	if (it_op == IT_QUOTA_DQACQ)
+		aa->aa_stat = sync ? QSD_STAT_ACQ_SYNC : QSD_STAT_ACQ_ASYNC;
+	else
+		aa->aa_stat = -1;
+	do_gettimeofday(&aa->aa_start);
 	lustre_handle_copy(&aa->aa_lockh, &qti->qti_lockh);
 
 	if (sync) {
@@ -70,6 +70,7 @@ static struct qsd_upd_rec *qsd_upd_alloc(struct qsd_qtype_info *qqi,
 	upd->qur_rec	= *rec;
 	upd->qur_ver	= ver;
 	upd->qur_global	= global;
+	upd->qur_prefetch = false;
 
 	return upd;
 }
@@ -272,7 +273,50 @@ void qsd_upd_schedule(struct qsd_qtype_info *qqi, struct lquota_entry *lqe,
 	EXIT;
 }
 
-static int qsd_process_upd(const struct lu_env *env, struct qsd_upd_rec *upd)
+/*
+ * Schedule the acquisition of space for an ID the master reported as just
+ * granted to another slave. Hints come with batched replies, in ptlrpcd
+ * context, the lquota entry is looked up and the space acquired by the
+ * writeback thread.
+ *
+ * \param  qsd  - qsd_instance which received the hint
+ * \param  hint - quota body flagged with QUOTA_DQACQ_FL_HINT
+ */
+void qsd_prefetch_schedule(struct qsd_instance *qsd, struct quota_body *hint)
+{
+	struct qsd_qtype_info	*qqi = NULL;
+	struct qsd_upd_rec	*upd;
+	union lquota_rec	 rec = { { 0 } };
+	int			 qtype;
+	ENTRY;
+
+	for (qtype = USRQUOTA; qtype < MAXQUOTAS; qtype++) {
+		if (qsd->qsd_type_array[qtype] != NULL &&
+		    lu_fid_eq(&qsd->qsd_type_array[qtype]->qqi_fid,
+			      &hint->qb_fid)) {
+			qqi = qsd->qsd_type_array[qtype];
+			break;
+		}
+	}
+	if (qqi == NULL || qqi->qqi_site == NULL)
+		RETURN_EXIT;
+
+	upd = qsd_upd_alloc(qqi, NULL, &hint->qb_id, &rec, 0, false);
+	if (upd == NULL)
+		RETURN_EXIT;
+	upd->qur_prefetch = true;
+
+	CDEBUG(D_QUOTA, "%s: schedule prefetch, qid:"LPU64", qunit:"LPU64"\n",
+	       qsd->qsd_svname, hint->qb_id.qid_uid, hint->qb_qunit);
+
+	write_lock(&qsd->qsd_lock);
+	qsd_upd_add(qsd, upd);
+	write_unlock(&qsd->qsd_lock);
+	EXIT;
+}
+
+static int qsd_process_upd(const struct lu_env *env, struct qsd_upd_rec *upd,
+			   struct qsd_batch **batchp)
 {
 	struct lquota_entry	*lqe = upd->qur_lqe;
 	struct qsd_qtype_info	*qqi = upd->qur_qqi;
@@ -285,6 +329,11 @@ static int qsd_process_upd(const struct lu_env *env, struct qsd_upd_rec *upd)
 			GOTO(out, rc = PTR_ERR(lqe));
 	}
 
+	if (upd->qur_prefetch) {
+		qsd_prefetch(env, lqe);
+		GOTO(out, rc = 0);
+	}
+
 	/* The in-memory lqe update for slave index copy isn't deferred,
 	 * we shouldn't touch it here. */
 	if (upd->qur_global) {
@@ -293,8 +342,9 @@ static int qsd_process_upd(const struct lu_env *env, struct qsd_upd_rec *upd)
 			GOTO(out, rc);
 		/* refresh usage */
 		qsd_refresh_usage(env, lqe);
-		/* Report usage asynchronously */
-		rc = qsd_adjust(env, lqe);
+		/* Report usage asynchronously, along with the other IDs
+		 * updated by the same glimpses */
+		rc = qsd_adjust_batch(env, lqe, batchp);
 		if (rc)
 			LQUOTA_ERROR(lqe, "failed to report usage, rc:%d", rc);
 	}
@@ -418,6 +468,7 @@ static int qsd_upd_thread(void *arg)
 	int			 qtype, rc = 0;
 	bool			 uptodate;
 	struct lquota_entry	*lqe, *tmp;
+	struct qsd_batch	*batch = NULL;
 	__u64			 cur_time;
 	ENTRY;
 
@@ -444,7 +495,7 @@ static int qsd_upd_thread(void *arg)
 
 		cfs_list_for_each_entry_safe(upd, n, &queue, qur_link) {
 			cfs_list_del_init(&upd->qur_link);
-			qsd_process_upd(env, upd);
+			qsd_process_upd(env, upd, &batch);
 			qsd_upd_free(upd);
 		}
 
@@ -465,7 +516,7 @@ static int qsd_upd_thread(void *arg)
 				if (lqe->lqe_adjust_time == 0)
 					qsd_id_lock_cancel(env, lqe);
 				else
-					qsd_adjust(env, lqe);
+					qsd_adjust_batch(env, lqe, &batch);
 			}
 
 			lqe_putref(lqe);
@@ -473,6 +524,9 @@ static int qsd_upd_thread(void *arg)
 		}
 		spin_unlock(&qsd->qsd_adjust_lock);
 
+		/* send what is left of the adjustments gathered above */
+		qsd_batch_flush(env, &batch);
+
 		if (!thread_is_running(thread))
 			break;
 
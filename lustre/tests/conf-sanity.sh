@@ -3328,6 +3328,82 @@ test_53b() {
 }
 run_test 53b "check MDS thread count params"
 
+test_53c() {
+	setup
+	local paramp=$(do_facet ost1 "lctl get_param -N ost.OSS.ost_io.threads_min")
+	paramp=${paramp%.threads_min}
+	local ncpts=$(check_cpt_number ost1)
+	local tmin=$(do_facet ost1 "lctl get_param -n $paramp.threads_min")
+	local tmax=$(do_facet ost1 "lctl get_param -n $paramp.threads_max")
+	local timeout=$(do_facet ost1 \
+		"lctl get_param -n $paramp.threads_idle_timeout")
+	# PTLRPC_NTHRS_INIT threads per CPT at least
+	local lmin=$((2 * ncpts))
+	local lmax=$((lmin + 4 * ncpts))
+	local started
+	local peak=0
+
+	[ $tmax -gt $lmin ] || { skip_env "$paramp has fixed thread count";
+				 cleanup; return 0; }
+	[ $lmax -gt $tmax ] && lmax=$tmax
+
+	do_facet ost1 "lctl set_param $paramp.threads_idle_timeout=-1" &&
+		error "negative idle timeout accepted"
+
+	# few threads to keep, so that the burst below has to start more
+	do_facet ost1 "lctl set_param $paramp.threads_min=$lmin" ||
+		error "cannot set threads_min=$lmin"
+	do_facet ost1 "lctl set_param $paramp.threads_max=$lmax" ||
+		error "cannot set threads_max=$lmax"
+	do_facet ost1 "lctl set_param $paramp.threads_utilisation=0"
+	do_facet ost1 "lctl set_param $paramp.threads_idle_timeout=2"
+
+	# the threads started by the setup above the new minimum retire first
+	for i in $(seq 20); do
+		started=$(do_facet ost1 "lctl get_param -n $paramp.threads_started")
+		[ $started -le $lmin ] && break
+		sleep 1
+	done
+	[ $started -le $lmin ] ||
+		error "$started threads above threads_min=$lmin did not retire"
+
+	# a burst of parallel writes should start extra threads...
+	for i in $(seq 16); do
+		dd if=/dev/zero of=$DIR/$tfile.$i bs=1M count=8 oflag=direct \
+			2>/dev/null &
+	done
+	while [ -n "$(jobs -rp)" ]; do
+		started=$(do_facet ost1 "lctl get_param -n $paramp.threads_started")
+		[ $started -gt $peak ] && peak=$started
+		sleep 0.5
+	done
+	wait
+	do_facet ost1 "lctl get_param $paramp.threads_utilisation"
+	local busy=$(do_facet ost1 \
+		"lctl get_param -n $paramp.threads_utilisation" |
+		awk '/%:/ { sum += $2 } END { print sum + 0 }')
+	[ $busy -gt 0 ] || error "no request in threads_utilisation"
+	[ $peak -gt $lmin ] ||
+		error "no more than $peak threads during the burst"
+
+	# ...which retire once they stay idle
+	for i in $(seq 20); do
+		started=$(do_facet ost1 "lctl get_param -n $paramp.threads_started")
+		[ $started -le $lmin ] && break
+		sleep 1
+	done
+
+	do_facet ost1 "lctl set_param $paramp.threads_max=$tmax"
+	do_facet ost1 "lctl set_param $paramp.threads_min=$tmin"
+	do_facet ost1 "lctl set_param $paramp.threads_idle_timeout=$timeout"
+	[ $started -le $lmin ] ||
+		error "$started threads left, expected no more than $lmin"
+
+	rm -f $DIR/$tfile.*
+	cleanup
+}
+run_test 53c "idle OSS threads retire after threads_idle_timeout"
+
 test_54a() {
 	if [ $(facet_fstype $SINGLEMDS) != ldiskfs ]; then
 		skip "Only applicable to ldiskfs-based MDTs"
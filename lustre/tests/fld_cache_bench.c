@@ -0,0 +1,282 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lustre/tests/fld_cache_bench.c
+ *
+ * Sanity check and lookup benchmark for the FLD cache: fills a cache with
+ * ranges inserted in random order, checks that every one of them is found
+ * again, and measures random sequence lookups per second. Entries of
+ * different types covering the same range are checked as well.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <libcfs/libcfs.h>
+#include <../ldlm/interval_tree.c>
+#undef DEBUG_SUBSYSTEM
+#include <../fld/fld_cache.c>
+
+/* what obdclass and liblustre would provide */
+__u64 obd_alloc;
+__u64 obd_max_alloc;
+unsigned int obd_alloc_fail_rate;
+struct task_struct *current;
+
+int obd_alloc_fail(const void *ptr, const char *name, const char *type,
+		   size_t size, const char *file, int line)
+{
+	return ptr == NULL;
+}
+
+#define error(fmt, args...) do {                        \
+	fflush(stdout), fflush(stderr);                 \
+	fprintf(stderr, "\nError:" fmt, ##args);        \
+	abort();                                        \
+} while (0)
+
+/* width of each cached range, in sequences */
+#define FCB_WIDTH	64
+
+static double fcb_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* ranges alternate between two MDTs so that neighbours are never merged */
+static void fcb_range(struct lu_seq_range *range, int i)
+{
+	range->lsr_start = (seqno_t)i * FCB_WIDTH;
+	range->lsr_end = range->lsr_start + FCB_WIDTH;
+	range->lsr_index = i % 2;
+	range->lsr_flags = LU_SEQ_RANGE_MDT;
+}
+
+static struct fld_cache *fcb_init(int count)
+{
+	struct fld_cache *cache;
+	struct lu_seq_range range;
+	int *order;
+	double start;
+	int i;
+
+	cache = fld_cache_init("fld_cache_bench", count + 1, 1);
+	if (IS_ERR(cache))
+		error("cannot create cache: %ld\n", PTR_ERR(cache));
+
+	order = malloc(count * sizeof(*order));
+	if (order == NULL)
+		error("no memory\n");
+	for (i = 0; i < count; i++)
+		order[i] = i;
+	for (i = count - 1; i > 0; i--) {
+		int j = random() % (i + 1);
+		int tmp = order[i];
+
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+
+	start = fcb_now();
+	for (i = 0; i < count; i++) {
+		fcb_range(&range, order[i]);
+		if (fld_cache_insert(cache, &range) != 0)
+			error("cannot insert "DRANGE"\n", PRANGE(&range));
+	}
+	printf("%8d ranges: %12.0f inserts/sec\n", count,
+	       count / (fcb_now() - start));
+	free(order);
+
+	if (cache->fci_cache_count != count)
+		error("%d entries cached, expected %d\n",
+		      cache->fci_cache_count, count);
+
+	return cache;
+}
+
+static void fcb_sanity(struct fld_cache *cache, int count)
+{
+	struct lu_seq_range expected;
+	struct lu_seq_range range;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		fcb_range(&expected, i);
+		if (fld_cache_lookup(cache, expected.lsr_start, &range) != 0 ||
+		    range.lsr_start != expected.lsr_start ||
+		    range.lsr_end != expected.lsr_end ||
+		    range.lsr_index != expected.lsr_index)
+			error("lookup "LPX64" got "DRANGE" expected "DRANGE"\n",
+			      expected.lsr_start, PRANGE(&range),
+			      PRANGE(&expected));
+	}
+
+	if (fld_cache_lookup(cache, (seqno_t)count * FCB_WIDTH, &range) !=
+	    -ENOENT)
+		error("found "DRANGE" past the last range\n", PRANGE(&range));
+}
+
+static void fcb_lookup(struct fld_cache *cache, int count, int lookups,
+		       int local)
+{
+	struct lu_seq_range range;
+	seqno_t seq = 0;
+	double start;
+	int i;
+
+	start = fcb_now();
+	for (i = 0; i < lookups; i++) {
+		/* either hop around, or stay within a few ranges */
+		if (!local || i % 64 == 0)
+			seq = (seqno_t)(random() % count) * FCB_WIDTH;
+		else
+			seq = seq / FCB_WIDTH * FCB_WIDTH + i % FCB_WIDTH;
+
+		if (fld_cache_lookup(cache, seq, &range) != 0 ||
+		    !range_within(&range, seq))
+			error("lookup "LPX64" failed\n", seq);
+	}
+	printf("%8d ranges: %12.0f %s lookups/sec\n", count,
+	       lookups / (fcb_now() - start), local ? "local " : "random");
+}
+
+/* entries of different types covering the same extent share a tree node;
+ * deleting the one in the tree must put the other one there */
+static void fcb_twins(void)
+{
+	struct fld_cache_entry *flde;
+	struct fld_cache *cache;
+	struct lu_seq_range ranges[2];
+	struct lu_seq_range range;
+	struct lu_seq_range gone;
+	int i;
+
+	cache = fld_cache_init("fld_cache_bench", 4, 1);
+	if (IS_ERR(cache))
+		error("cannot create cache: %ld\n", PTR_ERR(cache));
+
+	for (i = 0; i < 2; i++) {
+		fcb_range(&ranges[i], 1);
+		ranges[i].lsr_index = i;
+		ranges[i].lsr_flags = i == 0 ? LU_SEQ_RANGE_MDT :
+					       LU_SEQ_RANGE_OST;
+		if (fld_cache_insert(cache, &ranges[i]) != 0)
+			error("cannot insert "DRANGE"\n", PRANGE(&ranges[i]));
+	}
+	if (cache->fci_cache_count != 2)
+		error("%d entries cached, expected 2\n",
+		      cache->fci_cache_count);
+
+	flde = fld_cache_entry_lookup(cache, &ranges[0]);
+	if (flde == NULL)
+		error("cannot find "DRANGE"\n", PRANGE(&ranges[0]));
+	gone = flde->fce_range;
+	fld_cache_delete(cache, &gone);
+
+	for (i = 0; i < FCB_WIDTH; i++) {
+		seqno_t seq = ranges[0].lsr_start + i;
+
+		if (fld_cache_lookup(cache, seq, &range) != 0 ||
+		    range.lsr_start != gone.lsr_start ||
+		    range.lsr_end != gone.lsr_end ||
+		    range.lsr_flags == gone.lsr_flags)
+			error("lookup "LPX64" after deleting "DRANGE
+			      " got "DRANGE"\n", seq, PRANGE(&gone),
+			      PRANGE(&range));
+	}
+
+	fld_cache_delete(cache, &range);
+	if (cache->fci_cache_count != 0 ||
+	    fld_cache_lookup(cache, ranges[0].lsr_start, &range) != -ENOENT)
+		error("twins of "DRANGE" not deleted\n", PRANGE(&gone));
+
+	fld_cache_fini(cache);
+	printf("twin ranges: ok\n");
+}
+
+static void fcb_run(int count, int lookups)
+{
+	struct fld_cache *cache;
+
+	cache = fcb_init(count);
+	fcb_sanity(cache, count);
+	fcb_lookup(cache, count, lookups, 0);
+	fcb_lookup(cache, count, lookups, 1);
+
+	fld_cache_flush(cache);
+	fld_cache_fini(cache);
+}
+
+static void usage(char *prog)
+{
+	fprintf(stderr, "usage: %s [-n ranges] [-l lookups]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	int lookups = 1000000;
+	int count = 0;
+	struct timeval tv;
+	int c;
+
+	while ((c = getopt(argc, argv, "n:l:")) != -1) {
+		switch (c) {
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'l':
+			lookups = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (count < 0 || lookups <= 0)
+		usage(argv[0]);
+
+	gettimeofday(&tv, NULL);
+	srandom(tv.tv_usec);
+
+	if (cfs_cpu_init() != 0)
+		error("cannot initialize CPU partitions\n");
+
+	fcb_twins();
+	if (count != 0) {
+		fcb_run(count, lookups);
+	} else {
+		fcb_run(10000, lookups);
+		fcb_run(100000, lookups);
+		fcb_run(1000000, lookups);
+	}
+
+	cfs_cpu_fini();
+	return 0;
+}
@@ -43,6 +43,9 @@
 #include <pthread.h>
 #include <sys/file.h>
 #include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <signal.h>
 #include <stdarg.h>
 
 #define MAX_PATH_LENGTH 4096
@@ -438,6 +441,369 @@ out:
 	return rc;
 }
 
+/** =================================================================
+ * test number 5
+ *
+ * Stress and timing of POSIX record locks with many granted locks on one
+ * file: several processes take single byte locks interleaved with each
+ * other's, so that none of them merge, then each drops them, and finally
+ * splits a large read lock with one byte unlocks.
+ */
+static double t5_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static int t5_lock(int fd, short type, off_t start, off_t len)
+{
+	struct flock lock = {
+		.l_type = type,
+		.l_whence = SEEK_SET,
+		.l_start = start,
+		.l_len = len,
+	};
+
+	return t_fcntl(fd, F_SETLK, &lock);
+}
+
+static int t5_child(const char *file, int index, int procs, int locks)
+{
+	double start;
+	off_t base;
+	int fd;
+	int i;
+
+	if ((fd = open(file, O_RDWR)) < 0) {
+		fprintf(stderr, "Couldn't open file: %s\n", file);
+		return EXIT_FAILURE;
+	}
+
+	/* leave a byte between two locks of this process, and let the
+	 * other processes lock it */
+	start = t5_now();
+	for (i = 0; i < locks; i++) {
+		if (t5_lock(fd, F_WRLCK, ((off_t)i * procs + index) * 2,
+			    1) < 0) {
+			perror("lock failed");
+			goto out_fail;
+		}
+		if ((i + 1) % (locks / 10 == 0 ? 1 : locks / 10) == 0)
+			printf("%d: %8d locks: %10.0f locks/sec\n", getpid(),
+			       i + 1, (i + 1) / (t5_now() - start));
+	}
+
+	start = t5_now();
+	for (i = 0; i < locks; i++) {
+		if (t5_lock(fd, F_UNLCK, ((off_t)i * procs + index) * 2,
+			    1) < 0) {
+			perror("unlock failed");
+			goto out_fail;
+		}
+	}
+	printf("%d: %8d locks: %10.0f unlocks/sec\n", getpid(), locks,
+	       locks / (t5_now() - start));
+
+	/* each unlock splits the lock it falls into */
+	base = (off_t)locks * procs * 2 + (off_t)index * locks * 2;
+	if (t5_lock(fd, F_RDLCK, base, (off_t)locks * 2) < 0) {
+		perror("read lock failed");
+		goto out_fail;
+	}
+	start = t5_now();
+	for (i = 0; i < locks - 1; i++) {
+		if (t5_lock(fd, F_UNLCK, base + (off_t)i * 2 + 1, 1) < 0) {
+			perror("split failed");
+			goto out_fail;
+		}
+	}
+	printf("%d: %8d locks: %10.0f splits/sec\n", getpid(), locks,
+	       (locks - 1) / (t5_now() - start));
+
+	close(fd);
+	return EXIT_SUCCESS;
+
+out_fail:
+	close(fd);
+	return EXIT_FAILURE;
+}
+
+int t5(int argc, char *argv[])
+{
+	int procs = 4;
+	int locks = 10000;
+	int rc = EXIT_SUCCESS;
+	int status;
+	int pid;
+	int i;
+
+	if (argc < 3 || argc > 5) {
+		fprintf(stderr, "Usage: ./flocks_test 5 file [procs] [locks]\n");
+		return EXIT_FAILURE;
+	}
+	if (argc > 3)
+		procs = atoi(argv[3]);
+	if (argc > 4)
+		locks = atoi(argv[4]);
+	if (procs <= 0 || locks <= 0) {
+		fprintf(stderr, "Usage: ./flocks_test 5 file [procs] [locks]\n");
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < procs; i++) {
+		pid = fork();
+		if (pid == -1) {
+			perror("fork");
+			rc = EXIT_FAILURE;
+			break;
+		}
+		if (pid == 0)
+			exit(t5_child(argv[2], i, procs, locks));
+	}
+
+	while (wait(&status) > 0)
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			rc = EXIT_FAILURE;
+
+	return rc;
+}
+
+/** =================================================================
+ * test number 6
+ *
+ * Semantics of POSIX record locks: adjoining and overlapping locks of an
+ * owner merge, unlocking or relocking part of a lock splits it, and the locks
+ * of another owner only conflict with, and block, the overlapping requests of
+ * an incompatible mode. Locks are inspected with F_GETLK from a child.
+ */
+struct t6_check {
+	short	type;		/* type of the request */
+	off_t	start;
+	off_t	len;
+	short	conflict;	/* type of the conflicting lock, or F_UNLCK */
+	off_t	cstart;		/* extent of the conflicting lock */
+	off_t	clen;
+};
+
+static int t6_lock(int fd, int cmd, short type, off_t start, off_t len)
+{
+	struct flock lock = {
+		.l_type = type,
+		.l_whence = SEEK_SET,
+		.l_start = start,
+		.l_len = len,
+	};
+
+	return fcntl(fd, cmd, &lock);
+}
+
+static int t6_verify(int fd, const char *what, const struct t6_check *checks,
+		     int count)
+{
+	const struct t6_check *c;
+	struct flock lock;
+	int status;
+	int pid;
+	int i;
+
+	pid = fork();
+	if (pid == -1) {
+		perror("fork");
+		return EXIT_FAILURE;
+	}
+
+	if (pid == 0) {
+		for (i = 0; i < count; i++) {
+			c = &checks[i];
+			lock.l_type = c->type;
+			lock.l_whence = SEEK_SET;
+			lock.l_start = c->start;
+			lock.l_len = c->len;
+			if (fcntl(fd, F_GETLK, &lock) < 0) {
+				perror("F_GETLK failed");
+				exit(EXIT_FAILURE);
+			}
+			if (lock.l_type == c->conflict &&
+			    (c->conflict == F_UNLCK ||
+			     (lock.l_start == c->cstart &&
+			      lock.l_len == c->clen)))
+				continue;
+
+			fprintf(stderr, "%s: type %d at %lld+%lld conflicts "
+				"with type %d at %lld+%lld, expected type %d "
+				"at %lld+%lld\n", what, c->type,
+				(long long)c->start, (long long)c->len,
+				lock.l_type, (long long)lock.l_start,
+				(long long)lock.l_len, c->conflict,
+				(long long)c->cstart, (long long)c->clen);
+			exit(EXIT_FAILURE);
+		}
+		exit(EXIT_SUCCESS);
+	}
+
+	if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+	    WEXITSTATUS(status) != 0)
+		return EXIT_FAILURE;
+
+	printf("%s: ok\n", what);
+	fflush(stdout);
+	return EXIT_SUCCESS;
+}
+
+/* wait for up to \a timeout seconds for the child to report on \a pfd */
+static int t6_wait_child(int pfd, int timeout)
+{
+	struct timeval tv = { .tv_sec = timeout };
+	fd_set set;
+	char c;
+
+	FD_ZERO(&set);
+	FD_SET(pfd, &set);
+	if (select(pfd + 1, &set, NULL, NULL, &tv) <= 0)
+		return 0;
+
+	return read(pfd, &c, 1) == 1;
+}
+
+int t6(int argc, char *argv[])
+{
+	static const struct t6_check merged[] = {
+		{ F_WRLCK,  0, 100, F_WRLCK,  0, 20 },
+		{ F_RDLCK, 19,   1, F_WRLCK,  0, 20 },
+		{ F_WRLCK, 20,  10, F_UNLCK },
+	};
+	static const struct t6_check split[] = {
+		{ F_RDLCK,  8,   4, F_UNLCK },
+		{ F_WRLCK,  0,  10, F_WRLCK,  0,  8 },
+		{ F_WRLCK, 10,  20, F_WRLCK, 12,  8 },
+	};
+	static const struct t6_check converted[] = {
+		{ F_RDLCK, 30,  10, F_UNLCK },
+		{ F_RDLCK, 30,  30, F_WRLCK, 40, 10 },
+		{ F_WRLCK, 30,   5, F_RDLCK, 30, 10 },
+		{ F_WRLCK, 55,   5, F_RDLCK, 50, 10 },
+	};
+	static const struct t6_check unlocked[] = {
+		{ F_WRLCK,  0,   0, F_UNLCK },
+	};
+	int pfd[2];
+	int status;
+	int pid;
+	int fd;
+	int rc = EXIT_FAILURE;
+
+	if (argc != 3) {
+		fprintf(stderr, "Usage: ./flocks_test 6 file\n");
+		return EXIT_FAILURE;
+	}
+
+	if ((fd = open(argv[2], O_RDWR)) < 0) {
+		fprintf(stderr, "Couldn't open file: %s\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+
+	/* adjoining and overlapping locks merge into [0, 20) */
+	if (t6_lock(fd, F_SETLK, F_WRLCK, 0, 10) < 0 ||
+	    t6_lock(fd, F_SETLK, F_WRLCK, 10, 10) < 0 ||
+	    t6_lock(fd, F_SETLK, F_WRLCK, 5, 10) < 0) {
+		perror("lock failed");
+		goto out;
+	}
+	if (t6_verify(fd, "merge", merged, 3) != 0)
+		goto out;
+
+	/* a hole in the middle leaves [0, 8) and [12, 20) */
+	if (t6_lock(fd, F_SETLK, F_UNLCK, 8, 4) < 0) {
+		perror("unlock failed");
+		goto out;
+	}
+	if (t6_verify(fd, "split", split, 3) != 0)
+		goto out;
+
+	/* a write lock within a read lock splits it in three */
+	if (t6_lock(fd, F_SETLK, F_RDLCK, 30, 30) < 0 ||
+	    t6_lock(fd, F_SETLK, F_WRLCK, 40, 10) < 0) {
+		perror("lock failed");
+		goto out;
+	}
+	if (t6_verify(fd, "convert", converted, 4) != 0)
+		goto out;
+
+	if (pipe(pfd) < 0) {
+		perror("pipe");
+		goto out;
+	}
+
+	pid = fork();
+	if (pid == -1) {
+		perror("fork");
+		goto out_pipe;
+	}
+
+	if (pid == 0) {
+		close(pfd[0]);
+		if (t6_lock(fd, F_SETLK, F_WRLCK, 15, 1) == 0 ||
+		    (errno != EAGAIN && errno != EACCES)) {
+			fprintf(stderr, "conflicting lock was not refused\n");
+			exit(EXIT_FAILURE);
+		}
+		if (t6_lock(fd, F_SETLK, F_RDLCK, 35, 1) < 0) {
+			perror("compatible lock was refused");
+			exit(EXIT_FAILURE);
+		}
+		if (t6_lock(fd, F_SETLKW, F_WRLCK, 15, 1) < 0) {
+			perror("blocking lock failed");
+			exit(EXIT_FAILURE);
+		}
+		if (write(pfd[1], "", 1) != 1)
+			exit(EXIT_FAILURE);
+		exit(EXIT_SUCCESS);
+	}
+
+	close(pfd[1]);
+	pfd[1] = -1;
+	if (t6_wait_child(pfd[0], 2)) {
+		fprintf(stderr, "block: conflicting lock was granted\n");
+		goto out_child;
+	}
+	if (t6_lock(fd, F_SETLK, F_UNLCK, 0, 20) < 0) {
+		perror("unlock failed");
+		goto out_child;
+	}
+	if (!t6_wait_child(pfd[0], 30)) {
+		fprintf(stderr, "block: lock not granted after unlock\n");
+		goto out_child;
+	}
+	printf("block: ok\n");
+	fflush(stdout);
+
+	if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+	    WEXITSTATUS(status) != 0)
+		goto out_pipe;
+	pid = -1;
+
+	if (t6_lock(fd, F_SETLK, F_UNLCK, 0, 0) < 0) {
+		perror("unlock failed");
+		goto out_pipe;
+	}
+	rc = t6_verify(fd, "unlock", unlocked, 1);
+
+out_child:
+	if (pid > 0) {
+		kill(pid, SIGKILL);
+		waitpid(pid, &status, 0);
+	}
+out_pipe:
+	close(pfd[0]);
+	if (pfd[1] >= 0)
+		close(pfd[1]);
+out:
+	close(fd);
+	return rc;
+}
+
 /** ==============================================================
  * program entry
  */
@@ -470,6 +836,12 @@ int main(int argc, char* argv[])
 	case 4:
 		rc = t4(argc, argv);
 		break;
+	case 5:
+		rc = t5(argc, argv);
+		break;
+	case 6:
+		rc = t6(argc, argv);
+		break;
         default:
                 fprintf(stderr, "unknow test number %s\n", argv[1]);
                 break;
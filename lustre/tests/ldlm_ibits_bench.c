@@ -0,0 +1,433 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lustre/tests/ldlm_ibits_bench.c
+ *
+ * Sanity check and benchmark for the IBITS lock compatibility check: grows
+ * the granted queue of a single resource, as a hot directory shared by many
+ * clients would, checks every answer of ldlm_inodebits_compat_queue()
+ * against a plain scan of both queues, and reports how many locks one
+ * enqueue has to look at and how long it takes as the queue grows.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <libcfs/libcfs.h>
+#ifndef HAVE_SERVER_SUPPORT
+#define HAVE_SERVER_SUPPORT 1
+#endif
+#undef DEBUG_SUBSYSTEM
+#include <../ldlm/ldlm_inodebits.c>
+
+/* what obdclass and liblustre would provide */
+__u64 obd_alloc;
+__u64 obd_max_alloc;
+unsigned int obd_alloc_fail_rate;
+struct task_struct *current;
+
+int obd_alloc_fail(const void *ptr, const char *name, const char *type,
+		   size_t size, const char *file, int line)
+{
+	return ptr == NULL;
+}
+
+#define error(fmt, args...) do {                        \
+	fflush(stdout), fflush(stderr);                 \
+	fprintf(stderr, "\nError:" fmt, ##args);        \
+	abort();                                        \
+} while (0)
+
+/* what the rest of ldlm would provide, only what the benchmark needs */
+ldlm_mode_t lck_compat_array[] = {
+	[LCK_EX] LCK_COMPAT_EX,
+	[LCK_PW] LCK_COMPAT_PW,
+	[LCK_PR] LCK_COMPAT_PR,
+	[LCK_CW] LCK_COMPAT_CW,
+	[LCK_CR] LCK_COMPAT_CR,
+	[LCK_NL] LCK_COMPAT_NL,
+	[LCK_GROUP] LCK_COMPAT_GROUP,
+	[LCK_COS] LCK_COMPAT_COS,
+};
+
+void ldlm_add_ast_work_item(struct ldlm_lock *lock, struct ldlm_lock *new,
+			    cfs_list_t *work_list)
+{
+}
+
+void ldlm_grant_lock(struct ldlm_lock *lock, cfs_list_t *work_list)
+{
+}
+
+int ldlm_run_ast_work(struct ldlm_namespace *ns, cfs_list_t *rpc_list,
+		      ldlm_desc_ast_t ast_type)
+{
+	return 0;
+}
+
+void ldlm_resource_add_lock(struct ldlm_resource *res, cfs_list_t *head,
+			    struct ldlm_lock *lock)
+{
+	cfs_list_add_tail(&lock->l_res_link, head);
+	if (res->lr_ibits_queues != NULL)
+		ldlm_ibits_queues_add(lock, head);
+}
+
+void ldlm_resource_unlink_lock(struct ldlm_lock *lock)
+{
+	if (lock->l_resource->lr_ibits_queues != NULL &&
+	    !cfs_list_empty(&lock->l_res_link))
+		ldlm_ibits_queues_del(lock);
+	cfs_list_del_init(&lock->l_sl_policy);
+	cfs_list_del_init(&lock->l_sl_mode);
+	cfs_list_del_init(&lock->l_res_link);
+}
+
+/* the lock modes and bits the MDT hands out for a directory */
+static const struct {
+	ldlm_mode_t	mode;
+	__u64		bits;
+} ibb_kinds[] = {
+	{ LCK_CR, MDS_INODELOCK_LOOKUP },
+	{ LCK_PR, MDS_INODELOCK_LOOKUP | MDS_INODELOCK_UPDATE },
+	{ LCK_PR, MDS_INODELOCK_LOOKUP | MDS_INODELOCK_UPDATE |
+		  MDS_INODELOCK_PERM },
+	{ LCK_CR, MDS_INODELOCK_LOOKUP | MDS_INODELOCK_PERM },
+	{ LCK_PR, MDS_INODELOCK_LAYOUT },
+	{ LCK_CR, MDS_INODELOCK_XATTR },
+};
+#define IBB_KINDS	ARRAY_SIZE(ibb_kinds)
+
+/* a few modes and bits to check against, conflicting ones among them */
+static const struct {
+	ldlm_mode_t	mode;
+	__u64		bits;
+} ibb_requests[] = {
+	{ LCK_CR, MDS_INODELOCK_LOOKUP },
+	{ LCK_PR, MDS_INODELOCK_LOOKUP | MDS_INODELOCK_UPDATE },
+	{ LCK_PW, MDS_INODELOCK_LAYOUT },
+	{ LCK_EX, MDS_INODELOCK_UPDATE },
+	{ LCK_EX, MDS_INODELOCK_OPEN },
+	{ LCK_CW, MDS_INODELOCK_XATTR },
+	{ LCK_COS, MDS_INODELOCK_UPDATE },
+	{ LCK_PR, 1ULL << 40 },
+};
+#define IBB_REQUESTS	ARRAY_SIZE(ibb_requests)
+
+struct ibb_resource {
+	struct ldlm_ns_bucket	 ibr_bucket;
+	struct ldlm_namespace	 ibr_ns;
+	struct ldlm_resource	 ibr_res;
+	/* first granted lock of each kind, i.e. of each policy group */
+	struct ldlm_lock	*ibr_first[IBB_KINDS];
+};
+
+static double ibb_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void ibb_res_init(struct ibb_resource *ibr, int indexed)
+{
+	struct ldlm_resource *res = &ibr->ibr_res;
+
+	memset(ibr, 0, sizeof(*ibr));
+	ibr->ibr_bucket.nsb_namespace = &ibr->ibr_ns;
+	res->lr_ns_bucket = &ibr->ibr_bucket;
+	res->lr_type = LDLM_IBITS;
+	CFS_INIT_LIST_HEAD(&res->lr_granted);
+	CFS_INIT_LIST_HEAD(&res->lr_converting);
+	CFS_INIT_LIST_HEAD(&res->lr_waiting);
+	spin_lock_init(&res->lr_lock);
+
+	if (indexed) {
+		res->lr_ibits_queues = ldlm_ibits_queues_alloc();
+		if (res->lr_ibits_queues == NULL)
+			error("no memory\n");
+	}
+}
+
+static struct ldlm_lock *ibb_lock_new(struct ldlm_resource *res,
+				      ldlm_mode_t mode, __u64 bits)
+{
+	struct ldlm_lock *lock;
+
+	lock = calloc(1, sizeof(*lock));
+	if (lock == NULL)
+		error("no memory\n");
+
+	lock->l_resource = res;
+	lock->l_req_mode = mode;
+	lock->l_policy_data.l_inodebits.bits = bits;
+	lock->l_client_cookie = random();
+	CFS_INIT_LIST_HEAD(&lock->l_res_link);
+	CFS_INIT_LIST_HEAD(&lock->l_sl_mode);
+	CFS_INIT_LIST_HEAD(&lock->l_sl_policy);
+	return lock;
+}
+
+/*
+ * Grant a lock of kind \a kind, keeping the granted queue sorted into mode
+ * and policy groups with their skip lists, as ldlm_grant_lock() does.
+ */
+static void ibb_grant(struct ibb_resource *ibr, int kind)
+{
+	struct ldlm_resource *res = &ibr->ibr_res;
+	struct ldlm_lock *lock;
+	struct ldlm_lock *mode_first;
+	struct ldlm_lock *last;
+
+	lock = ibb_lock_new(res, ibb_kinds[kind].mode, ibb_kinds[kind].bits);
+	lock->l_granted_mode = lock->l_req_mode;
+
+	if (ibr->ibr_first[kind] != NULL) {
+		/* join the policy group, after its last lock */
+		last = cfs_list_entry(ibr->ibr_first[kind]->l_sl_policy.prev,
+				      struct ldlm_lock, l_sl_policy);
+		cfs_list_add(&lock->l_res_link, &last->l_res_link);
+		cfs_list_add(&lock->l_sl_mode, &last->l_sl_mode);
+		cfs_list_add(&lock->l_sl_policy, &last->l_sl_policy);
+		goto out;
+	}
+	ibr->ibr_first[kind] = lock;
+
+	cfs_list_for_each_entry(mode_first, &res->lr_granted, l_res_link) {
+		if (mode_first->l_req_mode != lock->l_req_mode)
+			continue;
+		/* a new policy group at the end of its mode group */
+		last = cfs_list_entry(mode_first->l_sl_mode.prev,
+				      struct ldlm_lock, l_sl_mode);
+		cfs_list_add(&lock->l_res_link, &last->l_res_link);
+		cfs_list_add(&lock->l_sl_mode, &last->l_sl_mode);
+		goto out;
+	}
+	/* a new mode group at the end of the queue */
+	cfs_list_add_tail(&lock->l_res_link, &res->lr_granted);
+out:
+	if (res->lr_ibits_queues != NULL)
+		ldlm_ibits_queues_add(lock, &res->lr_granted);
+}
+
+static void ibb_free_queue(cfs_list_t *queue)
+{
+	struct ldlm_lock *lock;
+
+	while (!cfs_list_empty(queue)) {
+		lock = cfs_list_entry(queue->next, struct ldlm_lock,
+				      l_res_link);
+		ldlm_resource_unlink_lock(lock);
+		free(lock);
+	}
+}
+
+static void ibb_res_fini(struct ibb_resource *ibr)
+{
+	struct ldlm_resource *res = &ibr->ibr_res;
+	int slot;
+	int idx;
+
+	ibb_free_queue(&res->lr_granted);
+	ibb_free_queue(&res->lr_waiting);
+
+	if (res->lr_ibits_queues == NULL)
+		return;
+
+	for (slot = 0; slot < LDLM_IBITS_SLOTS; slot++)
+		for (idx = 0; idx < LCK_MODE_NUM; idx++)
+			if (res->lr_ibits_queues->liq_granted.lic_count[slot][idx] ||
+			    res->lr_ibits_queues->liq_waiting.lic_count[slot][idx])
+				error("slot %d mode %d still counted\n",
+				      slot, 1 << idx);
+	ldlm_ibits_queues_free(res->lr_ibits_queues);
+}
+
+/* whether \a req conflicts with any lock on \a queue, the slow way */
+static int ibb_conflict(cfs_list_t *queue, struct ldlm_lock *req)
+{
+	struct ldlm_lock *lock;
+
+	cfs_list_for_each_entry(lock, queue, l_res_link) {
+		if (lock == req)
+			break;
+		if (lockmode_compat(lock->l_req_mode, req->l_req_mode))
+			continue;
+		if (!(lock->l_policy_data.l_inodebits.bits &
+		      req->l_policy_data.l_inodebits.bits))
+			continue;
+		if (lock->l_req_mode == LCK_COS &&
+		    lock->l_client_cookie == req->l_client_cookie)
+			continue;
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Check every request kind against the queues, as a first enqueue and from
+ * the waiting queue, and compare with ibb_conflict().
+ */
+static void ibb_sanity(struct ibb_resource *ibr)
+{
+	struct ldlm_resource *res = &ibr->ibr_res;
+	struct ldlm_lock *req;
+	int examined = 0;
+	int i;
+
+	for (i = 0; i < IBB_REQUESTS; i++) {
+		int expected;
+		int rc;
+
+		req = ibb_lock_new(res, ibb_requests[i].mode,
+				   ibb_requests[i].bits);
+
+		expected = !ibb_conflict(&res->lr_granted, req) &&
+			   !ibb_conflict(&res->lr_waiting, req);
+		rc = ldlm_inodebits_compat_queue(&res->lr_granted, req, NULL,
+						 &examined) &&
+		     ldlm_inodebits_compat_queue(&res->lr_waiting, req, NULL,
+						 &examined);
+		if (rc != expected)
+			error("request %d: compat %d, expected %d\n",
+			      i, rc, expected);
+
+		/* once queued, only the locks ahead of it matter */
+		ldlm_resource_add_lock(res, &res->lr_waiting, req);
+		expected = !ibb_conflict(&res->lr_granted, req) &&
+			   !ibb_conflict(&res->lr_waiting, req);
+		rc = ldlm_inodebits_compat_queue(&res->lr_granted, req, NULL,
+						 &examined) &&
+		     ldlm_inodebits_compat_queue(&res->lr_waiting, req, NULL,
+						 &examined);
+		if (rc != expected)
+			error("waiting request %d: compat %d, expected %d\n",
+			      i, rc, expected);
+
+		ldlm_resource_unlink_lock(req);
+		free(req);
+	}
+}
+
+/*
+ * Grow the granted queue to \a count locks, with \a waiting conflicting
+ * locks queued behind them, and time LOOKUP enqueues at each power of ten.
+ */
+static void ibb_run(int count, int waiting, int checks, int indexed)
+{
+	struct ibb_resource ibr;
+	struct ldlm_resource *res = &ibr.ibr_res;
+	struct ldlm_lock *req;
+	int granted = 0;
+	int step;
+	int i;
+
+	ibb_res_init(&ibr, indexed);
+
+	/* setattr and layout changes waiting for the readers to go away */
+	for (i = 0; i < waiting; i++) {
+		req = ibb_lock_new(res, i % 2 ? LCK_EX : LCK_PW,
+				   i % 2 ? MDS_INODELOCK_UPDATE :
+					   MDS_INODELOCK_LAYOUT);
+		ldlm_resource_add_lock(res, &res->lr_waiting, req);
+	}
+
+	req = ibb_lock_new(res, LCK_CR, MDS_INODELOCK_LOOKUP);
+	for (step = 1000; step <= count; step *= 10) {
+		int examined = 0;
+		double start;
+
+		while (granted < step)
+			ibb_grant(&ibr, granted++ % IBB_KINDS);
+		ibb_sanity(&ibr);
+
+		start = ibb_now();
+		for (i = 0; i < checks; i++) {
+			if (!ldlm_inodebits_compat_queue(&res->lr_granted, req,
+							 NULL, &examined) ||
+			    !ldlm_inodebits_compat_queue(&res->lr_waiting, req,
+							 NULL, &examined))
+				error("LOOKUP lock does not fit\n");
+		}
+		printf("%8d granted %6d waiting %s: %10.0f enqueues/sec, "
+		       "%8.1f locks examined/enqueue\n", granted, waiting,
+		       indexed ? "indexed" : "walked ",
+		       checks / (ibb_now() - start),
+		       (double)examined / checks);
+	}
+
+	free(req);
+	ibb_res_fini(&ibr);
+}
+
+static void usage(char *prog)
+{
+	fprintf(stderr, "usage: %s [-n granted] [-w waiting] [-c checks] "
+		"[-x]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	int count = 100000;
+	int waiting = 1000;
+	int checks = 100000;
+	int walk = 0;
+	struct timeval tv;
+	int c;
+
+	while ((c = getopt(argc, argv, "n:w:c:x")) != -1) {
+		switch (c) {
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'w':
+			waiting = atoi(optarg);
+			break;
+		case 'c':
+			checks = atoi(optarg);
+			break;
+		case 'x':
+			walk = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (count < 1000 || waiting < 0 || checks <= 0)
+		usage(argv[0]);
+
+	gettimeofday(&tv, NULL);
+	srandom(tv.tv_usec);
+
+	ibb_run(count, waiting, checks, 1);
+	if (walk)
+		ibb_run(count, waiting, checks, 0);
+
+	return 0;
+}
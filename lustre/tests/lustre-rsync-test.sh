@@ -615,6 +615,45 @@ test_9() {
 }
 run_test 9 "Replicate recursive directory removal"
 
+# Test 10 - Replicate with several threads
+test_10() {
+	init_src
+	init_changelog
+
+	local numfiles=1000
+	local i
+
+	for i in $(seq 8); do
+		mkdir $DIR/$tdir/d$i || error "mkdir d$i failed"
+		createmany -o $DIR/$tdir/d$i/$tfile $((numfiles / 8)) ||
+			error "createmany in d$i failed"
+	done
+	# repeated attribute updates, renames and unlinks in between
+	for i in $(seq 10); do
+		chmod 0600 $DIR/$tdir/d1/${tfile}0
+		touch $DIR/$tdir/d1/${tfile}0
+		chmod 0644 $DIR/$tdir/d1/${tfile}0
+	done
+	mv $DIR/$tdir/d2 $DIR/$tdir/d1/d2 || error "mv d2 failed"
+	mv $DIR/$tdir/d3/${tfile}1 $DIR/$tdir/d4/ || error "mv file failed"
+	unlinkmany $DIR/$tdir/d5/$tfile $((numfiles / 8)) ||
+		error "unlinkmany failed"
+	rmdir $DIR/$tdir/d5 || error "rmdir d5 failed"
+	dd if=/dev/urandom of=$DIR/$tdir/d6/${tfile}0 bs=1M count=4 ||
+		error "dd failed"
+
+	local LRSYNC_LOG=$(generate_logname "lrsync_log")
+	$LRSYNC -s $DIR -t $TGT -t $TGT2 -m $MDT0 -u $CL_USER -l $LREPL_LOG \
+		--threads 8 -D $LRSYNC_LOG
+	check_diff $DIR/$tdir $TGT/$tdir
+	check_diff $DIR/$tdir $TGT2/$tdir
+
+	fini_changelog
+	cleanup_src_tgt
+	return 0
+}
+run_test 10 "Replicate with several threads"
+
 cd $ORIG_PWD
 complete $SECONDS
 check_and_cleanup_lustre
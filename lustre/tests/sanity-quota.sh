@@ -2329,6 +2329,132 @@ test_36() {
 }
 run_test 36 "Migrate old admin files into new global indexes"
 
+# print the number of samples of counter $2 in the quota slave stats of $1
+qsd_stat_count() {
+	local facet=$1
+	local varsvc=${facet}_svc
+
+	do_facet $facet $LCTL get_param -n \
+		osd-$(facet_fstype $facet).${!varsvc}.quota_slave.stats |
+		awk '$1 == "'$2'" { n = $2 } END { print n + 0 }'
+}
+
+test_37() {
+	[ "$OSTCOUNT" -lt "2" ] && skip "needs 2 OSTs" && return
+
+	local LIMIT=20 # 20M
+	local TESTFILE=$DIR/$tdir/$tfile
+	local TESTFILE2=$DIR/$tdir/$tfile-2
+	local batch
+	local prefetch
+	local i
+
+	setup_quota_test
+	trap cleanup_quota_test EXIT
+
+	set_ost_qtype "u" || error "enable ost quota failed"
+	$LFS setquota -u $TSTUSR -b 0 -B ${LIMIT}M -i 0 -I 0 $DIR ||
+		error "set quota failed"
+
+	$LFS setstripe $TESTFILE -c 1 -i 0 || error "setstripe failed"
+	chown $TSTUSR.$TSTUSR $TESTFILE
+	$LFS setstripe $TESTFILE2 -c 1 -i 1 || error "setstripe failed"
+	chown $TSTUSR2.$TSTUSR2 $TESTFILE2
+
+	batch=$(qsd_stat_count ost2 batch)
+	prefetch=$(qsd_stat_count ost2 prefetch)
+
+	# $TSTUSR2 isn't enforced yet, ost2 uses space without owning any
+	$RUNAS2 $DD of=$TESTFILE2 count=1 oflag=sync ||
+		quota_error u $TSTUSR2 "write failed, but expect success"
+	# $TSTUSR gets its first space on ost1
+	$RUNAS $DD of=$TESTFILE count=1 oflag=sync ||
+		quota_error u $TSTUSR "write failed, but expect success"
+
+	# the glimpse of the new limit makes ost2 report the usage of
+	# $TSTUSR2 in a batched request, whose reply hints $TSTUSR
+	$LFS setquota -u $TSTUSR2 -b 0 -B ${LIMIT}M -i 0 -I 0 $DIR ||
+		error "set quota failed"
+	for i in $(seq 30); do
+		[ $(qsd_stat_count ost2 prefetch) -gt $prefetch ] && break
+		sleep 1
+	done
+
+	[ $(qsd_stat_count ost2 batch) -gt $batch ] ||
+		error "no batched quota request sent by ost2"
+	[ $(qsd_stat_count ost2 prefetch) -gt $prefetch ] ||
+		error "$TSTUSR not prefetched by ost2"
+	[ $(getquota -u $TSTUSR $FSNAME-OST0001_UUID bhardlimit) -gt 0 ] ||
+		quota_error u $TSTUSR "no space granted to ost2"
+
+	cleanup_quota_test
+	resetquota -u $TSTUSR
+	resetquota -u $TSTUSR2
+}
+run_test 37 "Batched quota requests and prefetch with a new master"
+
+# usage: restart_ost1_reint
+# reconnect ost1 to the master, which negotiates QUOTA_DQACQ_BATCH again
+restart_ost1_reint() {
+	stop ost1 || return 1
+	start ost1 $(ostdevname 1) $OST_MOUNT_OPTS || return 2
+	wait_ost_reint "u" || return 3
+}
+
+test_38() {
+	local LIMIT=20 # 20M
+	local TESTFILE=$DIR/$tdir/$tfile
+	local TESTFILE2=$DIR/$tdir/$tfile-2
+	local i
+
+	setup_quota_test
+	trap cleanup_quota_test EXIT
+
+	set_ost_qtype "u" || error "enable ost quota failed"
+	$LFS setstripe $TESTFILE -c 1 -i 0 || error "setstripe failed"
+	chown $TSTUSR.$TSTUSR $TESTFILE
+	$LFS setstripe $TESTFILE2 -c 1 -i 0 || error "setstripe failed"
+	chown $TSTUSR2.$TSTUSR2 $TESTFILE2
+
+	# define OBD_FAIL_QUOTA_NO_BATCH 0xa05
+	lustre_fail mds 0xa05
+	restart_ost1_reint || { lustre_fail mds 0; error "restart failed"; }
+	lustre_fail mds 0
+
+	# the usage report of the glimpse goes as a single request
+	$RUNAS $DD of=$TESTFILE count=1 oflag=sync ||
+		quota_error u $TSTUSR "write failed, but expect success"
+	$LFS setquota -u $TSTUSR -b 0 -B ${LIMIT}M -i 0 -I 0 $DIR ||
+		error "set quota failed"
+	for i in $(seq 30); do
+		[ $(getquota -u $TSTUSR $FSNAME-OST0000_UUID bhardlimit) -gt 0 ] &&
+			break
+		sleep 1
+	done
+	[ $(getquota -u $TSTUSR $FSNAME-OST0000_UUID bhardlimit) -gt 0 ] ||
+		quota_error u $TSTUSR "usage not reported to an old master"
+	[ $(qsd_stat_count ost1 batch) -eq 0 ] ||
+		error "batched request sent to an old master"
+
+	# reconnected to a new master, batched requests are used again
+	restart_ost1_reint || error "restart failed"
+	$RUNAS2 $DD of=$TESTFILE2 count=1 oflag=sync ||
+		quota_error u $TSTUSR2 "write failed, but expect success"
+	$LFS setquota -u $TSTUSR2 -b 0 -B ${LIMIT}M -i 0 -I 0 $DIR ||
+		error "set quota failed"
+	for i in $(seq 30); do
+		[ $(qsd_stat_count ost1 batch) -gt 0 ] && break
+		sleep 1
+	done
+	[ $(qsd_stat_count ost1 batch) -gt 0 ] ||
+		error "no batched request after reconnection"
+
+	cleanup_quota_test
+	resetquota -u $TSTUSR
+	resetquota -u $TSTUSR2
+}
+run_test 38 "Quota slave negotiates batched requests on each connection"
+
 quota_fini()
 {
         do_nodes $(comma_list $(nodes_list)) "lctl set_param debug=-quota"
@@ -38,6 +38,7 @@ SOCKETSERVER=${SOCKETSERVER:-socketserver}
 SOCKETCLIENT=${SOCKETCLIENT:-socketclient}
 MEMHOG=${MEMHOG:-memhog}
 DIRECTIO=${DIRECTIO:-directio}
+WRITE_BENCH=${WRITE_BENCH:-write_bench}
 ACCEPTOR_PORT=${ACCEPTOR_PORT:-988}
 UMOUNT=${UMOUNT:-"umount -d"}
 STRIPES_PER_OBJ=-1
@@ -3421,6 +3422,77 @@ test_42e() { # bug22074
 }
 run_test 42e "verify sub-RPC writes are not done synchronously"
 
+# average pages per write RPC in the rpc_stats $1, times 100
+write_rpc_pages() {
+	$LCTL get_param -n $1 | awk '/^pages per rpc/ { hist = 1; next }
+		hist && /^$/ { exit }
+		hist { split($1, b, ":"); rpcs += $6; pages += b[1] * $6 }
+		END { print rpcs ? int(pages * 100 / rpcs) : 0 }'
+}
+
+# write many small files and a large one with a 1MB dirty cache, with
+# write gathering set to $2 pages, and check their data
+write_gather_run() {
+	local proc_osc0=$1
+	local files=200
+	local i
+
+	test_mkdir -p $TDIR
+	$SETSTRIPE -c 1 -i 0 $TDIR
+	$LCTL set_param -n $proc_osc0/write_gather_pages $2
+	$LCTL set_param $proc_osc0/rpc_stats 0
+
+	for ((i = 0; i < files; i++)); do
+		dd if=/dev/urandom of=$TDIR/f$i bs=4k count=$((i % 8 + 1)) \
+			2>/dev/null || error "write $TDIR/f$i failed"
+		[ $((i % 8)) -eq 0 ] && dd if=/dev/zero of=$TDIR/big \
+			bs=1M count=2 seek=$((i / 8 * 2)) 2>/dev/null
+	done
+	for ((i = 0; i < files; i++)); do
+		md5sum $TDIR/f$i
+	done > $TMP/$tfile.md5
+	sync
+	cancel_lru_locks osc
+	md5sum -c --quiet $TMP/$tfile.md5 || error "data changed"
+	rm -rf $TDIR $TMP/$tfile.md5
+}
+
+test_42f() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	local TDIR=$DIR/${tdir}f
+	local proc_osc0="osc.${FSNAME}-OST0000-osc-[^MDT]*"
+	local max_dirty_mb=$($LCTL get_param -n $proc_osc0/max_dirty_mb)
+	local plain
+	local gathered
+	local rpcs
+
+	$LCTL set_param -n $proc_osc0/write_gather_pages 1025 &&
+		error "write_gather_pages above max_pages_per_rpc accepted"
+
+	# a small dirty cache makes writers wait for cache space
+	$LCTL set_param -n $proc_osc0/max_dirty_mb 1
+	$LCTL set_param -n $proc_osc0/write_gather_latency_ms 50
+
+	write_gather_run $proc_osc0 0
+	plain=$(write_rpc_pages $proc_osc0/rpc_stats)
+
+	write_gather_run $proc_osc0 16
+	gathered=$(write_rpc_pages $proc_osc0/rpc_stats)
+	$LCTL get_param $proc_osc0/rpc_stats
+	rpcs=$($LCTL get_param -n $proc_osc0/rpc_stats |
+		awk '/^gathered write RPCs:/ { print $4 }')
+
+	$LCTL set_param -n $proc_osc0/write_gather_pages 0
+	$LCTL set_param -n $proc_osc0/max_dirty_mb $max_dirty_mb
+
+	echo "pages per write RPC x100: $plain without, $gathered with" \
+		"gathering, $rpcs RPCs held back"
+	[ ${rpcs:-0} -gt 0 ] || error "no write RPC was held back"
+	[ $gathered -gt $plain ] ||
+		error "write RPCs not fuller with gathering: $gathered <= $plain"
+}
+run_test 42f "write gathering fills RPCs and keeps data intact"
+
 test_43() {
 	test_mkdir -p $DIR/$tdir
 	cp -p /bin/ls $DIR/$tdir/$tfile
@@ -4633,6 +4705,41 @@ test_56y() {
 }
 run_test 56y "lfs find -L raid0|released"
 
+test_56z() {
+	local dir0=$DIR/$tdir/$testnum
+	local i
+
+	mkdir -p $dir0/a/b/c || error "creating dirs in $dir0"
+	for i in $(seq 1 10); do
+		test_mkdir -p $dir0/d$i/e$i
+		createmany -o $dir0/d$i/e$i/f 20 > /dev/null ||
+			error "creating files in $dir0/d$i/e$i"
+	done
+	dd if=/dev/zero of=$dir0/a/b/c/f bs=1M count=2 ||
+		error "writing $dir0/a/b/c/f"
+
+	local expected=$($LFIND $dir0 | sort)
+	local res
+
+	for i in 2 8; do
+		res=$($LFIND $dir0 --threads $i | sort)
+		[ "$res" == "$expected" ] ||
+			error "--threads $i found other files than serial find"
+	done
+
+	expected=$($LFIND $dir0 -maxdepth 2 -type d | sort)
+	res=$($LFIND $dir0 -maxdepth 2 -type d --threads 4 | sort)
+	[ "$res" == "$expected" ] ||
+		error "--threads 4 -maxdepth 2 found other directories"
+
+	# the MDS times of new files are recent enough
+	expected=$($LFIND $dir0 -mtime -1 -type f | sort)
+	res=$($LFIND $dir0 --threads 4 --lazy -mtime -1 -type f | sort)
+	[ "$res" == "$expected" ] ||
+		error "--lazy -mtime -1 found other files than without --lazy"
+}
+run_test 56z "lfs find --threads and --lazy"
+
 test_57a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
 	# note test will not do anything if MDS is not local
@@ -4877,6 +4984,31 @@ test_64c() {
 }
 run_test 64c "verify grant shrink ========================------"
 
+test_64d() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	local proc_osc0="osc.${FSNAME}-OST0000-osc-[^mM]*"
+	local cache_pages=$($LCTL get_param -n $proc_osc0/grant_cache_pages)
+	local threads=$(($(grep -c "processor" /proc/cpuinfo) * 2))
+	local dirty
+	local p
+
+	[ $threads -gt 32 ] && threads=32
+	$SETSTRIPE -c 1 -i 0 $DIR/$tfile
+	# the grant check after this test verifies the accounting on the OST
+	for p in 0 $cache_pages; do
+		$LCTL set_param -n $proc_osc0/grant_cache_pages $p
+		echo "grant_cache_pages=$p"
+		$WRITE_BENCH -t 1,$threads -s 4 -v $DIR/$tfile ||
+			error "write_bench with $p cached pages failed"
+		# credits left in the caches must not be reported as dirty
+		dirty=$($LCTL get_param -n $proc_osc0/cur_dirty_bytes)
+		[ $dirty -eq 0 ] || error "$dirty bytes still dirty after fsync"
+	done
+	$LCTL set_param -n $proc_osc0/grant_cache_pages $cache_pages
+	rm -f $DIR/$tfile
+}
+run_test 64d "per-CPT grant cache keeps writes and accounting exact"
+
 # bug 1414 - set/get directories' stripe info
 test_65a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
@@ -5532,6 +5664,29 @@ test_77j() { # bug 13805
 }
 run_test 77j "client only supporting ADLER32"
 
+test_77k() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	$GSS && skip "could not run with gss" && return
+	[ -f /proc/sys/lnet/crypto_hash_speeds ] ||
+		{ skip "no crypto_hash_speeds" && return; }
+	cat /proc/sys/lnet/crypto_hash_speeds
+	[ ! -f $F77_TMP ] && setup_f77
+
+	# the whole RPC is hashed in page batches, check each type end to end
+	set_checksums 1
+	for algo in $CKSUM_TYPES; do
+		set_checksum_type $algo
+		dd if=$F77_TMP of=$DIR/$tfile bs=4M count=$((F77SZ / 4)) ||
+			error "dd write error with $algo"
+		cancel_lru_locks osc
+		cmp $F77_TMP $DIR/$tfile || error "compare failed with $algo"
+	done
+	set_checksum_type $ORIG_CSUM_TYPE
+	set_checksums 0
+	rm -f $DIR/$tfile
+}
+run_test 77k "bulk checksums of all types over multi-page RPCs"
+
 [ "$ORIG_CSUM" ] && set_checksums $ORIG_CSUM || true
 rm -f $F77_TMP
 unset F77_TMP
@@ -6078,6 +6233,64 @@ test_101f() {
 }
 run_test 101f "check read-ahead for max_read_ahead_whole_mb"
 
+# read the file with the multiop command $2 and check that at least half of
+# the $3 pages read were read-ahead hits of the pattern named $1
+ra_check_101g() {
+	local pattern="$1"
+	local cmd=$2
+	local pages=$3
+	local hits
+
+	cancel_lru_locks osc
+	$LCTL set_param -n llite.*.read_ahead_stats 0
+	$MULTIOP $DIR/$tfile o${cmd}c || error "$pattern read failed"
+
+	hits=$($LCTL get_param -n llite.*.read_ahead_stats |
+		get_named_value "$pattern hits" | cut -d" " -f1 | calc_total)
+	echo "$hits $pattern hits for $pages pages read"
+	if [ $((hits * 2)) -lt $pages ]; then
+		$LCTL get_param llite.*.read_ahead_stats
+		error "only $hits $pattern hits for $pages pages"
+	fi
+}
+
+test_101g() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	local bsize=65536
+	local psize=$(getconf PAGE_SIZE)
+	local async
+	local cmd
+	local i
+
+	$SETSTRIPE -c 1 $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=64 2>/dev/null ||
+		error "dd failed"
+
+	for async in 1 0; do
+		$LCTL set_param -n llite.*.read_ahead_async $async
+
+		# 64KB reads from the end of the file to its start
+		cmd=""
+		for ((i = 1023; i >= 0; i--)); do
+			cmd="${cmd}z$((i * bsize))r$bsize"
+		done
+		ra_check_101g reverse $cmd $((1024 * bsize / psize))
+
+		# three 64KB reads at 0, 128KB and 512KB of every 1MB
+		cmd=""
+		for ((i = 0; i < 64; i++)); do
+			cmd="${cmd}z$((i << 20))r${bsize}"
+			cmd="${cmd}z$(((i << 20) + 131072))r${bsize}"
+			cmd="${cmd}z$(((i << 20) + 524288))r${bsize}"
+		done
+		ra_check_101g "nested stride" $cmd $((192 * bsize / psize))
+	done
+
+	$LCTL set_param -n llite.*.read_ahead_async 1
+	rm -f $DIR/$tfile
+}
+run_test 101g "check read-ahead for reverse and nested stride reads"
+
 setup_test102() {
 	test_mkdir -p $DIR/$tdir
 	chown $RUNAS_ID $DIR/$tdir
@@ -6632,6 +6845,24 @@ test_105e() { # bug 22660 && 22040
 }
 run_test 105e "Two conflicting flocks from same process ======="
 
+test_105f() {
+	[ -z "$(mount | grep "$MOUNT.*flock" | grep -v noflock)" ] &&
+		skip "mount w/o flock enabled" && return
+	touch $DIR/$tfile
+	flocks_test 5 $DIR/$tfile 4 10000 || error "flocks_test 5 failed"
+	rm -f $DIR/$tfile
+}
+run_test 105f "many interleaved POSIX locks on one file ======="
+
+test_105g() {
+	[ -z "$(mount | grep "$MOUNT.*flock" | grep -v noflock)" ] &&
+		skip "mount w/o flock enabled" && return
+	touch $DIR/$tfile
+	flocks_test 6 $DIR/$tfile || error "flocks_test 6 failed"
+	rm -f $DIR/$tfile
+}
+run_test 105g "POSIX lock merge, split and conflicts ========="
+
 test_106() { #bug 10921
 	test_mkdir -p $DIR/$tdir
 	$DIR/$tdir && error "exec $DIR/$tdir succeeded"
@@ -7821,6 +8052,47 @@ test_124b() {
 }
 run_test 124b "lru resize (performance test) ======================="
 
+lru_stat() {
+	$LCTL get_param -n $1.lru_stats | awk "/^$2:/ { print \$2 }"
+}
+
+test_124c() {
+	local NSDIR=$($LCTL list_param ldlm.namespaces.*OST0000-osc-[^M]* |
+		head -n1)
+	[ -z "$NSDIR" ] && skip "no OST0000 osc namespace" && return
+	local OLD_POLICY=$($LCTL get_param -n $NSDIR.lru_policy)
+
+	$LCTL set_param -n $NSDIR.lru_policy bogus &&
+		error "bogus lru_policy accepted"
+	$LCTL set_param -n $NSDIR.lru_policy adaptive ||
+		error "cannot set adaptive lru_policy"
+	[ "$($LCTL get_param -n $NSDIR.lru_policy)" == "adaptive" ] ||
+		error "lru_policy is not adaptive"
+
+	$SETSTRIPE -c 1 -i 0 $DIR/$tfile
+	dd if=/dev/zero of=$DIR/$tfile bs=4k count=1 ||
+		error "write $DIR/$tfile failed"
+	local hits=$(lru_stat $NSDIR hits)
+	local i
+	# the cached extent lock is matched by every read
+	for ((i = 0; i < 20; i++)); do
+		cat $DIR/$tfile > /dev/null || error "read $DIR/$tfile failed"
+		echo 1 > /proc/sys/vm/drop_caches
+	done
+	$LCTL get_param $NSDIR.lru_stats
+	[ $(lru_stat $NSDIR hits) -gt $hits ] ||
+		error "no lock match hits accounted"
+
+	local target=$(lru_stat $NSDIR target)
+	local budget=$(lru_stat $NSDIR budget)
+	[ $target -ge 64 -a $target -le $budget ] ||
+		error "LRU target $target is not within 64..$budget"
+
+	$LCTL set_param -n $NSDIR.lru_policy $OLD_POLICY
+	rm -f $DIR/$tfile
+}
+run_test 124c "adaptive lru policy accounts lock matches ========"
+
 test_125() { # 13358
 	[ -z "$(lctl get_param -n llite.*.client_type | grep local)" ] && skip "must run as local client" && return
 	[ -z "$(lctl get_param -n mdc.*-mdc-*.connect_flags | grep acl)" ] && skip "must have acl enabled" && return
@@ -8750,6 +9022,33 @@ test_133f() {
 }
 run_test 133f "Check for LBUGs/Oopses/unreadable files in /proc"
 
+test_133g() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	remote_ost_nodsh && skip "remote OST with nodsh" && return
+	local ost=obdfilter.$FSNAME-OST0000
+
+	do_facet ost1 $LCTL get_param -N $ost.stats_snapshot > /dev/null ||
+		{ skip "OST has no stats_snapshot" && return 0; }
+
+	mkdir -p $DIR/$tdir || error "mkdir $DIR/$tdir failed"
+	$SETSTRIPE -c 1 -i 0 $DIR/$tdir/$tfile
+	do_facet ost1 $LCTL set_param $ost.stats=clear
+	dd if=/dev/zero of=$DIR/$tdir/$tfile bs=1M count=2 oflag=sync ||
+		error "dd failed"
+
+	local text=$(do_facet ost1 $LCTL get_param -n $ost.stats |
+		     awk '/^write_bytes/ { print $2, $5, $6, $7 }')
+	local bin=$(do_facet ost1 $LCTL get_param -n --binary $ost |
+		    awk '/^  write_bytes/ { print $2, $5, $6, $7 }')
+
+	[ -n "$text" ] || error "no write_bytes in $ost.stats"
+	[ "$text" == "$bin" ] ||
+		error "stats_snapshot has write_bytes '$bin', stats '$text'"
+
+	rm -rf $DIR/$tdir
+}
+run_test 133g "Verifying binary stats snapshot"
+
 test_140() { #bug-17379
 	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
         test_mkdir -p $DIR/$tdir || error "Creating dir $DIR/$tdir"
@@ -10815,7 +11114,7 @@ jobstats_set() {
 	wait_update $HOSTNAME "$LCTL get_param -n jobid_var" $NEW_JOBENV
 }
 
-test_205() { # Job stats
+test_205a() { # Job stats
 	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
 	[ -z "$(lctl get_param -n mdc.*.connect_flags | grep jobstats)" ] &&
 		skip "Server doesn't support jobstats" && return 0
@@ -10863,7 +11162,48 @@ test_205() { # Job stats
 
 	[ $OLD_JOBENV != $JOBENV ] && jobstats_set $OLD_JOBENV
 }
-run_test 205 "Verify job stats"
+run_test 205a "Verify job stats"
+
+test_205b() { # job_stats keeps at most job_max_entries jobs
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	[ -z "$(lctl get_param -n mdc.*.connect_flags | grep jobstats)" ] &&
+		skip "Server doesn't support jobstats" && return 0
+
+	local mdt=mdt.$FSNAME-MDT0000
+	local max=$(do_facet $SINGLEMDS lctl get_param -n $mdt.job_max_entries)
+	[ -z "$max" ] && skip "MDS doesn't limit job stats" && return 0
+
+	OLD_JOBENV=$($LCTL get_param -n jobid_var)
+	if [ $OLD_JOBENV != FAKE_JOBID ]; then
+		jobstats_set FAKE_JOBID
+		trap jobstats_set EXIT
+	fi
+
+	mkdir -p $DIR/$tdir || error "mkdir $DIR/$tdir failed"
+	do_facet $SINGLEMDS lctl set_param $mdt.job_stats=clear
+	do_facet $SINGLEMDS lctl set_param $mdt.job_max_entries=4
+
+	local i
+	for i in $(seq 8); do
+		FAKE_JOBID=test_id.$testnum.$i touch $DIR/$tdir/f$i ||
+			error "touch $DIR/$tdir/f$i failed"
+	done
+
+	local stats=$(do_facet $SINGLEMDS lctl get_param -n $mdt.job_stats)
+	do_facet $SINGLEMDS lctl set_param $mdt.job_max_entries=$max
+
+	local jobs=$(echo "$stats" | grep -c "job_id:")
+	[ $jobs -le 4 ] || error "$jobs jobs tracked, expected at most 4"
+	echo "$stats" | grep -q "test_id.$testnum.8" ||
+		error "latest job test_id.$testnum.8 was dropped"
+	echo "$stats" | grep -q "test_id.$testnum.1$" &&
+		error "oldest job test_id.$testnum.1 was kept"
+
+	rm -rf $DIR/$tdir
+	[ $OLD_JOBENV != FAKE_JOBID ] && jobstats_set $OLD_JOBENV
+	return 0
+}
+run_test 205b "job_stats drops the least recently used jobs"
 
 # LU-1480, LU-1773 and LU-1657
 test_206() {
@@ -11079,8 +11419,8 @@ test_215() { # for bugs 18102, 21079, 21517
 	local L2 # regexp for 2nd line (optional)
 	local BR # regexp for the rest (body)
 
-	# /proc/sys/lnet/stats should look as 11 space-separated non-negative numerics
-	BR="^$N $N $N $N $N $N $N $N $N $N $N$"
+	# /proc/sys/lnet/stats should look as 15 space-separated non-negative numerics
+	BR="^$N $N $N $N $N $N $N $N $N $N $N $N $N $N $N$"
 	create_lnet_proc_files "stats"
 	check_lnet_proc_stats "stats.out" "/proc/sys/lnet/stats" "$BR"
 	check_lnet_proc_stats "stats.sys" "lnet.stats" "$BR"
@@ -11909,6 +12249,123 @@ test_236() {
 }
 run_test 236 "Layout swap on open unlinked file"
 
+# print column $2 of the line for rail $1 in /proc/sys/lnet/rails:
+# 1 primary, 2 rail, 3 ni, 4 state, 5 sends, 6 errors
+rail_field() {
+	awk '$2 == "'$1'" { print $'$2' }' /proc/sys/lnet/rails
+}
+
+test_237a() {
+	local primary=192.0.2.1@tcp97
+	local rail1=192.0.2.2@tcp98
+	local rail2=192.0.2.3@tcp99
+
+	[ -r /proc/sys/lnet/rails ] || { skip "no rail support"; return 0; }
+
+	$LCTL add_rail $primary $rail1 || error "add_rail $rail1 failed"
+	$LCTL add_rail $primary $rail2 || error "add_rail $rail2 failed"
+	[ "$(rail_field $primary 1)" == "$primary" ] ||
+		error "$primary is not the first rail of its group"
+	[ "$(rail_field $rail2 1)" == "$primary" ] ||
+		error "$rail2 is not a rail of $primary"
+
+	# a NID is in one group only, and rails must be on different networks
+	$LCTL add_rail 192.0.2.4@tcp96 $rail1 &&
+		error "$rail1 added to a second group"
+	$LCTL add_rail $primary 192.0.2.5@tcp98 &&
+		error "second rail on tcp98 added"
+	$LCTL add_rail $rail1 192.0.2.6@tcp96 &&
+		error "a rail used as a primary NID"
+	$LCTL add_rail $primary $($LCTL list_nids | head -1) &&
+		error "a local NID added as a rail"
+
+	# removing a rail keeps the group, removing the primary drops it
+	$LCTL del_rail $rail1 || error "del_rail $rail1 failed"
+	[ -z "$(rail_field $rail1 1)" ] || error "$rail1 still listed"
+	[ "$(rail_field $rail2 1)" == "$primary" ] ||
+		error "$rail2 lost after removing $rail1"
+	$LCTL del_rail $rail1 && error "$rail1 removed twice"
+
+	$LCTL del_rail $primary || error "del_rail $primary failed"
+	[ -z "$(rail_field $primary 1)$(rail_field $rail2 1)" ] ||
+		error "group of $primary still listed"
+
+	# the NIDs are free for a new group again
+	$LCTL add_rail $rail2 $rail1 || error "reusing $rail1 failed"
+	$LCTL del_rail $rail2 || error "del_rail $rail2 failed"
+	return 0
+}
+run_test 237a "add_rail/del_rail manage rail groups"
+
+test_237b() {
+	local mds_nid=$(do_facet $SINGLEMDS $LCTL list_nids | head -1)
+	local primary=192.0.2.1@tcp97
+	local sends
+
+	[ -r /proc/sys/lnet/rails ] || { skip "no rail support"; return 0; }
+	$LCTL list_nids | grep -q "^$mds_nid$" &&
+		skip "MDS NID $mds_nid is local" && return 0
+
+	# the primary NID is on no local network, traffic for it must take
+	# the only rail that is reachable directly
+	$LCTL add_rail $primary $mds_nid || error "add_rail $mds_nid failed"
+	[ "$(rail_field $primary 3)" == "NA" ] ||
+		error "$primary should have no local NI"
+
+	sends=$(rail_field $mds_nid 5)
+	$LCTL ping $primary || { $LCTL del_rail $primary;
+		error "ping $primary through $mds_nid failed"; }
+	[ $(rail_field $mds_nid 5) -gt $sends ] ||
+		{ $LCTL del_rail $primary; error "$mds_nid was not used"; }
+	[ "$(rail_field $mds_nid 4)" == "up" ] ||
+		{ $LCTL del_rail $primary; error "$mds_nid not up"; }
+
+	$LCTL del_rail $primary || error "del_rail $primary failed"
+}
+run_test 237b "traffic for a peer takes a rail on a local network"
+
+test_237c() {
+	local mds_nid=$(do_facet $SINGLEMDS $LCTL list_nids | head -1)
+	local mds_net=${mds_nid#*@}
+	local dead_net
+	local dead
+	local errors
+	local i
+
+	[ -r /proc/sys/lnet/rails ] || { skip "no rail support"; return 0; }
+	$LCTL list_nids | grep -q "^$mds_nid$" &&
+		skip "MDS NID $mds_nid is local" && return 0
+
+	# a second local network which does not reach the MDS
+	dead_net=$($LCTL list_nids | cut -d@ -f2 | grep -v "^$mds_net$" |
+		   grep -v "^lo$" | head -1)
+	[ -z "$dead_net" ] && skip "needs two local networks" && return 0
+	dead=192.0.2.2@$dead_net
+
+	$LCTL add_rail $mds_nid $dead || error "add_rail $dead failed"
+
+	# sends on the dead rail fail and mark it down, after which every
+	# message takes the rail that works
+	for i in $(seq 10); do
+		$LCTL ping $mds_nid 1 > /dev/null 2>&1
+	done
+	errors=$(rail_field $dead 6)
+	[ $errors -gt 0 ] ||
+		{ $LCTL del_rail $mds_nid; error "no error on $dead"; }
+	[ "$(rail_field $dead 4)" == "down" ] ||
+		{ $LCTL del_rail $mds_nid; error "$dead not down"; }
+
+	for i in $(seq 10); do
+		$LCTL ping $mds_nid || { $LCTL del_rail $mds_nid;
+			error "ping $mds_nid failed with $dead down"; }
+	done
+	[ $(rail_field $dead 6) -eq $errors ] ||
+		{ $LCTL del_rail $mds_nid; error "$dead used while down"; }
+
+	$LCTL del_rail $mds_nid || error "del_rail $mds_nid failed"
+}
+run_test 237c "rail failover to a healthy rail"
+
 #
 # tests that do cleanup/setup should be run at the end
 #
@@ -2549,6 +2549,147 @@ test_74() {
 }
 run_test 74 "flock deadlock: different mounts =============="
 
+bl_cancel_stat() {
+	$LCTL get_param -n ldlm.namespaces.*osc*.bl_cancel_stats |
+		awk '/^'$1':/ { sum += $2 } END { print sum + 0 }'
+}
+
+test_75() {
+	local count=50
+	local i
+
+	test_mkdir -p $DIR1/$tdir
+	$SETSTRIPE -c 1 -i 0 $DIR1/$tdir
+	for ((i = 0; i < count; i++)); do
+		dd if=/dev/zero of=$DIR1/$tdir/f$i bs=4k count=1 2>/dev/null ||
+			error "write $DIR1/$tdir/f$i failed"
+	done
+	sync
+	cancel_lru_locks osc
+	# take read locks through the first mount
+	for ((i = 0; i < count; i++)); do
+		cat $DIR1/$tdir/f$i > /dev/null ||
+			error "read $DIR1/$tdir/f$i failed"
+	done
+
+	local cancels=$(bl_cancel_stat cancels)
+	local batches=$(bl_cancel_stat batches)
+	local locks=$(bl_cancel_stat batched_locks)
+
+	# concurrent writes from the second mount revoke all of them at once
+	for ((i = 0; i < count; i++)); do
+		dd if=/dev/zero of=$DIR2/$tdir/f$i bs=4k count=1 \
+			conv=notrunc 2>/dev/null &
+	done
+	wait
+
+	$LCTL get_param ldlm.namespaces.*osc*.bl_cancel_stats
+	cancels=$(($(bl_cancel_stat cancels) - cancels))
+	batches=$(($(bl_cancel_stat batches) - batches))
+	locks=$(($(bl_cancel_stat batched_locks) - locks))
+	echo "$cancels cancels, $locks locks in $batches batched RPCs"
+
+	[ $cancels -gt 0 ] || error "no cancel after blocking AST accounted"
+	# some cancel RPCs must have carried several locks
+	[ $batches -gt 0 -a $locks -gt $batches ] ||
+		error "no batched cancel RPC: $locks locks in $batches RPCs"
+	rm -rf $DIR1/$tdir
+}
+run_test 75 "cancels after blocking ASTs are batched =========="
+
+test_76() {
+	local oss=$(comma_list $(osts_nodes))
+	local nid=$($LCTL list_nids | head -n1)
+	local rate=20
+	local count=100
+	local start
+	local elapsed
+
+	do_nodes $oss $LCTL set_param ost.OSS.ost_io.nrs_policies="tbf\ nid" ||
+		{ skip "no TBF NRS policy" && return; }
+	# an argument can't be given to a policy which has already started
+	do_nodes $oss $LCTL set_param ost.OSS.ost_io.nrs_policies="tbf\ jobid" &&
+		error "restarting tbf with another argument succeeded"
+
+	do_nodes $oss $LCTL set_param ost.OSS.ost_io.nrs_tbf_rule=\
+"start\ t76\ nid={$nid}\ rate=$rate" ||
+		error "cannot start TBF rule for $nid"
+
+	$SETSTRIPE -c 1 -i 0 $DIR1/$tfile
+	start=$(date +%s)
+	dd if=/dev/zero of=$DIR1/$tfile bs=4k count=$count oflag=direct ||
+		error "dd to $DIR1/$tfile failed"
+	elapsed=$(($(date +%s) - start))
+
+	do_nodes $oss $LCTL set_param ost.OSS.ost_io.nrs_tbf_rule="stop\ t76"
+	do_nodes $oss $LCTL set_param ost.OSS.ost_io.nrs_policies="fifo"
+	rm -f $DIR1/$tfile
+
+	# every 4k direct write is one ost_io RPC, allow for the bucket depth
+	[ $elapsed -ge $((count / rate - 1)) ] ||
+		error "$count RPCs at $rate/s took only ${elapsed}s"
+}
+run_test 76 "NRS TBF policy rate limits RPCs by NID"
+
+test_77() {
+	local mdt=mds.MDS.mdt
+	local pause=200
+	local threads
+	local count
+	local start
+	local elapsed
+	local i
+
+	do_facet $SINGLEMDS $LCTL set_param $mdt.nrs_policies=edf ||
+		{ skip "no EDF NRS policy" && return; }
+
+	threads=$(do_facet $SINGLEMDS $LCTL get_param -n $mdt.threads_started)
+	if [ $threads -gt 64 ]; then
+		do_facet $SINGLEMDS $LCTL set_param $mdt.nrs_policies=fifo
+		skip "too many mdt threads: $threads" && return
+	fi
+	count=$((threads * 16))
+
+	# mkdir is a long operation, statfs a short one
+	do_facet $SINGLEMDS $LCTL set_param \
+		$mdt.nrs_edf_budget=ldlm_enqueue:10000000 \
+		$mdt.nrs_edf_budget=mds_reint:10000000 \
+		$mdt.nrs_edf_budget=mds_statfs:1 ||
+		error "cannot set EDF budgets"
+	do_facet $SINGLEMDS $LCTL get_param $mdt.nrs_edf_budget
+
+	test_mkdir -p $DIR1/$tdir
+	# let the statfs cache of the client expire
+	sleep 2
+
+	# every request keeps its service thread busy, so that a queue builds
+	do_facet $SINGLEMDS $LCTL set_param fail_val=$pause fail_loc=0x50a
+	for ((i = 0; i < count; i++)); do
+		mkdir $DIR1/$tdir/d$i &
+	done
+	sleep 1
+
+	start=$(date +%s%N)
+	stat -f $DIR1 > /dev/null || error "statfs of $DIR1 failed"
+	elapsed=$((($(date +%s%N) - start) / 1000000))
+
+	do_facet $SINGLEMDS $LCTL set_param fail_loc=0 fail_val=0
+	wait
+
+	do_facet $SINGLEMDS $LCTL set_param \
+		$mdt.nrs_edf_budget=ldlm_enqueue:0 \
+		$mdt.nrs_edf_budget=mds_reint:0 \
+		$mdt.nrs_edf_budget=mds_statfs:0
+	do_facet $SINGLEMDS $LCTL set_param $mdt.nrs_policies=fifo
+	rm -rf $DIR1/$tdir
+
+	# in arrival order, the statfs would wait for several rounds of mkdirs
+	echo "statfs took ${elapsed}ms behind $count mkdirs"
+	[ $elapsed -lt $((pause * 4)) ] ||
+		error "statfs waited ${elapsed}ms behind $count mkdirs"
+}
+run_test 77 "NRS EDF policy serves short opcodes ahead of earlier long ones"
+
 log "cleanup: ======================================================"
 
 [ "$(mount | grep $MOUNT2)" ] && umount $MOUNT2
@@ -0,0 +1,253 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lustre/tests/write_bench.c
+ *
+ * Multithreaded write benchmark: every thread writes its own region of one
+ * shared file, so that all of them dirty pages through the same OSC. The
+ * time spent in write() is reported separately from the final fsync(),
+ * since the former is what client side cache and grant accounting cost.
+ * Run it with an increasing number of threads to see how writes scale.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define error(fmt, args...) do {                        \
+	fflush(stdout), fflush(stderr);                 \
+	fprintf(stderr, "\nError:" fmt, ##args);        \
+	exit(1);                                        \
+} while (0)
+
+/* most threads the benchmark will start */
+#define WB_MAX_THREADS	1024
+
+static int wb_fd;
+static size_t wb_bufsize = 64 << 10;
+static off_t wb_size = 64 << 20;
+static int wb_verify;
+
+static pthread_mutex_t wb_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wb_cond = PTHREAD_COND_INITIALIZER;
+static int wb_ready;
+static int wb_go;
+
+struct wb_thread {
+	pthread_t	wt_id;
+	int		wt_index;
+	double		wt_elapsed;
+};
+
+static double wb_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* each word records where it was written, so misplaced data is caught */
+static void wb_fill(unsigned long *buf, off_t offset)
+{
+	size_t i;
+
+	for (i = 0; i < wb_bufsize / sizeof(*buf); i++)
+		buf[i] = offset + i * sizeof(*buf);
+}
+
+static void *wb_writer(void *arg)
+{
+	struct wb_thread *wt = arg;
+	off_t start = wt->wt_index * wb_size;
+	unsigned long *buf;
+	double begin;
+	off_t off;
+
+	buf = malloc(wb_bufsize);
+	if (buf == NULL)
+		error("no memory\n");
+
+	/* start all writers together */
+	pthread_mutex_lock(&wb_lock);
+	wb_ready++;
+	pthread_cond_broadcast(&wb_cond);
+	while (!wb_go)
+		pthread_cond_wait(&wb_cond, &wb_lock);
+	pthread_mutex_unlock(&wb_lock);
+
+	begin = wb_now();
+	for (off = start; off < start + wb_size; off += wb_bufsize) {
+		wb_fill(buf, off);
+		if (pwrite(wb_fd, buf, wb_bufsize, off) != wb_bufsize)
+			error("write at %llu failed: %s\n",
+			      (unsigned long long)off, strerror(errno));
+	}
+	wt->wt_elapsed = wb_now() - begin;
+
+	free(buf);
+	return NULL;
+}
+
+static void wb_check(int nthreads)
+{
+	unsigned long *buf;
+	unsigned long *expect;
+	off_t off;
+
+	buf = malloc(wb_bufsize);
+	expect = malloc(wb_bufsize);
+	if (buf == NULL || expect == NULL)
+		error("no memory\n");
+
+	for (off = 0; off < nthreads * wb_size; off += wb_bufsize) {
+		if (pread(wb_fd, buf, wb_bufsize, off) != wb_bufsize)
+			error("read at %llu failed: %s\n",
+			      (unsigned long long)off, strerror(errno));
+		wb_fill(expect, off);
+		if (memcmp(buf, expect, wb_bufsize) != 0)
+			error("data mismatch in %zu bytes at %llu\n",
+			      wb_bufsize, (unsigned long long)off);
+	}
+
+	free(expect);
+	free(buf);
+}
+
+static void wb_run(const char *path, int nthreads)
+{
+	struct wb_thread *threads;
+	double begin;
+	double slowest = 0;
+	double total;
+	double mb;
+	int rc;
+	int i;
+
+	threads = calloc(nthreads, sizeof(*threads));
+	if (threads == NULL)
+		error("no memory\n");
+
+	wb_fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (wb_fd < 0)
+		error("cannot open %s: %s\n", path, strerror(errno));
+
+	wb_ready = 0;
+	wb_go = 0;
+	for (i = 0; i < nthreads; i++) {
+		threads[i].wt_index = i;
+		rc = pthread_create(&threads[i].wt_id, NULL, wb_writer,
+				    &threads[i]);
+		if (rc != 0)
+			error("cannot start thread %d: %s\n", i, strerror(rc));
+	}
+
+	pthread_mutex_lock(&wb_lock);
+	while (wb_ready < nthreads)
+		pthread_cond_wait(&wb_cond, &wb_lock);
+	wb_go = 1;
+	begin = wb_now();
+	pthread_cond_broadcast(&wb_cond);
+	pthread_mutex_unlock(&wb_lock);
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(threads[i].wt_id, NULL);
+		if (threads[i].wt_elapsed > slowest)
+			slowest = threads[i].wt_elapsed;
+	}
+	if (fsync(wb_fd) != 0)
+		error("fsync %s failed: %s\n", path, strerror(errno));
+	total = wb_now() - begin;
+
+	mb = (double)nthreads * wb_size / (1 << 20);
+	printf("%4d threads: %10.1f MB/s write %10.1f MB/s write+fsync\n",
+	       nthreads, mb / slowest, mb / total);
+
+	if (wb_verify)
+		wb_check(nthreads);
+
+	close(wb_fd);
+	free(threads);
+}
+
+static void usage(char *prog)
+{
+	fprintf(stderr, "usage: %s [-t threads[,threads...]] [-s MB] "
+		"[-b KB] [-v] file\n", prog);
+	fprintf(stderr, "  -t  number of writer threads, or a list of them\n"
+		"  -s  megabytes written by each thread (default 64)\n"
+		"  -b  size of each write in kilobytes (default 64)\n"
+		"  -v  read the file back and check its contents\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	char deflt[] = "1,2,4,8,16,32";
+	char *threads = deflt;
+	char *tok;
+	int nthreads;
+	int c;
+
+	while ((c = getopt(argc, argv, "t:s:b:v")) != -1) {
+		switch (c) {
+		case 't':
+			threads = optarg;
+			break;
+		case 's':
+			wb_size = (off_t)atoi(optarg) << 20;
+			break;
+		case 'b':
+			wb_bufsize = (size_t)atoi(optarg) << 10;
+			break;
+		case 'v':
+			wb_verify = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || wb_size <= 0 || wb_bufsize == 0 ||
+	    wb_size % wb_bufsize != 0 ||
+	    wb_bufsize % sizeof(unsigned long) != 0)
+		usage(argv[0]);
+
+	for (tok = strtok(threads, ","); tok != NULL;
+	     tok = strtok(NULL, ",")) {
+		nthreads = atoi(tok);
+		if (nthreads <= 0 || nthreads > WB_MAX_THREADS)
+			usage(argv[0]);
+		wb_run(argv[optind], nthreads);
+	}
+
+	return 0;
+}
@@ -145,14 +145,16 @@ command_t cmdlist[] = {
         {"local_param", jt_lcfg_param, 0, "set a temporary, local param\n"
          "usage: local_param <target.keyword=val>\n"},
         {"get_param", jt_lcfg_getparam, 0, "get the Lustre or LNET parameter\n"
-         "usage: get_param [-n|-N|-F] <param_path1 param_path2 ...>\n"
+         "usage: get_param [-n|-N|-F|--binary] <param_path1 param_path2 ...>\n"
          "Get the value of Lustre or LNET parameter from the specified path.\n"
          "The path can contain shell-style filename patterns.\n"
          "  -n  Print only the value and not parameter name.\n"
          "  -N  Print only matched parameter names and not the values.\n"
          "      (Especially useful when using patterns.)\n"
          "  -F  When -N specified, add '/', '@' or '=' for directories,\n"
-         "      symlinks and writeable files, respectively."},
+         "      symlinks and writeable files, respectively.\n"
+         "  --binary  Decode the stats_snapshot of the matched devices.\n"
+         "      The counters of a device are all collected at once."},
         {"set_param", jt_lcfg_setparam, 0, "set the Lustre or LNET parameter\n"
 	 "usage: set_param [-n] [-P] [-d]"
 	 "<param_path1=value1 param_path2=value2 ...>\n"
@@ -417,6 +419,12 @@ command_t cmdlist[] = {
 	{"set_route", jt_ptl_notify_router, 0,
 	 "enable/disable routes via gateway in the portals routing table\n"
 	 "usage: set_route <gateway> <up/down> [<time>]"},
+	{"add_rail", jt_ptl_add_rail, 0,
+	 "send to a peer over another of its NIDs as well as its primary one\n"
+	 "usage: add_rail <primary nid> <rail nid>"},
+	{"del_rail", jt_ptl_del_rail, 0,
+	 "stop using a NID as a rail, or all rails of a primary NID\n"
+	 "usage: del_rail <nid>"},
 
 	{ 0, 0, 0, NULL }
 };
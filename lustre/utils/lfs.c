@@ -191,6 +191,10 @@ command_t cmdlist[] = {
          "     [[!] --gid|-g|--group|-G <gid>|<gname>]\n"
          "     [[!] --uid|-u|--user|-U <uid>|<uname>] [[!] --pool <pool>]\n"
 	 "     [[!] --layout|-L released,raid0]\n"
+	 "     [--threads <count>] [--lazy]\n"
+	 "\t threads: number of threads walking the directory tree\n"
+	 "\t lazy: use the attributes on the MDS only, which may not be\n"
+	 "\t       up to date for the size and times of striped files\n"
          "\t !: used before an option indicates 'NOT' requested attribute\n"
          "\t -: used before a value indicates 'AT MOST' requested value\n"
          "\t +: used before a value indicates 'AT LEAST' requested value\n"},
@@ -890,6 +894,8 @@ static int name2layout(__u32 *layout, char *name)
 }
 
 #define FIND_POOL_OPT 3
+#define FIND_THREADS_OPT 4
+#define FIND_LAZY_OPT 5
 static int lfs_find(int argc, char **argv)
 {
         int c, ret;
@@ -903,6 +909,7 @@ static int lfs_find(int argc, char **argv)
                 {"maxdepth",     required_argument, 0, 'D'},
                 {"gid",          required_argument, 0, 'g'},
                 {"group",        required_argument, 0, 'G'},
+		{"lazy",	 no_argument,	    0, FIND_LAZY_OPT},
                 {"stripe-index", required_argument, 0, 'i'},
                 {"stripe_index", required_argument, 0, 'i'},
 		{"layout",	 required_argument, 0, 'L'},
@@ -919,6 +926,7 @@ static int lfs_find(int argc, char **argv)
                 {"size",         required_argument, 0, 's'},
                 {"stripe-size",  required_argument, 0, 'S'},
                 {"stripe_size",  required_argument, 0, 'S'},
+		{"threads",	 required_argument, 0, FIND_THREADS_OPT},
                 {"type",         required_argument, 0, 't'},
                 {"uid",          required_argument, 0, 'u'},
                 {"user",         required_argument, 0, 'U'},
@@ -1150,6 +1158,18 @@ err_free:
                         break;
                 case 'P':
                         break;
+		case FIND_THREADS_OPT:
+			param.threads = strtol(optarg, &endptr, 0);
+			if (*endptr != '\0' || param.threads < 1) {
+				fprintf(stderr, "error: bad thread count '%s'\n",
+					optarg);
+				ret = CMD_HELP;
+				goto err;
+			}
+			break;
+		case FIND_LAZY_OPT:
+			param.lazy = 1;
+			break;
 		case 's':
 			if (optarg[0] == '+') {
 				param.size_sign = -1;
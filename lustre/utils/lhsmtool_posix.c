@@ -36,6 +36,9 @@
 #include <stdlib.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
 #include <utime.h>
 #include <sys/xattr.h>
 #include <sys/syscall.h>
@@ -52,6 +55,13 @@
 
 #define ONE_MB 0x100000
 
+/* Default number of actions processed at the same time */
+#define CT_MOVERS_DEFAULT 16
+/* A file is not split for parallel copy in segments smaller than this */
+#define CT_SEGMENT_MIN (64 * ONE_MB)
+/* Alignment of buffers, offsets and sizes for O_DIRECT I/O */
+#define CT_DIO_ALIGN 4096
+
 /* copytool uses a 32b bitmask field to register with kuc
  * archive num = 0 => all
  * archive num from 1 to 32
@@ -75,6 +85,10 @@ struct options {
 	int			 o_archive_cnt;
 	int			 o_archive_id[MAX_ARCHIVE_CNT];
 	int			 o_report_int;
+	int			 o_movers;
+	int			 o_copy_threads;
+	int			 o_direct_io;
+	int			 o_zero_copy;
 	unsigned long long	 o_bandwidth;
 	size_t			 o_chunk_size;
 	enum ct_action		 o_action;
@@ -91,6 +105,9 @@ struct options opt = {
 	.o_verbose = LLAPI_MSG_INFO,
 	.o_copy_xattrs = 1,
 	.o_report_int = REPORT_INTERVAL_DEFAULT,
+	.o_movers = CT_MOVERS_DEFAULT,
+	.o_copy_threads = 1,
+	.o_zero_copy = 1,
 	.o_chunk_size = ONE_MB,
 };
 
@@ -173,8 +190,15 @@ static void usage(const char *name, int rc)
 	"   --abort-on-error         Abort operation on major error\n"
 	"   --dry-run                Don't run, just show what would be done\n"
 	"   --bandwidth <bw>         Limit I/O bandwidth (unit can be used\n,"
-	"                            default is MB)\n",
-	cmd_name, cmd_name, cmd_name, cmd_name, cmd_name);
+	"                            default is MB)\n"
+	"   --movers <n>             Number of actions processed at the same\n"
+	"                            time (default %d)\n"
+	"   --copy-threads <n>       Number of threads copying segments of a\n"
+	"                            large file in parallel (default 1)\n"
+	"   --direct-io              Copy data with O_DIRECT I/O\n"
+	"   --no-zero-copy           Always copy data through a user buffer,\n"
+	"                            never with copy_file_range() or splice()\n",
+	cmd_name, cmd_name, cmd_name, cmd_name, cmd_name, CT_MOVERS_DEFAULT);
 
 	exit(rc);
 }
@@ -188,7 +212,11 @@ static int ct_parseopts(int argc, char * const *argv)
 		{"bandwidth",	   required_argument, NULL,		   'b'},
 		{"chunk-size",	   required_argument, NULL,		   'c'},
 		{"chunk_size",	   required_argument, NULL,		   'c'},
+		{"copy-threads",   required_argument, NULL,		   't'},
+		{"copy_threads",   required_argument, NULL,		   't'},
 		{"daemon",	   no_argument,	      &opt.o_daemonize,	    1},
+		{"direct-io",	   no_argument,	      &opt.o_direct_io,	    1},
+		{"direct_io",	   no_argument,	      &opt.o_direct_io,	    1},
 		{"dry-run",	   no_argument,	      &opt.o_dry_run,	    1},
 		{"help",	   no_argument,	      NULL,		   'h'},
 		{"hsm-root",	   required_argument, NULL,		   'p'},
@@ -196,12 +224,15 @@ static int ct_parseopts(int argc, char * const *argv)
 		{"import",	   no_argument,	      NULL,		   'i'},
 		{"max-sequence",   no_argument,	      NULL,		   'M'},
 		{"max_sequence",   no_argument,	      NULL,		   'M'},
+		{"movers",	   required_argument, NULL,		   'm'},
 		{"no-attr",	   no_argument,	      &opt.o_copy_attrs,    0},
 		{"no_attr",	   no_argument,	      &opt.o_copy_attrs,    0},
 		{"no-shadow",	   no_argument,	      &opt.o_shadow_tree,   0},
 		{"no_shadow",	   no_argument,	      &opt.o_shadow_tree,   0},
 		{"no-xattr",	   no_argument,	      &opt.o_copy_xattrs,   0},
 		{"no_xattr",	   no_argument,	      &opt.o_copy_xattrs,   0},
+		{"no-zero-copy",   no_argument,	      &opt.o_zero_copy,	    0},
+		{"no_zero_copy",   no_argument,	      &opt.o_zero_copy,	    0},
 		{"quiet",	   no_argument,	      NULL,		   'q'},
 		{"rebind",	   no_argument,	      NULL,		   'r'},
 		{"report",	   required_argument, &opt.o_report_int,    0},
@@ -249,6 +280,21 @@ static int ct_parseopts(int argc, char * const *argv)
 		case 'M':
 			opt.o_action = CA_MAXSEQ;
 			break;
+		case 'm':
+		case 't':
+			value = strtoul(optarg, NULL, 0);
+			if (value < 1 || value > INT_MAX) {
+				rc = -EINVAL;
+				CT_ERROR(rc, "bad value for --%s '%s'",
+					 c == 'm' ? "movers" : "copy-threads",
+					 optarg);
+				return rc;
+			}
+			if (c == 'm')
+				opt.o_movers = value;
+			else
+				opt.o_copy_threads = value;
+			break;
 		case 'p':
 			opt.o_hsm_root = optarg;
 			break;
@@ -307,6 +353,11 @@ static int ct_parseopts(int argc, char * const *argv)
 
 	opt.o_mnt = argv[optind];
 
+	/* O_DIRECT I/O needs aligned sizes */
+	if (opt.o_direct_io)
+		opt.o_chunk_size = (opt.o_chunk_size + CT_DIO_ALIGN - 1) &
+				   ~(size_t)(CT_DIO_ALIGN - 1);
+
 	CT_TRACE("action=%d src=%s dst=%s mount_point=%s",
 		 opt.o_action, opt.o_src, opt.o_dst, opt.o_mnt);
 
@@ -469,6 +520,7 @@ static int ct_restore_stripe(const char *src, const char *dst, int dst_fd,
 
 static void bandwidth_ctl_delay(int wsize)
 {
+	static pthread_mutex_t		lock = PTHREAD_MUTEX_INITIALIZER;
 	static unsigned long long	tot_bytes;
 	static time_t			start_time;
 	static time_t			last_time;
@@ -477,6 +529,8 @@ static void bandwidth_ctl_delay(int wsize)
 	double				excess;
 	unsigned int			sleep_time;
 
+	/* all copying threads share the same limit */
+	pthread_mutex_lock(&lock);
 	if (now > last_time + 5) {
 		tot_bytes = 0;
 		start_time = last_time = now;
@@ -493,10 +547,437 @@ static void bandwidth_ctl_delay(int wsize)
 		CT_TRACE("bandwith control: excess=%E sleep for %dus", excess,
 			 sleep_time);
 
+	last_time = now;
+	pthread_mutex_unlock(&lock);
+
 	if (excess > 0)
 		usleep(sleep_time);
+}
 
-	last_time = now;
+/* How a chunk of data is copied, in order of preference. A copy moves down
+ * the list when a method is not supported by the kernel or the filesystems */
+enum ct_copy_method {
+	CT_COPY_RANGE,		/* copy_file_range(), no copy to user space */
+	CT_COPY_SPLICE,		/* splice() through a pipe, no user copy */
+	CT_COPY_RW,		/* pread()/pwrite() through a user buffer */
+};
+
+/* Data copy of one action, shared by the threads copying its segments */
+struct ct_copy_job {
+	struct hsm_copyaction_private	*cj_hcp;
+	const char			*cj_src;
+	const char			*cj_dst;
+	int				 cj_src_fd;
+	int				 cj_dst_fd;
+	bool				 cj_direct;	/* O_DIRECT is set */
+	pthread_mutex_t			 cj_lock;	/* protects below */
+	int				 cj_rc;		/* first error */
+};
+
+/* Range of a file copied by one thread */
+struct ct_copy_segment {
+	struct ct_copy_job	*cs_job;
+	__u64			 cs_offset;
+	__u64			 cs_length;
+};
+
+static ssize_t ct_copy_file_range(int src_fd, loff_t *src_off, int dst_fd,
+				  loff_t *dst_off, size_t len)
+{
+#ifdef __NR_copy_file_range
+	return syscall(__NR_copy_file_range, src_fd, src_off, dst_fd, dst_off,
+		       len, 0);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/* errors meaning that a copy method cannot be used for these files */
+static bool ct_copy_unsupported(int err)
+{
+	return err == ENOSYS || err == EINVAL || err == EXDEV ||
+	       err == EOPNOTSUPP || err == EBADF;
+}
+
+static int ct_copy_get_rc(struct ct_copy_job *job)
+{
+	int	rc;
+
+	pthread_mutex_lock(&job->cj_lock);
+	rc = job->cj_rc;
+	pthread_mutex_unlock(&job->cj_lock);
+
+	return rc;
+}
+
+static void ct_copy_set_rc(struct ct_copy_job *job, int rc)
+{
+	pthread_mutex_lock(&job->cj_lock);
+	if (job->cj_rc == 0)
+		job->cj_rc = rc;
+	pthread_mutex_unlock(&job->cj_lock);
+}
+
+/* Copy up to len bytes at offset with pread()/pwrite(), and return the
+ * number of bytes copied, 0 at end of file, or a negative errno */
+static ssize_t ct_copy_chunk_rw(struct ct_copy_job *job, char *buf,
+				__u64 offset, size_t len)
+{
+	size_t	 rlen = len;
+	ssize_t	 rsize;
+	ssize_t	 wsize;
+	int	 flags;
+
+	/* O_DIRECT reads are aligned, the buffer is large enough */
+	if (job->cj_direct)
+		rlen = (len + CT_DIO_ALIGN - 1) & ~(size_t)(CT_DIO_ALIGN - 1);
+
+	rsize = pread(job->cj_src_fd, buf, rlen, offset);
+	if (rsize < 0) {
+		CT_ERROR(-errno, "cannot read from '%s'", job->cj_src);
+		return -errno;
+	}
+	if (rsize > len)
+		rsize = len;
+	if (rsize == 0)
+		return 0;
+
+	if (job->cj_direct && (rsize & (CT_DIO_ALIGN - 1)) != 0) {
+		/* the tail of the file cannot be written with O_DIRECT */
+		flags = fcntl(job->cj_dst_fd, F_GETFL);
+		if (flags >= 0 && (flags & O_DIRECT))
+			fcntl(job->cj_dst_fd, F_SETFL, flags & ~O_DIRECT);
+	}
+
+	wsize = pwrite(job->cj_dst_fd, buf, rsize, offset);
+	if (wsize < 0) {
+		CT_ERROR(-errno, "cannot write to '%s'", job->cj_dst);
+		return -errno;
+	}
+
+	return wsize;
+}
+
+/* Copy up to len bytes at offset with splice() through pipefd, falling back
+ * to pread()/pwrite() if splice() is not supported */
+static ssize_t ct_copy_chunk_splice(struct ct_copy_job *job,
+				    enum ct_copy_method *method, char *buf,
+				    int *pipefd, __u64 offset, size_t len)
+{
+	loff_t	 src_off = offset;
+	loff_t	 dst_off = offset;
+	ssize_t	 rsize;
+	ssize_t	 wsize;
+	ssize_t	 done = 0;
+
+	rsize = splice(job->cj_src_fd, &src_off, pipefd[1], NULL, len,
+		       SPLICE_F_MOVE | SPLICE_F_MORE);
+	if (rsize < 0) {
+		if (!ct_copy_unsupported(errno)) {
+			CT_ERROR(-errno, "cannot read from '%s'", job->cj_src);
+			return -errno;
+		}
+		CT_TRACE("cannot splice from '%s', copying through buffer",
+			 job->cj_src);
+		*method = CT_COPY_RW;
+		return ct_copy_chunk_rw(job, buf, offset, len);
+	}
+
+	while (done < rsize) {
+		wsize = splice(pipefd[0], NULL, job->cj_dst_fd, &dst_off,
+			       rsize - done, SPLICE_F_MOVE | SPLICE_F_MORE);
+		if (wsize >= 0) {
+			done += wsize;
+			continue;
+		}
+
+		if (!ct_copy_unsupported(errno)) {
+			CT_ERROR(-errno, "cannot write to '%s'", job->cj_dst);
+			return -errno;
+		}
+
+		/* move what is left in the pipe through the buffer */
+		CT_TRACE("cannot splice to '%s', copying through buffer",
+			 job->cj_dst);
+		*method = CT_COPY_RW;
+		while (done < rsize) {
+			ssize_t	size;
+
+			size = read(pipefd[0], buf, rsize - done);
+			if (size <= 0)
+				return size < 0 ? -errno : -EIO;
+
+			wsize = pwrite(job->cj_dst_fd, buf, size,
+				       offset + done);
+			if (wsize != size) {
+				CT_ERROR(-errno, "cannot write to '%s'",
+					 job->cj_dst);
+				return wsize < 0 ? -errno : -EIO;
+			}
+			done += wsize;
+		}
+	}
+
+	return done;
+}
+
+/* Copy up to len bytes at offset with the best method available, and
+ * return the number of bytes copied, 0 at end of file or a negative errno */
+static ssize_t ct_copy_chunk(struct ct_copy_job *job,
+			     enum ct_copy_method *method, char *buf,
+			     int *pipefd, __u64 offset, size_t len)
+{
+	loff_t	 src_off = offset;
+	loff_t	 dst_off = offset;
+	ssize_t	 size;
+
+	switch (*method) {
+	case CT_COPY_RANGE:
+		size = ct_copy_file_range(job->cj_src_fd, &src_off,
+					  job->cj_dst_fd, &dst_off, len);
+		if (size >= 0)
+			return size;
+
+		if (!ct_copy_unsupported(errno)) {
+			CT_ERROR(-errno, "cannot copy from '%s' to '%s'",
+				 job->cj_src, job->cj_dst);
+			return -errno;
+		}
+		*method = CT_COPY_SPLICE;
+		/* fall through */
+	case CT_COPY_SPLICE:
+		if (pipefd[0] < 0) {
+			if (pipe(pipefd) < 0) {
+				*method = CT_COPY_RW;
+				return ct_copy_chunk_rw(job, buf, offset, len);
+			}
+#ifdef F_SETPIPE_SZ
+			/* a larger pipe takes fewer splice() calls, this is
+			 * only a hint */
+			fcntl(pipefd[1], F_SETPIPE_SZ, opt.o_chunk_size);
+#endif
+		}
+		return ct_copy_chunk_splice(job, method, buf, pipefd, offset,
+					    len);
+	case CT_COPY_RW:
+	default:
+		return ct_copy_chunk_rw(job, buf, offset, len);
+	}
+}
+
+/* Copy one segment of the file, and report the progress of its copy
+ * from time to time. Any error stops the copy of all segments. */
+static int ct_copy_segment(struct ct_copy_segment *seg)
+{
+	struct ct_copy_job	*job = seg->cs_job;
+	enum ct_copy_method	 method;
+	struct hsm_extent	 he;
+	time_t			 last_print_time = time(NULL);
+	char			*buf;
+	int			 pipefd[2] = { -1, -1 };
+	__u64			 done = 0;
+	__u64			 reported = 0;
+	int			 rc = 0;
+
+	if (job->cj_direct || !opt.o_zero_copy)
+		method = CT_COPY_RW;
+	else
+		method = CT_COPY_RANGE;
+
+	rc = posix_memalign((void **)&buf, CT_DIO_ALIGN, opt.o_chunk_size);
+	if (rc != 0) {
+		ct_copy_set_rc(job, -rc);
+		return -rc;
+	}
+
+	while (done < seg->cs_length) {
+		ssize_t	wsize;
+		size_t	chunk = (seg->cs_length - done > opt.o_chunk_size) ?
+				 opt.o_chunk_size : seg->cs_length - done;
+
+		/* another segment failed, or the action was canceled */
+		rc = ct_copy_get_rc(job);
+		if (rc < 0)
+			break;
+
+		wsize = ct_copy_chunk(job, &method, buf, pipefd,
+				      seg->cs_offset + done, chunk);
+		if (wsize == 0)
+			/* EOF */
+			break;
+
+		if (wsize < 0) {
+			rc = wsize;
+			break;
+		}
+
+		done += wsize;
+
+		if (opt.o_bandwidth != 0)
+			/* sleep if needed, to honor bandwidth limits */
+			bandwidth_ctl_delay(wsize);
+
+		if (time(0) >= last_print_time + opt.o_report_int) {
+			last_print_time = time(0);
+			CT_TRACE("%%"LPU64" of segment "LPU64,
+				 100 * done / seg->cs_length, seg->cs_offset);
+			/* report only what was copied since last time */
+			he.offset = seg->cs_offset + reported;
+			he.length = done - reported;
+			rc = llapi_hsm_action_progress(job->cj_hcp, &he, 0);
+			if (rc < 0) {
+				/* Action has been canceled or something wrong
+				 * is happening. Stop copying data. */
+				CT_ERROR(rc, "progress ioctl for copy"
+					 " '%s'->'%s' failed", job->cj_src,
+					 job->cj_dst);
+				break;
+			}
+			reported = done;
+		}
+	}
+
+	if (rc < 0)
+		ct_copy_set_rc(job, rc);
+
+	if (pipefd[0] >= 0) {
+		close(pipefd[0]);
+		close(pipefd[1]);
+	}
+	free(buf);
+
+	return rc;
+}
+
+static void *ct_copy_segment_thread(void *data)
+{
+	ct_copy_segment(data);
+
+	return NULL;
+}
+
+/* Stripe size of a Lustre file, or 0 if it cannot be found */
+static __u64 ct_stripe_size(int fd)
+{
+	char			 lov_buf[XATTR_SIZE_MAX];
+	struct lov_user_md	*lum = (struct lov_user_md *)lov_buf;
+
+	if (fgetxattr(fd, XATTR_LUSTRE_LOV, lov_buf, sizeof(lov_buf)) < 0)
+		return 0;
+
+	if (lum->lmm_magic != LOV_USER_MAGIC_V1 &&
+	    lum->lmm_magic != LOV_USER_MAGIC_V3)
+		return 0;
+
+	return lum->lmm_stripe_size;
+}
+
+/* Copy length bytes from offset, in up to opt.o_copy_threads segments
+ * copied in parallel. Segments start on stripe boundaries of the Lustre
+ * file, so that threads do not write to the same stripe. */
+static int ct_copy_segments(struct ct_copy_job *job, int lustre_fd,
+			    __u64 offset, __u64 length)
+{
+	struct ct_copy_segment	*segs;
+	pthread_t		*threads;
+	bool			*started;
+	__u64			 unit;
+	__u64			 seg_size;
+	int			 count;
+	int			 i;
+
+	count = opt.o_copy_threads;
+	if (length / CT_SEGMENT_MIN < count)
+		count = length / CT_SEGMENT_MIN;
+	if (count <= 1) {
+		struct ct_copy_segment	seg = {
+			.cs_job		= job,
+			.cs_offset	= offset,
+			.cs_length	= length,
+		};
+
+		return ct_copy_segment(&seg);
+	}
+
+	unit = ct_stripe_size(lustre_fd);
+	if (unit == 0 || (job->cj_direct && unit % CT_DIO_ALIGN != 0))
+		unit = opt.o_chunk_size;
+
+	seg_size = (length + count - 1) / count;
+	seg_size = (seg_size + unit - 1) / unit * unit;
+	count = (length + seg_size - 1) / seg_size;
+
+	CT_TRACE("copying '%s' in %d segments of "LPU64" bytes",
+		 job->cj_src, count, seg_size);
+
+	segs = calloc(count, sizeof(*segs));
+	threads = calloc(count, sizeof(*threads));
+	started = calloc(count, sizeof(*started));
+	if (segs == NULL || threads == NULL || started == NULL) {
+		free(segs);
+		free(threads);
+		free(started);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < count; i++) {
+		segs[i].cs_job = job;
+		segs[i].cs_offset = offset + i * seg_size;
+		segs[i].cs_length = (i < count - 1) ? seg_size :
+				    length - i * seg_size;
+	}
+
+	/* the first segment is copied by the calling thread */
+	for (i = 1; i < count; i++)
+		started[i] = pthread_create(&threads[i], NULL,
+					    ct_copy_segment_thread,
+					    &segs[i]) == 0;
+
+	for (i = 0; i < count; i++)
+		if (!started[i])
+			ct_copy_segment(&segs[i]);
+
+	for (i = 1; i < count; i++)
+		if (started[i])
+			pthread_join(threads[i], NULL);
+
+	free(segs);
+	free(threads);
+	free(started);
+
+	return ct_copy_get_rc(job);
+}
+
+/* Set O_DIRECT on both files if offset allows it, and return the previous
+ * flags of the files, to be restored by ct_copy_clear_direct() */
+static bool ct_copy_set_direct(struct ct_copy_job *job, __u64 offset,
+			       int *src_flags, int *dst_flags)
+{
+	if ((offset & (CT_DIO_ALIGN - 1)) != 0)
+		return false;
+
+	*src_flags = fcntl(job->cj_src_fd, F_GETFL);
+	*dst_flags = fcntl(job->cj_dst_fd, F_GETFL);
+	if (*src_flags < 0 || *dst_flags < 0)
+		return false;
+
+	if (fcntl(job->cj_src_fd, F_SETFL, *src_flags | O_DIRECT) < 0)
+		return false;
+
+	if (fcntl(job->cj_dst_fd, F_SETFL, *dst_flags | O_DIRECT) < 0) {
+		fcntl(job->cj_src_fd, F_SETFL, *src_flags);
+		return false;
+	}
+
+	return true;
+}
+
+static void ct_copy_clear_direct(struct ct_copy_job *job, int src_flags,
+				 int dst_flags)
+{
+	fcntl(job->cj_src_fd, F_SETFL, src_flags);
+	fcntl(job->cj_dst_fd, F_SETFL, dst_flags);
 }
 
 static int ct_copy_data(struct hsm_copyaction_private *hcp, const char *src,
@@ -504,13 +985,12 @@ static int ct_copy_data(struct hsm_copyaction_private *hcp, const char *src,
 			const struct hsm_action_item *hai, long hal_flags)
 {
 	struct hsm_extent	 he;
-	__u64			 offset = hai->hai_extent.offset;
+	struct ct_copy_job	 job;
 	struct stat		 src_st;
 	struct stat		 dst_st;
-	char			*buf = NULL;
-	__u64			 write_total = 0;
 	__u64			 length;
-	time_t			 last_print_time = time(NULL);
+	int			 src_flags = 0;
+	int			 dst_flags = 0;
 	int			 rc = 0;
 
 	CT_TRACE("going to copy data from '%s' to '%s'", src, dst);
@@ -539,16 +1019,7 @@ static int ct_copy_data(struct hsm_copyaction_private *hcp, const char *src,
 		return rc;
 	}
 
-	rc = lseek(src_fd, hai->hai_extent.offset, SEEK_SET);
-	if (rc < 0) {
-		rc = -errno;
-		CT_ERROR(rc,
-			 "cannot seek for read to "LPU64" (len %jd) in '%s'",
-			 hai->hai_extent.offset, (intmax_t)src_st.st_size, src);
-		return rc;
-	}
-
-	he.offset = offset;
+	he.offset = hai->hai_extent.offset;
 	he.length = 0;
 	rc = llapi_hsm_action_progress(hcp, &he, 0);
 	if (rc < 0) {
@@ -559,64 +1030,31 @@ static int ct_copy_data(struct hsm_copyaction_private *hcp, const char *src,
 		goto out;
 	}
 
-	errno = 0;
 	/* Don't read beyond a given extent */
 	length = min(hai->hai_extent.length, src_st.st_size);
 
-	buf = malloc(opt.o_chunk_size);
-	if (buf == NULL) {
-		rc = -ENOMEM;
-		goto out;
-	}
-
 	CT_DEBUG("Going to copy "LPU64" bytes %s -> %s\n", length, src, dst);
 
-	while (write_total < length) {
-		ssize_t	rsize;
-		ssize_t	wsize;
-		int	chunk = (length - write_total > opt.o_chunk_size) ?
-				 opt.o_chunk_size : length - write_total;
-
-		rsize = pread(src_fd, buf, chunk, offset);
-		if (rsize == 0)
-			/* EOF */
-			break;
-
-		if (rsize < 0) {
-			rc = -errno;
-			CT_ERROR(rc, "cannot read from '%s'", src);
-			break;
-		}
-
-		wsize = pwrite(dst_fd, buf, rsize, offset);
-		if (wsize < 0) {
-			rc = -errno;
-			CT_ERROR(rc, "cannot write to '%s'", dst);
-			break;
-		}
+	memset(&job, 0, sizeof(job));
+	job.cj_hcp = hcp;
+	job.cj_src = src;
+	job.cj_dst = dst;
+	job.cj_src_fd = src_fd;
+	job.cj_dst_fd = dst_fd;
+	pthread_mutex_init(&job.cj_lock, NULL);
 
-		write_total += wsize;
-		offset += wsize;
+	if (opt.o_direct_io)
+		job.cj_direct = ct_copy_set_direct(&job, hai->hai_extent.offset,
+						   &src_flags, &dst_flags);
 
-		if (opt.o_bandwidth != 0)
-			/* sleep if needed, to honor bandwidth limits */
-			bandwidth_ctl_delay(wsize);
+	/* stripes of the Lustre file are the ones to care about */
+	rc = ct_copy_segments(&job, hai->hai_action == HSMA_RESTORE ?
+				    dst_fd : src_fd,
+			      hai->hai_extent.offset, length);
 
-		if (time(0) >= last_print_time + opt.o_report_int) {
-			last_print_time = time(0);
-			CT_TRACE("%%"LPU64" ", 100 * write_total / length);
-			he.length = write_total;
-			rc = llapi_hsm_action_progress(hcp, &he, 0);
-			if (rc < 0) {
-				/* Action has been canceled or something wrong
-				 * is happening. Stop copying data. */
-				CT_ERROR(rc, "progress ioctl for copy"
-					 " '%s'->'%s' failed", src, dst);
-				goto out;
-			}
-		}
-		rc = 0;
-	}
+	if (job.cj_direct)
+		ct_copy_clear_direct(&job, src_flags, dst_flags);
+	pthread_mutex_destroy(&job.cj_lock);
 
 out:
 	/*
@@ -630,8 +1068,7 @@ out:
 		/*
 		 * make sure the file is on disk before reporting success.
 		 */
-		rc = ftruncate(dst_fd, src_st.st_size);
-		if (rc < 0) {
+		if (ftruncate(dst_fd, src_st.st_size) < 0) {
 			rc = -errno;
 			CT_ERROR(rc, "cannot truncate '%s' to size %jd",
 				 dst, (intmax_t)src_st.st_size);
@@ -639,9 +1076,6 @@ out:
 		}
 	}
 
-	if (buf != NULL)
-		free(buf);
-
 	return rc;
 }
 
@@ -1252,29 +1686,127 @@ static int ct_process_item(struct hsm_action_item *hai, const long hal_flags)
 }
 
 struct ct_th_data {
+	struct ct_th_data	*next;
 	long			 hal_flags;
 	struct hsm_action_item	*hai;
 };
 
+/* Items waiting for a mover thread, processed in arrival order. The number
+ * of movers bounds the number of concurrent copies. */
+static struct {
+	pthread_mutex_t		 lock;
+	pthread_cond_t		 cond;
+	struct ct_th_data	*head;
+	struct ct_th_data	*tail;
+	int			 running;
+	bool			 stopping;
+} ct_pool = {
+	.lock	= PTHREAD_MUTEX_INITIALIZER,
+	.cond	= PTHREAD_COND_INITIALIZER,
+};
+
 static void *ct_thread(void *data)
 {
-	struct ct_th_data *cttd = data;
-	int rc;
+	struct ct_th_data	*cttd;
+
+	while (1) {
+		pthread_mutex_lock(&ct_pool.lock);
+		while (ct_pool.head == NULL && !ct_pool.stopping)
+			pthread_cond_wait(&ct_pool.cond, &ct_pool.lock);
+
+		if (ct_pool.stopping) {
+			ct_pool.running--;
+			pthread_mutex_unlock(&ct_pool.lock);
+			break;
+		}
+
+		cttd = ct_pool.head;
+		ct_pool.head = cttd->next;
+		if (ct_pool.head == NULL)
+			ct_pool.tail = NULL;
+		pthread_mutex_unlock(&ct_pool.lock);
 
-	rc = ct_process_item(cttd->hai, cttd->hal_flags);
+		ct_process_item(cttd->hai, cttd->hal_flags);
 
-	free(cttd->hai);
-	free(cttd);
-	pthread_exit((void *)(intptr_t)rc);
+		free(cttd->hai);
+		free(cttd);
+	}
+
+	return NULL;
 }
 
-static int ct_process_item_async(const struct hsm_action_item *hai,
-				 long hal_flags)
+static int ct_pool_start(int movers)
 {
 	pthread_attr_t		 attr;
 	pthread_t		 thread;
-	struct ct_th_data	*data;
 	int			 rc;
+	int			 i;
+
+	rc = pthread_attr_init(&attr);
+	if (rc != 0) {
+		CT_ERROR(rc, "pthread_attr_init failed for '%s' service",
+			 opt.o_mnt);
+		return -rc;
+	}
+
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	for (i = 0; i < movers; i++) {
+		rc = pthread_create(&thread, &attr, ct_thread, NULL);
+		if (rc != 0) {
+			CT_ERROR(rc, "cannot create mover thread for '%s' "
+				 "service", opt.o_mnt);
+			break;
+		}
+		pthread_mutex_lock(&ct_pool.lock);
+		ct_pool.running++;
+		pthread_mutex_unlock(&ct_pool.lock);
+	}
+
+	pthread_attr_destroy(&attr);
+
+	/* run with what could be started */
+	if (i == 0)
+		return -rc;
+
+	CT_TRACE("%d mover threads started", i);
+	return 0;
+}
+
+/* Stop idle movers and end the items not started yet with -ECANCELED, so
+ * that the coordinator does not keep them STARTED until they time out. */
+static void ct_pool_stop(void)
+{
+	struct ct_th_data	*cttd;
+	struct ct_th_data	*queue;
+	int			 rc;
+
+	pthread_mutex_lock(&ct_pool.lock);
+	ct_pool.stopping = true;
+	queue = ct_pool.head;
+	ct_pool.head = NULL;
+	ct_pool.tail = NULL;
+	pthread_cond_broadcast(&ct_pool.cond);
+	pthread_mutex_unlock(&ct_pool.lock);
+
+	while (queue != NULL) {
+		cttd = queue;
+		queue = cttd->next;
+		rc = ct_report_error(cttd->hai, 0, -ECANCELED);
+		if (rc < 0)
+			CT_ERROR(rc, "'%s' cannot cancel queued item: "
+				 "cookie="LPX64", FID="DFID, opt.o_mnt,
+				 cttd->hai->hai_cookie,
+				 PFID(&cttd->hai->hai_fid));
+		free(cttd->hai);
+		free(cttd);
+	}
+}
+
+static int ct_process_item_async(const struct hsm_action_item *hai,
+				 long hal_flags)
+{
+	struct ct_th_data	*data;
 
 	data = malloc(sizeof(*data));
 	if (data == NULL)
@@ -1288,24 +1820,17 @@ static int ct_process_item_async(const struct hsm_action_item *hai,
 
 	memcpy(data->hai, hai, hai->hai_len);
 	data->hal_flags = hal_flags;
+	data->next = NULL;
 
-	rc = pthread_attr_init(&attr);
-	if (rc != 0) {
-		CT_ERROR(rc, "pthread_attr_init failed for '%s' service",
-			 opt.o_mnt);
-		free(data->hai);
-		free(data);
-		return -rc;
-	}
-
-	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-
-	rc = pthread_create(&thread, &attr, ct_thread, data);
-	if (rc != 0)
-		CT_ERROR(rc, "cannot create thread for '%s' service",
-			 opt.o_mnt);
+	pthread_mutex_lock(&ct_pool.lock);
+	if (ct_pool.tail != NULL)
+		ct_pool.tail->next = data;
+	else
+		ct_pool.head = data;
+	ct_pool.tail = data;
+	pthread_cond_signal(&ct_pool.cond);
+	pthread_mutex_unlock(&ct_pool.lock);
 
-	pthread_attr_destroy(&attr);
 	return 0;
 }
 
@@ -1702,6 +2227,12 @@ static int ct_run(void)
 		return rc;
 	}
 
+	rc = ct_pool_start(opt.o_movers);
+	if (rc < 0) {
+		llapi_hsm_copytool_unregister(&ctdata);
+		return rc;
+	}
+
 	signal(SIGINT, handler);
 	signal(SIGTERM, handler);
 
@@ -1767,6 +2298,7 @@ static int ct_run(void)
 			break;
 	}
 
+	ct_pool_stop();
 	llapi_hsm_copytool_unregister(&ctdata);
 
 	return rc;
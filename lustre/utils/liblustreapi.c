@@ -68,6 +68,10 @@
 #include <unistd.h>
 #endif
 #include <poll.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
+#include <sys/resource.h>
 
 #include <liblustre.h>
 #include <lnet/lnetctl.h>
@@ -1625,6 +1629,390 @@ err:
         return ret;
 }
 
+#ifdef HAVE_LIBPTHREAD
+/*
+ * Parallel namespace traversal.
+ *
+ * Directories are the unit of work: a thread reads one directory, calls
+ * sem_init()/sem_fini() on its entries, and queues its subdirectories on
+ * its own queue. A thread takes the newest directory of its own queue, so
+ * that its walk stays depth first, or steals the oldest directory of
+ * another thread's queue, likely the root of a large subtree. Each thread
+ * keeps only one directory open, the number of threads bounds the number
+ * of open directories.
+ *
+ * Each thread has its own copy of the find_param, with its own buffers,
+ * as the callbacks keep per-file state there. The callbacks of the same
+ * directory are always called by the same thread.
+ */
+#define FIND_MAX_THREADS	256
+
+struct find_dir {
+	cfs_list_t		 fd_list;
+	unsigned int		 fd_depth;	/* param->depth of this dir */
+	int			 fd_root;
+	char			 fd_path[0];
+};
+
+struct find_pool;
+
+struct find_worker {
+	struct find_pool	*fw_pool;
+	int			 fw_index;
+	pthread_t		 fw_thread;
+	pthread_mutex_t		 fw_lock;	/* protects fw_dirs */
+	cfs_list_t		 fw_dirs;	/* directories to read */
+	struct find_param	 fw_param;
+	char			 fw_path[PATH_MAX + 1];
+};
+
+struct find_pool {
+	pthread_mutex_t		 fp_lock;	/* protects below */
+	pthread_cond_t		 fp_cond;	/* idle threads wait here */
+	unsigned long		 fp_gen;	/* bumped on each queued dir */
+	long			 fp_pending;	/* dirs queued or being read */
+	int			 fp_idle;
+	int			 fp_rc;		/* first error */
+	int			 fp_nr;
+	struct find_worker	*fp_workers;
+	semantic_func_t		*fp_sem_init;
+	semantic_func_t		*fp_sem_fini;
+};
+
+static int find_dir_push(struct find_worker *fw, const char *path,
+			 unsigned int depth, int root)
+{
+	struct find_pool *pool = fw->fw_pool;
+	struct find_dir *fdir;
+	size_t len = strlen(path) + 1;
+
+	fdir = malloc(sizeof(*fdir) + len);
+	if (fdir == NULL)
+		return -ENOMEM;
+
+	fdir->fd_depth = depth;
+	fdir->fd_root = root;
+	memcpy(fdir->fd_path, path, len);
+
+	/* account for the directory before anybody can read it */
+	pthread_mutex_lock(&pool->fp_lock);
+	pool->fp_pending++;
+	pthread_mutex_unlock(&pool->fp_lock);
+
+	pthread_mutex_lock(&fw->fw_lock);
+	cfs_list_add_tail(&fdir->fd_list, &fw->fw_dirs);
+	pthread_mutex_unlock(&fw->fw_lock);
+
+	pthread_mutex_lock(&pool->fp_lock);
+	pool->fp_gen++;
+	if (pool->fp_idle > 0)
+		pthread_cond_signal(&pool->fp_cond);
+	pthread_mutex_unlock(&pool->fp_lock);
+
+	return 0;
+}
+
+static struct find_dir *find_dir_pop(struct find_worker *fw)
+{
+	struct find_pool *pool = fw->fw_pool;
+	struct find_dir *fdir = NULL;
+	int i;
+
+	pthread_mutex_lock(&fw->fw_lock);
+	if (!cfs_list_empty(&fw->fw_dirs)) {
+		fdir = cfs_list_entry(fw->fw_dirs.prev, struct find_dir,
+				      fd_list);
+		cfs_list_del(&fdir->fd_list);
+	}
+	pthread_mutex_unlock(&fw->fw_lock);
+
+	for (i = 1; fdir == NULL && i < pool->fp_nr; i++) {
+		struct find_worker *victim;
+
+		victim = &pool->fp_workers[(fw->fw_index + i) % pool->fp_nr];
+		pthread_mutex_lock(&victim->fw_lock);
+		if (!cfs_list_empty(&victim->fw_dirs)) {
+			fdir = cfs_list_entry(victim->fw_dirs.next,
+					      struct find_dir, fd_list);
+			cfs_list_del(&fdir->fd_list);
+		}
+		pthread_mutex_unlock(&victim->fw_lock);
+	}
+
+	return fdir;
+}
+
+/* Same as one level of llapi_semantic_traverse(), subdirectories are
+ * queued instead of being walked */
+static int find_dir_read(struct find_worker *fw, struct find_dir *fdir)
+{
+	struct find_pool *pool = fw->fw_pool;
+	struct find_param *param = &fw->fw_param;
+	struct dirent64 de_dir = { .d_type = DT_DIR };
+	struct dirent64 *de = fdir->fd_root ? NULL : &de_dir;
+	struct dirent64 *dent;
+	char *path = fw->fw_path;
+	int len, ret = 0;
+	DIR *d;
+
+	strcpy(path, fdir->fd_path);
+	len = strlen(path);
+	param->depth = fdir->fd_depth;
+
+	d = opendir(path);
+	if (d == NULL) {
+		ret = -errno;
+		/* removed since its parent was read */
+		if (ret == -ENOENT && !fdir->fd_root)
+			return 0;
+		llapi_error(LLAPI_MSG_ERROR, ret, "%s: Failed to open '%s'",
+			    __func__, path);
+		return ret;
+	}
+
+	if (pool->fp_sem_init &&
+	    (ret = pool->fp_sem_init(path, NULL, d, param, de)))
+		goto err;
+
+	if (param->get_lmv && !param->recursive)
+		goto out;
+
+	while ((dent = readdir64(d)) != NULL) {
+		param->have_fileinfo = 0;
+
+		if (!strcmp(dent->d_name, ".") || !strcmp(dent->d_name, ".."))
+			continue;
+
+		/* Don't traverse .lustre directory */
+		if (!(strcmp(dent->d_name, dot_lustre_name)))
+			continue;
+
+		path[len] = 0;
+		if ((len + dent->d_reclen + 2) > PATH_MAX + 1) {
+			llapi_err_noerrno(LLAPI_MSG_ERROR,
+					  "error: %s: string buffer is too small",
+					  __func__);
+			break;
+		}
+		strcat(path, "/");
+		strcat(path, dent->d_name);
+
+		if (dent->d_type == DT_UNKNOWN) {
+			lstat_t *st = &param->lmd->lmd_st;
+
+			ret = get_lmd_info(path, d, NULL, param->lmd,
+					   param->lumlen);
+			if (ret == 0) {
+				dent->d_type =
+					llapi_filetype_dir_table[st->st_mode &
+								 S_IFMT];
+			}
+			if (ret == -ENOENT)
+				continue;
+		}
+		switch (dent->d_type) {
+		case DT_UNKNOWN:
+			llapi_err_noerrno(LLAPI_MSG_ERROR,
+					  "error: %s: '%s' is UNKNOWN type %d",
+					  __func__, dent->d_name, dent->d_type);
+			break;
+		case DT_DIR:
+			ret = find_dir_push(fw, path, param->depth, 0);
+			if (ret < 0)
+				goto out;
+			break;
+		default:
+			ret = 0;
+			if (pool->fp_sem_init) {
+				ret = pool->fp_sem_init(path, d, NULL, param,
+							dent);
+				if (ret < 0)
+					goto out;
+			}
+			if (pool->fp_sem_fini && ret == 0)
+				pool->fp_sem_fini(path, d, NULL, param, dent);
+		}
+	}
+	ret = 0;
+
+out:
+	path[len] = 0;
+
+	if (pool->fp_sem_fini)
+		pool->fp_sem_fini(path, NULL, d, param, de);
+err:
+	closedir(d);
+	return ret < 0 ? ret : 0;
+}
+
+static void *find_worker_main(void *arg)
+{
+	struct find_worker *fw = arg;
+	struct find_pool *pool = fw->fw_pool;
+	struct find_dir *fdir;
+	unsigned long gen;
+	int rc;
+
+	while (1) {
+		pthread_mutex_lock(&pool->fp_lock);
+		gen = pool->fp_gen;
+		rc = pool->fp_pending == 0 || pool->fp_rc < 0;
+		pthread_mutex_unlock(&pool->fp_lock);
+		if (rc)
+			break;
+
+		fdir = find_dir_pop(fw);
+		if (fdir == NULL) {
+			/* wait unless a directory was queued meanwhile */
+			pthread_mutex_lock(&pool->fp_lock);
+			if (gen == pool->fp_gen && pool->fp_pending > 0 &&
+			    pool->fp_rc == 0) {
+				pool->fp_idle++;
+				pthread_cond_wait(&pool->fp_cond,
+						  &pool->fp_lock);
+				pool->fp_idle--;
+			}
+			pthread_mutex_unlock(&pool->fp_lock);
+			continue;
+		}
+
+		rc = find_dir_read(fw, fdir);
+		free(fdir);
+
+		pthread_mutex_lock(&pool->fp_lock);
+		if (rc < 0 && pool->fp_rc == 0)
+			pool->fp_rc = rc;
+		if (--pool->fp_pending == 0 || rc < 0)
+			pthread_cond_broadcast(&pool->fp_cond);
+		pthread_mutex_unlock(&pool->fp_lock);
+	}
+
+	return NULL;
+}
+
+/* Number of threads to walk with, each may have a directory and a file
+ * open at the same time */
+static int find_threads(struct find_param *param)
+{
+	struct rlimit rlim;
+	int nr = param->threads;
+
+	if (nr > FIND_MAX_THREADS)
+		nr = FIND_MAX_THREADS;
+
+	if (getrlimit(RLIMIT_NOFILE, &rlim) == 0 &&
+	    rlim.rlim_cur != RLIM_INFINITY && nr > (rlim.rlim_cur - 16) / 2)
+		nr = (rlim.rlim_cur - 16) / 2;
+
+	return nr;
+}
+
+static int find_worker_init(struct find_worker *fw, struct find_pool *pool,
+			    int index, struct find_param *param)
+{
+	fw->fw_pool = pool;
+	fw->fw_index = index;
+	pthread_mutex_init(&fw->fw_lock, NULL);
+	CFS_INIT_LIST_HEAD(&fw->fw_dirs);
+
+	fw->fw_param = *param;
+	fw->fw_param.lmd = malloc(sizeof(lstat_t) + param->lumlen);
+	fw->fw_param.fp_lmv_md = malloc(lmv_user_md_size(param->fp_lmv_count,
+							 LMV_MAGIC_V1));
+	if (fw->fw_param.lmd == NULL || fw->fw_param.fp_lmv_md == NULL)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static void find_worker_fini(struct find_worker *fw, struct find_param *param)
+{
+	struct find_dir *fdir;
+
+	/* left over after an error */
+	while (!cfs_list_empty(&fw->fw_dirs)) {
+		fdir = cfs_list_entry(fw->fw_dirs.next, struct find_dir,
+				      fd_list);
+		cfs_list_del(&fdir->fd_list);
+		free(fdir);
+	}
+
+	free(fw->fw_param.lmd);
+	free(fw->fw_param.fp_lmv_md);
+	/* set up by the callbacks of this thread */
+	if (fw->fw_param.obdindexes != param->obdindexes)
+		free(fw->fw_param.obdindexes);
+	if (fw->fw_param.mdtindexes != param->mdtindexes)
+		free(fw->fw_param.mdtindexes);
+	pthread_mutex_destroy(&fw->fw_lock);
+}
+
+static int find_parallel(char *path, semantic_func_t sem_init,
+			 semantic_func_t sem_fini, struct find_param *param)
+{
+	struct find_pool pool;
+	int started = 0;
+	int nr = find_threads(param);
+	int ret = 0;
+	int i;
+
+	memset(&pool, 0, sizeof(pool));
+	pthread_mutex_init(&pool.fp_lock, NULL);
+	pthread_cond_init(&pool.fp_cond, NULL);
+	pool.fp_sem_init = sem_init;
+	pool.fp_sem_fini = sem_fini;
+
+	pool.fp_workers = calloc(nr, sizeof(*pool.fp_workers));
+	if (pool.fp_workers == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (pool.fp_nr = 0; pool.fp_nr < nr; pool.fp_nr++) {
+		ret = find_worker_init(&pool.fp_workers[pool.fp_nr], &pool,
+				       pool.fp_nr, param);
+		if (ret < 0) {
+			pool.fp_nr++;
+			goto out_workers;
+		}
+	}
+
+	ret = find_dir_push(&pool.fp_workers[0], path, param->depth, 1);
+	if (ret < 0)
+		goto out_workers;
+
+	for (started = 0; started < pool.fp_nr; started++) {
+		ret = pthread_create(&pool.fp_workers[started].fw_thread, NULL,
+				     find_worker_main,
+				     &pool.fp_workers[started]);
+		if (ret != 0) {
+			/* the threads started can do the whole walk */
+			if (started > 0) {
+				ret = 0;
+				break;
+			}
+			ret = -ret;
+			llapi_error(LLAPI_MSG_ERROR, ret,
+				    "cannot start threads to walk '%s'", path);
+			goto out_workers;
+		}
+	}
+
+	for (i = 0; i < started; i++)
+		pthread_join(pool.fp_workers[i].fw_thread, NULL);
+	ret = pool.fp_rc;
+
+out_workers:
+	for (i = 0; i < pool.fp_nr; i++)
+		find_worker_fini(&pool.fp_workers[i], param);
+	free(pool.fp_workers);
+out:
+	pthread_cond_destroy(&pool.fp_cond);
+	pthread_mutex_destroy(&pool.fp_lock);
+	return ret;
+}
+#endif /* HAVE_LIBPTHREAD */
+
 static int param_callback(char *path, semantic_func_t sem_init,
                           semantic_func_t sem_fini, struct find_param *param)
 {
@@ -1648,6 +2036,18 @@ static int param_callback(char *path, semantic_func_t sem_init,
                 goto out;
         param->depth = 0;
 
+#ifdef HAVE_LIBPTHREAD
+	if (param->threads > 1 && param->maxdepth > 0 &&
+	    !(param->get_lmv && !param->recursive)) {
+		struct stat st;
+
+		if (stat(buf, &st) == 0 && S_ISDIR(st.st_mode)) {
+			ret = find_parallel(buf, sem_init, sem_fini, param);
+			goto out;
+		}
+	}
+#endif
+
         ret = llapi_semantic_traverse(buf, PATH_MAX + 1, NULL, sem_init,
                                       sem_fini, param, NULL);
 out:
@@ -2976,9 +3376,10 @@ obd_matches:
         if (param->atime || param->ctime || param->mtime) {
                 int for_mds;
 
-                for_mds = lustre_fs ? (S_ISREG(st->st_mode) &&
-                                       param->lmd->lmd_lmm.lmm_stripe_count)
-                                    : 0;
+		/* lazy: take the MDS timestamps as they are */
+		for_mds = lustre_fs && !param->lazy ?
+			  (S_ISREG(st->st_mode) &&
+			   param->lmd->lmd_lmm.lmm_stripe_count) : 0;
                 decision = find_time_check(st, param, for_mds);
                 if (decision == -1)
                         goto decided;
@@ -2988,9 +3389,9 @@ obd_matches:
            The regular stat is almost of the same speed as some new
            'glimpse-size-ioctl'. */
 
-        if (param->check_size && S_ISREG(st->st_mode) &&
-            param->lmd->lmd_lmm.lmm_stripe_count)
-                decision = 0;
+	if (param->check_size && S_ISREG(st->st_mode) &&
+	    param->lmd->lmd_lmm.lmm_stripe_count && !param->lazy)
+		decision = 0;
 
         while (!decision) {
                 /* For regular files with the stripe the decision may have not
@@ -3041,13 +3442,10 @@ obd_matches:
                                           param->size_sign, param->exclude_size,
                                           param->size_units, 0);
 
-        if (decision != -1) {
-                llapi_printf(LLAPI_MSG_NORMAL, "%s", path);
-                if (param->zeroend)
-                        llapi_printf(LLAPI_MSG_NORMAL, "%c", '\0');
-                else
-                        llapi_printf(LLAPI_MSG_NORMAL, "\n");
-        }
+	/* a single call, not to mix paths printed by several threads */
+	if (decision != -1)
+		llapi_printf(LLAPI_MSG_NORMAL, "%s%c", path,
+			     param->zeroend ? '\0' : '\n');
 
 decided:
         /* Do not get down anymore? */
@@ -3226,8 +3624,12 @@ static int cb_getstripe(char *path, DIR *parent, DIR *d, void *data,
         }
 
 dump:
-        if (!(param->verbose & VERBOSE_MDTINDEX))
-                llapi_lov_dump_user_lmm(param, path, d ? 1 : 0);
+	if (!(param->verbose & VERBOSE_MDTINDEX)) {
+		/* keep the lines of a file together in a parallel walk */
+		flockfile(stdout);
+		llapi_lov_dump_user_lmm(param, path, d ? 1 : 0);
+		funlockfile(stdout);
+	}
 
 out:
         /* Do not get down anymore? */
@@ -48,6 +48,7 @@
 #include <stdarg.h>
 #include <ctype.h>
 #include <glob.h>
+#include <getopt.h>
 
 #ifndef __KERNEL__
 #include <liblustre.h>
@@ -497,6 +498,7 @@ struct param_opts {
 	unsigned int po_recursive:1;
 	unsigned int po_params2:1;
 	unsigned int po_delete:1;
+	unsigned int po_binary:1;
 };
 
 /* Param set to single log file, used by all clients and servers.
@@ -851,15 +853,23 @@ int jt_lcfg_listparam(int argc, char **argv)
 
 static int getparam_cmdline(int argc, char **argv, struct param_opts *popt)
 {
+	struct option long_opts[] = {
+		{ "binary",	no_argument,	NULL,	'b' },
+		{ 0,		0,		NULL,	0 }
+	};
         int ch;
 
         popt->po_show_path = 1;
         popt->po_only_path = 0;
         popt->po_show_type = 0;
         popt->po_recursive = 0;
+	popt->po_binary = 0;
 
-        while ((ch = getopt(argc, argv, "nNF")) != -1) {
+	while ((ch = getopt_long(argc, argv, "bnNF", long_opts, NULL)) != -1) {
                 switch (ch) {
+		case 'b':
+			popt->po_binary = 1;
+			break;
                 case 'N':
                         popt->po_only_path = 1;
                         break;
@@ -876,6 +886,147 @@ static int getparam_cmdline(int argc, char **argv, struct param_opts *popt)
         return optind;
 }
 
+static void snapshot_counter_display(struct lprocfs_snapshot_counter *lsc)
+{
+	printf("  %-25.*s "LPU64" samples [%.*s]", LPROCFS_SNAPSHOT_NAME_LEN,
+	       lsc->lsc_name, lsc->lsc_count, LPROCFS_SNAPSHOT_UNITS_LEN,
+	       lsc->lsc_units);
+	if (lsc->lsc_config & LPROCFS_CNTR_AVGMINMAX) {
+		printf(" "LPU64" "LPU64" "LPU64,
+		       lsc->lsc_min, lsc->lsc_max, lsc->lsc_sum);
+		if (lsc->lsc_config & LPROCFS_CNTR_STDDEV)
+			printf(" "LPU64, lsc->lsc_sumsquare);
+	}
+	printf("\n");
+}
+
+/* Decode a stats_snapshot file, see struct lprocfs_snapshot_header */
+static int snapshot_display(const char *path, char *valuename,
+			    char *buf, size_t len)
+{
+	struct lprocfs_snapshot_header *lsh = (void *)buf;
+	struct lprocfs_snapshot_set *set;
+	struct lprocfs_snapshot_counter *lsc;
+	char *end = buf + len;
+	char *ptr;
+	int jobs = 0;
+	int i;
+	int j;
+
+	if (len < sizeof(*lsh) || lsh->lsh_magic != LPROCFS_SNAPSHOT_MAGIC) {
+		fprintf(stderr, "error: get_param: '%s' is not a stats "
+			"snapshot\n", path);
+		return -EINVAL;
+	}
+	if (lsh->lsh_version != LPROCFS_SNAPSHOT_VERSION) {
+		fprintf(stderr, "error: get_param: '%s': unsupported snapshot "
+			"version %u\n", path, lsh->lsh_version);
+		return -EPROTO;
+	}
+	if (lsh->lsh_size != len) {
+		fprintf(stderr, "error: get_param: '%s': snapshot of "LPU64
+			" bytes, read %zu\n", path, lsh->lsh_size, len);
+		return -EINVAL;
+	}
+
+	if (valuename != NULL)
+		printf("%s=\n", valuename);
+	printf("%-25s "LPU64".%06u secs.usecs\n", "snapshot_time",
+	       lsh->lsh_time_sec, lsh->lsh_time_usec);
+
+	ptr = (char *)(lsh + 1);
+	for (i = 0; i < lsh->lsh_sets; i++) {
+		set = (struct lprocfs_snapshot_set *)ptr;
+		lsc = (struct lprocfs_snapshot_counter *)(set + 1);
+		if ((char *)lsc > end ||
+		    set->lss_counters > (end - (char *)lsc) / sizeof(*lsc)) {
+			fprintf(stderr, "error: get_param: '%s': truncated "
+				"set %d\n", path, i);
+			return -EINVAL;
+		}
+
+		if (set->lss_type == LPROCFS_SNAP_JOB) {
+			if (!jobs++)
+				printf("job_stats:\n");
+			printf("- %-16s %.*s\n", "job_id:",
+			       LPROCFS_SNAPSHOT_NAME_LEN, set->lss_name);
+			printf("  %-16s "LPU64"\n", "snapshot_time:",
+			       set->lss_timestamp);
+		} else {
+			printf("%.*s:\n", LPROCFS_SNAPSHOT_NAME_LEN,
+			       set->lss_name);
+		}
+
+		for (j = 0; j < set->lss_counters; j++)
+			snapshot_counter_display(&lsc[j]);
+		ptr = (char *)(lsc + set->lss_counters);
+	}
+
+	return 0;
+}
+
+/*
+ * Read and decode the stats_snapshot file of a device, given either the
+ * file itself or the directory of the device.
+ */
+static int getparam_binary(struct param_opts *popt, char *path)
+{
+	char filename[PATH_MAX + 1];
+	char *valuename = NULL;
+	struct stat st;
+	size_t size = 0;
+	size_t len = 0;
+	char *buf = NULL;
+	char *tmp;
+	int fd;
+	int rc;
+
+	if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+		rc = snprintf(filename, sizeof(filename), "%s/stats_snapshot",
+			      path);
+	else
+		rc = snprintf(filename, sizeof(filename), "%s", path);
+	if (rc >= sizeof(filename))
+		return -E2BIG;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		rc = -errno;
+		fprintf(stderr, "error: get_param: opening('%s') failed: %s\n",
+			filename, strerror(errno));
+		return rc;
+	}
+
+	do {
+		if (len == size) {
+			size = size == 0 ? PAGE_CACHE_SIZE : size * 2;
+			tmp = realloc(buf, size);
+			if (tmp == NULL) {
+				rc = -ENOMEM;
+				goto out;
+			}
+			buf = tmp;
+		}
+
+		rc = read(fd, buf + len, size - len);
+		if (rc < 0) {
+			rc = -errno;
+			fprintf(stderr, "error: get_param: read('%s') failed: "
+				"%s\n", filename, strerror(errno));
+			goto out;
+		}
+		len += rc;
+	} while (rc > 0);
+
+	if (popt->po_show_path)
+		valuename = display_name(filename, 0);
+	rc = snapshot_display(path, valuename, buf, len);
+out:
+	free(buf);
+	close(fd);
+	return rc;
+}
+
 static int getparam_display(struct param_opts *popt, char *pattern)
 {
         int rc;
@@ -892,6 +1043,13 @@ static int getparam_display(struct param_opts *popt, char *pattern)
                 return -ESRCH;
         }
 
+	if (popt->po_binary) {
+		for (i = 0; i < glob_info.gl_pathc; i++)
+			rc = getparam_binary(popt, glob_info.gl_pathv[i]);
+		globfree(&glob_info);
+		return rc;
+	}
+
 	buf = malloc(PAGE_CACHE_SIZE);
 	for (i = 0; i  < glob_info.gl_pathc; i++) {
 		char *valuename = NULL;
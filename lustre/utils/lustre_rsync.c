@@ -119,6 +119,7 @@
 #include <errno.h>
 #include <limits.h>
 #include <utime.h>
+#include <pthread.h>
 #include <sys/xattr.h>
 
 #include <libcfs/libcfsutil.h>
@@ -129,6 +130,11 @@
 #define REPLICATE_STATUS_VER 1
 #define CLEAR_INTERVAL 100
 #define DEFAULT_RSYNC_THRESHOLD 0xA00000 /* 10 MB */
+#define LR_MAX_THREADS 256
+#define LR_WINDOW 256	/* records being replicated in pipelined mode */
+#define LR_PREFETCH 256	/* records read ahead of the window */
+#define LR_BATCH 32	/* records queued by the reader at once */
+#define LR_STATS_INTERVAL 10 /* seconds between stats in verbose mode */
 
 #define TYPE_STR_LEN 16
 
@@ -188,7 +194,9 @@ int noxattr;    /* Flag to turn off replicating xattrs */
 int noclear;    /* Flag to turn off clearing changelogs */
 int debug;      /* Flag to turn debugging information on and off */
 int verbose;    /* Verbose output */
-long long rec_count; /* No of changelog records that were processed */
+long long rec_count; /* No of changelog records that were processed; updated
+		      * under lr_pipe.lp_lock by the reader thread when
+		      * replicating with several threads */
 int errors;
 int dryrun;
 int use_rsync;  /* Flag to turn on use of rsync to copy data */
@@ -197,9 +205,17 @@ int quit;       /* Flag to stop processing the changelog; set on the
                    receipt of a signal */
 int abort_on_err = 0;
 
+int lr_threads; /* Replicate records in parallel with that many threads */
+long long rec_replicated; /* No of changelog records that were replicated */
+long long rec_merged; /* No of records merged with an earlier one */
+time_t lr_start_time;
+
 char rsync[PATH_MAX];
 char rsync_ver[PATH_MAX];
 struct lr_parent_child_list *parents;
+/* Protects the parents list and the errors count, when records are
+ * replicated in parallel */
+pthread_mutex_t pc_lock = PTHREAD_MUTEX_INITIALIZER;
 
 FILE *debug_log;
 
@@ -219,6 +235,7 @@ struct option long_opts[] = {
         {"rsync-threshold", required_argument, 0, 'y'},
         {"start-recno", required_argument, 0, 'n'},
         {"abort-on-err",no_argument,       0, 'a'},
+	{"threads",	required_argument, 0, 'P'},
         {"debug",       required_argument, 0, 'd'},
 	{"debuglog",	required_argument, 0, 'D'},
 	{0, 0, 0, 0}
@@ -235,6 +252,8 @@ void lr_usage()
                 "options:\n"
                 "\t--xattr <yes|no> replicate EAs\n"
                 "\t--abort-on-err   abort at first err\n"
+		"\t--threads <n>    replicate independent records in "
+		"parallel\n"
                 "\t--verbose\n"
                 "\t--dry-run        don't write anything\n");
 }
@@ -499,7 +518,9 @@ int lr_copy_xattr(struct lr_info *info)
                                         fprintf(stderr, "Error replicating "
                                                 " xattr for %s: %d\n",
                                                 info->dest, errno);
-                                        errors++;
+					pthread_mutex_lock(&pc_lock);
+					errors++;
+					pthread_mutex_unlock(&pc_lock);
                                 }
                                 rc = 0;
                         }
@@ -643,9 +664,11 @@ int lr_add_pc(const char *pfid, const char *tfid, const char *name)
 		goto out_err;
 	strncpy(p->pc_log.pcl_name, name, sizeof(p->pc_log.pcl_name));
 
-        p->pc_next = parents;
-        parents = p;
-        return 0;
+	pthread_mutex_lock(&pc_lock);
+	p->pc_next = parents;
+	parents = p;
+	pthread_mutex_unlock(&pc_lock);
+	return 0;
 
 out_err:
 	free(p);
@@ -696,6 +719,7 @@ int lr_remove_pc(const char *pfid, const char *tfid)
 {
         struct lr_parent_child_list *curr, *prev;
 
+	pthread_mutex_lock(&pc_lock);
         for (prev = curr = parents; curr; prev = curr, curr = curr->pc_next) {
                 if (strcmp(curr->pc_log.pcl_pfid, pfid) == 0 &&
                     strcmp(curr->pc_log.pcl_tfid, tfid) == 0) {
@@ -707,6 +731,7 @@ int lr_remove_pc(const char *pfid, const char *tfid)
                         break;
                 }
         }
+	pthread_mutex_unlock(&pc_lock);
         return 0;
 }
 
@@ -960,8 +985,11 @@ int lr_move(struct lr_info *info)
 
 		if (special_src) {
 			rc1 = lr_remove_pc(info->spfid, info->sfid);
-			if (!special_dest)
+			if (!special_dest) {
+				pthread_mutex_lock(&pc_lock);
 				lr_cascade_move(info->sfid, info->dest, info);
+				pthread_mutex_unlock(&pc_lock);
+			}
                 }
 		if (special_dest)
 			rc1 = lr_add_pc(info->pfid, info->sfid, info->name);
@@ -1143,7 +1171,6 @@ int lr_parse_line(void *priv, struct lr_info *info)
 
         llapi_changelog_free(&rec);
 
-        rec_count++;
         return 0;
 }
 
@@ -1207,6 +1234,7 @@ int lr_write_log()
                 return -1;
         }
 
+	pthread_mutex_lock(&pc_lock);
         for (curr = parents; curr; curr = curr->pc_next) {
                 size = write(fd, &curr->pc_log, sizeof(curr->pc_log));
                 if (size != sizeof(curr->pc_log)) {
@@ -1216,6 +1244,7 @@ int lr_write_log()
                         break;
                 }
         }
+	pthread_mutex_unlock(&pc_lock);
         close(fd);
         return rc;
 }
@@ -1384,6 +1413,19 @@ int lr_locate_rsync()
 
 }
 
+/* Print the replication rate, and how many records have been consumed
+   from the changelog but not replicated yet */
+void lr_print_stats(long long consumed)
+{
+	time_t elapsed = time(NULL) - lr_start_time;
+
+	if (elapsed < 1)
+		elapsed = 1;
+	printf("Records replicated: %lld (%lld merged), %lld records/s, "
+	       "lag %lld records\n", rec_replicated, rec_merged,
+	       rec_replicated / (long long)elapsed, consumed - rec_replicated);
+}
+
 /* Print the replication parameters */
 void lr_print_status(struct lr_info *info)
 {
@@ -1407,6 +1449,10 @@ void lr_print_status(struct lr_info *info)
                 printf("Clear changelog after use: no\n");
         if (use_rsync)
                 printf("Using rsync: %s (%s)\n", rsync, rsync_ver);
+	if (lr_threads > 1)
+		printf("Replication threads: %d\n", lr_threads);
+	if (rec_count > 0)
+		lr_print_stats(rec_count);
 }
 
 void lr_print_failure(struct lr_info *info, int rc)
@@ -1417,6 +1463,513 @@ void lr_print_failure(struct lr_info *info, int rc)
                 info->pfid, info->name);
 }
 
+/* Read the next changelog record into info. Old changelogs store a rename
+   in two records, which are merged into info using ext. Returns the number
+   of changelog records consumed, or -1. */
+int lr_read_rec(void *priv, struct lr_info *info, struct lr_info *ext)
+{
+	if (lr_parse_line(priv, info) != 0)
+		return -1;
+
+	if (info->type == CL_RENAME && !info->is_extended) {
+		/* Newer rename operations extends changelog to store
+		 * source file information, but old changelog has
+		 * another record.
+		 */
+		if (lr_parse_line(priv, ext) != 0)
+			return -1;
+		memcpy(info->sfid, info->tfid, sizeof(info->sfid));
+		memcpy(info->spfid, info->pfid, sizeof(info->spfid));
+		memcpy(info->tfid, ext->tfid, sizeof(info->tfid));
+		memcpy(info->pfid, ext->pfid, sizeof(info->pfid));
+		strncpy(info->sname, info->name, sizeof(info->sname));
+		strncpy(info->name, ext->name, sizeof(info->name));
+		info->is_extended = 1;
+		return 2;
+	}
+
+	return 1;
+}
+
+/* Replicate one changelog record */
+int lr_process(struct lr_info *info)
+{
+	int rc = 0;
+
+	DEBUG_ENTRY(info);
+
+	switch (info->type) {
+	case CL_CREATE:
+	case CL_MKDIR:
+	case CL_MKNOD:
+	case CL_SOFTLINK:
+		rc = lr_create(info);
+		break;
+	case CL_RMDIR:
+	case CL_UNLINK:
+		rc = lr_remove(info);
+		break;
+	case CL_RENAME:
+		rc = lr_move(info);
+		break;
+	case CL_HARDLINK:
+		rc = lr_link(info);
+		break;
+	case CL_TRUNC:
+	case CL_SETATTR:
+		rc = lr_setattr(info);
+		break;
+	case CL_XATTR:
+		rc = lr_setxattr(info);
+		break;
+	case CL_CLOSE:
+	case CL_EXT:
+	case CL_OPEN:
+	case CL_LAYOUT:
+	case CL_MARK:
+		/* Nothing needs to be done for these entries */
+		/* fallthrough */
+	default:
+		break;
+	}
+
+	DEBUG_EXIT(info, rc);
+
+	return rc;
+}
+
+/* Pipelined replication.
+
+   A reader thread prefetches changelog records in batches. Records then
+   enter a window, in changelog order, and each one waits for the earlier
+   records of the window it depends on: those sharing a FID with it, other
+   than two entries of the same directory. Renames and hard links, which
+   resolve paths of other objects, wait for all earlier records and are
+   waited for by all later ones. Records without dependencies are
+   replicated in parallel by the worker threads.
+
+   A setattr, truncate or time update of a FID that is still queued behind
+   another one for the same FID is merged with it, as replicating a file
+   attributes copies them from the source in their current state.
+
+   The changelog is cleared, and the statuslog written, up to the oldest
+   record not replicated yet. */
+
+enum lr_job_state {
+	LR_JOB_WAITING,	/* waiting for earlier records */
+	LR_JOB_READY,	/* queued for a worker */
+	LR_JOB_RUNNING,
+	LR_JOB_DONE,
+	LR_JOB_MERGED,	/* replicated along with an earlier record */
+};
+
+struct lr_job {
+	cfs_list_t lj_list;		/* on the prefetch list or window */
+	cfs_list_t lj_ready;		/* on the ready list */
+	enum lr_job_state lj_state;
+	int lj_deps;			/* earlier jobs not done yet */
+	struct lr_info lj_info;
+};
+
+struct lr_pipe {
+	pthread_mutex_t lp_lock;
+	pthread_cond_t lp_read_cond;	/* reader waits for prefetch room */
+	pthread_cond_t lp_work_cond;	/* workers wait for ready jobs */
+	pthread_cond_t lp_main_cond;	/* main thread waits for progress */
+	cfs_list_t lp_prefetch;		/* records read, not in window */
+	cfs_list_t lp_window;		/* records being replicated */
+	cfs_list_t lp_ready;		/* jobs ready to be replicated */
+	int lp_nr_prefetch;
+	int lp_nr_window;
+	int lp_running;			/* jobs being replicated */
+	long long lp_read;		/* jobs read from the changelog */
+	int lp_reader_done;
+	int lp_stop;			/* stop the workers */
+	int lp_abort;			/* stop replicating new records */
+	void *lp_changelog;
+	char lp_zero_fid[LR_FID_STR_LEN];
+};
+
+static struct lr_pipe lr_pipe;
+
+static void lr_job_free(struct lr_job *job)
+{
+	free(job->lj_info.buf);
+	free(job->lj_info.xlist);
+	free(job->lj_info.xvalue);
+	free(job);
+}
+
+static int lr_job_barrier(struct lr_job *job)
+{
+	return job->lj_info.type == CL_RENAME ||
+	       job->lj_info.type == CL_HARDLINK;
+}
+
+/* Records only updating the attributes of tfid */
+static int lr_job_attr(struct lr_job *job)
+{
+	switch (job->lj_info.type) {
+	case CL_SETATTR:
+	case CL_TRUNC:
+	case CL_MTIME:
+	case CL_CTIME:
+	case CL_ATIME:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static int lr_fid_match(const char *fid1, const char *fid2)
+{
+	return fid1[0] != '\0' && strcmp(fid1, lr_pipe.lp_zero_fid) != 0 &&
+	       strcmp(fid1, fid2) == 0;
+}
+
+/* Whether one of the two jobs must be replicated after the other */
+static int lr_job_conflict(struct lr_job *job1, struct lr_job *job2)
+{
+	struct lr_info *i1 = &job1->lj_info;
+	struct lr_info *i2 = &job2->lj_info;
+	const char *obj1[2] = { i1->tfid, i1->sfid };
+	const char *obj2[2] = { i2->tfid, i2->sfid };
+	const char *par1[2] = { i1->pfid, i1->spfid };
+	const char *par2[2] = { i2->pfid, i2->spfid };
+	const char *name1[2] = { i1->name, i1->sname };
+	const char *name2[2] = { i2->name, i2->sname };
+	int i;
+	int j;
+
+	if (lr_job_barrier(job1) || lr_job_barrier(job2))
+		return 1;
+
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < 2; j++) {
+			if (lr_fid_match(obj1[i], obj2[j]) ||
+			    lr_fid_match(obj1[i], par2[j]) ||
+			    lr_fid_match(par1[i], obj2[j]))
+				return 1;
+			/* entries of the same directory only conflict if they
+			 * have the same name */
+			if (lr_fid_match(par1[i], par2[j]) &&
+			    strcmp(name1[i], name2[j]) == 0)
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void lr_job_ready(struct lr_job *job)
+{
+	job->lj_state = LR_JOB_READY;
+	cfs_list_add_tail(&job->lj_ready, &lr_pipe.lp_ready);
+	pthread_cond_signal(&lr_pipe.lp_work_cond);
+}
+
+/* Move a job into the window, after the jobs it depends on. Called with
+   lp_lock held. */
+static void lr_job_enqueue(struct lr_job *job)
+{
+	struct lr_job *prev;
+	int found = 0;
+
+	/* the latest job this one conflicts with comes first */
+	cfs_list_for_each_entry_reverse(prev, &lr_pipe.lp_window, lj_list) {
+		if (prev->lj_state == LR_JOB_DONE ||
+		    prev->lj_state == LR_JOB_MERGED ||
+		    !lr_job_conflict(prev, job))
+			continue;
+
+		if (!found && lr_job_attr(job) && lr_job_attr(prev) &&
+		    prev->lj_state != LR_JOB_RUNNING &&
+		    strcmp(prev->lj_info.tfid, job->lj_info.tfid) == 0) {
+			/* time updates alone need no replication */
+			if (job->lj_info.type == CL_SETATTR ||
+			    job->lj_info.type == CL_TRUNC)
+				prev->lj_info.type = CL_SETATTR;
+			job->lj_state = LR_JOB_MERGED;
+			rec_merged++;
+			break;
+		}
+		found = 1;
+		job->lj_deps++;
+	}
+
+	cfs_list_add_tail(&job->lj_list, &lr_pipe.lp_window);
+	lr_pipe.lp_nr_window++;
+
+	if (job->lj_state == LR_JOB_WAITING && job->lj_deps == 0)
+		lr_job_ready(job);
+}
+
+/* Release the jobs waiting for this one. They are the later jobs of the
+   window it conflicts with, as no job is merged after waiting for another.
+   Called with lp_lock held. */
+static void lr_job_done(struct lr_job *job)
+{
+	struct lr_job *next = job;
+
+	job->lj_state = LR_JOB_DONE;
+	cfs_list_for_each_entry_continue(next, &lr_pipe.lp_window, lj_list) {
+		if (next->lj_state == LR_JOB_WAITING &&
+		    lr_job_conflict(job, next) && --next->lj_deps == 0)
+			lr_job_ready(next);
+	}
+}
+
+static void *lr_reader(void *arg)
+{
+	struct lr_info *ext;
+	struct lr_job *job;
+	cfs_list_t batch;
+	long long records;
+	int nr;
+	int rc;
+	int eof = 0;
+
+	ext = calloc(1, sizeof(*ext));
+	if (ext == NULL)
+		eof = 1;
+
+	while (!eof) {
+		CFS_INIT_LIST_HEAD(&batch);
+		records = 0;
+		for (nr = 0; nr < LR_BATCH && !quit; nr++) {
+			job = calloc(1, sizeof(*job));
+			if (job == NULL) {
+				fprintf(stderr, "Error: cannot allocate changelog "
+					"record\n");
+				eof = 1;
+				break;
+			}
+			rc = lr_read_rec(lr_pipe.lp_changelog, &job->lj_info,
+					 ext);
+			if (rc < 0) {
+				free(job);
+				eof = 1;
+				break;
+			}
+			records += rc;
+			cfs_list_add_tail(&job->lj_list, &batch);
+		}
+		if (quit)
+			eof = 1;
+
+		pthread_mutex_lock(&lr_pipe.lp_lock);
+		while (lr_pipe.lp_nr_prefetch >= LR_PREFETCH &&
+		       !lr_pipe.lp_abort)
+			pthread_cond_wait(&lr_pipe.lp_read_cond,
+					  &lr_pipe.lp_lock);
+		cfs_list_splice_tail(&batch, &lr_pipe.lp_prefetch);
+		lr_pipe.lp_nr_prefetch += nr;
+		lr_pipe.lp_read += nr;
+		rec_count += records;
+		if (lr_pipe.lp_abort)
+			eof = 1;
+		if (eof)
+			lr_pipe.lp_reader_done = 1;
+		pthread_cond_signal(&lr_pipe.lp_main_cond);
+		pthread_mutex_unlock(&lr_pipe.lp_lock);
+	}
+
+	free(ext);
+	return NULL;
+}
+
+static void *lr_worker(void *arg)
+{
+	struct lr_job *job;
+	int rc;
+
+	pthread_mutex_lock(&lr_pipe.lp_lock);
+	while (1) {
+		/* after an error, with --abort-on-err, let the jobs running
+		 * complete but do not start new ones */
+		while ((cfs_list_empty(&lr_pipe.lp_ready) ||
+			lr_pipe.lp_abort) && !lr_pipe.lp_stop)
+			pthread_cond_wait(&lr_pipe.lp_work_cond,
+					  &lr_pipe.lp_lock);
+		if (lr_pipe.lp_stop)
+			break;
+
+		job = cfs_list_entry(lr_pipe.lp_ready.next, struct lr_job,
+				     lj_ready);
+		cfs_list_del_init(&job->lj_ready);
+		job->lj_state = LR_JOB_RUNNING;
+		lr_pipe.lp_running++;
+		pthread_mutex_unlock(&lr_pipe.lp_lock);
+
+		rc = lr_process(&job->lj_info);
+
+		pthread_mutex_lock(&lr_pipe.lp_lock);
+		if (rc && rc != -ENOENT) {
+			lr_print_failure(&job->lj_info, rc);
+			pthread_mutex_lock(&pc_lock);
+			errors++;
+			pthread_mutex_unlock(&pc_lock);
+			if (abort_on_err)
+				lr_pipe.lp_abort = 1;
+		}
+
+		lr_job_done(job);
+		lr_pipe.lp_running--;
+		pthread_cond_signal(&lr_pipe.lp_main_cond);
+	}
+	pthread_mutex_unlock(&lr_pipe.lp_lock);
+
+	return NULL;
+}
+
+/* Replicate the records of an open changelog with lr_threads workers.
+   On return, info holds the last record committed, or a zero recno if no
+   record was. */
+int lr_replicate_pipelined(void *changelog_priv, struct lr_info *info)
+{
+	lustre_fid zero_fid = { 0 };
+	pthread_t reader;
+	pthread_t *workers;
+	struct lr_job *job;
+	struct lr_job *committed = NULL;
+	time_t last_stats = time(NULL);
+	int reader_started = 0;
+	int nr_workers;
+	int rc = 0;
+
+	memset(&lr_pipe, 0, sizeof(lr_pipe));
+	pthread_mutex_init(&lr_pipe.lp_lock, NULL);
+	pthread_cond_init(&lr_pipe.lp_read_cond, NULL);
+	pthread_cond_init(&lr_pipe.lp_work_cond, NULL);
+	pthread_cond_init(&lr_pipe.lp_main_cond, NULL);
+	CFS_INIT_LIST_HEAD(&lr_pipe.lp_prefetch);
+	CFS_INIT_LIST_HEAD(&lr_pipe.lp_window);
+	CFS_INIT_LIST_HEAD(&lr_pipe.lp_ready);
+	lr_pipe.lp_changelog = changelog_priv;
+	snprintf(lr_pipe.lp_zero_fid, sizeof(lr_pipe.lp_zero_fid), DFID,
+		 PFID(&zero_fid));
+
+	workers = calloc(lr_threads, sizeof(*workers));
+	if (workers == NULL)
+		return -ENOMEM;
+
+	for (nr_workers = 0; nr_workers < lr_threads; nr_workers++) {
+		rc = pthread_create(&workers[nr_workers], NULL, lr_worker,
+				    NULL);
+		if (rc != 0)
+			break;
+	}
+	if (nr_workers == 0) {
+		fprintf(stderr, "Error: cannot start replication threads: "
+			"%s\n", strerror(rc));
+		free(workers);
+		return -rc;
+	}
+
+	rc = pthread_create(&reader, NULL, lr_reader, NULL);
+	if (rc == 0) {
+		reader_started = 1;
+	} else {
+		fprintf(stderr, "Error: cannot start changelog reader: %s\n",
+			strerror(rc));
+		rc = -rc;
+		lr_pipe.lp_reader_done = 1;
+	}
+
+	pthread_mutex_lock(&lr_pipe.lp_lock);
+	while (1) {
+		int advanced = 0;
+
+		/* Commit the records replicated so far in changelog order */
+		while (!cfs_list_empty(&lr_pipe.lp_window)) {
+			job = cfs_list_entry(lr_pipe.lp_window.next,
+					     struct lr_job, lj_list);
+			if (job->lj_state != LR_JOB_DONE &&
+			    job->lj_state != LR_JOB_MERGED)
+				break;
+			cfs_list_del(&job->lj_list);
+			lr_pipe.lp_nr_window--;
+			rec_replicated++;
+			if (committed != NULL)
+				lr_job_free(committed);
+			committed = job;
+			advanced = 1;
+		}
+
+		if (advanced) {
+			/* lr_clear_cl() only uses the record number and
+			 * type, and may write the statuslog. */
+			info->recno = committed->lj_info.recno;
+			info->type = committed->lj_info.type;
+			pthread_mutex_unlock(&lr_pipe.lp_lock);
+			lr_clear_cl(info, 0);
+			pthread_mutex_lock(&lr_pipe.lp_lock);
+		}
+
+		if (quit)
+			lr_pipe.lp_abort = 1;
+
+		/* Move prefetched records into the window */
+		while (!lr_pipe.lp_abort &&
+		       lr_pipe.lp_nr_window < LR_WINDOW &&
+		       !cfs_list_empty(&lr_pipe.lp_prefetch)) {
+			job = cfs_list_entry(lr_pipe.lp_prefetch.next,
+					     struct lr_job, lj_list);
+			cfs_list_del(&job->lj_list);
+			lr_pipe.lp_nr_prefetch--;
+			pthread_cond_signal(&lr_pipe.lp_read_cond);
+
+			lr_job_enqueue(job);
+		}
+
+		if (verbose && time(NULL) >= last_stats + LR_STATS_INTERVAL) {
+			last_stats = time(NULL);
+			lr_print_stats(lr_pipe.lp_read);
+		}
+
+		if (lr_pipe.lp_abort ? lr_pipe.lp_running == 0 :
+		    cfs_list_empty(&lr_pipe.lp_window) &&
+		    lr_pipe.lp_reader_done &&
+		    cfs_list_empty(&lr_pipe.lp_prefetch))
+			break;
+
+		pthread_cond_wait(&lr_pipe.lp_main_cond, &lr_pipe.lp_lock);
+	}
+
+	/* wake up the reader if waiting for room, and the workers */
+	lr_pipe.lp_abort = 1;
+	lr_pipe.lp_stop = 1;
+	pthread_cond_broadcast(&lr_pipe.lp_read_cond);
+	pthread_cond_broadcast(&lr_pipe.lp_work_cond);
+	pthread_mutex_unlock(&lr_pipe.lp_lock);
+
+	while (nr_workers > 0)
+		pthread_join(workers[--nr_workers], NULL);
+	free(workers);
+
+	if (reader_started)
+		pthread_join(reader, NULL);
+
+	/* records read but left unreplicated on abort */
+	cfs_list_splice_tail(&lr_pipe.lp_prefetch, &lr_pipe.lp_window);
+	while (!cfs_list_empty(&lr_pipe.lp_window)) {
+		job = cfs_list_entry(lr_pipe.lp_window.next, struct lr_job,
+				     lj_list);
+		cfs_list_del(&job->lj_list);
+		lr_job_free(job);
+	}
+
+	if (committed != NULL)
+		lr_job_free(committed);
+
+	pthread_mutex_destroy(&lr_pipe.lp_lock);
+	pthread_cond_destroy(&lr_pipe.lp_read_cond);
+	pthread_cond_destroy(&lr_pipe.lp_work_cond);
+	pthread_cond_destroy(&lr_pipe.lp_main_cond);
+
+	return rc;
+}
+
 /* Replicate filesystem operations from src_path to target_path */
 int lr_replicate()
 {
@@ -1426,6 +1979,7 @@ int lr_replicate()
         time_t start;
         int xattr_not_supp;
         int i;
+	int nr;
         int rc;
 
         start = time(NULL);
@@ -1482,70 +2036,28 @@ int lr_replicate()
 		goto out;
         }
 
-        while (!quit && lr_parse_line(changelog_priv, info) == 0) {
-                rc = 0;
-		if (info->type == CL_RENAME && !info->is_extended) {
-			/* Newer rename operations extends changelog to store
-			 * source file information, but old changelog has
-			 * another record.
-			 */
-			if (lr_parse_line(changelog_priv, ext) != 0)
-				break;
-			memcpy(info->sfid, info->tfid, sizeof(info->sfid));
-			memcpy(info->spfid, info->pfid, sizeof(info->spfid));
-			memcpy(info->tfid, ext->tfid, sizeof(info->tfid));
-			memcpy(info->pfid, ext->pfid, sizeof(info->pfid));
-			strncpy(info->sname, info->name, sizeof(info->sname));
-			strncpy(info->name, ext->name, sizeof(info->name));
-			info->is_extended = 1;
-		}
+	lr_start_time = time(NULL);
+
+	if (lr_threads > 1 && !dryrun) {
+		rc = lr_replicate_pipelined(changelog_priv, info);
+		if (rc < 0)
+			errors++;
+		goto fini;
+	}
 
+	while (!quit && (nr = lr_read_rec(changelog_priv, info, ext)) > 0) {
+		rec_count += nr;
                 if (dryrun)
                         continue;
 
-		DEBUG_ENTRY(info);
-
-                switch(info->type) {
-                case CL_CREATE:
-                case CL_MKDIR:
-                case CL_MKNOD:
-                case CL_SOFTLINK:
-                        rc = lr_create(info);
-                        break;
-                case CL_RMDIR:
-                case CL_UNLINK:
-                        rc = lr_remove(info);
-                        break;
-                case CL_RENAME:
-			rc = lr_move(info);
-                        break;
-                case CL_HARDLINK:
-                        rc = lr_link(info);
-                        break;
-                case CL_TRUNC:
-                case CL_SETATTR:
-                        rc = lr_setattr(info);
-                        break;
-                case CL_XATTR:
-                        rc = lr_setxattr(info);
-                        break;
-		case CL_CLOSE:
-		case CL_EXT:
-		case CL_OPEN:
-		case CL_LAYOUT:
-		case CL_MARK:
-			/* Nothing needs to be done for these entries */
-			/* fallthrough */
-		default:
-			break;
-		}
-		DEBUG_EXIT(info, rc);
+		rc = lr_process(info);
                 if (rc && rc != -ENOENT) {
                         lr_print_failure(info, rc);
                         errors++;
                         if (abort_on_err)
                                 break;
                 }
+		rec_replicated++;
                 lr_clear_cl(info, 0);
                 if (debug) {
                         bzero(info, sizeof(struct lr_info));
@@ -1553,17 +2065,21 @@ int lr_replicate()
                 }
         }
 
+fini:
         llapi_changelog_fini(&changelog_priv);
 
         if (errors || verbose)
                 printf("Errors: %d\n", errors);
 
-        /* Clear changelog records used so far */
-        lr_clear_cl(info, 1);
+	/* Clear changelog records used so far. Changelog records start at 1,
+	 * and clearing up to 0 would purge the whole changelog */
+	if (info->recno != 0)
+		lr_clear_cl(info, 1);
 
         if (verbose) {
                 printf("lustre_rsync took %ld seconds\n", time(NULL) - start);
                 printf("Changelog records consumed: %lld\n", rec_count);
+		lr_print_stats(rec_count);
         }
 
 	rc = 0;
@@ -1594,7 +2110,7 @@ int main(int argc, char *argv[])
         if ((rc = lr_init_status()) != 0)
                 return rc;
 
-	while ((rc = getopt_long(argc, argv, "as:t:m:u:l:vx:zc:ry:n:d:D:",
+	while ((rc = getopt_long(argc, argv, "as:t:m:u:l:vx:zc:ry:n:d:D:P:",
 				 long_opts, NULL)) >= 0) {
                 switch (rc) {
                 case 'a':
@@ -1685,6 +2201,15 @@ int main(int argc, char *argv[])
                         if (debug < 0 || debug > 2)
                                 debug = 0;
                         break;
+		case 'P':
+			lr_threads = atoi(optarg);
+			if (lr_threads < 1 || lr_threads > LR_MAX_THREADS) {
+				printf("Invalid parameter %s. Specify "
+				       "--threads between 1 and %d\n", optarg,
+				       LR_MAX_THREADS);
+				return -1;
+			}
+			break;
 		case 'D':
 			/* Undocumented option debug log file */
 			debug_log = fopen(optarg, "a");
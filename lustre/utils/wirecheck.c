@@ -524,6 +524,7 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT_PINGLESS);
 	CHECK_DEFINE_64X(OBD_CONNECT_FLOCK_DEAD);
 	CHECK_DEFINE_64X(OBD_CONNECT_OPEN_BY_FID);
+	CHECK_DEFINE_64X(OBD_CONNECT_QUOTA_BATCH);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);
@@ -2299,6 +2300,7 @@ main(int argc, char **argv)
 
 	CHECK_VALUE(QUOTA_DQACQ);
 	CHECK_VALUE(QUOTA_DQREL);
+	CHECK_VALUE(QUOTA_DQACQ_BATCH);
 	CHECK_VALUE(QUOTA_LAST_OPC);
 
 	CHECK_VALUE(MGS_CONNECT);
@@ -373,7 +373,9 @@ void lustre_assert_wire_constants(void)
 		 (long long)QUOTA_DQACQ);
 	LASSERTF(QUOTA_DQREL == 602, "found %lld\n",
 		 (long long)QUOTA_DQREL);
-	LASSERTF(QUOTA_LAST_OPC == 603, "found %lld\n",
+	LASSERTF(QUOTA_DQACQ_BATCH == 603, "found %lld\n",
+		 (long long)QUOTA_DQACQ_BATCH);
+	LASSERTF(QUOTA_LAST_OPC == 604, "found %lld\n",
 		 (long long)QUOTA_LAST_OPC);
 	LASSERTF(MGS_CONNECT == 250, "found %lld\n",
 		 (long long)MGS_CONNECT);
@@ -1173,6 +1175,8 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT_FLOCK_DEAD);
 	LASSERTF(OBD_CONNECT_OPEN_BY_FID == 0x20000000000000ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT_OPEN_BY_FID);
+	LASSERTF(OBD_CONNECT_QUOTA_BATCH == 0x40000000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT_QUOTA_BATCH);
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32);
 	LASSERTF(OBD_CKSUM_ADLER == 0x00000002UL, "found 0x%.8xUL\n",